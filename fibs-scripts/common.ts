@@ -16,18 +16,21 @@ export function embed(dir: string, outHeader: string, files: string[]): TargetJo
 
 export type ShdcOptions = {
     name: string,
+    src?: string,
     defs?: string[]
     mod?: string,
     refl?: boolean
 };
 
 export function shdc(opts: ShdcOptions): TargetJob {
-    const { name, defs, mod, refl } = opts;
+    const { name, src, defs, mod, refl } = opts;
+    // shaders outside the samples directory are named after the file, e.g. 'mipgen.glsl.h'
+    const base = src ? name : `${name}-sapp`;
     return {
         job: 'sokolshdc',
         args: {
-            src: `${name}-sapp.glsl`,
-            out: `${name}-sapp.glsl${mod ? `.${mod}` : ''}.h`,
+            src: src ?? `${base}.glsl`,
+            out: `${base}.glsl${mod ? `.${mod}` : ''}.h`,
             defines: defs,
             module: mod,
             reflection: refl,
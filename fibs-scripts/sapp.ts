@@ -3,6 +3,13 @@ import { hasCompute, copy, embed, shdc } from './common.ts';
 
 export function addSokolAppSamples(b: Builder) {
     samples.forEach((s) => addSample(b, s));
+    addDrawcallPerfBench(b);
+    addVecmathBench(b);
+    addFrustumCullBench(b);
+    addImageBlurRef(b);
+    addMandelorbitTest(b);
+    addMipgenBench(b);
+    addShapecacheBench(b);
 }
 
 export const samples: SampleOptions[] = [
@@ -97,11 +104,11 @@ export const samples: SampleOptions[] = [
         ])],
     },
     { name: 'sgl', ui: 'cc' },
-    { name: 'sgl-lines', ui: 'cc' },
+    { name: 'sgl-lines', ui: 'cc', shd: true },
     { name: 'sgl-boing', ui: 'cc' },
     { name: 'sgl-points', ui: 'cc' },
     { name: 'sgl-context', ui: 'cc' },
-    { name: 'sgl-microui', ui: 'c', deps: ['microui'] },
+    { name: 'sgl-microui', ui: 'c', shd: true, deps: ['microui'] },
     { name: 'nuklear', ui: 'cc', deps: ['nuklear-static'] },
     { name: 'nuklear-images', ui: 'cc', deps: ['nuklear-static'] },
     { name: 'cubemaprt', ui: 'cc', shd: true },
@@ -167,7 +174,7 @@ export const samples: SampleOptions[] = [
             ]),
         ],
     },
-    { name: 'loadpng', shd: true, ui: 'cc', deps: ['fileutil', 'stb'], jobs: [copy('data', ['baboon.png'])] },
+    { name: 'loadpng', shd: true, ui: 'cc', deps: ['fileutil', 'stb'], mipgen: true, jobs: [copy('data', ['baboon.png'])] },
     { name: 'box3d-simple', shd: true, deps: ['imgui', 'box3d'] },
     { name: 'spine-simple', ui: 'cc', deps: ['spine', 'stb', 'fileutil'], jobs: [copySpineAssets()] },
     { name: 'spine-inspector', deps: ['spine', 'stb', 'fileutil', 'imgui'], jobs: [copySpineAssets()] },
@@ -175,6 +182,7 @@ export const samples: SampleOptions[] = [
     { name: 'spine-layers', ui: 'cc', deps: ['spine', 'stb', 'fileutil'], jobs: [copySpineAssets()] },
     { name: 'spine-contexts', ui: 'cc', deps: ['spine', 'stb', 'fileutil'], jobs: [copySpineAssets()] },
     { name: 'spine-switch-skinsets', ui: 'cc', deps: ['spine', 'stb', 'fileutil'], jobs: [copySpineAssets()] },
+    { name: 'spine-crowd', deps: ['spine', 'stb', 'fileutil', 'imgui'], jobs: [copySpineAssets()] },
     {
         name: 'ozz-anim',
         ext: 'cc',
@@ -232,10 +240,20 @@ export type SampleOptions = {
     shd?: true;
     deps?: string[];
     jobs?: TargetJob[];
+    mipgen?: true;
     filter?: (b: Builder) => boolean;
 };
 
-function addSample(b: Builder, { name, ext, ui, sokol, shd, deps, jobs, filter }: SampleOptions) {
+// the util/mipgen.h compute shader, only on platforms with compute support
+function addMipgenShader(b: Builder, t: TargetBuilder) {
+    if (hasCompute(b)) {
+        t.addSource('../libs/util/mipgen.glsl');
+        t.addJob(shdc({ name: 'mipgen', src: '../libs/util/mipgen.glsl' }));
+        t.addCompileDefinitions({ MIPGEN_COMPUTE: '1' });
+    }
+}
+
+function addSample(b: Builder, { name, ext, ui, sokol, shd, deps, jobs, mipgen, filter }: SampleOptions) {
     if (filter && !filter(b)) {
         return;
     }
@@ -260,6 +278,9 @@ function addSample(b: Builder, { name, ext, ui, sokol, shd, deps, jobs, filter }
             t.addSource(`${name}-sapp.glsl`);
             t.addJob(shdc({ name }));
         }
+        if (mipgen) {
+            addMipgenShader(b, t);
+        }
         if (jobs) {
             jobs.forEach((j) => t.addJob(j));
         }
@@ -278,6 +299,128 @@ function addSample(b: Builder, { name, ext, ui, sokol, shd, deps, jobs, filter }
     }
 }
 
+// headless sokol-gfx submission benchmark on the dummy backend (see drawcallperf-bench.c)
+function addDrawcallPerfBench(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    b.addTarget('drawcallperf-bench', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSources(['drawcallperf-bench.c', 'drawcallperf-sapp.glsl']);
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        t.addIncludeDirectories([t.buildDir()]);
+        t.addDependencies(['sokol']);
+        t.addJob(shdc({ name: 'drawcallperf' }));
+    });
+}
+
+// camera.h frustum culling micro benchmark (see frustumcull-bench.c)
+function addFrustumCullBench(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    b.addTarget('frustumcull-bench', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSource('frustumcull-bench.c');
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        t.addDependencies(['sokol-noentry']);
+    });
+}
+
+// CPU reference for the imageblur sample blur modes (see imageblur-ref.c)
+function addImageBlurRef(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    b.addTarget('imageblur-ref', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSource('imageblur-ref.c');
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        t.addDependencies(['sokol-noentry', 'stb']);
+    });
+}
+
+// CPU unit tests for the mandelbrot deep zoom math (see mandelorbit-test.c)
+function addMandelorbitTest(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    b.addTarget('mandelorbit-test', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSource('mandelorbit-test.c');
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        // fma() etc. are only inlined as builtins with optimization enabled
+        if (b.isLinux()) {
+            t.addDependencies(['m']);
+        }
+    });
+}
+
+// util/mipgen.h CPU filter timings and compute vs. per-level render pass
+// submission cost on the dummy backend (see mipgen-bench.c)
+function addMipgenBench(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux()) || !hasCompute(b)) {
+        return;
+    }
+    b.addTarget('mipgen-bench', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSources(['mipgen-bench.c', 'mipgen-bench.glsl']);
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        t.addIncludeDirectories([t.buildDir()]);
+        t.addDependencies(['sokol']);
+        t.addJob(shdc({ name: 'mipgen-bench', src: 'mipgen-bench.glsl' }));
+    });
+}
+
+// util/shapecache.h startup time: rebuild vs. cold and warm cache (see shapecache-bench.c)
+function addShapecacheBench(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    b.addTarget('shapecache-bench', 'plain-exe', (t) => {
+        t.setDir('sapp');
+        t.addSource('shapecache-bench.c');
+        t.addIncludeDirectories({ system: true, dirs: ['../libs']});
+        t.addDependencies(['sokol-noentry']);
+    });
+}
+
+// vecmath.h micro benchmarks: scalar, SIMD batch functions, -ffast-math and
+// (clang only) ext_vector_type builds, compare them with 'vecmath-bench --csv'
+// and '--compare'
+function addVecmathBench(b: Builder) {
+    if (!(b.isWindows() || b.isMacOS() || b.isLinux())) {
+        return;
+    }
+    const variants = [
+        { name: 'vecmath-bench', simd: false, fastMath: false, extVec: false },
+        { name: 'vecmath-bench-simd', simd: true, fastMath: false, extVec: false },
+        { name: 'vecmath-bench-fastmath', simd: false, fastMath: true, extVec: false },
+        { name: 'vecmath-bench-extvec', simd: false, fastMath: false, extVec: true },
+    ];
+    for (const variant of variants) {
+        if (variant.fastMath && !(b.isGcc() || b.isClang())) {
+            continue;
+        }
+        if (variant.extVec && !b.isClang()) {
+            continue;
+        }
+        b.addTarget(variant.name, 'plain-exe', (t) => {
+            t.setDir('libs/vecmath');
+            t.addSources(['vecmath-bench.c']);
+            if (variant.simd) {
+                t.addCompileDefinitions({ VECMATH_SIMD: '1' });
+            }
+            if (variant.extVec) {
+                t.addCompileDefinitions({ VECMATH_EXT_VECTOR_TYPE: '1' });
+            }
+            if (variant.fastMath) {
+                t.addCompileOptions({ scope: 'private', opts: ['-ffast-math'] });
+            }
+        });
+    }
+}
+
 function copySpineAssets(): TargetJob {
     return copy('data/spine', [
         'spineboy-pro.json',
@@ -1,6 +1,10 @@
 //
 //  NOTE sokol: all IO functions have been removed
 //
+//  NOTE sokol: optional multi-page glyph cache, set FONSparams.maxPages > 1
+//  and provide the renderUpdatePage/renderDrawPage callbacks, when all pages
+//  are full the least recently used page is evicted (see fonsNextFrame())
+//
 // Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
 //
 // This software is provided 'as-is', without any express or implied
@@ -34,6 +38,11 @@ extern "C" {
 
 #define FONS_INVALID -1
 
+// Upper limit for FONSparams.maxPages.
+#ifndef FONS_MAX_PAGES
+#define FONS_MAX_PAGES 16
+#endif
+
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
@@ -71,9 +80,19 @@ struct FONSparams {
 	void (*renderUpdate)(void* uptr, int* rect, const unsigned char* data);
 	void (*renderDraw)(void* uptr, const float* verts, const float* tcoords, const unsigned int* colors, int nverts);
 	void (*renderDelete)(void* uptr);
+	// Multi-page glyph cache, each page is width x height, 0 or 1 for a single page.
+	int maxPages;
+	void (*renderUpdatePage)(void* uptr, int page, int* rect, const unsigned char* data);
+	void (*renderDrawPage)(void* uptr, int page, const float* verts, const float* tcoords, const unsigned int* colors, int nverts);
 };
 typedef struct FONSparams FONSparams;
 
+struct FONScacheStats {
+	int hits, misses, evictions;
+	int numPages, maxPages;
+};
+typedef struct FONScacheStats FONScacheStats;
+
 struct FONSquad
 {
 	float x0,y0,s0,t0;
@@ -91,6 +110,7 @@ struct FONStextIter {
 	const char* next;
 	const char* end;
 	unsigned int utf8state;
+	int page;
 };
 typedef struct FONStextIter FONStextIter;
 
@@ -144,6 +164,12 @@ FONS_DEF int fonsValidateTexture(FONScontext* s, int* dirty);
 // Draws the stash texture for debugging
 FONS_DEF void fonsDrawDebug(FONScontext* s, float x, float y);
 
+// Multi-page glyph cache, call fonsNextFrame() once per frame after the
+// text has been rendered, pages used in the current frame are never evicted.
+FONS_DEF void fonsNextFrame(FONScontext* s);
+FONS_DEF void fonsGetCacheStats(FONScontext* s, FONScacheStats* stats);
+FONS_DEF void fonsResetCacheStats(FONScontext* s);
+
 #ifdef __cplusplus
 }
 #endif
@@ -376,6 +402,7 @@ struct FONSglyph
 	short size, blur;
 	short x0,y0,x1,y1;
 	short xadv,xoff,yoff;
+	short page;
 };
 typedef struct FONSglyph FONSglyph;
 
@@ -423,14 +450,26 @@ struct FONSatlas
 };
 typedef struct FONSatlas FONSatlas;
 
+struct FONSpage
+{
+	FONSatlas* atlas;
+	unsigned char* texData;
+	int dirtyRect[4];
+	unsigned int lastUsed;
+};
+typedef struct FONSpage FONSpage;
+
 struct FONScontext
 {
 	FONSparams params;
 	float itw,ith;
-	unsigned char* texData;
-	int dirtyRect[4];
+	FONSpage pages[FONS_MAX_PAGES];
+	int npages;
+	int fillPage;
+	int drawPage;
+	unsigned int frame;
+	FONScacheStats stats;
 	FONSfont** fonts;
-	FONSatlas* atlas;
 	int cfonts;
 	int nfonts;
 	float verts[FONS_VERTEX_COUNT*2];
@@ -695,25 +734,59 @@ static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry
 	return 1;
 }
 
+static void fons__resetDirtyRect(FONScontext* stash, FONSpage* page)
+{
+	page->dirtyRect[0] = stash->params.width;
+	page->dirtyRect[1] = stash->params.height;
+	page->dirtyRect[2] = 0;
+	page->dirtyRect[3] = 0;
+}
+
+static void fons__addDirtyRect(FONSpage* page, int x0, int y0, int x1, int y1)
+{
+	page->dirtyRect[0] = fons__mini(page->dirtyRect[0], x0);
+	page->dirtyRect[1] = fons__mini(page->dirtyRect[1], y0);
+	page->dirtyRect[2] = fons__maxi(page->dirtyRect[2], x1);
+	page->dirtyRect[3] = fons__maxi(page->dirtyRect[3], y1);
+}
+
 static void fons__addWhiteRect(FONScontext* stash, int w, int h)
 {
 	int x, y, gx, gy;
 	unsigned char* dst;
-	if (fons__atlasAddRect(stash->atlas, w, h, &gx, &gy) == 0)
+	FONSpage* page = &stash->pages[0];
+	if (fons__atlasAddRect(page->atlas, w, h, &gx, &gy) == 0)
 		return;
 
 	// Rasterize
-	dst = &stash->texData[gx + gy * stash->params.width];
+	dst = &page->texData[gx + gy * stash->params.width];
 	for (y = 0; y < h; y++) {
 		for (x = 0; x < w; x++)
 			dst[x] = 0xff;
 		dst += stash->params.width;
 	}
 
-	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], gx);
-	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], gy);
-	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], gx+w);
-	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], gy+h);
+	fons__addDirtyRect(page, gx, gy, gx+w, gy+h);
+}
+
+static int fons__allocPage(FONScontext* stash, int index)
+{
+	FONSpage* page = &stash->pages[index];
+	page->atlas = fons__allocAtlas(stash->params.width, stash->params.height, FONS_INIT_ATLAS_NODES);
+	if (page->atlas == NULL) return 0;
+	page->texData = (unsigned char*)malloc(stash->params.width * stash->params.height);
+	if (page->texData == NULL) return 0;
+	memset(page->texData, 0, stash->params.width * stash->params.height);
+	fons__resetDirtyRect(stash, page);
+	page->lastUsed = stash->frame;
+	return 1;
+}
+
+static void fons__freePage(FONSpage* page)
+{
+	if (page->atlas) fons__deleteAtlas(page->atlas);
+	if (page->texData) free(page->texData);
+	memset(page, 0, sizeof(FONSpage));
 }
 
 FONScontext* fonsCreateInternal(FONSparams* params)
@@ -739,9 +812,6 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 			goto error;
 	}
 
-	stash->atlas = fons__allocAtlas(stash->params.width, stash->params.height, FONS_INIT_ATLAS_NODES);
-	if (stash->atlas == NULL) goto error;
-
 	// Allocate space for fonts.
 	stash->fonts = (FONSfont**)malloc(sizeof(FONSfont*) * FONS_INIT_FONTS);
 	if (stash->fonts == NULL) goto error;
@@ -749,17 +819,13 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 	stash->cfonts = FONS_INIT_FONTS;
 	stash->nfonts = 0;
 
-	// Create texture for the cache.
+	// Create the first cache page, more pages are added on demand.
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
-	stash->texData = (unsigned char*)malloc(stash->params.width * stash->params.height);
-	if (stash->texData == NULL) goto error;
-	memset(stash->texData, 0, stash->params.width * stash->params.height);
-
-	stash->dirtyRect[0] = stash->params.width;
-	stash->dirtyRect[1] = stash->params.height;
-	stash->dirtyRect[2] = 0;
-	stash->dirtyRect[3] = 0;
+	stash->params.maxPages = fons__maxi(1, fons__mini(stash->params.maxPages, FONS_MAX_PAGES));
+	stash->frame = 1;
+	if (fons__allocPage(stash, 0) == 0) goto error;
+	stash->npages = 1;
 
 	// Add white rect at 0,0 for debug drawing.
 	fons__addWhiteRect(stash, 2,2);
@@ -1018,6 +1084,68 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+static void fons__evictPage(FONScontext* stash, int index)
+{
+	int i, j, n;
+	unsigned int h;
+	FONSpage* page = &stash->pages[index];
+
+	// Drop the cached glyphs which live on the page and rebuild the hash lookups.
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		n = 0;
+		for (j = 0; j < font->nglyphs; j++) {
+			if (font->glyphs[j].page != index)
+				font->glyphs[n++] = font->glyphs[j];
+		}
+		font->nglyphs = n;
+		for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
+			font->lut[j] = -1;
+		for (j = 0; j < n; j++) {
+			h = fons__hashint(font->glyphs[j].codepoint) & (FONS_HASH_LUT_SIZE-1);
+			font->glyphs[j].next = font->lut[h];
+			font->lut[h] = j;
+		}
+	}
+
+	// Clear the old texels, new glyphs only write their bitmap and outer border,
+	// the padding in between would keep the coverage of the evicted glyphs.
+	fons__atlasReset(page->atlas, stash->params.width, stash->params.height);
+	memset(page->texData, 0, stash->params.width * stash->params.height);
+	fons__addDirtyRect(page, 0, 0, stash->params.width, stash->params.height);
+	if (index == 0)
+		fons__addWhiteRect(stash, 2,2);
+	stash->stats.evictions++;
+}
+
+// Returns the page to continue filling when the current fill page is full,
+// or -1 if all pages are full and were used in the current frame.
+static int fons__nextPage(FONScontext* stash)
+{
+	int i, lru = -1;
+
+	if (stash->npages < stash->params.maxPages) {
+		if (fons__allocPage(stash, stash->npages) == 0)
+			return -1;
+		stash->fillPage = stash->npages++;
+		return stash->fillPage;
+	}
+
+	// Evict the least recently used page, but never one used in the current
+	// frame, its glyphs may have been drawn already but not yet uploaded.
+	for (i = 0; i < stash->npages; i++) {
+		if (stash->pages[i].lastUsed == stash->frame)
+			continue;
+		if (lru == -1 || stash->pages[i].lastUsed < stash->pages[lru].lastUsed)
+			lru = i;
+	}
+	if (lru == -1)
+		return -1;
+	fons__evictPage(stash, lru);
+	stash->fillPage = lru;
+	return lru;
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
 								 short isize, short iblur)
 {
@@ -1026,10 +1154,11 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	FONSglyph* glyph = NULL;
 	unsigned int h;
 	float size = isize/10.0f;
-	int pad, added;
+	int pad, added, pageIndex;
 	unsigned char* bdst;
 	unsigned char* dst;
 	FONSfont* renderFont = font;
+	FONSpage* page;
 
 	if (isize < 2) return NULL;
 	if (iblur > 20) iblur = 20;
@@ -1042,10 +1171,14 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
 	i = font->lut[h];
 	while (i != -1) {
-		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
+		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
+			stash->pages[font->glyphs[i].page].lastUsed = stash->frame;
+			stash->stats.hits++;
 			return &font->glyphs[i];
+		}
 		i = font->glyphs[i].next;
 	}
+	stash->stats.misses++;
 
 	// Could not find glyph, create it.
 	g = fons__tt_getGlyphIndex(&font->font, codepoint);
@@ -1069,13 +1202,25 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	gh = y1-y0 + pad*2;
 
 	// Find free spot for the rect in the atlas
-	added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+	pageIndex = stash->fillPage;
+	added = fons__atlasAddRect(stash->pages[pageIndex].atlas, gw, gh, &gx, &gy);
+	if (added == 0 && stash->params.maxPages > 1) {
+		// Page is full, continue on a new or evicted page.
+		pageIndex = fons__nextPage(stash);
+		if (pageIndex != -1)
+			added = fons__atlasAddRect(stash->pages[pageIndex].atlas, gw, gh, &gx, &gy);
+		else
+			pageIndex = stash->fillPage;
+	}
 	if (added == 0 && stash->handleError != NULL) {
 		// Atlas is full, let the user to resize the atlas (or not), and try again.
 		stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-		added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+		pageIndex = stash->fillPage;
+		added = fons__atlasAddRect(stash->pages[pageIndex].atlas, gw, gh, &gx, &gy);
 	}
 	if (added == 0) return NULL;
+	page = &stash->pages[pageIndex];
+	page->lastUsed = stash->frame;
 
 	// Init glyph.
 	glyph = fons__allocGlyph(font);
@@ -1090,6 +1235,7 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	glyph->xadv = (short)(scale * advance * 10.0f);
 	glyph->xoff = (short)(x0 - pad);
 	glyph->yoff = (short)(y0 - pad);
+	glyph->page = (short)pageIndex;
 	glyph->next = 0;
 
 	// Insert char to hash lookup.
@@ -1097,11 +1243,11 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	font->lut[h] = font->nglyphs-1;
 
 	// Rasterize
-	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
+	dst = &page->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
 	fons__tt_renderGlyphBitmap(&renderFont->font, dst, gw-pad*2,gh-pad*2, stash->params.width, scale,scale, g);
 
 	// Make sure there is one pixel empty border.
-	dst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
+	dst = &page->texData[glyph->x0 + glyph->y0 * stash->params.width];
 	for (y = 0; y < gh; y++) {
 		dst[y*stash->params.width] = 0;
 		dst[gw-1 + y*stash->params.width] = 0;
@@ -1112,7 +1258,7 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	}
 
 	// Debug code to color the glyph background
-/*	unsigned char* fdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
+/*	unsigned char* fdst = &page->texData[glyph->x0 + glyph->y0 * stash->params.width];
 	for (y = 0; y < gh; y++) {
 		for (x = 0; x < gw; x++) {
 			int a = (int)fdst[x+y*stash->params.width] + 20;
@@ -1124,14 +1270,11 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	// Blur
 	if (iblur > 0) {
 		stash->nscratch = 0;
-		bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
+		bdst = &page->texData[glyph->x0 + glyph->y0 * stash->params.width];
 		fons__blur(stash, bdst, gw,gh, stash->params.width, iblur);
 	}
 
-	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+	fons__addDirtyRect(page, glyph->x0, glyph->y0, glyph->x1, glyph->y1);
 
 	return glyph;
 }
@@ -1190,25 +1333,40 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 
 static void fons__flush(FONScontext* stash)
 {
+	int i;
+
 	// Flush texture
-	if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
-		if (stash->params.renderUpdate != NULL)
-			stash->params.renderUpdate(stash->params.userPtr, stash->dirtyRect, stash->texData);
-		// Reset dirty rect
-		stash->dirtyRect[0] = stash->params.width;
-		stash->dirtyRect[1] = stash->params.height;
-		stash->dirtyRect[2] = 0;
-		stash->dirtyRect[3] = 0;
+	for (i = 0; i < stash->npages; i++) {
+		FONSpage* page = &stash->pages[i];
+		if (page->dirtyRect[0] < page->dirtyRect[2] && page->dirtyRect[1] < page->dirtyRect[3]) {
+			if (stash->params.renderUpdatePage != NULL)
+				stash->params.renderUpdatePage(stash->params.userPtr, i, page->dirtyRect, page->texData);
+			else if (stash->params.renderUpdate != NULL)
+				stash->params.renderUpdate(stash->params.userPtr, page->dirtyRect, page->texData);
+			// Reset dirty rect
+			fons__resetDirtyRect(stash, page);
+		}
 	}
 
 	// Flush triangles
 	if (stash->nverts > 0) {
-		if (stash->params.renderDraw != NULL)
+		if (stash->params.renderDrawPage != NULL)
+			stash->params.renderDrawPage(stash->params.userPtr, stash->drawPage, stash->verts, stash->tcoords, stash->colors, stash->nverts);
+		else if (stash->params.renderDraw != NULL)
 			stash->params.renderDraw(stash->params.userPtr, stash->verts, stash->tcoords, stash->colors, stash->nverts);
 		stash->nverts = 0;
 	}
 }
 
+// Batched vertices all sample the same page, flush when switching pages.
+static void fons__setDrawPage(FONScontext* stash, int page)
+{
+	if (page != stash->drawPage) {
+		fons__flush(stash);
+		stash->drawPage = page;
+	}
+}
+
 static __inline void fons__vertex(FONScontext* stash, float x, float y, float s, float t, unsigned int c)
 {
 	stash->verts[stash->nverts*2+0] = x;
@@ -1291,6 +1449,7 @@ FONS_DEF float fonsDrawText(FONScontext* stash,
 		if (glyph != NULL) {
 			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
 
+			fons__setDrawPage(stash, glyph->page);
 			if (stash->nverts+6 > FONS_VERTEX_COUNT)
 				fons__flush(stash);
 
@@ -1371,8 +1530,10 @@ FONS_DEF int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad*
 		iter->x = iter->nextx;
 		iter->y = iter->nexty;
 		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur);
-		if (glyph != NULL)
+		if (glyph != NULL) {
 			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			iter->page = glyph->page;
+		}
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
 		break;
 	}
@@ -1388,7 +1549,9 @@ FONS_DEF void fonsDrawDebug(FONScontext* stash, float x, float y)
 	int h = stash->params.height;
 	float u = w == 0 ? 0 : (1.0f / w);
 	float v = h == 0 ? 0 : (1.0f / h);
+	FONSatlas* atlas = stash->pages[0].atlas;
 
+	fons__setDrawPage(stash, 0);
 	if (stash->nverts+6+6 > FONS_VERTEX_COUNT)
 		fons__flush(stash);
 
@@ -1411,8 +1574,8 @@ FONS_DEF void fonsDrawDebug(FONScontext* stash, float x, float y)
 	fons__vertex(stash, x+w, y+h, 1, 1, 0xffffffff);
 
 	// Drawbug draw atlas
-	for (i = 0; i < stash->atlas->nnodes; i++) {
-		FONSatlasNode* n = &stash->atlas->nodes[i];
+	for (i = 0; i < atlas->nnodes; i++) {
+		FONSatlasNode* n = &atlas->nodes[i];
 
 		if (stash->nverts+6 > FONS_VERTEX_COUNT)
 			fons__flush(stash);
@@ -1556,21 +1719,19 @@ FONS_DEF const unsigned char* fonsGetTextureData(FONScontext* stash, int* width,
 		*width = stash->params.width;
 	if (height != NULL)
 		*height = stash->params.height;
-	return stash->texData;
+	return stash->pages[0].texData;
 }
 
 FONS_DEF int fonsValidateTexture(FONScontext* stash, int* dirty)
 {
-	if (stash->dirtyRect[0] < stash->dirtyRect[2] && stash->dirtyRect[1] < stash->dirtyRect[3]) {
-		dirty[0] = stash->dirtyRect[0];
-		dirty[1] = stash->dirtyRect[1];
-		dirty[2] = stash->dirtyRect[2];
-		dirty[3] = stash->dirtyRect[3];
+	FONSpage* page = &stash->pages[0];
+	if (page->dirtyRect[0] < page->dirtyRect[2] && page->dirtyRect[1] < page->dirtyRect[3]) {
+		dirty[0] = page->dirtyRect[0];
+		dirty[1] = page->dirtyRect[1];
+		dirty[2] = page->dirtyRect[2];
+		dirty[3] = page->dirtyRect[3];
 		// Reset dirty rect
-		stash->dirtyRect[0] = stash->params.width;
-		stash->dirtyRect[1] = stash->params.height;
-		stash->dirtyRect[2] = 0;
-		stash->dirtyRect[3] = 0;
+		fons__resetDirtyRect(stash, page);
 		return 1;
 	}
 	return 0;
@@ -1587,9 +1748,9 @@ FONS_DEF void fonsDeleteInternal(FONScontext* stash)
 	for (i = 0; i < stash->nfonts; ++i)
 		fons__freeFont(stash->fonts[i]);
 
-	if (stash->atlas) fons__deleteAtlas(stash->atlas);
+	for (i = 0; i < FONS_MAX_PAGES; ++i)
+		fons__freePage(&stash->pages[i]);
 	if (stash->fonts) free(stash->fonts);
-	if (stash->texData) free(stash->texData);
 	if (stash->scratch) free(stash->scratch);
 	free(stash);
 }
@@ -1612,7 +1773,11 @@ FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 {
 	int i, maxy = 0;
 	unsigned char* data = NULL;
+	FONSpage* page;
 	if (stash == NULL) return 0;
+	// Multi-page caches evict pages instead of growing.
+	if (stash->params.maxPages > 1) return 0;
+	page = &stash->pages[0];
 
 	width = fons__maxi(width, stash->params.width);
 	height = fons__maxi(height, stash->params.height);
@@ -1634,7 +1799,7 @@ FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 		return 0;
 	for (i = 0; i < stash->params.height; i++) {
 		unsigned char* dst = &data[i*width];
-		unsigned char* src = &stash->texData[i*stash->params.width];
+		unsigned char* src = &page->texData[i*stash->params.width];
 		memcpy(dst, src, stash->params.width);
 		if (width > stash->params.width)
 			memset(dst+stash->params.width, 0, width - stash->params.width);
@@ -1642,19 +1807,19 @@ FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 	if (height > stash->params.height)
 		memset(&data[stash->params.height * width], 0, (height - stash->params.height) * width);
 
-	free(stash->texData);
-	stash->texData = data;
+	free(page->texData);
+	page->texData = data;
 
 	// Increase atlas size
-	fons__atlasExpand(stash->atlas, width, height);
+	fons__atlasExpand(page->atlas, width, height);
 
 	// Add existing data as dirty.
-	for (i = 0; i < stash->atlas->nnodes; i++)
-		maxy = fons__maxi(maxy, stash->atlas->nodes[i].y);
-	stash->dirtyRect[0] = 0;
-	stash->dirtyRect[1] = 0;
-	stash->dirtyRect[2] = stash->params.width;
-	stash->dirtyRect[3] = maxy;
+	for (i = 0; i < page->atlas->nnodes; i++)
+		maxy = fons__maxi(maxy, page->atlas->nodes[i].y);
+	page->dirtyRect[0] = 0;
+	page->dirtyRect[1] = 0;
+	page->dirtyRect[2] = stash->params.width;
+	page->dirtyRect[3] = maxy;
 
 	stash->params.width = width;
 	stash->params.height = height;
@@ -1678,19 +1843,26 @@ FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height)
 			return 0;
 	}
 
+	// Drop all but the first page.
+	for (i = 1; i < stash->npages; i++)
+		fons__freePage(&stash->pages[i]);
+	stash->npages = 1;
+	stash->fillPage = 0;
+	stash->drawPage = 0;
+
 	// Reset atlas
-	fons__atlasReset(stash->atlas, width, height);
+	fons__atlasReset(stash->pages[0].atlas, width, height);
 
 	// Clear texture data.
-	stash->texData = (unsigned char*)realloc(stash->texData, width * height);
-	if (stash->texData == NULL) return 0;
-	memset(stash->texData, 0, width * height);
+	stash->pages[0].texData = (unsigned char*)realloc(stash->pages[0].texData, width * height);
+	if (stash->pages[0].texData == NULL) return 0;
+	memset(stash->pages[0].texData, 0, width * height);
 
 	// Reset dirty rect
-	stash->dirtyRect[0] = width;
-	stash->dirtyRect[1] = height;
-	stash->dirtyRect[2] = 0;
-	stash->dirtyRect[3] = 0;
+	stash->pages[0].dirtyRect[0] = width;
+	stash->pages[0].dirtyRect[1] = height;
+	stash->pages[0].dirtyRect[2] = 0;
+	stash->pages[0].dirtyRect[3] = 0;
 
 	// Reset cached glyphs
 	for (i = 0; i < stash->nfonts; i++) {
@@ -1711,4 +1883,24 @@ FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height)
 	return 1;
 }
 
+FONS_DEF void fonsNextFrame(FONScontext* stash)
+{
+	if (stash == NULL) return;
+	stash->frame++;
+}
+
+FONS_DEF void fonsGetCacheStats(FONScontext* stash, FONScacheStats* stats)
+{
+	if (stash == NULL) return;
+	*stats = stash->stats;
+	stats->numPages = stash->npages;
+	stats->maxPages = stash->params.maxPages;
+}
+
+FONS_DEF void fonsResetCacheStats(FONScontext* stash)
+{
+	if (stash == NULL) return;
+	memset(&stash->stats, 0, sizeof(stash->stats));
+}
+
 #endif // FONTSTASH_IMPLEMENTATION
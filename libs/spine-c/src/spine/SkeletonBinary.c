@@ -72,7 +72,7 @@ static int string_starts_with(const char *str, const char *needle) {
 static char *string_copy(const char *str) {
 	if (str == NULL) return NULL;
 	int len = strlen(str);
-	char *tmp = (char *) malloc(len + 1);
+	char *tmp = MALLOC(char, len + 1);
 	strncpy(tmp, str, len);
 	tmp[len] = '\0';
 	return tmp;
@@ -0,0 +1,117 @@
+#pragma once
+/*
+    Glue code to run Box3D's internal task system on the work-stealing
+    job system in jobs.h. Include after box3d.h and jobs.h.
+
+    Usage:
+
+        jobs_setup(&(jobs_desc_t){ .num_threads = ... });
+        b3WorldDef world_def = b3DefaultWorldDef();
+        b3jobs_init_world_def(&world_def);
+        b3WorldId world = b3CreateWorld(&world_def);
+        ...
+        b3jobs_begin_step();
+        b3World_Step(world, dt, num_sub_steps);
+
+    The Box3D worker count is the number of job system worker threads
+    plus the main thread. Each task is split into at most that many
+    ranges, and each range is run with the index of the thread it runs
+    on as the Box3D worker index.
+*/
+#include <assert.h>
+
+#define B3JOBS_MAX_TASKS (256)
+#define B3JOBS_MAX_RANGES (JOBS_MAX_THREADS + 1)
+
+typedef struct _b3jobs_task_t _b3jobs_task_t;
+
+typedef struct {
+    _b3jobs_task_t* task;
+    int start;
+    int end;
+} _b3jobs_range_t;
+
+struct _b3jobs_task_t {
+    jobs_group_t group;
+    b3TaskCallback* func;
+    void* context;
+    _b3jobs_range_t ranges[B3JOBS_MAX_RANGES];
+};
+
+static struct {
+    int num_tasks;
+    _b3jobs_task_t tasks[B3JOBS_MAX_TASKS];
+} _b3jobs;
+
+static inline void _b3jobs_run_range(void* user_data) {
+    const _b3jobs_range_t* range = (const _b3jobs_range_t*) user_data;
+    range->task->func(range->start, range->end, (uint32_t)jobs_thread_index(), range->task->context);
+}
+
+static inline void* _b3jobs_enqueue_task(b3TaskCallback* func, int item_count, int min_range, void* task_context, void* user_context) {
+    (void)user_context;
+    if (_b3jobs.num_tasks >= B3JOBS_MAX_TASKS) {
+        // out of task slots, run serially (Box3D won't call finish for a null task)
+        func(0, item_count, (uint32_t)jobs_thread_index(), task_context);
+        return 0;
+    }
+    _b3jobs_task_t* task = &_b3jobs.tasks[_b3jobs.num_tasks++];
+    task->group = (jobs_group_t){0};
+    task->func = func;
+    task->context = task_context;
+
+    // split the items into at most one range per thread, but no smaller than min_range
+    if (min_range < 1) {
+        min_range = 1;
+    }
+    int num_ranges = (item_count + min_range - 1) / min_range;
+    const int max_ranges = jobs_num_threads() + 1;
+    if (num_ranges > max_ranges) {
+        num_ranges = max_ranges;
+    }
+    if (num_ranges < 1) {
+        num_ranges = 1;
+    }
+    const int items_per_range = item_count / num_ranges;
+    int remainder = item_count % num_ranges;
+    int start = 0;
+    for (int i = 0; i < num_ranges; i++) {
+        _b3jobs_range_t* range = &task->ranges[i];
+        const int count = items_per_range + ((remainder > 0) ? 1 : 0);
+        remainder -= (remainder > 0) ? 1 : 0;
+        range->task = task;
+        range->start = start;
+        range->end = start + count;
+        start += count;
+        jobs_push(&task->group, _b3jobs_run_range, range);
+    }
+    assert(start == item_count);
+    return task;
+}
+
+static inline void _b3jobs_finish_task(void* user_task, void* user_context) {
+    (void)user_context;
+    if (user_task) {
+        _b3jobs_task_t* task = (_b3jobs_task_t*) user_task;
+        jobs_wait(&task->group);
+    }
+}
+
+/* configure a Box3D world def to use the job system, call after jobs_setup() */
+static inline void b3jobs_init_world_def(b3WorldDef* def) {
+    assert(def);
+    def->workerCount = jobs_num_threads() + 1;
+    def->enqueueTask = _b3jobs_enqueue_task;
+    def->finishTask = _b3jobs_finish_task;
+    def->userTaskContext = 0;
+}
+
+/* recycle the task slots, call before each b3World_Step() */
+static inline void b3jobs_begin_step(void) {
+    _b3jobs.num_tasks = 0;
+}
+
+/* number of tasks Box3D issued in the last step */
+static inline int b3jobs_num_tasks(void) {
+    return _b3jobs.num_tasks;
+}
@@ -0,0 +1,246 @@
+#pragma once
+/*
+    CPU reference implementation of the box blurs in imageblur-sapp.c, for
+    checking the compute shader output without a GPU (see imageblur-ref.c).
+
+    All functions work on tightly packed RGBA8 pixels with clamp-to-edge
+    addressing, and round the result to 8 bits after each horizontal and
+    vertical pass, just like the RGBA8 storage images on the GPU:
+
+        // box blur with a (2*radius+1)^2 kernel, dst may be the same as src
+        boxblur_box(dst, src, width, height, radius);
+
+        // approximate a gaussian blur with 3 box blurs
+        boxblur_gauss(dst, src, width, height, sigma);
+
+    The box blurs use a running sum per row or column, so the cost per
+    pixel doesn't depend on the radius. One pixel is processed as a vector
+    of 4 int32 channel sums (SSE2, NEON or a scalar fallback).
+
+    boxblur_box_naive() sums up the whole kernel for each pixel and must
+    produce exactly the same result as boxblur_box().
+
+    boxblur_gauss_sizes() computes the odd box sizes for approximating a
+    gaussian with n box blurs (see Peter Kovesi: "Fast Almost-Gaussian
+    Filtering"), this is also used by the GPU version. Below
+    BOXBLUR_GAUSS_MIN_SIGMA the boxes are only 1 or 3 pixels wide and the
+    approximation gets too coarse (a mean error of several 8-bit steps).
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define _BOXBLUR_SIMD_SSE2 (1)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define _BOXBLUR_SIMD_NEON (1)
+#endif
+
+#define BOXBLUR_GAUSS_NUM_BOXES (3)
+#define BOXBLUR_GAUSS_MIN_SIGMA (2.0f)
+
+// the channel sums of one pixel
+#if defined(_BOXBLUR_SIMD_SSE2)
+typedef __m128i _boxblur_acc_t;
+#elif defined(_BOXBLUR_SIMD_NEON)
+typedef uint32x4_t _boxblur_acc_t;
+#else
+typedef struct { uint32_t v[4]; } _boxblur_acc_t;
+#endif
+
+static inline int _boxblur_clamp(int i, int last) {
+    return (i < 0) ? 0 : ((i > last) ? last : i);
+}
+
+static inline _boxblur_acc_t _boxblur_zero(void) {
+    #if defined(_BOXBLUR_SIMD_SSE2)
+    return _mm_setzero_si128();
+    #elif defined(_BOXBLUR_SIMD_NEON)
+    return vdupq_n_u32(0);
+    #else
+    _boxblur_acc_t res = { { 0, 0, 0, 0 } };
+    return res;
+    #endif
+}
+
+static inline _boxblur_acc_t _boxblur_load(const uint8_t* ptr) {
+    #if defined(_BOXBLUR_SIMD_SSE2)
+    int32_t px;
+    memcpy(&px, ptr, sizeof(px));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero);
+    return _mm_unpacklo_epi16(v, zero);
+    #elif defined(_BOXBLUR_SIMD_NEON)
+    uint32_t px;
+    memcpy(&px, ptr, sizeof(px));
+    const uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(px));
+    return vmovl_u16(vget_low_u16(vmovl_u8(v)));
+    #else
+    _boxblur_acc_t res = { { ptr[0], ptr[1], ptr[2], ptr[3] } };
+    return res;
+    #endif
+}
+
+static inline _boxblur_acc_t _boxblur_add(_boxblur_acc_t a, _boxblur_acc_t b) {
+    #if defined(_BOXBLUR_SIMD_SSE2)
+    return _mm_add_epi32(a, b);
+    #elif defined(_BOXBLUR_SIMD_NEON)
+    return vaddq_u32(a, b);
+    #else
+    for (int i = 0; i < 4; i++) {
+        a.v[i] += b.v[i];
+    }
+    return a;
+    #endif
+}
+
+static inline _boxblur_acc_t _boxblur_sub(_boxblur_acc_t a, _boxblur_acc_t b) {
+    #if defined(_BOXBLUR_SIMD_SSE2)
+    return _mm_sub_epi32(a, b);
+    #elif defined(_BOXBLUR_SIMD_NEON)
+    return vsubq_u32(a, b);
+    #else
+    for (int i = 0; i < 4; i++) {
+        a.v[i] -= b.v[i];
+    }
+    return a;
+    #endif
+}
+
+// write sum * scale rounded to 8 bits per channel
+static inline void _boxblur_store(uint8_t* ptr, _boxblur_acc_t a, float scale) {
+    #if defined(_BOXBLUR_SIMD_SSE2)
+    const __m128 f = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), _mm_set1_ps(scale)), _mm_set1_ps(0.5f));
+    __m128i v = _mm_cvttps_epi32(f);
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    const int32_t px = _mm_cvtsi128_si32(v);
+    memcpy(ptr, &px, sizeof(px));
+    #elif defined(_BOXBLUR_SIMD_NEON)
+    const float32x4_t f = vaddq_f32(vmulq_n_f32(vcvtq_f32_u32(a), scale), vdupq_n_f32(0.5f));
+    const uint16x4_t v = vmovn_u32(vcvtq_u32_f32(f));
+    const uint32_t px = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(v, v))), 0);
+    memcpy(ptr, &px, sizeof(px));
+    #else
+    for (int i = 0; i < 4; i++) {
+        ptr[i] = (uint8_t)((float)a.v[i] * scale + 0.5f);
+    }
+    #endif
+}
+
+/* horizontal box blur pass, dst and src must not overlap */
+static inline void boxblur_box_h(uint8_t* dst, const uint8_t* src, int width, int height, int radius) {
+    assert(dst && src && (dst != src) && (width > 0) && (height > 0) && (radius >= 0));
+    const float scale = 1.0f / (float)(2 * radius + 1);
+    const int last = width - 1;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* s = &src[(size_t)y * (size_t)width * 4];
+        uint8_t* d = &dst[(size_t)y * (size_t)width * 4];
+        _boxblur_acc_t acc = _boxblur_zero();
+        for (int i = -radius; i <= radius; i++) {
+            acc = _boxblur_add(acc, _boxblur_load(&s[_boxblur_clamp(i, last) * 4]));
+        }
+        for (int x = 0; x < width; x++) {
+            _boxblur_store(&d[x * 4], acc, scale);
+            acc = _boxblur_add(acc, _boxblur_load(&s[_boxblur_clamp(x + radius + 1, last) * 4]));
+            acc = _boxblur_sub(acc, _boxblur_load(&s[_boxblur_clamp(x - radius, last) * 4]));
+        }
+    }
+}
+
+/* vertical box blur pass, keeps one running sum per column so that rows are read front to back */
+static inline void boxblur_box_v(uint8_t* dst, const uint8_t* src, int width, int height, int radius) {
+    assert(dst && src && (dst != src) && (width > 0) && (height > 0) && (radius >= 0));
+    const float scale = 1.0f / (float)(2 * radius + 1);
+    const int last = height - 1;
+    const size_t pitch = (size_t)width * 4;
+    void* mem = malloc((size_t)width * sizeof(_boxblur_acc_t) + 16);
+    assert(mem);
+    _boxblur_acc_t* acc = (_boxblur_acc_t*)(((uintptr_t)mem + 15) & ~(uintptr_t)15);
+    for (int x = 0; x < width; x++) {
+        acc[x] = _boxblur_zero();
+    }
+    for (int i = -radius; i <= radius; i++) {
+        const uint8_t* s = &src[(size_t)_boxblur_clamp(i, last) * pitch];
+        for (int x = 0; x < width; x++) {
+            acc[x] = _boxblur_add(acc[x], _boxblur_load(&s[x * 4]));
+        }
+    }
+    for (int y = 0; y < height; y++) {
+        uint8_t* d = &dst[(size_t)y * pitch];
+        const uint8_t* s_add = &src[(size_t)_boxblur_clamp(y + radius + 1, last) * pitch];
+        const uint8_t* s_sub = &src[(size_t)_boxblur_clamp(y - radius, last) * pitch];
+        for (int x = 0; x < width; x++) {
+            _boxblur_store(&d[x * 4], acc[x], scale);
+            acc[x] = _boxblur_sub(_boxblur_add(acc[x], _boxblur_load(&s_add[x * 4])), _boxblur_load(&s_sub[x * 4]));
+        }
+    }
+    free(mem);
+}
+
+/* horizontal + vertical box blur, dst may be the same as src */
+static inline void boxblur_box(uint8_t* dst, const uint8_t* src, int width, int height, int radius) {
+    uint8_t* tmp = (uint8_t*) malloc((size_t)width * (size_t)height * 4);
+    assert(tmp);
+    boxblur_box_h(tmp, src, width, height, radius);
+    boxblur_box_v(dst, tmp, width, height, radius);
+    free(tmp);
+}
+
+static inline void _boxblur_naive_pass(uint8_t* dst, const uint8_t* src, int width, int height, int radius, bool vertical) {
+    const float scale = 1.0f / (float)(2 * radius + 1);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            _boxblur_acc_t acc = _boxblur_zero();
+            for (int i = -radius; i <= radius; i++) {
+                const int sx = vertical ? x : _boxblur_clamp(x + i, width - 1);
+                const int sy = vertical ? _boxblur_clamp(y + i, height - 1) : y;
+                acc = _boxblur_add(acc, _boxblur_load(&src[((size_t)sy * (size_t)width + (size_t)sx) * 4]));
+            }
+            _boxblur_store(&dst[((size_t)y * (size_t)width + (size_t)x) * 4], acc, scale);
+        }
+    }
+}
+
+/* same result as boxblur_box(), but sums up the whole kernel for each pixel */
+static inline void boxblur_box_naive(uint8_t* dst, const uint8_t* src, int width, int height, int radius) {
+    assert(dst && src && (width > 0) && (height > 0) && (radius >= 0));
+    uint8_t* tmp = (uint8_t*) malloc((size_t)width * (size_t)height * 4);
+    assert(tmp);
+    _boxblur_naive_pass(tmp, src, width, height, radius, false);
+    _boxblur_naive_pass(dst, tmp, width, height, radius, true);
+    free(tmp);
+}
+
+/* odd box sizes (2*radius+1) for approximating a gaussian with num_boxes box blurs */
+static inline void boxblur_gauss_sizes(float sigma, int num_boxes, int* out_sizes) {
+    assert((num_boxes > 0) && out_sizes);
+    const float n = (float)num_boxes;
+    const float w_ideal = sqrtf((12.0f * sigma * sigma / n) + 1.0f);
+    int wl = (int)floorf(w_ideal);
+    if ((wl & 1) == 0) {
+        wl--;
+    }
+    if (wl < 1) {
+        wl = 1;
+    }
+    const int wu = wl + 2;
+    const float m_ideal = (12.0f * sigma * sigma - n * (float)(wl * wl) - 4.0f * n * (float)wl - 3.0f * n) / (-4.0f * (float)wl - 4.0f);
+    const int m = (int)roundf(m_ideal);
+    for (int i = 0; i < num_boxes; i++) {
+        out_sizes[i] = (i < m) ? wl : wu;
+    }
+}
+
+/* approximate a gaussian blur with BOXBLUR_GAUSS_NUM_BOXES box blurs, dst may be the same as src */
+static inline void boxblur_gauss(uint8_t* dst, const uint8_t* src, int width, int height, float sigma) {
+    int sizes[BOXBLUR_GAUSS_NUM_BOXES];
+    boxblur_gauss_sizes(sigma, BOXBLUR_GAUSS_NUM_BOXES, sizes);
+    for (int i = 0; i < BOXBLUR_GAUSS_NUM_BOXES; i++) {
+        boxblur_box(dst, (i == 0) ? src : dst, width, height, (sizes[i] - 1) / 2);
+    }
+}
@@ -2,10 +2,41 @@
 /*
     Quick'n'dirty Maya-style camera. Include after vecmath.h
     and sokol_app.h
+
+    Also has view frustum culling helpers, for any view-projection matrix
+    built with the vecmath.h projection functions (clip space depth 0..1):
+
+        cam_frustum_t frustum = cam_frustum(cam.view_proj);
+        uint32_t visible[CAM_CULL_MASK_WORDS(NUM_OBJECTS)];
+        cam_cull_aabbs(&frustum, aabb_mins, aabb_maxs, NUM_OBJECTS, visible);
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            if (visible[i >> 5] & (1u << (i & 31))) {
+                ...
+            }
+        }
+
+    The batched tests check 8 (AVX), or 4 (SSE2, NEON) bounds per iteration
+    against all planes and write the result into a visibility bitmask, other
+    platforms fall back to the single-object tests. Culling is conservative:
+    bounds which intersect the frustum planes outside the frustum corners
+    count as visible.
 */
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#define _CAM_SIMD_AVX (1)
+#define _CAM_SIMD_SSE2 (1)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define _CAM_SIMD_SSE2 (1)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define _CAM_SIMD_NEON (1)
+#endif
 
 #define CAMERA_DEFAULT_MIN_DIST (2.0f)
 #define CAMERA_DEFAULT_MAX_DIST (30.0f)
@@ -15,6 +46,9 @@
 #define CAMERA_DEFAULT_FOV (60.0f)
 #define CAMERA_DEFAULT_NEARZ (0.01f)
 #define CAMERA_DEFAULT_FARZ (100.0f)
+#define CAM_FRUSTUM_NUM_PLANES (6)
+// number of uint32_t words in the visibility bitmask for n objects
+#define CAM_CULL_MASK_WORDS(n) (((n) + 31) / 32)
 
 #if defined(__cplusplus)
 using namespace vecmath;
@@ -52,6 +86,12 @@ typedef struct {
     mat44_t view_proj;
 } camera_t;
 
+// normalized frustum planes (left, right, bottom, top, near, far), xyz is the
+// inwards pointing normal and w the distance, a point p is inside if dot(xyz,p)+w >= 0
+typedef struct {
+    vec4_t planes[CAM_FRUSTUM_NUM_PLANES];
+} cam_frustum_t;
+
 static float _cam_def(float val, float def) {
     return ((val == 0.0f) ? def:val);
 }
@@ -137,3 +177,237 @@ static void cam_handle_event(camera_t* cam, const sapp_event* ev) {
             break;
     }
 }
+
+static inline vec4_t _cam_plane(float x, float y, float z, float w) {
+    const float len = sqrtf(x*x + y*y + z*z);
+    const float s = (len > 0.0f) ? (1.0f / len) : 0.0f;
+    return vec4(x * s, y * s, z * s, w * s);
+}
+
+/* extract the frustum planes from a view-projection matrix (e.g. camera_t.view_proj) */
+static inline cam_frustum_t cam_frustum(mat44_t m) {
+    // vecmath.h transforms row vectors (v * m), so the clip space components are the matrix columns
+    const vec4_t cx = vec4(m.x.x, m.y.x, m.z.x, m.w.x);
+    const vec4_t cy = vec4(m.x.y, m.y.y, m.z.y, m.w.y);
+    const vec4_t cz = vec4(m.x.z, m.y.z, m.z.z, m.w.z);
+    const vec4_t cw = vec4(m.x.w, m.y.w, m.z.w, m.w.w);
+    cam_frustum_t f;
+    f.planes[0] = _cam_plane(cw.x + cx.x, cw.y + cx.y, cw.z + cx.z, cw.w + cx.w);  // left: x >= -w
+    f.planes[1] = _cam_plane(cw.x - cx.x, cw.y - cx.y, cw.z - cx.z, cw.w - cx.w);  // right: x <= w
+    f.planes[2] = _cam_plane(cw.x + cy.x, cw.y + cy.y, cw.z + cy.z, cw.w + cy.w);  // bottom: y >= -w
+    f.planes[3] = _cam_plane(cw.x - cy.x, cw.y - cy.y, cw.z - cy.z, cw.w - cy.w);  // top: y <= w
+    f.planes[4] = _cam_plane(cz.x, cz.y, cz.z, cz.w);                              // near: z >= 0
+    f.planes[5] = _cam_plane(cw.x - cz.x, cw.y - cz.y, cw.z - cz.z, cw.w - cz.w);  // far: z <= w
+    return f;
+}
+
+/* test a single bounding sphere against the frustum */
+static inline bool cam_sphere_visible(const cam_frustum_t* f, vec3_t center, float radius) {
+    assert(f);
+    for (int i = 0; i < CAM_FRUSTUM_NUM_PLANES; i++) {
+        const vec4_t p = f->planes[i];
+        // same evaluation order as the batched tests, so that both return the same results
+        if (((p.x * center.x + p.y * center.y) + (p.z * center.z + p.w)) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* test a single axis-aligned bounding box against the frustum */
+static inline bool cam_aabb_visible(const cam_frustum_t* f, vec3_t min, vec3_t max) {
+    assert(f);
+    const float cx = (min.x + max.x) * 0.5f, cy = (min.y + max.y) * 0.5f, cz = (min.z + max.z) * 0.5f;
+    const float ex = (max.x - min.x) * 0.5f, ey = (max.y - min.y) * 0.5f, ez = (max.z - min.z) * 0.5f;
+    for (int i = 0; i < CAM_FRUSTUM_NUM_PLANES; i++) {
+        const vec4_t p = f->planes[i];
+        const float d = (p.x * cx + p.y * cy) + (p.z * cz + p.w);
+        const float r = (fabsf(p.x) * ex + fabsf(p.y) * ey) + fabsf(p.z) * ez;
+        if ((d + r) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline int _cam_popcount(uint32_t v) {
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (int)((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+#if defined(_CAM_SIMD_NEON)
+static inline uint32_t _cam_neon_movemask(uint32x4_t m) {
+    const uint32_t bits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t b = vandq_u32(m, vld1q_u32(bits));
+    return vgetq_lane_u32(b, 0) | vgetq_lane_u32(b, 1) | vgetq_lane_u32(b, 2) | vgetq_lane_u32(b, 3);
+}
+#endif
+
+/*
+    Test 'count' bounding spheres against the frustum, and write the result
+    into 'out_mask' (CAM_CULL_MASK_WORDS(count) words, bit i set if object i
+    is visible). Returns the number of visible objects.
+*/
+static inline int cam_cull_spheres(const cam_frustum_t* f, const vec3_t* centers, const float* radii, int count, uint32_t* out_mask) {
+    assert(f && centers && radii && out_mask && (count >= 0));
+    memset(out_mask, 0, CAM_CULL_MASK_WORDS(count) * sizeof(uint32_t));
+    int i = 0;
+    #if defined(_CAM_SIMD_AVX)
+    for (; (i + 8) <= count; i += 8) {
+        const vec3_t* c = &centers[i];
+        const __m256 x = _mm256_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x, c[4].x, c[5].x, c[6].x, c[7].x);
+        const __m256 y = _mm256_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y, c[4].y, c[5].y, c[6].y, c[7].y);
+        const __m256 z = _mm256_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z, c[4].z, c[5].z, c[6].z, c[7].z);
+        const __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&radii[i]));
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.x), x), _mm256_mul_ps(_mm256_set1_ps(pl.y), y));
+            d = _mm256_add_ps(d, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.z), z), _mm256_set1_ps(pl.w)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, neg_r, _CMP_LT_OQ));
+        }
+        out_mask[i >> 5] |= ((uint32_t)~_mm256_movemask_ps(outside) & 0xFFu) << (i & 31);
+    }
+    #endif
+    #if defined(_CAM_SIMD_SSE2)
+    for (; (i + 4) <= count; i += 4) {
+        const vec3_t* c = &centers[i];
+        const __m128 x = _mm_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x);
+        const __m128 y = _mm_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y);
+        const __m128 z = _mm_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z);
+        const __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radii[i]));
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            __m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.x), x), _mm_mul_ps(_mm_set1_ps(pl.y), y));
+            d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.z), z), _mm_set1_ps(pl.w)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, neg_r));
+        }
+        out_mask[i >> 5] |= ((uint32_t)~_mm_movemask_ps(outside) & 0xFu) << (i & 31);
+    }
+    #elif defined(_CAM_SIMD_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        const vec3_t* c = &centers[i];
+        const float xs[4] = { c[0].x, c[1].x, c[2].x, c[3].x };
+        const float ys[4] = { c[0].y, c[1].y, c[2].y, c[3].y };
+        const float zs[4] = { c[0].z, c[1].z, c[2].z, c[3].z };
+        const float32x4_t x = vld1q_f32(xs), y = vld1q_f32(ys), z = vld1q_f32(zs);
+        const float32x4_t neg_r = vnegq_f32(vld1q_f32(&radii[i]));
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            float32x4_t d = vaddq_f32(vmulq_n_f32(x, pl.x), vmulq_n_f32(y, pl.y));
+            d = vaddq_f32(d, vaddq_f32(vmulq_n_f32(z, pl.z), vdupq_n_f32(pl.w)));
+            outside = vorrq_u32(outside, vcltq_f32(d, neg_r));
+        }
+        out_mask[i >> 5] |= (~_cam_neon_movemask(outside) & 0xFu) << (i & 31);
+    }
+    #endif
+    for (; i < count; i++) {
+        if (cam_sphere_visible(f, centers[i], radii[i])) {
+            out_mask[i >> 5] |= 1u << (i & 31);
+        }
+    }
+    int num_visible = 0;
+    for (int w = 0; w < CAM_CULL_MASK_WORDS(count); w++) {
+        num_visible += _cam_popcount(out_mask[w]);
+    }
+    return num_visible;
+}
+
+/*
+    Test 'count' axis-aligned bounding boxes against the frustum, and write
+    the result into 'out_mask' (CAM_CULL_MASK_WORDS(count) words, bit i set
+    if object i is visible). Returns the number of visible objects.
+*/
+static inline int cam_cull_aabbs(const cam_frustum_t* f, const vec3_t* mins, const vec3_t* maxs, int count, uint32_t* out_mask) {
+    assert(f && mins && maxs && out_mask && (count >= 0));
+    memset(out_mask, 0, CAM_CULL_MASK_WORDS(count) * sizeof(uint32_t));
+    int i = 0;
+    #if defined(_CAM_SIMD_AVX)
+    for (; (i + 8) <= count; i += 8) {
+        const vec3_t* a = &mins[i];
+        const vec3_t* b = &maxs[i];
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 ax = _mm256_setr_ps(a[0].x, a[1].x, a[2].x, a[3].x, a[4].x, a[5].x, a[6].x, a[7].x);
+        const __m256 ay = _mm256_setr_ps(a[0].y, a[1].y, a[2].y, a[3].y, a[4].y, a[5].y, a[6].y, a[7].y);
+        const __m256 az = _mm256_setr_ps(a[0].z, a[1].z, a[2].z, a[3].z, a[4].z, a[5].z, a[6].z, a[7].z);
+        const __m256 bx = _mm256_setr_ps(b[0].x, b[1].x, b[2].x, b[3].x, b[4].x, b[5].x, b[6].x, b[7].x);
+        const __m256 by = _mm256_setr_ps(b[0].y, b[1].y, b[2].y, b[3].y, b[4].y, b[5].y, b[6].y, b[7].y);
+        const __m256 bz = _mm256_setr_ps(b[0].z, b[1].z, b[2].z, b[3].z, b[4].z, b[5].z, b[6].z, b[7].z);
+        const __m256 cx = _mm256_mul_ps(_mm256_add_ps(ax, bx), half), ex = _mm256_mul_ps(_mm256_sub_ps(bx, ax), half);
+        const __m256 cy = _mm256_mul_ps(_mm256_add_ps(ay, by), half), ey = _mm256_mul_ps(_mm256_sub_ps(by, ay), half);
+        const __m256 cz = _mm256_mul_ps(_mm256_add_ps(az, bz), half), ez = _mm256_mul_ps(_mm256_sub_ps(bz, az), half);
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.x), cx), _mm256_mul_ps(_mm256_set1_ps(pl.y), cy));
+            d = _mm256_add_ps(d, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.z), cz), _mm256_set1_ps(pl.w)));
+            __m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabsf(pl.x)), ex), _mm256_mul_ps(_mm256_set1_ps(fabsf(pl.y)), ey));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(fabsf(pl.z)), ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        out_mask[i >> 5] |= ((uint32_t)~_mm256_movemask_ps(outside) & 0xFFu) << (i & 31);
+    }
+    #endif
+    #if defined(_CAM_SIMD_SSE2)
+    for (; (i + 4) <= count; i += 4) {
+        const vec3_t* a = &mins[i];
+        const vec3_t* b = &maxs[i];
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 ax = _mm_setr_ps(a[0].x, a[1].x, a[2].x, a[3].x);
+        const __m128 ay = _mm_setr_ps(a[0].y, a[1].y, a[2].y, a[3].y);
+        const __m128 az = _mm_setr_ps(a[0].z, a[1].z, a[2].z, a[3].z);
+        const __m128 bx = _mm_setr_ps(b[0].x, b[1].x, b[2].x, b[3].x);
+        const __m128 by = _mm_setr_ps(b[0].y, b[1].y, b[2].y, b[3].y);
+        const __m128 bz = _mm_setr_ps(b[0].z, b[1].z, b[2].z, b[3].z);
+        const __m128 cx = _mm_mul_ps(_mm_add_ps(ax, bx), half), ex = _mm_mul_ps(_mm_sub_ps(bx, ax), half);
+        const __m128 cy = _mm_mul_ps(_mm_add_ps(ay, by), half), ey = _mm_mul_ps(_mm_sub_ps(by, ay), half);
+        const __m128 cz = _mm_mul_ps(_mm_add_ps(az, bz), half), ez = _mm_mul_ps(_mm_sub_ps(bz, az), half);
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            __m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.x), cx), _mm_mul_ps(_mm_set1_ps(pl.y), cy));
+            d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.z), cz), _mm_set1_ps(pl.w)));
+            __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(pl.x)), ex), _mm_mul_ps(_mm_set1_ps(fabsf(pl.y)), ey));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(fabsf(pl.z)), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        }
+        out_mask[i >> 5] |= ((uint32_t)~_mm_movemask_ps(outside) & 0xFu) << (i & 31);
+    }
+    #elif defined(_CAM_SIMD_NEON)
+    for (; (i + 4) <= count; i += 4) {
+        const vec3_t* a = &mins[i];
+        const vec3_t* b = &maxs[i];
+        const float axs[4] = { a[0].x, a[1].x, a[2].x, a[3].x }, bxs[4] = { b[0].x, b[1].x, b[2].x, b[3].x };
+        const float ays[4] = { a[0].y, a[1].y, a[2].y, a[3].y }, bys[4] = { b[0].y, b[1].y, b[2].y, b[3].y };
+        const float azs[4] = { a[0].z, a[1].z, a[2].z, a[3].z }, bzs[4] = { b[0].z, b[1].z, b[2].z, b[3].z };
+        const float32x4_t ax = vld1q_f32(axs), ay = vld1q_f32(ays), az = vld1q_f32(azs);
+        const float32x4_t bx = vld1q_f32(bxs), by = vld1q_f32(bys), bz = vld1q_f32(bzs);
+        const float32x4_t cx = vmulq_n_f32(vaddq_f32(ax, bx), 0.5f), ex = vmulq_n_f32(vsubq_f32(bx, ax), 0.5f);
+        const float32x4_t cy = vmulq_n_f32(vaddq_f32(ay, by), 0.5f), ey = vmulq_n_f32(vsubq_f32(by, ay), 0.5f);
+        const float32x4_t cz = vmulq_n_f32(vaddq_f32(az, bz), 0.5f), ez = vmulq_n_f32(vsubq_f32(bz, az), 0.5f);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < CAM_FRUSTUM_NUM_PLANES; p++) {
+            const vec4_t pl = f->planes[p];
+            float32x4_t d = vaddq_f32(vmulq_n_f32(cx, pl.x), vmulq_n_f32(cy, pl.y));
+            d = vaddq_f32(d, vaddq_f32(vmulq_n_f32(cz, pl.z), vdupq_n_f32(pl.w)));
+            float32x4_t r = vaddq_f32(vmulq_n_f32(ex, fabsf(pl.x)), vmulq_n_f32(ey, fabsf(pl.y)));
+            r = vaddq_f32(r, vmulq_n_f32(ez, fabsf(pl.z)));
+            outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(d, r), vdupq_n_f32(0.0f)));
+        }
+        out_mask[i >> 5] |= (~_cam_neon_movemask(outside) & 0xFu) << (i & 31);
+    }
+    #endif
+    for (; i < count; i++) {
+        if (cam_aabb_visible(f, mins[i], maxs[i])) {
+            out_mask[i >> 5] |= 1u << (i & 31);
+        }
+    }
+    int num_visible = 0;
+    for (int w = 0; w < CAM_CULL_MASK_WORDS(count); w++) {
+        num_visible += _cam_popcount(out_mask[w]);
+    }
+    return num_visible;
+}
@@ -0,0 +1,234 @@
+#pragma once
+/*
+    Multi-page glyph cache glue for fontstash.h on top of sokol_gl.h, an
+    alternative to sokol_fontstash.h for text heavy applications (e.g. lots
+    of CJK glyphs). Include after sokol_gfx.h, sokol_gl.h and fontstash.h.
+
+        FONScontext* fs = fonspages_create(&(fonspages_desc_t){
+            .page_width = 1024,
+            .page_height = 1024,
+            .max_pages = 4,
+        });
+        fonsAddFontMem(fs, ...);
+        ...
+        // records sokol-gl draw commands, one texture per atlas page
+        fonsDrawText(fs, ...);
+        ...
+        // once per frame after all text has been drawn, before sgl_draw()
+        fonspages_flush(fs);
+
+    Glyphs are rasterized into the current page until it is full, then a
+    new page is started until max_pages is reached. After that the least
+    recently used page is evicted: its glyphs are dropped from the cache
+    and rasterized again when they are needed, instead of the whole atlas
+    being reset or expanded. Pages used in the current frame are never
+    evicted, so a single frame can't use more glyphs than fit into all pages.
+
+    sokol-gfx images can only be updated as a whole, fonspages_flush() only
+    uploads pages which have changed since the last flush, and only the
+    changed rectangles are converted into the RGBA8 upload copy of a page.
+
+    Only one fonspages context may exist at a time.
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define FONSPAGES_DEFAULT_PAGE_SIZE (512)
+#define FONSPAGES_DEFAULT_MAX_PAGES (4)
+
+typedef struct {
+    int page_width;     // default is FONSPAGES_DEFAULT_PAGE_SIZE
+    int page_height;
+    int max_pages;      // default is FONSPAGES_DEFAULT_MAX_PAGES, at most FONS_MAX_PAGES
+} fonspages_desc_t;
+
+typedef struct {
+    int hits;           // glyph cache lookups since fonspages_reset_stats()
+    int misses;
+    int evictions;
+    int num_pages;
+    int max_pages;
+    int uploaded_pages; // in the last fonspages_flush()
+    size_t uploaded_bytes;
+} fonspages_stats_t;
+
+typedef struct {
+    sg_image img;
+    sg_view view;
+    uint32_t* pixels;
+    bool dirty;
+} _fonspages_page_t;
+
+static struct {
+    FONScontext* fons;
+    int width, height;
+    sg_sampler smp;
+    sgl_pipeline pip;
+    _fonspages_page_t pages[FONS_MAX_PAGES];
+    int uploaded_pages;
+    size_t uploaded_bytes;
+} _fonspages;
+
+static inline void _fonspages_destroy_pages(void) {
+    for (int i = 0; i < FONS_MAX_PAGES; i++) {
+        _fonspages_page_t* page = &_fonspages.pages[i];
+        if (page->pixels) {
+            sg_destroy_view(page->view);
+            sg_destroy_image(page->img);
+            free(page->pixels);
+        }
+        *page = (_fonspages_page_t){0};
+    }
+}
+
+static inline int _fonspages_render_create(void* user_ptr, int width, int height) {
+    (void)user_ptr;
+    _fonspages.width = width;
+    _fonspages.height = height;
+    return 1;
+}
+
+static inline int _fonspages_render_resize(void* user_ptr, int width, int height) {
+    // pages are created again on demand with the new size
+    _fonspages_destroy_pages();
+    return _fonspages_render_create(user_ptr, width, height);
+}
+
+// convert a changed rect of a fontstash page into the RGBA8 page copy
+static inline void _fonspages_render_update(void* user_ptr, int page_index, int* rect, const unsigned char* data) {
+    (void)user_ptr;
+    assert((page_index >= 0) && (page_index < FONS_MAX_PAGES));
+    _fonspages_page_t* page = &_fonspages.pages[page_index];
+    const int w = _fonspages.width;
+    const int h = _fonspages.height;
+    if (!page->pixels) {
+        page->pixels = (uint32_t*) calloc((size_t)(w * h), sizeof(uint32_t));
+        page->img = sg_make_image(&(sg_image_desc){
+            .usage.dynamic_update = true,
+            .width = w,
+            .height = h,
+            .pixel_format = SG_PIXELFORMAT_RGBA8,
+            .label = "fonspages-page",
+        });
+        page->view = sg_make_view(&(sg_view_desc){ .texture.image = page->img });
+    }
+    for (int y = rect[1]; y < rect[3]; y++) {
+        const unsigned char* src = &data[y * w];
+        uint32_t* dst = &page->pixels[y * w];
+        for (int x = rect[0]; x < rect[2]; x++) {
+            dst[x] = ((uint32_t)src[x] << 24) | 0x00FFFFFF;
+        }
+    }
+    page->dirty = true;
+}
+
+static inline void _fonspages_render_draw(void* user_ptr, int page_index, const float* verts, const float* tcoords, const unsigned int* colors, int nverts) {
+    (void)user_ptr;
+    const _fonspages_page_t* page = &_fonspages.pages[page_index];
+    if (!page->pixels) {
+        return;
+    }
+    sgl_enable_texture();
+    sgl_texture(page->view, _fonspages.smp);
+    sgl_push_pipeline();
+    sgl_load_pipeline(_fonspages.pip);
+    sgl_begin_triangles();
+    for (int i = 0; i < nverts; i++) {
+        sgl_v2f_t2f_c1i(verts[2*i+0], verts[2*i+1], tcoords[2*i+0], tcoords[2*i+1], colors[i]);
+    }
+    sgl_end();
+    sgl_pop_pipeline();
+    sgl_disable_texture();
+}
+
+static inline void _fonspages_render_delete(void* user_ptr) {
+    (void)user_ptr;
+    _fonspages_destroy_pages();
+}
+
+/* create the fontstash context, call after sg_setup() and sgl_setup() */
+static inline FONScontext* fonspages_create(const fonspages_desc_t* desc) {
+    assert(desc && !_fonspages.fons);
+    FONSparams params;
+    memset(&params, 0, sizeof(params));
+    params.width = (desc->page_width > 0) ? desc->page_width : FONSPAGES_DEFAULT_PAGE_SIZE;
+    params.height = (desc->page_height > 0) ? desc->page_height : FONSPAGES_DEFAULT_PAGE_SIZE;
+    params.flags = FONS_ZERO_TOPLEFT;
+    params.maxPages = (desc->max_pages > 0) ? desc->max_pages : FONSPAGES_DEFAULT_MAX_PAGES;
+    params.renderCreate = _fonspages_render_create;
+    params.renderResize = _fonspages_render_resize;
+    params.renderUpdatePage = _fonspages_render_update;
+    params.renderDrawPage = _fonspages_render_draw;
+    params.renderDelete = _fonspages_render_delete;
+    _fonspages.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_LINEAR,
+        .mag_filter = SG_FILTER_LINEAR,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "fonspages-sampler",
+    });
+    _fonspages.pip = sgl_make_pipeline(&(sg_pipeline_desc){
+        .colors[0].blend = {
+            .enabled = true,
+            .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+            .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        },
+        .label = "fonspages-pipeline",
+    });
+    _fonspages.fons = fonsCreateInternal(&params);
+    return _fonspages.fons;
+}
+
+static inline void fonspages_destroy(FONScontext* fons) {
+    assert(fons == _fonspages.fons);
+    fonsDeleteInternal(fons);
+    sgl_destroy_pipeline(_fonspages.pip);
+    sg_destroy_sampler(_fonspages.smp);
+    memset(&_fonspages, 0, sizeof(_fonspages));
+}
+
+/* upload changed pages and advance the cache frame, call once per frame outside a render pass */
+static inline void fonspages_flush(FONScontext* fons) {
+    assert(fons == _fonspages.fons);
+    _fonspages.uploaded_pages = 0;
+    _fonspages.uploaded_bytes = 0;
+    for (int i = 0; i < FONS_MAX_PAGES; i++) {
+        _fonspages_page_t* page = &_fonspages.pages[i];
+        if (!page->dirty) {
+            continue;
+        }
+        page->dirty = false;
+        const size_t size = (size_t)(_fonspages.width * _fonspages.height) * sizeof(uint32_t);
+        sg_update_image(page->img, &(sg_image_data){
+            .mip_levels[0] = { .ptr = page->pixels, .size = size },
+        });
+        _fonspages.uploaded_pages++;
+        _fonspages.uploaded_bytes += size;
+    }
+    fonsNextFrame(fons);
+}
+
+static inline uint32_t fonspages_rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return ((uint32_t)r) | ((uint32_t)g<<8) | ((uint32_t)b<<16) | ((uint32_t)a<<24);
+}
+
+static inline fonspages_stats_t fonspages_stats(FONScontext* fons) {
+    FONScacheStats cache;
+    fonsGetCacheStats(fons, &cache);
+    return (fonspages_stats_t){
+        .hits = cache.hits,
+        .misses = cache.misses,
+        .evictions = cache.evictions,
+        .num_pages = cache.numPages,
+        .max_pages = cache.maxPages,
+        .uploaded_pages = _fonspages.uploaded_pages,
+        .uploaded_bytes = _fonspages.uploaded_bytes,
+    };
+}
+
+static inline void fonspages_reset_stats(FONScontext* fons) {
+    fonsResetCacheStats(fons);
+}
@@ -0,0 +1,383 @@
+#pragma once
+/*
+    Quick'n'dirty work-stealing job system.
+
+    Each thread (the main thread and a fixed number of worker threads)
+    owns a job queue. Jobs are pushed to and popped from the front of the
+    pushing thread's own queue, idle threads steal jobs from the back of
+    other threads' queues.
+
+    Jobs are pushed into a 'group' (just an atomic counter of unfinished
+    jobs), the group can be polled with jobs_done() or waited on with
+    jobs_wait(), while waiting, the calling thread helps running jobs.
+
+    On platforms without threads (e.g. Emscripten without pthreads), or
+    when jobs_setup() was called with zero threads, jobs are executed
+    right away inside jobs_push().
+
+    Only call jobs_setup() and jobs_shutdown() from the main thread,
+    jobs_push() and jobs_wait() may also be called from inside jobs.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    #define JOBS_NO_THREADS (1)
+#elif defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <intrin.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <sched.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define JOBS_THREAD_LOCAL __declspec(thread)
+#else
+    #define JOBS_THREAD_LOCAL __thread
+#endif
+
+#define JOBS_MAX_THREADS (32)
+#define JOBS_MAX_QUEUED (256)   // per thread
+
+typedef void (*jobs_func_t)(void* user_data);
+
+typedef struct {
+    int num_threads;    // default: number of CPU cores minus one, negative: no worker threads
+} jobs_desc_t;
+
+typedef struct {
+    #if defined(_MSC_VER)
+    volatile long pending;
+    #else
+    int pending;
+    #endif
+} jobs_group_t;
+
+typedef struct {
+    jobs_func_t func;
+    void* user_data;
+    jobs_group_t* group;
+} _jobs_item_t;
+
+#if !defined(JOBS_NO_THREADS)
+#if defined(_WIN32)
+typedef SRWLOCK _jobs_lock_t;
+#else
+typedef pthread_mutex_t _jobs_lock_t;
+#endif
+
+// a per-thread job queue, the owner pushes and pops at the head, thieves steal at the tail
+typedef struct {
+    _jobs_lock_t lock;
+    uint32_t head;
+    uint32_t tail;
+    _jobs_item_t items[JOBS_MAX_QUEUED];
+} _jobs_queue_t;
+#endif
+
+static struct {
+    bool valid;
+    int num_threads;
+    #if !defined(JOBS_NO_THREADS)
+    bool quit;
+    jobs_group_t num_queued;    // total number of queued jobs, checked before going to sleep
+    _jobs_queue_t queues[JOBS_MAX_THREADS + 1];     // queue 0 belongs to the main thread
+    _jobs_lock_t sleep_lock;
+    #if defined(_WIN32)
+    CONDITION_VARIABLE sleep_cond;
+    HANDLE threads[JOBS_MAX_THREADS];
+    #else
+    pthread_cond_t sleep_cond;
+    pthread_t threads[JOBS_MAX_THREADS];
+    #endif
+    #endif
+} _jobs;
+
+// 0 on the main thread, 1..num_threads on worker threads
+static JOBS_THREAD_LOCAL int _jobs_thread_index;
+
+/* atomically add to a group counter, returns the new value */
+static inline int _jobs_atomic_add(jobs_group_t* group, int val) {
+    #if defined(_MSC_VER)
+    return (int)_InterlockedExchangeAdd(&group->pending, (long)val) + val;
+    #else
+    return __atomic_add_fetch(&group->pending, val, __ATOMIC_ACQ_REL);
+    #endif
+}
+
+static inline int _jobs_atomic_load(jobs_group_t* group) {
+    #if defined(_MSC_VER)
+    return (int)_InterlockedOr(&group->pending, 0);
+    #else
+    return __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE);
+    #endif
+}
+
+static inline void _jobs_run(const _jobs_item_t* item) {
+    item->func(item->user_data);
+    if (item->group) {
+        _jobs_atomic_add(item->group, -1);
+    }
+}
+
+/* returns the number of logical CPU cores minus one (the main thread) */
+static inline int jobs_default_num_threads(void) {
+    #if defined(JOBS_NO_THREADS)
+    return 0;
+    #else
+        #if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int num_cores = (int)info.dwNumberOfProcessors;
+        #else
+        int num_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        #endif
+        int num_threads = num_cores - 1;
+        if (num_threads < 0) {
+            num_threads = 0;
+        } else if (num_threads > JOBS_MAX_THREADS) {
+            num_threads = JOBS_MAX_THREADS;
+        }
+        return num_threads;
+    #endif
+}
+
+#if !defined(JOBS_NO_THREADS)
+#if defined(_WIN32)
+static inline void _jobs_lock_init(_jobs_lock_t* l) { InitializeSRWLock(l); }
+static inline void _jobs_lock_destroy(_jobs_lock_t* l) { (void)l; }
+static inline void _jobs_lock(_jobs_lock_t* l) { AcquireSRWLockExclusive(l); }
+static inline void _jobs_unlock(_jobs_lock_t* l) { ReleaseSRWLockExclusive(l); }
+static inline void _jobs_sleep(void) { SleepConditionVariableSRW(&_jobs.sleep_cond, &_jobs.sleep_lock, INFINITE, 0); }
+static inline void _jobs_wake_one(void) { WakeConditionVariable(&_jobs.sleep_cond); }
+static inline void _jobs_wake_all(void) { WakeAllConditionVariable(&_jobs.sleep_cond); }
+static inline void _jobs_yield(void) { SwitchToThread(); }
+#else
+static inline void _jobs_lock_init(_jobs_lock_t* l) { pthread_mutex_init(l, 0); }
+static inline void _jobs_lock_destroy(_jobs_lock_t* l) { pthread_mutex_destroy(l); }
+static inline void _jobs_lock(_jobs_lock_t* l) { pthread_mutex_lock(l); }
+static inline void _jobs_unlock(_jobs_lock_t* l) { pthread_mutex_unlock(l); }
+static inline void _jobs_sleep(void) { pthread_cond_wait(&_jobs.sleep_cond, &_jobs.sleep_lock); }
+static inline void _jobs_wake_one(void) { pthread_cond_signal(&_jobs.sleep_cond); }
+static inline void _jobs_wake_all(void) { pthread_cond_broadcast(&_jobs.sleep_cond); }
+static inline void _jobs_yield(void) { sched_yield(); }
+#endif
+
+static inline bool _jobs_queue_push(_jobs_queue_t* q, const _jobs_item_t* item) {
+    bool res = false;
+    _jobs_lock(&q->lock);
+    if ((q->head - q->tail) < JOBS_MAX_QUEUED) {
+        q->items[q->head++ % JOBS_MAX_QUEUED] = *item;
+        res = true;
+    }
+    _jobs_unlock(&q->lock);
+    return res;
+}
+
+/* pop the most recently pushed job (owner thread only) */
+static inline bool _jobs_queue_pop(_jobs_queue_t* q, _jobs_item_t* out_item) {
+    bool res = false;
+    _jobs_lock(&q->lock);
+    if (q->head != q->tail) {
+        *out_item = q->items[--q->head % JOBS_MAX_QUEUED];
+        res = true;
+    }
+    _jobs_unlock(&q->lock);
+    return res;
+}
+
+/* steal the oldest job (any thread) */
+static inline bool _jobs_queue_steal(_jobs_queue_t* q, _jobs_item_t* out_item) {
+    bool res = false;
+    _jobs_lock(&q->lock);
+    if (q->head != q->tail) {
+        *out_item = q->items[q->tail++ % JOBS_MAX_QUEUED];
+        res = true;
+    }
+    _jobs_unlock(&q->lock);
+    return res;
+}
+
+/* try to get a job from the own queue first, then from other threads */
+static inline bool _jobs_find(_jobs_item_t* out_item) {
+    if (0 == _jobs_atomic_load(&_jobs.num_queued)) {
+        return false;
+    }
+    const int self = _jobs_thread_index;
+    bool res = _jobs_queue_pop(&_jobs.queues[self], out_item);
+    for (int i = 1; !res && (i <= _jobs.num_threads); i++) {
+        res = _jobs_queue_steal(&_jobs.queues[(self + i) % (_jobs.num_threads + 1)], out_item);
+    }
+    if (res) {
+        _jobs_atomic_add(&_jobs.num_queued, -1);
+    }
+    return res;
+}
+
+static inline void _jobs_worker_loop(void) {
+    while (true) {
+        _jobs_item_t item;
+        if (_jobs_find(&item)) {
+            _jobs_run(&item);
+            continue;
+        }
+        _jobs_lock(&_jobs.sleep_lock);
+        if (_jobs.quit && (0 == _jobs_atomic_load(&_jobs.num_queued))) {
+            _jobs_unlock(&_jobs.sleep_lock);
+            break;
+        }
+        if (0 == _jobs_atomic_load(&_jobs.num_queued)) {
+            _jobs_sleep();
+        }
+        _jobs_unlock(&_jobs.sleep_lock);
+    }
+}
+
+#if defined(_WIN32)
+static inline DWORD WINAPI _jobs_thread_func(LPVOID arg) {
+    _jobs_thread_index = (int)(intptr_t)arg;
+    _jobs_worker_loop();
+    return 0;
+}
+#else
+static inline void* _jobs_thread_func(void* arg) {
+    _jobs_thread_index = (int)(intptr_t)arg;
+    _jobs_worker_loop();
+    return 0;
+}
+#endif
+#endif // !JOBS_NO_THREADS
+
+/* start the worker threads */
+static inline void jobs_setup(const jobs_desc_t* desc) {
+    assert(desc);
+    assert(!_jobs.valid);
+    memset(&_jobs, 0, sizeof(_jobs));
+    _jobs.valid = true;
+    _jobs_thread_index = 0;
+    #if !defined(JOBS_NO_THREADS)
+        if (desc->num_threads < 0) {
+            _jobs.num_threads = 0;
+        } else if (desc->num_threads == 0) {
+            _jobs.num_threads = jobs_default_num_threads();
+        } else {
+            _jobs.num_threads = desc->num_threads;
+        }
+        if (_jobs.num_threads > JOBS_MAX_THREADS) {
+            _jobs.num_threads = JOBS_MAX_THREADS;
+        }
+        _jobs_lock_init(&_jobs.sleep_lock);
+        for (int i = 0; i <= _jobs.num_threads; i++) {
+            _jobs_lock_init(&_jobs.queues[i].lock);
+        }
+        #if defined(_WIN32)
+        InitializeConditionVariable(&_jobs.sleep_cond);
+        for (int i = 0; i < _jobs.num_threads; i++) {
+            _jobs.threads[i] = CreateThread(NULL, 0, _jobs_thread_func, (LPVOID)(intptr_t)(i + 1), 0, NULL);
+        }
+        #else
+        pthread_cond_init(&_jobs.sleep_cond, 0);
+        for (int i = 0; i < _jobs.num_threads; i++) {
+            pthread_create(&_jobs.threads[i], 0, _jobs_thread_func, (void*)(intptr_t)(i + 1));
+        }
+        #endif
+    #else
+        (void)desc;
+    #endif
+}
+
+/* finish all queued jobs and stop the worker threads */
+static inline void jobs_shutdown(void) {
+    assert(_jobs.valid);
+    #if !defined(JOBS_NO_THREADS)
+        _jobs_lock(&_jobs.sleep_lock);
+        _jobs.quit = true;
+        _jobs_wake_all();
+        _jobs_unlock(&_jobs.sleep_lock);
+        for (int i = 0; i < _jobs.num_threads; i++) {
+            #if defined(_WIN32)
+            WaitForSingleObject(_jobs.threads[i], INFINITE);
+            CloseHandle(_jobs.threads[i]);
+            #else
+            pthread_join(_jobs.threads[i], 0);
+            #endif
+        }
+        // run any jobs that are left over (only happens without worker threads)
+        _jobs_item_t item;
+        while (_jobs_find(&item)) {
+            _jobs_run(&item);
+        }
+        for (int i = 0; i <= _jobs.num_threads; i++) {
+            _jobs_lock_destroy(&_jobs.queues[i].lock);
+        }
+        _jobs_lock_destroy(&_jobs.sleep_lock);
+        #if !defined(_WIN32)
+        pthread_cond_destroy(&_jobs.sleep_cond);
+        #endif
+    #endif
+    _jobs.valid = false;
+}
+
+/* number of worker threads (not counting the main thread) */
+static inline int jobs_num_threads(void) {
+    return _jobs.num_threads;
+}
+
+/* index of the calling thread, 0 for the main thread, 1..jobs_num_threads() for worker threads */
+static inline int jobs_thread_index(void) {
+    return _jobs_thread_index;
+}
+
+/* push a job, the group pointer is optional and must outlive the job */
+static inline void jobs_push(jobs_group_t* group, jobs_func_t func, void* user_data) {
+    assert(_jobs.valid && func);
+    _jobs_item_t item = { func, user_data, group };
+    if (group) {
+        _jobs_atomic_add(group, 1);
+    }
+    #if !defined(JOBS_NO_THREADS)
+    if (_jobs.num_threads > 0) {
+        if (_jobs_queue_push(&_jobs.queues[_jobs_thread_index], &item)) {
+            _jobs_atomic_add(&_jobs.num_queued, 1);
+            // wake a sleeping worker, taking the lock prevents a lost wakeup
+            _jobs_lock(&_jobs.sleep_lock);
+            _jobs_wake_one();
+            _jobs_unlock(&_jobs.sleep_lock);
+            return;
+        }
+    }
+    #endif
+    // no worker threads or queue full: run the job right here
+    _jobs_run(&item);
+}
+
+/* check if all jobs in a group have finished (non-blocking) */
+static inline bool jobs_done(jobs_group_t* group) {
+    assert(group);
+    return 0 == _jobs_atomic_load(group);
+}
+
+/* wait until all jobs in a group have finished, helps running queued jobs while waiting */
+static inline void jobs_wait(jobs_group_t* group) {
+    assert(group);
+    while (!jobs_done(group)) {
+        #if !defined(JOBS_NO_THREADS)
+        _jobs_item_t item;
+        if (_jobs_find(&item)) {
+            _jobs_run(&item);
+        } else {
+            _jobs_yield();
+        }
+        #endif
+    }
+}
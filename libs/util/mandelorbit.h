@@ -0,0 +1,232 @@
+#pragma once
+/*
+    Reference orbits for rendering deep Mandelbrot zooms with perturbation
+    (see mandelbrot-sapp.c, tested in mandelorbit-test.c).
+
+    The orbit of a reference point C (usually the view center) is iterated
+    on the CPU in double-double precision (about 32 decimal digits) and
+    stored as float pairs:
+
+        float orbit[2 * MAX_ITER];
+        int len = mandelorbit_compute(center_re, center_im, MAX_ITER, orbit);
+
+    Every pixel c = C + dc then only iterates its float difference dz to
+    the reference orbit Z:
+
+        dz' = 2*Z*dz + dz^2 + dc
+
+    which works down to a view width of about 1e-30 instead of about 1e-7
+    for a plain float iteration. mandelorbit_iterations() is the CPU version
+    of this loop which must match the fragment shader. When the reference
+    orbit escapes before the pixel, or when |Z+dz| < |dz| (which would lose
+    precision), the pixel continues with the start of the reference orbit
+    ('rebasing'), so any point in the view works as reference. Precision
+    is only kept if the reference orbit doesn't escape much earlier than the
+    pixels though, mandelorbit_find_reference() looks for a good one.
+
+    The double-double functions rely on strict IEEE double rounding and
+    break with -ffast-math or /fp:fast.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <assert.h>
+
+#define MANDELORBIT_ESCAPE_RADIUS_SQ (4.0)
+
+// a double-double number, the unevaluated sum hi + lo with |lo| <= ulp(hi)/2
+typedef struct {
+    double hi;
+    double lo;
+} mandelorbit_dd_t;
+
+static inline mandelorbit_dd_t mandelorbit_dd(double v) {
+    mandelorbit_dd_t res = { v, 0.0 };
+    return res;
+}
+
+static inline double mandelorbit_dd_to_double(mandelorbit_dd_t a) {
+    return a.hi + a.lo;
+}
+
+// error-free transformations (Knuth two-sum, Dekker split and product), with
+// hardware FMA the product error comes from fma(), this also keeps it exact
+// when the compiler contracts the split into FMA instructions
+static inline mandelorbit_dd_t _mandelorbit_two_sum(double a, double b) {
+    const double s = a + b;
+    const double bb = s - a;
+    mandelorbit_dd_t res = { s, (a - (s - bb)) + (b - bb) };
+    return res;
+}
+
+static inline mandelorbit_dd_t _mandelorbit_quick_two_sum(double a, double b) {
+    const double s = a + b;
+    mandelorbit_dd_t res = { s, b - (s - a) };
+    return res;
+}
+
+static inline mandelorbit_dd_t _mandelorbit_two_prod(double a, double b) {
+    #if defined(__FMA__) || defined(__ARM_FEATURE_FMA) || defined(FP_FAST_FMA)
+    const double p = a * b;
+    mandelorbit_dd_t res = { p, fma(a, b, -p) };
+    return res;
+    #else
+    const double split = 134217729.0; // 2^27 + 1
+    const double ta = split * a;
+    const double a_hi = ta - (ta - a);
+    const double a_lo = a - a_hi;
+    const double tb = split * b;
+    const double b_hi = tb - (tb - b);
+    const double b_lo = b - b_hi;
+    const double p = a * b;
+    mandelorbit_dd_t res = { p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo };
+    return res;
+    #endif
+}
+
+static inline mandelorbit_dd_t mandelorbit_dd_add(mandelorbit_dd_t a, mandelorbit_dd_t b) {
+    const mandelorbit_dd_t s = _mandelorbit_two_sum(a.hi, b.hi);
+    const mandelorbit_dd_t t = _mandelorbit_two_sum(a.lo, b.lo);
+    mandelorbit_dd_t res = _mandelorbit_quick_two_sum(s.hi, s.lo + t.hi);
+    return _mandelorbit_quick_two_sum(res.hi, res.lo + t.lo);
+}
+
+static inline mandelorbit_dd_t mandelorbit_dd_neg(mandelorbit_dd_t a) {
+    mandelorbit_dd_t res = { -a.hi, -a.lo };
+    return res;
+}
+
+static inline mandelorbit_dd_t mandelorbit_dd_sub(mandelorbit_dd_t a, mandelorbit_dd_t b) {
+    return mandelorbit_dd_add(a, mandelorbit_dd_neg(b));
+}
+
+static inline mandelorbit_dd_t mandelorbit_dd_mul(mandelorbit_dd_t a, mandelorbit_dd_t b) {
+    const mandelorbit_dd_t p = _mandelorbit_two_prod(a.hi, b.hi);
+    return _mandelorbit_quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+// multiply with a plain double, e.g. a pixel offset or zoom factor
+static inline mandelorbit_dd_t mandelorbit_dd_mul_d(mandelorbit_dd_t a, double b) {
+    const mandelorbit_dd_t p = _mandelorbit_two_prod(a.hi, b);
+    return _mandelorbit_quick_two_sum(p.hi, p.lo + a.lo * b);
+}
+
+/*
+    iterate the reference point (c_re, c_im) and write Z_0 = 0, Z_1 = c, ...
+    as float pairs into out_orbit until the orbit escapes or max_len entries
+    have been written, returns the number of entries (at least 2)
+*/
+static inline int mandelorbit_compute(mandelorbit_dd_t c_re, mandelorbit_dd_t c_im, int max_len, float* out_orbit) {
+    assert(out_orbit && (max_len >= 2));
+    mandelorbit_dd_t z_re = mandelorbit_dd(0.0);
+    mandelorbit_dd_t z_im = mandelorbit_dd(0.0);
+    int len = 0;
+    while (len < max_len) {
+        const double re = mandelorbit_dd_to_double(z_re);
+        const double im = mandelorbit_dd_to_double(z_im);
+        out_orbit[len * 2 + 0] = (float)re;
+        out_orbit[len * 2 + 1] = (float)im;
+        len++;
+        if ((re * re + im * im) > MANDELORBIT_ESCAPE_RADIUS_SQ) {
+            break;
+        }
+        const mandelorbit_dd_t re2 = mandelorbit_dd_mul(z_re, z_re);
+        const mandelorbit_dd_t im2 = mandelorbit_dd_mul(z_im, z_im);
+        const mandelorbit_dd_t reim = mandelorbit_dd_mul(z_re, z_im);
+        z_re = mandelorbit_dd_add(mandelorbit_dd_sub(re2, im2), c_re);
+        z_im = mandelorbit_dd_add(mandelorbit_dd_mul_d(reim, 2.0), c_im);
+    }
+    return len;
+}
+
+/*
+    the view center is a bad reference point if it escapes much earlier
+    than the other pixels, after the reference has escaped, pixels continue
+    with only float precision and deep zooms turn into noise, so this tries
+    the center and a grid of num_grid x num_grid points in the view and
+    keeps the one with the longest orbit, the offset of the reference point
+    from the view center is returned in out_ofs_re/im
+*/
+static inline int mandelorbit_find_reference(mandelorbit_dd_t center_re, mandelorbit_dd_t center_im, double width, double height, int num_grid, int max_len, float* out_orbit, double* out_ofs_re, double* out_ofs_im) {
+    assert(out_ofs_re && out_ofs_im);
+    int best_len = mandelorbit_compute(center_re, center_im, max_len, out_orbit);
+    int best_index = -1;
+    for (int i = 0; (i < num_grid * num_grid) && (best_len < max_len); i++) {
+        const double ofs_re = (((double)(i % num_grid) + 0.5) / (double)num_grid - 0.5) * width;
+        const double ofs_im = (((double)(i / num_grid) + 0.5) / (double)num_grid - 0.5) * height;
+        const int len = mandelorbit_compute(
+            mandelorbit_dd_add(center_re, mandelorbit_dd(ofs_re)),
+            mandelorbit_dd_add(center_im, mandelorbit_dd(ofs_im)),
+            max_len, out_orbit);
+        if (len > best_len) {
+            best_len = len;
+            best_index = i;
+        }
+    }
+    *out_ofs_re = 0.0;
+    *out_ofs_im = 0.0;
+    if (best_index >= 0) {
+        *out_ofs_re = (((double)(best_index % num_grid) + 0.5) / (double)num_grid - 0.5) * width;
+        *out_ofs_im = (((double)(best_index / num_grid) + 0.5) / (double)num_grid - 0.5) * height;
+    }
+    // the last computed orbit isn't necessarily the best one
+    return mandelorbit_compute(
+        mandelorbit_dd_add(center_re, mandelorbit_dd(*out_ofs_re)),
+        mandelorbit_dd_add(center_im, mandelorbit_dd(*out_ofs_im)),
+        max_len, out_orbit);
+}
+
+/*
+    the number of iterations until the point at offset (dc_re, dc_im) from
+    the reference point escapes (iter_max if it doesn't), same as the
+    perturbation loop in the mandelbrot-sapp fragment shader
+*/
+static inline int mandelorbit_iterations(const float* orbit, int orbit_len, float dc_re, float dc_im, int iter_max) {
+    assert(orbit && (orbit_len >= 2));
+    float dz_re = 0.0f;
+    float dz_im = 0.0f;
+    int m = 0;
+    int n = 0;
+    for (; n < iter_max; n++) {
+        // dz = (2*Z + dz) * dz + dc
+        const float a_re = 2.0f * orbit[m * 2 + 0] + dz_re;
+        const float a_im = 2.0f * orbit[m * 2 + 1] + dz_im;
+        const float t_re = a_re * dz_re - a_im * dz_im + dc_re;
+        const float t_im = a_re * dz_im + a_im * dz_re + dc_im;
+        dz_re = t_re;
+        dz_im = t_im;
+        m++;
+        const float z_re = orbit[m * 2 + 0] + dz_re;
+        const float z_im = orbit[m * 2 + 1] + dz_im;
+        const float z_sq = z_re * z_re + z_im * z_im;
+        if (z_sq > (float)MANDELORBIT_ESCAPE_RADIUS_SQ) {
+            break;
+        }
+        if ((z_sq < (dz_re * dz_re + dz_im * dz_im)) || (m >= (orbit_len - 1))) {
+            dz_re = z_re;
+            dz_im = z_im;
+            m = 0;
+        }
+    }
+    return n;
+}
+
+/* the same as mandelorbit_iterations() with a full double-double iteration of c, slow */
+static inline int mandelorbit_iterations_dd(mandelorbit_dd_t c_re, mandelorbit_dd_t c_im, int iter_max) {
+    mandelorbit_dd_t z_re = mandelorbit_dd(0.0);
+    mandelorbit_dd_t z_im = mandelorbit_dd(0.0);
+    int n = 0;
+    for (; n < iter_max; n++) {
+        const mandelorbit_dd_t re2 = mandelorbit_dd_mul(z_re, z_re);
+        const mandelorbit_dd_t im2 = mandelorbit_dd_mul(z_im, z_im);
+        const mandelorbit_dd_t reim = mandelorbit_dd_mul(z_re, z_im);
+        z_re = mandelorbit_dd_add(mandelorbit_dd_sub(re2, im2), c_re);
+        z_im = mandelorbit_dd_add(mandelorbit_dd_mul_d(reim, 2.0), c_im);
+        const double re = mandelorbit_dd_to_double(z_re);
+        const double im = mandelorbit_dd_to_double(z_im);
+        if ((re * re + im * im) > MANDELORBIT_ESCAPE_RADIUS_SQ) {
+            break;
+        }
+    }
+    return n;
+}
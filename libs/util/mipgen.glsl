@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+//  Mip level compute shader for util/mipgen.h, include it into a sample's
+//  shader file with:
+//
+//      @include ../libs/util/mipgen.glsl
+//
+//  Each dispatch writes one mip level filtered from the previous level,
+//  the filter weights must match _mipgen_weights() in util/mipgen.h.
+//------------------------------------------------------------------------------
+
+// mipgen_params, mipgen_src_tex and mipgen_smp must be declared by the shader
+@block mipgen_filter
+const float MIPGEN_KAISER_WIDTH = 3.0;
+const float MIPGEN_KAISER_ALPHA = 4.0;
+const int MIPGEN_MAX_TAPS = 20;
+const float MIPGEN_PI = 3.14159265358979;
+
+float mipgen_bessel_i0(float x) {
+    float q = 0.25 * x * x;
+    float sum = 1.0;
+    float term = 1.0;
+    for (int k = 1; k < 20; k++) {
+        term *= q / float(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+float mipgen_kaiser(float t) {
+    float x = t / MIPGEN_KAISER_WIDTH;
+    if (abs(x) >= 1.0) {
+        return 0.0;
+    }
+    float sinc = (abs(t) < 1e-6) ? 1.0 : (sin(MIPGEN_PI * t) / (MIPGEN_PI * t));
+    return sinc * mipgen_bessel_i0(MIPGEN_KAISER_ALPHA * sqrt(1.0 - x * x)) / mipgen_bessel_i0(MIPGEN_KAISER_ALPHA);
+}
+
+// 1D filter weights of destination pixel x, returns the number of taps
+int mipgen_weights(int x, int src_size, int dst_size, out int first, out float weights[MIPGEN_MAX_TAPS]) {
+    float s = float(src_size) / float(dst_size);
+    int num = 0;
+    if (mode.x == 0) {
+        // box: area of each source pixel covered by the destination pixel
+        float x0 = float(x) * s;
+        float x1 = float(x + 1) * s;
+        first = int(floor(x0));
+        int last = int(ceil(x1)) - 1;
+        for (int i = first; (i <= last) && (num < MIPGEN_MAX_TAPS); i++) {
+            weights[num++] = (min(float(i + 1), x1) - max(float(i), x0)) / s;
+        }
+    } else {
+        // kaiser windowed sinc
+        float u = (float(x) + 0.5) * s;
+        float r = MIPGEN_KAISER_WIDTH * s;
+        first = int(floor(u - r));
+        int last = int(ceil(u + r));
+        float sum = 0.0;
+        for (int i = first; (i <= last) && (num < MIPGEN_MAX_TAPS); i++) {
+            float w = mipgen_kaiser((float(i) + 0.5 - u) / s);
+            weights[num++] = w;
+            sum += w;
+        }
+        for (int i = 0; i < num; i++) {
+            weights[i] /= sum;
+        }
+    }
+    return num;
+}
+
+vec3 mipgen_srgb_to_linear(vec3 c) {
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), greaterThan(c, vec3(0.04045)));
+}
+
+vec3 mipgen_linear_to_srgb(vec3 l) {
+    l = clamp(l, 0.0, 1.0);
+    return mix(l * 12.92, 1.055 * pow(l, vec3(1.0 / 2.4)) - 0.055, greaterThan(l, vec3(0.0031308)));
+}
+
+vec4 mipgen_fetch(ivec2 pos) {
+    vec4 c = texelFetch(sampler2D(mipgen_src_tex, mipgen_smp), clamp(pos, ivec2(0), size.xy - 1), 0);
+    if (mode.y != 0) {
+        c.rgb = mipgen_srgb_to_linear(c.rgb);
+    }
+    return c;
+}
+
+// the filtered destination pixel
+vec4 mipgen_sample(ivec2 dst_pos) {
+    if (mode.z != 0) {
+        // straight copy of level 0
+        return texelFetch(sampler2D(mipgen_src_tex, mipgen_smp), dst_pos, 0);
+    }
+    int first_x;
+    int first_y;
+    float wx[MIPGEN_MAX_TAPS];
+    float wy[MIPGEN_MAX_TAPS];
+    int num_x = mipgen_weights(dst_pos.x, size.x, size.z, first_x, wx);
+    int num_y = mipgen_weights(dst_pos.y, size.y, size.w, first_y, wy);
+    vec4 acc = vec4(0.0);
+    for (int j = 0; j < num_y; j++) {
+        vec4 row = vec4(0.0);
+        for (int i = 0; i < num_x; i++) {
+            row += wx[i] * mipgen_fetch(ivec2(first_x + i, first_y + j));
+        }
+        acc += wy[j] * row;
+    }
+    if (mode.y != 0) {
+        acc.rgb = mipgen_linear_to_srgb(acc.rgb);
+    }
+    return clamp(acc, 0.0, 1.0);
+}
+@end
+
+@cs mipgen_cs
+layout(binding=0) uniform mipgen_params {
+    ivec4 size;     // source width and height, destination width and height
+    ivec4 mode;     // x: filter (0: box, 1: kaiser), y: sRGB, z: copy level 0
+};
+layout(binding=0) uniform texture2D mipgen_src_tex;
+layout(binding=0) uniform sampler mipgen_smp;
+layout(binding=1, rgba8) uniform writeonly image2D mipgen_dst_img;
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+
+@include_block mipgen_filter
+
+void main() {
+    ivec2 dst_pos = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(dst_pos, size.zw))) {
+        return;
+    }
+    imageStore(mipgen_dst_img, dst_pos, mipgen_sample(dst_pos));
+}
+@end
+
+@program mipgen mipgen_cs
@@ -0,0 +1,575 @@
+#pragma once
+/*
+    Mipmap chain generation for RGBA8 textures, used by loadpng-sapp.c and
+    cubemap-jpeg-sapp.c, benchmarked in mipgen-bench.c.
+
+    Each mip level is filtered from the previous level, either on the GPU
+    with a compute shader (util/mipgen.glsl) or on the CPU (SSE2, NEON or a
+    scalar fallback). Both paths use the same filter weights:
+
+        - MIPGEN_FILTER_BOX: each destination pixel is the area-weighted
+          average of the source pixels it covers
+        - MIPGEN_FILTER_KAISER: a Kaiser-windowed sinc with a support of
+          MIPGEN_KAISER_WIDTH destination pixels, sharper than the box
+          filter, but the negative lobes may ring at hard edges
+
+    Non-power-of-two sizes are handled by computing the filter footprint of
+    each destination pixel in continuous coordinates (so an odd source
+    size produces 3-tap box footprints with fractional weights instead of
+    dropping the last row or column). The next level size is max(1, size/2).
+
+    By default the color channels are treated as sRGB encoded: they're
+    converted to linear before filtering and back to sRGB afterward (alpha
+    is always linear). Set 'linear' for normal maps or other data textures.
+
+    CPU only (no sokol-gfx needed), levels[0] is the source image and
+    levels[1..num_mipmaps-1] are written:
+
+        uint8_t* levels[MIPGEN_MAX_MIPMAPS];
+        mipgen_cpu_chain(levels, width, height, num_mipmaps, MIPGEN_FILTER_BOX, true);
+
+    With sokol-gfx, create a texture with a complete mip chain from the
+    tightly packed level 0 pixels:
+
+        mipgen_setup();
+        sg_image img = mipgen_make_image(&(mipgen_image_desc_t){
+            .width = width,
+            .height = height,
+            .data = { pixels, width * height * 4 },
+        });
+        ...
+        mipgen_shutdown();
+
+    mipgen_make_image() must be called outside of a pass. The GPU path is
+    only compiled in when the shader header generated from util/mipgen.glsl
+    (or from a shader file which @includes it, without a @module prefix) is
+    included before this header, the build scripts do this for samples
+    with 'mipgen: true' on platforms with compute support:
+
+        #if defined(MIPGEN_COMPUTE)
+        #include "mipgen.glsl.h"
+        #endif
+        #include "util/mipgen.h"
+
+    At runtime the GPU path is only used if the backend supports compute
+    shaders and writing RGBA8 storage images (and on GL texture views,
+    since each dispatch reads a single mip level of the image it writes
+    to). The whole chain is built in one compute pass with one dispatch
+    per level. Cubemaps and array textures always use the CPU path since
+    the compute shader only writes 2D storage images.
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define _MIPGEN_SIMD_SSE2 (1)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define _MIPGEN_SIMD_NEON (1)
+#endif
+
+#define MIPGEN_MAX_MIPMAPS (16)
+// filter support and shape of the Kaiser filter, must match util/mipgen.glsl
+#define MIPGEN_KAISER_WIDTH (3.0f)
+#define MIPGEN_KAISER_ALPHA (4.0f)
+// max taps per dimension (Kaiser filter with a 3:1 footprint for odd sizes)
+#define MIPGEN_MAX_TAPS (20)
+
+typedef enum {
+    MIPGEN_FILTER_BOX,
+    MIPGEN_FILTER_KAISER,
+    MIPGEN_NUM_FILTERS,
+} mipgen_filter_t;
+
+// the 4 float channels of one pixel
+#if defined(_MIPGEN_SIMD_SSE2)
+typedef __m128 _mipgen_vec_t;
+#elif defined(_MIPGEN_SIMD_NEON)
+typedef float32x4_t _mipgen_vec_t;
+#else
+typedef struct { float v[4]; } _mipgen_vec_t;
+#endif
+
+/* number of mip levels of a complete mip chain down to 1x1 */
+static inline int mipgen_num_mipmaps(int width, int height) {
+    assert((width > 0) && (height > 0));
+    int max_dim = (width > height) ? width : height;
+    int num = 1;
+    while ((max_dim > 1) && (num < MIPGEN_MAX_MIPMAPS)) {
+        max_dim >>= 1;
+        num++;
+    }
+    return num;
+}
+
+/* width or height of a mip level */
+static inline int mipgen_level_dim(int dim, int level) {
+    const int res = dim >> level;
+    return (res < 1) ? 1 : res;
+}
+
+static inline float _mipgen_srgb_to_linear(float c) {
+    return (c <= 0.04045f) ? (c / 12.92f) : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// modified Bessel function of the first kind, order 0 (power series)
+static inline float _mipgen_bessel_i0(float x) {
+    const float q = 0.25f * x * x;
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= q / (float)(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc, t is the distance in destination pixels
+static inline float _mipgen_kaiser(float t) {
+    const float x = t / MIPGEN_KAISER_WIDTH;
+    if (fabsf(x) >= 1.0f) {
+        return 0.0f;
+    }
+    const float pi = 3.14159265358979f;
+    const float sinc = (fabsf(t) < 1e-6f) ? 1.0f : (sinf(pi * t) / (pi * t));
+    const float window = _mipgen_bessel_i0(MIPGEN_KAISER_ALPHA * sqrtf(1.0f - x * x)) / _mipgen_bessel_i0(MIPGEN_KAISER_ALPHA);
+    return sinc * window;
+}
+
+/*
+    1D filter weights of destination pixel x, returns the number of taps
+    and the first source pixel (which may be outside the source for the
+    Kaiser filter, the caller clamps to the edge), same as
+    mipgen_weights() in util/mipgen.glsl
+*/
+static inline int _mipgen_weights(mipgen_filter_t filter, int x, int src_size, int dst_size, int* out_first, float* out_weights) {
+    const float s = (float)src_size / (float)dst_size;
+    int num = 0;
+    if (filter == MIPGEN_FILTER_BOX) {
+        const float x0 = (float)x * s;
+        const float x1 = (float)(x + 1) * s;
+        const int first = (int)floorf(x0);
+        const int last = (int)ceilf(x1) - 1;
+        *out_first = first;
+        for (int i = first; (i <= last) && (num < MIPGEN_MAX_TAPS); i++) {
+            const float lo = ((float)i > x0) ? (float)i : x0;
+            const float hi = ((float)(i + 1) < x1) ? (float)(i + 1) : x1;
+            out_weights[num++] = (hi - lo) / s;
+        }
+    } else {
+        const float u = ((float)x + 0.5f) * s;
+        const float r = MIPGEN_KAISER_WIDTH * s;
+        const int first = (int)floorf(u - r);
+        const int last = (int)ceilf(u + r);
+        *out_first = first;
+        float sum = 0.0f;
+        for (int i = first; (i <= last) && (num < MIPGEN_MAX_TAPS); i++) {
+            const float w = _mipgen_kaiser(((float)i + 0.5f - u) / s);
+            out_weights[num++] = w;
+            sum += w;
+        }
+        for (int i = 0; i < num; i++) {
+            out_weights[i] /= sum;
+        }
+    }
+    return num;
+}
+
+static inline int _mipgen_clamp(int i, int last) {
+    return (i < 0) ? 0 : ((i > last) ? last : i);
+}
+
+static inline _mipgen_vec_t _mipgen_zero(void) {
+    #if defined(_MIPGEN_SIMD_SSE2)
+    return _mm_setzero_ps();
+    #elif defined(_MIPGEN_SIMD_NEON)
+    return vdupq_n_f32(0.0f);
+    #else
+    _mipgen_vec_t res = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+    return res;
+    #endif
+}
+
+static inline _mipgen_vec_t _mipgen_load(const float* ptr) {
+    #if defined(_MIPGEN_SIMD_SSE2)
+    return _mm_loadu_ps(ptr);
+    #elif defined(_MIPGEN_SIMD_NEON)
+    return vld1q_f32(ptr);
+    #else
+    _mipgen_vec_t res = { { ptr[0], ptr[1], ptr[2], ptr[3] } };
+    return res;
+    #endif
+}
+
+// an RGBA8 pixel converted to linear float with the decode table (alpha is always linear)
+static inline _mipgen_vec_t _mipgen_load_rgba8(const uint8_t* ptr, const float* decode) {
+    #if defined(_MIPGEN_SIMD_SSE2)
+    return _mm_setr_ps(decode[ptr[0]], decode[ptr[1]], decode[ptr[2]], (float)ptr[3] * (1.0f / 255.0f));
+    #elif defined(_MIPGEN_SIMD_NEON)
+    const float v[4] = { decode[ptr[0]], decode[ptr[1]], decode[ptr[2]], (float)ptr[3] * (1.0f / 255.0f) };
+    return vld1q_f32(v);
+    #else
+    _mipgen_vec_t res = { { decode[ptr[0]], decode[ptr[1]], decode[ptr[2]], (float)ptr[3] * (1.0f / 255.0f) } };
+    return res;
+    #endif
+}
+
+static inline void _mipgen_store(float* ptr, _mipgen_vec_t a) {
+    #if defined(_MIPGEN_SIMD_SSE2)
+    _mm_storeu_ps(ptr, a);
+    #elif defined(_MIPGEN_SIMD_NEON)
+    vst1q_f32(ptr, a);
+    #else
+    memcpy(ptr, a.v, sizeof(a.v));
+    #endif
+}
+
+// acc + a * w
+static inline _mipgen_vec_t _mipgen_madd(_mipgen_vec_t acc, _mipgen_vec_t a, float w) {
+    #if defined(_MIPGEN_SIMD_SSE2)
+    return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(w)));
+    #elif defined(_MIPGEN_SIMD_NEON)
+    return vmlaq_n_f32(acc, a, w);
+    #else
+    for (int i = 0; i < 4; i++) {
+        acc.v[i] += a.v[i] * w;
+    }
+    return acc;
+    #endif
+}
+
+// 8-bit sRGB quantization of a linear value, thresholds[b] is the smallest
+// linear value which rounds to sRGB value b+1
+static inline uint8_t _mipgen_encode_srgb_exact(float v, const float* thresholds) {
+    int lo = 0;
+    int hi = 255;
+    while (lo < hi) {
+        const int mid = (lo + hi) >> 1;
+        if (v >= thresholds[mid]) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (uint8_t)lo;
+}
+
+// same result as _mipgen_encode_srgb_exact(), the table lookup is off by
+// at most one step which the thresholds correct
+#define _MIPGEN_ENCODE_TABLE_SIZE (4096)
+static inline uint8_t _mipgen_encode_srgb(float v, const uint8_t* table, const float* thresholds) {
+    v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+    int b = table[(int)(v * (float)(_MIPGEN_ENCODE_TABLE_SIZE - 1))];
+    while ((b < 255) && (v >= thresholds[b])) {
+        b++;
+    }
+    while ((b > 0) && (v < thresholds[b - 1])) {
+        b--;
+    }
+    return (uint8_t)b;
+}
+
+static inline uint8_t _mipgen_encode_linear(float v) {
+    v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+/*
+    filter one mip level from the previous one, both tightly packed RGBA8,
+    dst must be max(1, src/2) in each dimension (other sizes work too)
+*/
+static inline void mipgen_cpu_level(uint8_t* dst, int dst_width, int dst_height, const uint8_t* src, int src_width, int src_height, mipgen_filter_t filter, bool srgb) {
+    assert(dst && src && (dst != src));
+    assert((dst_width > 0) && (dst_height > 0) && (src_width > 0) && (src_height > 0));
+    assert((filter >= 0) && (filter < MIPGEN_NUM_FILTERS));
+
+    // sRGB decode and encode tables
+    float decode[256];
+    float thresholds[256];
+    uint8_t encode[_MIPGEN_ENCODE_TABLE_SIZE];
+    for (int i = 0; i < 256; i++) {
+        decode[i] = srgb ? _mipgen_srgb_to_linear((float)i / 255.0f) : ((float)i / 255.0f);
+        thresholds[i] = _mipgen_srgb_to_linear(((float)i + 0.5f) / 255.0f);
+    }
+    for (int i = 0; i < _MIPGEN_ENCODE_TABLE_SIZE; i++) {
+        encode[i] = _mipgen_encode_srgb_exact((float)i / (float)(_MIPGEN_ENCODE_TABLE_SIZE - 1), thresholds);
+    }
+
+    // horizontally filtered rows in linear float, one output row, and the
+    // horizontal filter weights of each destination column
+    const size_t tmp_num = (size_t)dst_width * (size_t)src_height * 4;
+    const size_t row_num = (size_t)dst_width * 4;
+    const size_t wx_num = (size_t)dst_width * MIPGEN_MAX_TAPS;
+    float* mem = (float*) malloc((tmp_num + row_num + wx_num) * sizeof(float) + (size_t)dst_width * 2 * sizeof(int));
+    assert(mem);
+    float* tmp = mem;
+    float* row = tmp + tmp_num;
+    float* wx = row + row_num;
+    int* wx_first = (int*)(wx + wx_num);
+    int* wx_num_taps = wx_first + dst_width;
+    for (int x = 0; x < dst_width; x++) {
+        wx_num_taps[x] = _mipgen_weights(filter, x, src_width, dst_width, &wx_first[x], &wx[x * MIPGEN_MAX_TAPS]);
+    }
+
+    // horizontal pass
+    for (int y = 0; y < src_height; y++) {
+        const uint8_t* s = &src[(size_t)y * (size_t)src_width * 4];
+        float* t = &tmp[(size_t)y * row_num];
+        for (int x = 0; x < dst_width; x++) {
+            const float* w = &wx[x * MIPGEN_MAX_TAPS];
+            _mipgen_vec_t acc = _mipgen_zero();
+            for (int i = 0; i < wx_num_taps[x]; i++) {
+                acc = _mipgen_madd(acc, _mipgen_load_rgba8(&s[_mipgen_clamp(wx_first[x] + i, src_width - 1) * 4], decode), w[i]);
+            }
+            _mipgen_store(&t[x * 4], acc);
+        }
+    }
+
+    float weights[MIPGEN_MAX_TAPS];
+    int first;
+
+    // vertical pass, accumulates whole rows so that tmp is read front to back
+    for (int y = 0; y < dst_height; y++) {
+        const int num_taps = _mipgen_weights(filter, y, src_height, dst_height, &first, weights);
+        for (int x = 0; x < dst_width; x++) {
+            _mipgen_store(&row[x * 4], _mipgen_zero());
+        }
+        for (int i = 0; i < num_taps; i++) {
+            const float* t = &tmp[(size_t)_mipgen_clamp(first + i, src_height - 1) * row_num];
+            for (int x = 0; x < dst_width; x++) {
+                _mipgen_store(&row[x * 4], _mipgen_madd(_mipgen_load(&row[x * 4]), _mipgen_load(&t[x * 4]), weights[i]));
+            }
+        }
+        uint8_t* d = &dst[(size_t)y * row_num];
+        for (size_t i = 0; i < row_num; i += 4) {
+            for (size_t c = 0; c < 3; c++) {
+                d[i + c] = srgb ? _mipgen_encode_srgb(row[i + c], encode, thresholds) : _mipgen_encode_linear(row[i + c]);
+            }
+            d[i + 3] = _mipgen_encode_linear(row[i + 3]);
+        }
+    }
+    free(mem);
+}
+
+/* compute levels[1..num_mipmaps-1] from levels[0], each level is tightly packed RGBA8 */
+static inline void mipgen_cpu_chain(uint8_t* const levels[], int width, int height, int num_mipmaps, mipgen_filter_t filter, bool srgb) {
+    assert(levels && (num_mipmaps > 0) && (num_mipmaps <= MIPGEN_MAX_MIPMAPS));
+    for (int i = 1; i < num_mipmaps; i++) {
+        mipgen_cpu_level(
+            levels[i], mipgen_level_dim(width, i), mipgen_level_dim(height, i),
+            levels[i - 1], mipgen_level_dim(width, i - 1), mipgen_level_dim(height, i - 1),
+            filter, srgb);
+    }
+}
+
+#if defined(SOKOL_GFX_INCLUDED)
+typedef struct {
+    sg_image_type type;         // default: SG_IMAGETYPE_2D, cubemaps and arrays use the CPU path
+    int width;
+    int height;
+    int num_slices;             // only for SG_IMAGETYPE_ARRAY
+    int num_mipmaps;            // default: complete chain down to 1x1
+    sg_range data;              // tightly packed RGBA8 level 0 of all slices or cube faces
+    mipgen_filter_t filter;     // default: MIPGEN_FILTER_BOX
+    bool linear;                // data isn't sRGB encoded (e.g. normal maps)
+    bool force_cpu;             // don't use the compute shader even if supported
+    const char* label;
+} mipgen_image_desc_t;
+
+static struct {
+    bool valid;
+    sg_pipeline pip;
+    sg_sampler smp;
+    bool last_gpu;
+} _mipgen;
+
+/* setup the GPU path if supported, call after sg_setup() */
+static inline void mipgen_setup(void) {
+    assert(!_mipgen.valid);
+    memset(&_mipgen, 0, sizeof(_mipgen));
+    _mipgen.valid = true;
+    #if defined(UB_mipgen_params)
+    const sg_backend backend = sg_query_backend();
+    const bool is_gl = (backend == SG_BACKEND_GLCORE) || (backend == SG_BACKEND_GLES3);
+    if (sg_query_features().compute
+        && sg_query_pixelformat(SG_PIXELFORMAT_RGBA8).write
+        && !(is_gl && !sg_query_features().gl_texture_views))
+    {
+        _mipgen.pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(mipgen_shader_desc(backend)),
+            .label = "mipgen-pipeline",
+        });
+        _mipgen.smp = sg_make_sampler(&(sg_sampler_desc){
+            .min_filter = SG_FILTER_NEAREST,
+            .mag_filter = SG_FILTER_NEAREST,
+            .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+            .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+            .label = "mipgen-sampler",
+        });
+    }
+    #endif
+}
+
+static inline void mipgen_shutdown(void) {
+    assert(_mipgen.valid);
+    sg_destroy_pipeline(_mipgen.pip);
+    sg_destroy_sampler(_mipgen.smp);
+    _mipgen.valid = false;
+}
+
+/* true if mipgen_make_image() can use the compute shader for 2D images */
+static inline bool mipgen_gpu_supported(void) {
+    assert(_mipgen.valid);
+    return sg_query_pipeline_state(_mipgen.pip) == SG_RESOURCESTATE_VALID;
+}
+
+/* true if the last mipgen_make_image() call used the compute shader */
+static inline bool mipgen_last_used_gpu(void) {
+    return _mipgen.last_gpu;
+}
+
+static inline mipgen_image_desc_t _mipgen_image_desc_defaults(const mipgen_image_desc_t* desc) {
+    mipgen_image_desc_t res = *desc;
+    res.type = (res.type == _SG_IMAGETYPE_DEFAULT) ? SG_IMAGETYPE_2D : res.type;
+    if (res.type == SG_IMAGETYPE_CUBE) {
+        res.num_slices = 6;
+    } else if (res.type != SG_IMAGETYPE_ARRAY) {
+        res.num_slices = 1;
+    }
+    const int max_mipmaps = mipgen_num_mipmaps(res.width, res.height);
+    res.num_mipmaps = ((res.num_mipmaps <= 0) || (res.num_mipmaps > max_mipmaps)) ? max_mipmaps : res.num_mipmaps;
+    return res;
+}
+
+static inline sg_image _mipgen_make_image_cpu(const mipgen_image_desc_t* desc) {
+    size_t level_size[MIPGEN_MAX_MIPMAPS];
+    size_t total_size = 0;
+    for (int i = 1; i < desc->num_mipmaps; i++) {
+        level_size[i] = (size_t)mipgen_level_dim(desc->width, i) * (size_t)mipgen_level_dim(desc->height, i) * 4;
+        total_size += level_size[i] * (size_t)desc->num_slices;
+    }
+    uint8_t* mem = (uint8_t*) malloc(total_size > 0 ? total_size : 1);
+    assert(mem);
+    sg_image_data data = { .mip_levels[0] = desc->data };
+    uint8_t* ptr = mem;
+    for (int i = 1; i < desc->num_mipmaps; i++) {
+        data.mip_levels[i] = (sg_range){ .ptr = ptr, .size = level_size[i] * (size_t)desc->num_slices };
+        ptr += data.mip_levels[i].size;
+    }
+    // slices are stored one after another in each mip level
+    for (int slice = 0; slice < desc->num_slices; slice++) {
+        uint8_t* levels[MIPGEN_MAX_MIPMAPS];
+        levels[0] = (uint8_t*)desc->data.ptr + (size_t)slice * (size_t)desc->width * (size_t)desc->height * 4;
+        for (int i = 1; i < desc->num_mipmaps; i++) {
+            levels[i] = (uint8_t*)data.mip_levels[i].ptr + (size_t)slice * level_size[i];
+        }
+        mipgen_cpu_chain(levels, desc->width, desc->height, desc->num_mipmaps, desc->filter, !desc->linear);
+    }
+    sg_image img = sg_make_image(&(sg_image_desc){
+        .type = desc->type,
+        .width = desc->width,
+        .height = desc->height,
+        .num_slices = (desc->type == SG_IMAGETYPE_ARRAY) ? desc->num_slices : 0,
+        .num_mipmaps = desc->num_mipmaps,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .data = data,
+        .label = desc->label,
+    });
+    free(mem);
+    return img;
+}
+
+#if defined(UB_mipgen_params)
+static inline sg_image _mipgen_make_image_gpu(const mipgen_image_desc_t* desc) {
+    // storage images can't be initialized with data, so level 0 is
+    // uploaded into a temporary texture and copied by the first dispatch
+    sg_image src_img = sg_make_image(&(sg_image_desc){
+        .width = desc->width,
+        .height = desc->height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .data.mip_levels[0] = desc->data,
+        .label = "mipgen-source-image",
+    });
+    sg_image img = sg_make_image(&(sg_image_desc){
+        .usage.storage_image = true,
+        .width = desc->width,
+        .height = desc->height,
+        .num_mipmaps = desc->num_mipmaps,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .label = desc->label,
+    });
+    sg_view src_views[MIPGEN_MAX_MIPMAPS];
+    sg_view dst_views[MIPGEN_MAX_MIPMAPS];
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        // level 0 and 1 read from the source texture, all other levels from the previous level
+        if (i < 2) {
+            src_views[i] = sg_make_view(&(sg_view_desc){ .texture = { .image = src_img }, .label = "mipgen-source-view" });
+        } else {
+            src_views[i] = sg_make_view(&(sg_view_desc){
+                .texture = { .image = img, .mip_levels = { .base = i - 1, .count = 1 } },
+                .label = "mipgen-level-texture-view",
+            });
+        }
+        dst_views[i] = sg_make_view(&(sg_view_desc){
+            .storage_image = { .image = img, .mip_level = i },
+            .label = "mipgen-level-storage-view",
+        });
+    }
+    sg_begin_pass(&(sg_pass){ .compute = true, .label = "mipgen-pass" });
+    sg_apply_pipeline(_mipgen.pip);
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        const int src_level = (i < 2) ? 0 : (i - 1);
+        const mipgen_params_t params = {
+            .size = {
+                mipgen_level_dim(desc->width, src_level),
+                mipgen_level_dim(desc->height, src_level),
+                mipgen_level_dim(desc->width, i),
+                mipgen_level_dim(desc->height, i),
+            },
+            .mode = { (int)desc->filter, desc->linear ? 0 : 1, (i == 0) ? 1 : 0, 0 },
+        };
+        sg_apply_bindings(&(sg_bindings){
+            .views = {
+                [VIEW_mipgen_src_tex] = src_views[i],
+                [VIEW_mipgen_dst_img] = dst_views[i],
+            },
+            .samplers[SMP_mipgen_smp] = _mipgen.smp,
+        });
+        sg_apply_uniforms(UB_mipgen_params, &SG_RANGE(params));
+        // shader local_size is 8x8
+        sg_dispatch((params.size[2] + 7) / 8, (params.size[3] + 7) / 8, 1);
+    }
+    sg_end_pass();
+    // the backends keep resources alive until the recorded commands have finished
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        sg_destroy_view(src_views[i]);
+        sg_destroy_view(dst_views[i]);
+    }
+    sg_destroy_image(src_img);
+    return img;
+}
+#endif
+
+/*
+    create an RGBA8 image with a complete mip chain from the level 0 pixels
+    in desc->data, must be called outside of a pass
+*/
+static inline sg_image mipgen_make_image(const mipgen_image_desc_t* desc) {
+    assert(_mipgen.valid && desc);
+    const mipgen_image_desc_t d = _mipgen_image_desc_defaults(desc);
+    assert(d.data.ptr && (d.data.size == ((size_t)d.width * (size_t)d.height * 4 * (size_t)d.num_slices)));
+    _mipgen.last_gpu = false;
+    #if defined(UB_mipgen_params)
+    if ((d.type == SG_IMAGETYPE_2D) && !d.force_cpu && mipgen_gpu_supported()) {
+        _mipgen.last_gpu = true;
+        return _mipgen_make_image_gpu(&d);
+    }
+    #endif
+    return _mipgen_make_image_cpu(&d);
+}
+#endif // SOKOL_GFX_INCLUDED
@@ -0,0 +1,249 @@
+#pragma once
+/*
+    Recorded display lists for line geometry, with the same begin/end
+    vertex API as sokol_gl.h. Include after sokol_gfx.h.
+
+    Geometry is recorded once into a CPU-side vertex array and uploaded
+    into GPU buffers, replaying a display list is just a few draw calls
+    with whatever uniforms (e.g. a transform) the caller applied:
+
+        sgllist_t* list = sgllist_make(&(sgllist_desc_t){ .max_vertices = 4096 });
+        sgllist_rewind(list);
+        sgllist_c3f(list, 1.0f, 0.0f, 1.0f);
+        sgllist_begin_lines(list);
+        sgllist_v3f(list, ...);
+        ...
+        sgllist_end(list);
+
+        // once per frame, outside a render pass
+        sgllist_update(list);
+        ...
+        // inside a render pass
+        sg_apply_pipeline(pip);
+        sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+        sgllist_draw(list, 0, sgllist_num_vertices(list));
+
+    The pipeline must use the vertex layout from sgllist_vertex_layout()
+    (float3 position in attribute 0, ubyte4n color in attribute 1) and
+    SG_PRIMITIVETYPE_LINES. Line strips are expanded into line lists
+    while recording, so that each line occupies two vertices.
+
+    sokol-gfx buffers can only be updated as a whole, so the vertices are
+    split into segments of 'segment_vertices' vertices, each with its own
+    GPU buffer. sgllist_patch() overwrites a vertex range of a recorded
+    list and only marks the touched segments as dirty, sgllist_update()
+    only uploads dirty segments.
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define SGLLIST_MAX_SEGMENTS (64)
+#define SGLLIST_DEFAULT_SEGMENT_VERTICES (1024)
+
+typedef struct {
+    float pos[3];
+    uint32_t rgba;
+} sgllist_vertex_t;
+
+typedef struct {
+    int max_vertices;
+    int segment_vertices;   // patch and upload granularity (must be even), default is SGLLIST_DEFAULT_SEGMENT_VERTICES
+    const char* label;
+} sgllist_desc_t;
+
+typedef struct {
+    sgllist_vertex_t* vertices;
+    int num_vertices;
+    int max_vertices;
+    int segment_vertices;
+    int num_segments;
+    sg_buffer bufs[SGLLIST_MAX_SEGMENTS];
+    bool dirty[SGLLIST_MAX_SEGMENTS];
+    // recording state
+    bool in_begin;
+    bool strip;
+    bool has_prev;
+    sgllist_vertex_t prev;
+    uint32_t rgba;
+} sgllist_t;
+
+static inline void _sgllist_mark_dirty(sgllist_t* list, int first_vertex, int num_vertices) {
+    if (num_vertices <= 0) {
+        return;
+    }
+    const int first_seg = first_vertex / list->segment_vertices;
+    const int last_seg = (first_vertex + num_vertices - 1) / list->segment_vertices;
+    for (int i = first_seg; i <= last_seg; i++) {
+        list->dirty[i] = true;
+    }
+}
+
+static inline void _sgllist_push(sgllist_t* list, sgllist_vertex_t vtx) {
+    if (list->num_vertices < list->max_vertices) {
+        const int index = list->num_vertices++;
+        list->vertices[index] = vtx;
+        list->dirty[index / list->segment_vertices] = true;
+    }
+}
+
+/* pack a float color into the vertex color format */
+static inline uint32_t sgllist_pack_rgba(float r, float g, float b, float a) {
+    const uint32_t r8 = (uint32_t)(r * 255.0f);
+    const uint32_t g8 = (uint32_t)(g * 255.0f);
+    const uint32_t b8 = (uint32_t)(b * 255.0f);
+    const uint32_t a8 = (uint32_t)(a * 255.0f);
+    return (a8 << 24) | (b8 << 16) | (g8 << 8) | r8;
+}
+
+/* create a display list with a fixed vertex capacity */
+static inline sgllist_t* sgllist_make(const sgllist_desc_t* desc) {
+    assert(desc && (desc->max_vertices > 0));
+    sgllist_t* list = (sgllist_t*) calloc(1, sizeof(sgllist_t));
+    if (!list) {
+        return 0;
+    }
+    list->max_vertices = desc->max_vertices;
+    list->segment_vertices = (desc->segment_vertices > 0) ? desc->segment_vertices : SGLLIST_DEFAULT_SEGMENT_VERTICES;
+    assert((list->segment_vertices & 1) == 0);
+    list->num_segments = (list->max_vertices + list->segment_vertices - 1) / list->segment_vertices;
+    assert(list->num_segments <= SGLLIST_MAX_SEGMENTS);
+    list->vertices = (sgllist_vertex_t*) calloc((size_t)list->max_vertices, sizeof(sgllist_vertex_t));
+    for (int i = 0; i < list->num_segments; i++) {
+        list->bufs[i] = sg_make_buffer(&(sg_buffer_desc){
+            .usage.dynamic_update = true,
+            .size = (size_t)list->segment_vertices * sizeof(sgllist_vertex_t),
+            .label = desc->label,
+        });
+    }
+    list->rgba = 0xFFFFFFFF;
+    return list;
+}
+
+static inline void sgllist_destroy(sgllist_t* list) {
+    if (list) {
+        for (int i = 0; i < list->num_segments; i++) {
+            sg_destroy_buffer(list->bufs[i]);
+        }
+        free(list->vertices);
+        free(list);
+    }
+}
+
+/* the vertex layout for pipelines which render display lists */
+static inline sg_vertex_layout_state sgllist_vertex_layout(void) {
+    return (sg_vertex_layout_state){
+        .attrs = {
+            [0].format = SG_VERTEXFORMAT_FLOAT3,
+            [1].format = SG_VERTEXFORMAT_UBYTE4N,
+        },
+    };
+}
+
+/* throw away the recorded vertices and start recording from scratch */
+static inline void sgllist_rewind(sgllist_t* list) {
+    assert(!list->in_begin);
+    list->num_vertices = 0;
+    list->rgba = 0xFFFFFFFF;
+}
+
+static inline void sgllist_begin_lines(sgllist_t* list) {
+    assert(!list->in_begin);
+    list->in_begin = true;
+    list->strip = false;
+}
+
+static inline void sgllist_begin_line_strip(sgllist_t* list) {
+    assert(!list->in_begin);
+    list->in_begin = true;
+    list->strip = true;
+    list->has_prev = false;
+}
+
+static inline void sgllist_end(sgllist_t* list) {
+    assert(list->in_begin);
+    list->in_begin = false;
+}
+
+static inline void sgllist_c4f(sgllist_t* list, float r, float g, float b, float a) {
+    list->rgba = sgllist_pack_rgba(r, g, b, a);
+}
+
+static inline void sgllist_c3f(sgllist_t* list, float r, float g, float b) {
+    list->rgba = sgllist_pack_rgba(r, g, b, 1.0f);
+}
+
+static inline void sgllist_c1i(sgllist_t* list, uint32_t rgba) {
+    list->rgba = rgba;
+}
+
+static inline void sgllist_v3f(sgllist_t* list, float x, float y, float z) {
+    assert(list->in_begin);
+    const sgllist_vertex_t vtx = { .pos = { x, y, z }, .rgba = list->rgba };
+    if (list->strip) {
+        if (list->has_prev) {
+            _sgllist_push(list, list->prev);
+            _sgllist_push(list, vtx);
+        }
+        list->prev = vtx;
+        list->has_prev = true;
+    } else {
+        _sgllist_push(list, vtx);
+    }
+}
+
+static inline void sgllist_v2f(sgllist_t* list, float x, float y) {
+    sgllist_v3f(list, x, y, 0.0f);
+}
+
+/* overwrite recorded vertices, only the touched segments are uploaded in the next sgllist_update() */
+static inline void sgllist_patch(sgllist_t* list, int first_vertex, int num_vertices, const sgllist_vertex_t* vertices) {
+    assert((first_vertex >= 0) && ((first_vertex + num_vertices) <= list->num_vertices));
+    memcpy(&list->vertices[first_vertex], vertices, (size_t)num_vertices * sizeof(sgllist_vertex_t));
+    _sgllist_mark_dirty(list, first_vertex, num_vertices);
+}
+
+static inline int sgllist_num_vertices(const sgllist_t* list) {
+    return list->num_vertices;
+}
+
+/* upload dirty segments, call at most once per frame outside a render pass, returns the number of uploaded bytes */
+static inline size_t sgllist_update(sgllist_t* list) {
+    size_t num_bytes = 0;
+    for (int i = 0; i < list->num_segments; i++) {
+        if (!list->dirty[i]) {
+            continue;
+        }
+        list->dirty[i] = false;
+        const int first = i * list->segment_vertices;
+        int num = list->num_vertices - first;
+        if (num > list->segment_vertices) {
+            num = list->segment_vertices;
+        }
+        if (num > 0) {
+            const size_t size = (size_t)num * sizeof(sgllist_vertex_t);
+            sg_update_buffer(list->bufs[i], &(sg_range){ .ptr = &list->vertices[first], .size = size });
+            num_bytes += size;
+        }
+    }
+    return num_bytes;
+}
+
+/* draw a vertex range of the display list, with the currently applied pipeline and uniforms */
+static inline void sgllist_draw(const sgllist_t* list, int first_vertex, int num_vertices) {
+    assert((first_vertex >= 0) && ((first_vertex + num_vertices) <= list->num_vertices));
+    const int end_vertex = first_vertex + num_vertices;
+    while (first_vertex < end_vertex) {
+        const int seg = first_vertex / list->segment_vertices;
+        const int seg_start = seg * list->segment_vertices;
+        int seg_end = seg_start + list->segment_vertices;
+        if (seg_end > end_vertex) {
+            seg_end = end_vertex;
+        }
+        sg_apply_bindings(&(sg_bindings){ .vertex_buffers[0] = list->bufs[seg] });
+        sg_draw(first_vertex - seg_start, seg_end - first_vertex, 1);
+        first_vertex = seg_end;
+    }
+}
@@ -0,0 +1,416 @@
+#pragma once
+/*
+    A cache for sokol_shape.h geometry which builds each shape variant
+    (shape type and build parameters) only once into one merged vertex and
+    index buffer, and which can be written to disk and loaded again on the
+    next start instead of building the shapes.
+
+    Include after sokol_gfx.h and sokol_shape.h:
+
+        shapecache_t cache;
+        shapecache_init(&cache, &(shapecache_desc_t){
+            .format.disable.colors = true,      // vertex components like sshape_state_t
+            .path = "my-sample.shapecache",     // optional, see below
+        });
+        sshape_element_range_t box = shapecache_box(&cache, &(sshape_box_t){ .width = 1.0f, ... });
+        sshape_element_range_t sphere = shapecache_sphere(&cache, &(sshape_sphere_t){ ... });
+        shapecache_save(&cache);    // only writes the file if new shapes were built
+
+        const sg_buffer_desc vbuf_desc = shapecache_vertex_buffer_desc(&cache);
+        const sg_buffer_desc ibuf_desc = shapecache_index_buffer_desc(&cache);
+        ...
+        // vertex layout from the sokol_shape.h helpers
+        .layout.buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
+        .layout.attrs[0] = sshape_position_vertex_attr_state(&cache.format),
+        ...
+        .index_type = SG_INDEXTYPE_UINT32,
+        ...
+        shapecache_shutdown(&cache);    // after the buffers are created
+
+    NOTE:
+    - the index buffer has 32-bit indices, so that the merged buffer isn't
+      limited to 64k vertices like sokol_shape.h's 16-bit indices
+    - shapes are identified by the bytes of their build parameters, so
+      the parameter structs should be zero-initialized (designated
+      initializers do this), the .merge flag is ignored, use
+      shapecache_merge() to combine element ranges into a single draw
+    - without a .path the cache only merges the shapes in memory, and
+      shapecache_save() does nothing, the cache file only pays off for
+      scenes with many shape variants (see sapp/shapecache-bench.c), not
+      for a handful of simple shapes
+    - the cache file is written in the native byte order and struct layout,
+      a file which doesn't match the current build or vertex format is
+      ignored and the shapes are built again
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if !defined(SOKOL_SHAPE_INCLUDED)
+#error "please include sokol_shape.h before util/shapecache.h"
+#endif
+
+#define SHAPECACHE_MAX_MERGE_RANGES (8)
+#define SHAPECACHE_MAX_SHAPE_VERTICES (1<<16)       // sokol_shape.h has 16-bit indices
+#define SHAPECACHE_MAX_SHAPE_INDICES (6 * SHAPECACHE_MAX_SHAPE_VERTICES)
+#define SHAPECACHE_FILE_MAGIC (0x43504853)          // 'SHPC'
+#define SHAPECACHE_FILE_VERSION (1)
+
+typedef enum {
+    SHAPECACHE_PLANE,
+    SHAPECACHE_BOX,
+    SHAPECACHE_SPHERE,
+    SHAPECACHE_CYLINDER,
+    SHAPECACHE_TORUS,
+    SHAPECACHE_MERGE,
+} shapecache_type_t;
+
+typedef struct {
+    sshape_state_t format;  // only the .disable flags are used
+    const char* path;       // optional cache file
+} shapecache_desc_t;
+
+typedef union {
+    sshape_plane_t plane;
+    sshape_box_t box;
+    sshape_sphere_t sphere;
+    sshape_cylinder_t cylinder;
+    sshape_torus_t torus;
+    struct {
+        int num_ranges;
+        sshape_element_range_t ranges[SHAPECACHE_MAX_MERGE_RANGES];
+    } merge;
+} _shapecache_params_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t hash;
+    _shapecache_params_t params;
+    sshape_element_range_t range;
+} _shapecache_entry_t;
+
+typedef struct {
+    sshape_state_t format;  // pass to the sokol_shape.h vertex layout helpers
+    const char* path;
+    int stride;
+    int num_entries;
+    int max_entries;
+    _shapecache_entry_t* entries;
+    int num_vertices;
+    int max_vertices;
+    uint8_t* vertices;
+    int num_indices;
+    int max_indices;
+    uint32_t* indices;
+    uint16_t* scratch_indices;  // 16-bit indices of the shape which is currently built
+    bool dirty;                 // shapes were built since the last load or save
+    // statistics
+    bool loaded;                // the cache file was loaded
+    int num_hits;
+    int num_built;
+} shapecache_t;
+
+static inline uint32_t _shapecache_hash(const _shapecache_entry_t* e) {
+    // FNV-1a
+    uint32_t h = 2166136261u ^ e->type;
+    const uint8_t* p = (const uint8_t*)&e->params;
+    for (size_t i = 0; i < sizeof(e->params); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static inline void* _shapecache_grow(void* ptr, int* inout_max, int required, size_t item_size) {
+    if (required <= *inout_max) {
+        return ptr;
+    }
+    int new_max = (*inout_max > 0) ? *inout_max : 1024;
+    while (new_max < required) {
+        new_max *= 2;
+    }
+    ptr = realloc(ptr, (size_t)new_max * item_size);
+    assert(ptr);
+    *inout_max = new_max;
+    return ptr;
+}
+
+static inline void _shapecache_reset(shapecache_t* cache) {
+    cache->num_entries = 0;
+    cache->num_vertices = 0;
+    cache->num_indices = 0;
+}
+
+static inline bool _shapecache_read(FILE* fp, void* ptr, size_t size) {
+    return (size == 0) || (fread(ptr, size, 1, fp) == 1);
+}
+
+static inline bool _shapecache_write(FILE* fp, const void* ptr, size_t size) {
+    return (size == 0) || (fwrite(ptr, size, 1, fp) == 1);
+}
+
+// load the cache file, leaves the cache empty if the file is missing or doesn't match
+static inline bool _shapecache_load(shapecache_t* cache) {
+    FILE* fp = fopen(cache->path, "rb");
+    if (!fp) {
+        return false;
+    }
+    uint32_t header[7];
+    sshape_state_t format;
+    memset(&format, 0, sizeof(format));
+    bool ok = _shapecache_read(fp, header, sizeof(header))
+        && (header[0] == SHAPECACHE_FILE_MAGIC)
+        && (header[1] == SHAPECACHE_FILE_VERSION)
+        && (header[2] == (uint32_t)sizeof(_shapecache_entry_t))
+        && (header[3] == (uint32_t)cache->stride)
+        && _shapecache_read(fp, &format.disable, sizeof(format.disable))
+        && (0 == memcmp(&format.disable, &cache->format.disable, sizeof(format.disable)))
+        && (header[4] <= (uint32_t)INT32_MAX / (uint32_t)sizeof(_shapecache_entry_t))
+        && (header[5] <= (uint32_t)INT32_MAX / (uint32_t)cache->stride)
+        && (header[6] <= (uint32_t)INT32_MAX / (uint32_t)sizeof(uint32_t));
+    if (ok) {
+        const int num_entries = (int)header[4];
+        const int num_vertices = (int)header[5];
+        const int num_indices = (int)header[6];
+        cache->entries = (_shapecache_entry_t*)_shapecache_grow(cache->entries, &cache->max_entries, num_entries, sizeof(_shapecache_entry_t));
+        cache->vertices = (uint8_t*)_shapecache_grow(cache->vertices, &cache->max_vertices, num_vertices, (size_t)cache->stride);
+        cache->indices = (uint32_t*)_shapecache_grow(cache->indices, &cache->max_indices, num_indices, sizeof(uint32_t));
+        ok = _shapecache_read(fp, cache->entries, (size_t)num_entries * sizeof(_shapecache_entry_t))
+            && _shapecache_read(fp, cache->vertices, (size_t)num_vertices * (size_t)cache->stride)
+            && _shapecache_read(fp, cache->indices, (size_t)num_indices * sizeof(uint32_t));
+        // don't trust the content of the file
+        for (int i = 0; ok && (i < num_entries); i++) {
+            const sshape_element_range_t r = cache->entries[i].range;
+            ok = (r.base_element >= 0) && (r.num_elements >= 0) && (r.base_element <= (num_indices - r.num_elements));
+        }
+        for (int i = 0; ok && (i < num_indices); i++) {
+            ok = cache->indices[i] < (uint32_t)num_vertices;
+        }
+        if (ok) {
+            cache->num_entries = num_entries;
+            cache->num_vertices = num_vertices;
+            cache->num_indices = num_indices;
+        }
+    }
+    fclose(fp);
+    if (!ok) {
+        _shapecache_reset(cache);
+    }
+    return ok;
+}
+
+static inline void shapecache_init(shapecache_t* cache, const shapecache_desc_t* desc) {
+    assert(cache && desc);
+    memset(cache, 0, sizeof(shapecache_t));
+    cache->format = desc->format;
+    cache->path = desc->path;
+    cache->stride = sshape_vertex_buffer_layout_state(&cache->format).stride;
+    assert(cache->stride > 0);
+    if (cache->path) {
+        cache->loaded = _shapecache_load(cache);
+    }
+}
+
+static inline void shapecache_shutdown(shapecache_t* cache) {
+    assert(cache);
+    free(cache->entries);
+    free(cache->vertices);
+    free(cache->indices);
+    free(cache->scratch_indices);
+    memset(cache, 0, sizeof(shapecache_t));
+}
+
+// write the cache file if shapes were built since it was loaded, returns false on error
+static inline bool shapecache_save(shapecache_t* cache) {
+    assert(cache);
+    if (!cache->path || !cache->dirty) {
+        return true;
+    }
+    FILE* fp = fopen(cache->path, "wb");
+    if (!fp) {
+        return false;
+    }
+    const uint32_t header[7] = {
+        SHAPECACHE_FILE_MAGIC,
+        SHAPECACHE_FILE_VERSION,
+        (uint32_t)sizeof(_shapecache_entry_t),
+        (uint32_t)cache->stride,
+        (uint32_t)cache->num_entries,
+        (uint32_t)cache->num_vertices,
+        (uint32_t)cache->num_indices,
+    };
+    const bool ok = _shapecache_write(fp, header, sizeof(header))
+        && _shapecache_write(fp, &cache->format.disable, sizeof(cache->format.disable))
+        && _shapecache_write(fp, cache->entries, (size_t)cache->num_entries * sizeof(_shapecache_entry_t))
+        && _shapecache_write(fp, cache->vertices, (size_t)cache->num_vertices * (size_t)cache->stride)
+        && _shapecache_write(fp, cache->indices, (size_t)cache->num_indices * sizeof(uint32_t));
+    if ((0 != fclose(fp)) || !ok) {
+        return false;
+    }
+    cache->dirty = false;
+    return true;
+}
+
+static inline const _shapecache_entry_t* _shapecache_find(const shapecache_t* cache, const _shapecache_entry_t* key) {
+    for (int i = 0; i < cache->num_entries; i++) {
+        const _shapecache_entry_t* e = &cache->entries[i];
+        if ((e->hash == key->hash) && (e->type == key->type) && (0 == memcmp(&e->params, &key->params, sizeof(key->params)))) {
+            return e;
+        }
+    }
+    return 0;
+}
+
+static inline void _shapecache_add(shapecache_t* cache, _shapecache_entry_t* entry, int base_element) {
+    entry->range.base_element = base_element;
+    entry->range.num_elements = cache->num_indices - base_element;
+    cache->entries = (_shapecache_entry_t*)_shapecache_grow(cache->entries, &cache->max_entries, cache->num_entries + 1, sizeof(_shapecache_entry_t));
+    cache->entries[cache->num_entries++] = *entry;
+    cache->dirty = true;
+}
+
+// build a shape with sokol_shape.h and append it to the merged buffers, the
+// vertices are directly built at the end of the merged vertex buffer, the
+// 16-bit indices are rebased into the 32-bit index buffer
+static inline sshape_element_range_t _shapecache_build(shapecache_t* cache, _shapecache_entry_t* key) {
+    if (!cache->scratch_indices) {
+        cache->scratch_indices = (uint16_t*)malloc(SHAPECACHE_MAX_SHAPE_INDICES * sizeof(uint16_t));
+        assert(cache->scratch_indices);
+    }
+    cache->vertices = (uint8_t*)_shapecache_grow(cache->vertices, &cache->max_vertices, cache->num_vertices + SHAPECACHE_MAX_SHAPE_VERTICES, (size_t)cache->stride);
+    sshape_state_t shp = cache->format;
+    shp.vertices.buffer = (sshape_range){ cache->vertices + (size_t)cache->num_vertices * (size_t)cache->stride, (size_t)SHAPECACHE_MAX_SHAPE_VERTICES * (size_t)cache->stride };
+    shp.indices.buffer = (sshape_range){ cache->scratch_indices, SHAPECACHE_MAX_SHAPE_INDICES * sizeof(uint16_t) };
+    switch (key->type) {
+        case SHAPECACHE_PLANE:      sshape_build_plane(&shp, &key->params.plane); break;
+        case SHAPECACHE_BOX:        sshape_build_box(&shp, &key->params.box); break;
+        case SHAPECACHE_SPHERE:     sshape_build_sphere(&shp, &key->params.sphere); break;
+        case SHAPECACHE_CYLINDER:   sshape_build_cylinder(&shp, &key->params.cylinder); break;
+        case SHAPECACHE_TORUS:      sshape_build_torus(&shp, &key->params.torus); break;
+        default: assert(false); break;
+    }
+    sshape_element_range_t range = { 0 };
+    if (!shp.valid) {
+        return range;
+    }
+    const sg_buffer_desc vbuf_desc = sshape_vertex_buffer_desc(&shp);
+    const sg_buffer_desc ibuf_desc = sshape_index_buffer_desc(&shp);
+    const int num_vertices = (int)(vbuf_desc.data.size / (size_t)cache->stride);
+    const int num_indices = (int)(ibuf_desc.data.size / sizeof(uint16_t));
+    cache->indices = (uint32_t*)_shapecache_grow(cache->indices, &cache->max_indices, cache->num_indices + num_indices, sizeof(uint32_t));
+    const uint16_t* src = (const uint16_t*)ibuf_desc.data.ptr;
+    const int base_element = cache->num_indices;
+    const uint32_t base_vertex = (uint32_t)cache->num_vertices;
+    for (int i = 0; i < num_indices; i++) {
+        cache->indices[cache->num_indices++] = base_vertex + src[i];
+    }
+    cache->num_vertices += num_vertices;
+    _shapecache_add(cache, key, base_element);
+    cache->num_built++;
+    return key->range;
+}
+
+static inline sshape_element_range_t _shapecache_get(shapecache_t* cache, shapecache_type_t type, const void* params, size_t params_size) {
+    assert(cache && params && (params_size <= sizeof(_shapecache_params_t)));
+    _shapecache_entry_t key;
+    memset(&key, 0, sizeof(key));
+    key.type = (uint32_t)type;
+    memcpy(&key.params, params, params_size);
+    switch (type) {
+        case SHAPECACHE_PLANE:      key.params.plane.merge = false; break;
+        case SHAPECACHE_BOX:        key.params.box.merge = false; break;
+        case SHAPECACHE_SPHERE:     key.params.sphere.merge = false; break;
+        case SHAPECACHE_CYLINDER:   key.params.cylinder.merge = false; break;
+        case SHAPECACHE_TORUS:      key.params.torus.merge = false; break;
+        default: break;
+    }
+    key.hash = _shapecache_hash(&key);
+    const _shapecache_entry_t* entry = _shapecache_find(cache, &key);
+    if (entry) {
+        cache->num_hits++;
+        return entry->range;
+    }
+    return _shapecache_build(cache, &key);
+}
+
+static inline sshape_element_range_t shapecache_plane(shapecache_t* cache, const sshape_plane_t* params) {
+    return _shapecache_get(cache, SHAPECACHE_PLANE, params, sizeof(sshape_plane_t));
+}
+
+static inline sshape_element_range_t shapecache_box(shapecache_t* cache, const sshape_box_t* params) {
+    return _shapecache_get(cache, SHAPECACHE_BOX, params, sizeof(sshape_box_t));
+}
+
+static inline sshape_element_range_t shapecache_sphere(shapecache_t* cache, const sshape_sphere_t* params) {
+    return _shapecache_get(cache, SHAPECACHE_SPHERE, params, sizeof(sshape_sphere_t));
+}
+
+static inline sshape_element_range_t shapecache_cylinder(shapecache_t* cache, const sshape_cylinder_t* params) {
+    return _shapecache_get(cache, SHAPECACHE_CYLINDER, params, sizeof(sshape_cylinder_t));
+}
+
+static inline sshape_element_range_t shapecache_torus(shapecache_t* cache, const sshape_torus_t* params) {
+    return _shapecache_get(cache, SHAPECACHE_TORUS, params, sizeof(sshape_torus_t));
+}
+
+/*
+    combine element ranges into a single range for one draw call, ranges
+    which follow each other in the index buffer are simply joined, otherwise
+    their indices are copied (once) to the end of the index buffer
+*/
+static inline sshape_element_range_t shapecache_merge(shapecache_t* cache, const sshape_element_range_t* ranges, int num_ranges) {
+    assert(cache && ranges && (num_ranges > 0) && (num_ranges <= SHAPECACHE_MAX_MERGE_RANGES));
+    sshape_element_range_t range = ranges[0];
+    bool contiguous = true;
+    for (int i = 1; i < num_ranges; i++) {
+        contiguous &= (ranges[i].base_element == (range.base_element + range.num_elements));
+        range.num_elements += ranges[i].num_elements;
+    }
+    if (contiguous) {
+        return range;
+    }
+    _shapecache_entry_t key;
+    memset(&key, 0, sizeof(key));
+    key.type = SHAPECACHE_MERGE;
+    key.params.merge.num_ranges = num_ranges;
+    for (int i = 0; i < num_ranges; i++) {
+        key.params.merge.ranges[i] = ranges[i];
+    }
+    key.hash = _shapecache_hash(&key);
+    const _shapecache_entry_t* entry = _shapecache_find(cache, &key);
+    if (entry) {
+        cache->num_hits++;
+        return entry->range;
+    }
+    const int base_element = cache->num_indices;
+    cache->indices = (uint32_t*)_shapecache_grow(cache->indices, &cache->max_indices, cache->num_indices + range.num_elements, sizeof(uint32_t));
+    for (int i = 0; i < num_ranges; i++) {
+        memcpy(&cache->indices[cache->num_indices], &cache->indices[ranges[i].base_element], (size_t)ranges[i].num_elements * sizeof(uint32_t));
+        cache->num_indices += ranges[i].num_elements;
+    }
+    _shapecache_add(cache, &key, base_element);
+    return key.range;
+}
+
+static inline sg_buffer_desc shapecache_vertex_buffer_desc(const shapecache_t* cache) {
+    assert(cache && (cache->num_vertices > 0));
+    sg_buffer_desc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.data.ptr = cache->vertices;
+    desc.data.size = (size_t)cache->num_vertices * (size_t)cache->stride;
+    desc.label = "shapecache-vertices";
+    return desc;
+}
+
+static inline sg_buffer_desc shapecache_index_buffer_desc(const shapecache_t* cache) {
+    assert(cache && (cache->num_indices > 0));
+    sg_buffer_desc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.usage.index_buffer = true;
+    desc.data.ptr = cache->indices;
+    desc.data.size = (size_t)cache->num_indices * sizeof(uint32_t);
+    desc.label = "shapecache-indices";
+    return desc;
+}
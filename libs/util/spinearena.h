@@ -0,0 +1,267 @@
+#pragma once
+/*
+    Arena allocation for spine-c data loading. Include after spine/spine.h
+    and spine/extension.h.
+
+    Loading skeleton and atlas data with spine-c causes thousands of small
+    allocations (one per timeline, per float array, per string etc...).
+    spinearena.h installs spine-c malloc hooks (via _spSetMalloc() and
+    friends) which route allocations either to the system heap, or
+    while an arena is active, into large blocks owned by that arena:
+
+        spinearena_setup();     // once, before any other spine-c call
+        ...
+        spinearena_t* arena = spinearena_begin(0);
+        spAtlas* atlas = spAtlas_create(...);
+        spSkeletonData* skel_data = spSkeletonBinary_readSkeletonData(...);
+        spinearena_end();
+        ...
+        // free everything in one go, spSkeletonData_dispose() isn't needed,
+        // but spAtlas_dispose() still needs to be called to release textures
+        spAtlas_dispose(atlas);
+        spinearena_discard(arena);
+
+    Freeing an arena allocation is a no-op, reallocating it moves the data
+    out of the arena. Objects created from arena data (e.g. skeleton instances)
+    are allocated on the system heap once the arena is no longer active, but
+    must be destroyed before the arena is discarded.
+
+    All heap and arena allocations carry a small header, so the hooks must be
+    installed before spine-c allocates anything, and must not be combined with
+    other spine-c allocation hooks.
+
+    Threading: the hooks may be called from any thread (e.g. when
+    util/spinebatch.h updates instances on job threads), the statistics
+    counters are updated atomically. The active arena however is global,
+    so spinearena_begin()/spinearena_end() must only be used while no other
+    thread calls into spine-c, otherwise allocations of other threads would
+    end up in the arena.
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#define SPINEARENA_DEFAULT_BLOCK_SIZE (256 * 1024)
+#define SPINEARENA_ALIGN (16)
+
+typedef struct _spinearena_block_t {
+    struct _spinearena_block_t* next;
+    size_t size;
+    size_t pos;
+} _spinearena_block_t;
+
+typedef struct {
+    size_t block_size;
+    _spinearena_block_t* blocks;    // current block is first
+    int num_blocks;
+    int num_allocs;
+    size_t num_bytes;
+} spinearena_t;
+
+typedef struct {
+    int num_allocs;         // number of spine-c allocations (heap and arena)
+    int num_heap_allocs;    // number of allocations which went to the system heap
+    size_t num_bytes;
+} spinearena_stats_t;
+
+// allocation header, padded to keep the user pointer aligned
+typedef struct {
+    size_t size;
+    uint32_t in_arena;
+    uint32_t pad;
+} _spinearena_header_t;
+
+// atomic versions of the spinearena_stats_t counters
+typedef struct {
+    #if defined(_MSC_VER)
+    volatile long num_allocs;
+    volatile long num_heap_allocs;
+    volatile long long num_bytes;
+    #else
+    int num_allocs;
+    int num_heap_allocs;
+    size_t num_bytes;
+    #endif
+} _spinearena_counters_t;
+
+static struct {
+    bool valid;
+    spinearena_t* active;
+    _spinearena_counters_t stats;
+} _spinearena;
+
+// count an allocation, called from the malloc hooks on any thread
+static inline void _spinearena_count(bool heap, size_t size) {
+    #if defined(_MSC_VER)
+    _InterlockedIncrement(&_spinearena.stats.num_allocs);
+    if (heap) {
+        _InterlockedIncrement(&_spinearena.stats.num_heap_allocs);
+    }
+    _InterlockedExchangeAdd64(&_spinearena.stats.num_bytes, (long long)size);
+    #else
+    __atomic_add_fetch(&_spinearena.stats.num_allocs, 1, __ATOMIC_RELAXED);
+    if (heap) {
+        __atomic_add_fetch(&_spinearena.stats.num_heap_allocs, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&_spinearena.stats.num_bytes, size, __ATOMIC_RELAXED);
+    #endif
+}
+
+static inline size_t _spinearena_header_size(void) {
+    return (sizeof(_spinearena_header_t) + (SPINEARENA_ALIGN - 1)) & ~(size_t)(SPINEARENA_ALIGN - 1);
+}
+
+// block header size, padded so that the block data starts aligned
+static inline size_t _spinearena_block_header_size(void) {
+    return (sizeof(_spinearena_block_t) + (SPINEARENA_ALIGN - 1)) & ~(size_t)(SPINEARENA_ALIGN - 1);
+}
+
+static inline _spinearena_header_t* _spinearena_header(void* ptr) {
+    return (_spinearena_header_t*)((uint8_t*)ptr - _spinearena_header_size());
+}
+
+static inline void* _spinearena_alloc_from_arena(spinearena_t* arena, size_t size) {
+    const size_t total = (_spinearena_header_size() + size + (SPINEARENA_ALIGN - 1)) & ~(size_t)(SPINEARENA_ALIGN - 1);
+    _spinearena_block_t* block = arena->blocks;
+    if (!block || ((block->pos + total) > block->size)) {
+        const size_t block_size = (total > arena->block_size) ? total : arena->block_size;
+        block = (_spinearena_block_t*) malloc(_spinearena_block_header_size() + block_size);
+        if (!block) {
+            return 0;
+        }
+        block->next = arena->blocks;
+        block->size = block_size;
+        block->pos = 0;
+        arena->blocks = block;
+        arena->num_blocks++;
+    }
+    uint8_t* ptr = (uint8_t*)block + _spinearena_block_header_size() + block->pos;
+    block->pos += total;
+    arena->num_allocs++;
+    arena->num_bytes += size;
+    _spinearena_header_t* hdr = (_spinearena_header_t*) ptr;
+    hdr->size = size;
+    hdr->in_arena = 1;
+    return ptr + _spinearena_header_size();
+}
+
+static inline void* _spinearena_malloc(size_t size) {
+    spinearena_t* arena = _spinearena.active;
+    _spinearena_count(!arena, size);
+    if (arena) {
+        return _spinearena_alloc_from_arena(arena, size);
+    }
+    uint8_t* ptr = (uint8_t*) malloc(_spinearena_header_size() + size);
+    if (!ptr) {
+        return 0;
+    }
+    _spinearena_header_t* hdr = (_spinearena_header_t*) ptr;
+    hdr->size = size;
+    hdr->in_arena = 0;
+    return ptr + _spinearena_header_size();
+}
+
+static inline void _spinearena_free(void* ptr) {
+    if (ptr) {
+        _spinearena_header_t* hdr = _spinearena_header(ptr);
+        if (!hdr->in_arena) {
+            free(hdr);
+        }
+    }
+}
+
+static inline void* _spinearena_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return _spinearena_malloc(size);
+    }
+    _spinearena_header_t* hdr = _spinearena_header(ptr);
+    if (!hdr->in_arena && !_spinearena.active) {
+        _spinearena_count(true, size);
+        _spinearena_header_t* new_hdr = (_spinearena_header_t*) realloc(hdr, _spinearena_header_size() + size);
+        if (!new_hdr) {
+            return 0;
+        }
+        new_hdr->size = size;
+        return (uint8_t*)new_hdr + _spinearena_header_size();
+    }
+    // moving into or out of an arena, old arena allocations are simply abandoned
+    void* new_ptr = _spinearena_malloc(size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, (hdr->size < size) ? hdr->size : size);
+        _spinearena_free(ptr);
+    }
+    return new_ptr;
+}
+
+/* install the spine-c allocation hooks, call once before any other spine-c function */
+static inline void spinearena_setup(void) {
+    assert(!_spinearena.valid);
+    _spinearena.valid = true;
+    _spSetMalloc(_spinearena_malloc);
+    _spSetRealloc(_spinearena_realloc);
+    _spSetFree(_spinearena_free);
+}
+
+/* create an arena and route all spine-c allocations into it until spinearena_end() */
+static inline spinearena_t* spinearena_begin(size_t block_size) {
+    assert(_spinearena.valid && !_spinearena.active);
+    spinearena_t* arena = (spinearena_t*) calloc(1, sizeof(spinearena_t));
+    if (!arena) {
+        return 0;
+    }
+    arena->block_size = (block_size > 0) ? block_size : SPINEARENA_DEFAULT_BLOCK_SIZE;
+    _spinearena.active = arena;
+    return arena;
+}
+
+/* stop routing spine-c allocations into the active arena */
+static inline void spinearena_end(void) {
+    assert(_spinearena.valid && _spinearena.active);
+    _spinearena.active = 0;
+}
+
+/* free all memory owned by an arena */
+static inline void spinearena_discard(spinearena_t* arena) {
+    if (arena) {
+        assert(arena != _spinearena.active);
+        _spinearena_block_t* block = arena->blocks;
+        while (block) {
+            _spinearena_block_t* next = block->next;
+            free(block);
+            block = next;
+        }
+        free(arena);
+    }
+}
+
+/* cumulative allocation counters, can be reset with spinearena_reset_stats() */
+static inline spinearena_stats_t spinearena_stats(void) {
+    spinearena_stats_t stats;
+    #if defined(_MSC_VER)
+    stats.num_allocs = (int)_InterlockedOr(&_spinearena.stats.num_allocs, 0);
+    stats.num_heap_allocs = (int)_InterlockedOr(&_spinearena.stats.num_heap_allocs, 0);
+    stats.num_bytes = (size_t)_InterlockedExchangeAdd64(&_spinearena.stats.num_bytes, 0);
+    #else
+    stats.num_allocs = __atomic_load_n(&_spinearena.stats.num_allocs, __ATOMIC_RELAXED);
+    stats.num_heap_allocs = __atomic_load_n(&_spinearena.stats.num_heap_allocs, __ATOMIC_RELAXED);
+    stats.num_bytes = __atomic_load_n(&_spinearena.stats.num_bytes, __ATOMIC_RELAXED);
+    #endif
+    return stats;
+}
+
+static inline void spinearena_reset_stats(void) {
+    #if defined(_MSC_VER)
+    _InterlockedExchange(&_spinearena.stats.num_allocs, 0);
+    _InterlockedExchange(&_spinearena.stats.num_heap_allocs, 0);
+    _InterlockedExchange64(&_spinearena.stats.num_bytes, 0);
+    #else
+    __atomic_store_n(&_spinearena.stats.num_allocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_spinearena.stats.num_heap_allocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_spinearena.stats.num_bytes, 0, __ATOMIC_RELAXED);
+    #endif
+}
@@ -0,0 +1,180 @@
+#pragma once
+/*
+    Baked animation pose cache for spine-c skeletons. Include after spine/spine.h.
+
+    A looping animation is sampled at a fixed rate into a table of per-bone
+    world transforms (the result of spAnimation_apply() and
+    spSkeleton_updateWorldTransform(), including all constraints). At runtime
+    spinebake_apply() linearly blends between the two nearest baked frames
+    and writes the result directly into the skeleton's bones, instead of
+    evaluating the bone timelines and running the constraint solvers.
+
+    Timelines which don't affect bones (attachment, color, deform, sequence
+    and draw order timelines) are still applied normally, so that the
+    skeleton can be rendered as usual after spinebake_apply().
+
+    Usage:
+
+        spinebake_anim_t bake;
+        spinebake_init(&bake, skeleton_data, spSkeletonData_findAnimation(skeleton_data, "walk"), 30.0f);
+        ...
+        // per frame and skeleton instead of spAnimationState_apply()
+        // and spSkeleton_updateWorldTransform():
+        spinebake_apply(&bake, skeleton, anim_time);
+        ...
+        spinebake_discard(&bake);
+
+    Limitations:
+
+    - the skeleton's x/y position is added to the baked transforms, but
+      the skeleton scale and bone overrides (e.g. IK targets set from
+      code) are ignored since they are baked in
+    - no animation mixing and no events
+    - physics constraints are baked in their 'pose' state
+
+    Memory cost is num_frames * num_bones * 24 bytes, see spinebake_size().
+*/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <assert.h>
+
+typedef struct {
+    float a, b, c, d;
+    float x, y;
+} spinebake_xform_t;
+
+typedef struct {
+    spAnimation* anim;
+    float rate;                 // baked frames per second, rounded up to evenly divide the duration
+    float duration;
+    int num_bones;
+    int num_frames;
+    spinebake_xform_t* xforms;  // num_frames * num_bones
+    int num_slot_timelines;
+    spTimeline** slot_timelines;
+} spinebake_anim_t;
+
+static inline bool _spinebake_is_slot_timeline(const spTimeline* tl) {
+    switch (tl->type) {
+        case SP_TIMELINE_ATTACHMENT:
+        case SP_TIMELINE_ALPHA:
+        case SP_TIMELINE_DEFORM:
+        case SP_TIMELINE_SEQUENCE:
+        case SP_TIMELINE_RGB2:
+        case SP_TIMELINE_RGBA2:
+        case SP_TIMELINE_RGBA:
+        case SP_TIMELINE_RGB:
+        case SP_TIMELINE_DRAWORDER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* sample an animation into a pose table, returns false on allocation failure */
+static inline bool spinebake_init(spinebake_anim_t* bake, spSkeletonData* skel_data, spAnimation* anim, float rate) {
+    assert(bake && skel_data && anim && (rate > 0.0f));
+    *bake = (spinebake_anim_t){0};
+    spSkeleton* skel = spSkeleton_create(skel_data);
+    if (!skel) {
+        return false;
+    }
+    bake->anim = anim;
+    bake->duration = anim->duration;
+    bake->num_bones = skel->bonesCount;
+    bake->num_frames = (int)ceilf(anim->duration * rate) + 1;
+    // the frames are evenly spaced with the last frame at the end of the animation,
+    // so that the last interval is a full step like all others
+    bake->rate = (bake->num_frames > 1) ? ((float)(bake->num_frames - 1) / anim->duration) : rate;
+    bake->xforms = (spinebake_xform_t*) malloc((size_t)(bake->num_frames * bake->num_bones) * sizeof(spinebake_xform_t));
+    bake->slot_timelines = (spTimeline**) malloc((size_t)(anim->timelines->size + 1) * sizeof(spTimeline*));
+    if (!bake->xforms || !bake->slot_timelines) {
+        spSkeleton_dispose(skel);
+        free(bake->xforms);
+        free(bake->slot_timelines);
+        *bake = (spinebake_anim_t){0};
+        return false;
+    }
+
+    // sample the full solver at a fixed rate
+    for (int frame = 0; frame < bake->num_frames; frame++) {
+        float t = (float)frame / bake->rate;
+        if (t > anim->duration) {
+            t = anim->duration;
+        }
+        spSkeleton_setToSetupPose(skel);
+        spAnimation_apply(anim, skel, t, t, 1, 0, 0, 1.0f, SP_MIX_BLEND_SETUP, SP_MIX_DIRECTION_IN);
+        spSkeleton_updateWorldTransform(skel, SP_PHYSICS_POSE);
+        spinebake_xform_t* dst = &bake->xforms[frame * bake->num_bones];
+        for (int i = 0; i < bake->num_bones; i++) {
+            const spBone* bone = skel->bones[i];
+            dst[i] = (spinebake_xform_t){ bone->a, bone->b, bone->c, bone->d, bone->worldX, bone->worldY };
+        }
+    }
+    spSkeleton_dispose(skel);
+
+    // keep the timelines which need to be applied at runtime
+    for (int i = 0; i < anim->timelines->size; i++) {
+        spTimeline* tl = anim->timelines->items[i];
+        if (_spinebake_is_slot_timeline(tl)) {
+            bake->slot_timelines[bake->num_slot_timelines++] = tl;
+        }
+    }
+    return true;
+}
+
+static inline void spinebake_discard(spinebake_anim_t* bake) {
+    assert(bake);
+    free(bake->xforms);
+    free(bake->slot_timelines);
+    *bake = (spinebake_anim_t){0};
+}
+
+/* size of the baked pose table in bytes */
+static inline size_t spinebake_size(const spinebake_anim_t* bake) {
+    assert(bake);
+    return (size_t)(bake->num_frames * bake->num_bones) * sizeof(spinebake_xform_t);
+}
+
+/* pose a skeleton at a (looping) animation time from the pose table, can be called from any thread for different skeletons */
+static inline void spinebake_apply(const spinebake_anim_t* bake, spSkeleton* skel, float time) {
+    assert(bake && bake->xforms && skel);
+    assert(skel->bonesCount == bake->num_bones);
+    if (bake->duration > 0.0f) {
+        time = fmodf(time, bake->duration);
+        if (time < 0.0f) {
+            time += bake->duration;
+        }
+    } else {
+        time = 0.0f;
+    }
+
+    // non-bone timelines, these are cheap compared to the bone timelines and constraints
+    for (int i = 0; i < bake->num_slot_timelines; i++) {
+        spTimeline_apply(bake->slot_timelines[i], skel, time, time, 0, 0, 1.0f, SP_MIX_BLEND_SETUP, SP_MIX_DIRECTION_IN);
+    }
+
+    // blend between the two nearest baked frames
+    const float ft = time * bake->rate;
+    int f0 = (int)ft;
+    if (f0 > (bake->num_frames - 1)) {
+        f0 = bake->num_frames - 1;
+    }
+    const int f1 = (f0 < (bake->num_frames - 1)) ? (f0 + 1) : f0;
+    const float w1 = ft - (float)f0;
+    const float w0 = 1.0f - w1;
+    const spinebake_xform_t* src0 = &bake->xforms[f0 * bake->num_bones];
+    const spinebake_xform_t* src1 = &bake->xforms[f1 * bake->num_bones];
+    const float x = skel->x;
+    const float y = skel->y;
+    for (int i = 0; i < bake->num_bones; i++) {
+        spBone* bone = skel->bones[i];
+        bone->a = src0[i].a * w0 + src1[i].a * w1;
+        bone->b = src0[i].b * w0 + src1[i].b * w1;
+        bone->c = src0[i].c * w0 + src1[i].c * w1;
+        bone->d = src0[i].d * w0 + src1[i].d * w1;
+        bone->worldX = src0[i].x * w0 + src1[i].x * w1 + x;
+        bone->worldY = src0[i].y * w0 + src1[i].y * w1 + y;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+/*
+    Update many sokol-spine instances in parallel on the job system in
+    jobs.h. Include after sokol_spine.h and jobs.h.
+
+    Usage:
+
+        jobs_setup(&(jobs_desc_t){0});
+        ...
+        // set positions, animations, IK targets etc... on the main thread
+        ...
+        spinebatch_update_instances(instances, num_instances, delta_time);
+        // draw on the main thread, this records vertices in a deterministic order
+        for (int i = 0; i < num_instances; i++) {
+            sspine_draw_instance_in_layer(instances[i], 0);
+        }
+
+    sspine_update_instance() only touches the instance's own spine-c
+    skeleton and animation state (spAnimationState_update/apply and
+    spSkeleton_updateWorldTransform), and only reads the shared atlas and
+    skeleton pools, so different instances can be updated on different
+    threads. The instance array is split into chunks which are pushed as
+    jobs, spinebatch_update_instances() returns when all chunks have been
+    updated (the calling thread helps running the chunk jobs).
+
+    While a batch update is running, no other sokol-spine functions may
+    be called, and the same instance must not appear twice in the array.
+    Triggered events can be queried after the batch update has returned.
+
+    spinebatch_parallel_for() uses the same chunking for other per-instance
+    work (e.g. posing skeletons from a util/spinebake.h pose cache).
+*/
+#include <assert.h>
+
+#define SPINEBATCH_MAX_CHUNKS (4 * (JOBS_MAX_THREADS + 1))
+#define SPINEBATCH_CHUNKS_PER_THREAD (4)    // more chunks than threads to balance uneven skeletons
+
+typedef void (*spinebatch_range_func_t)(int start, int end, void* user_data);
+
+typedef struct {
+    spinebatch_range_func_t func;
+    void* user_data;
+    int start;
+    int end;
+} _spinebatch_chunk_t;
+
+typedef struct {
+    const sspine_instance* instances;
+    float delta_time;
+} _spinebatch_update_t;
+
+static struct {
+    _spinebatch_chunk_t chunks[SPINEBATCH_MAX_CHUNKS];
+} _spinebatch;
+
+static inline void _spinebatch_run_chunk(void* user_data) {
+    const _spinebatch_chunk_t* chunk = (const _spinebatch_chunk_t*) user_data;
+    chunk->func(chunk->start, chunk->end, chunk->user_data);
+}
+
+/* call func for chunks of the item range [0, num_items) in parallel, call from the main thread after jobs_setup() */
+static inline void spinebatch_parallel_for(int num_items, spinebatch_range_func_t func, void* user_data) {
+    assert((num_items >= 0) && func);
+    if (num_items == 0) {
+        return;
+    }
+    int num_chunks = (jobs_num_threads() + 1) * SPINEBATCH_CHUNKS_PER_THREAD;
+    if (num_chunks > SPINEBATCH_MAX_CHUNKS) {
+        num_chunks = SPINEBATCH_MAX_CHUNKS;
+    }
+    if (num_chunks > num_items) {
+        num_chunks = num_items;
+    }
+    if (jobs_num_threads() == 0) {
+        num_chunks = 1;
+    }
+    const int items_per_chunk = num_items / num_chunks;
+    int remainder = num_items % num_chunks;
+    int start = 0;
+    jobs_group_t group = {0};
+    for (int i = 0; i < num_chunks; i++) {
+        const int count = items_per_chunk + ((remainder > 0) ? 1 : 0);
+        remainder -= (remainder > 0) ? 1 : 0;
+        _spinebatch.chunks[i] = (_spinebatch_chunk_t){
+            .func = func,
+            .user_data = user_data,
+            .start = start,
+            .end = start + count,
+        };
+        start += count;
+        jobs_push(&group, _spinebatch_run_chunk, &_spinebatch.chunks[i]);
+    }
+    assert(start == num_items);
+    jobs_wait(&group);
+}
+
+static inline void _spinebatch_update_range(int start, int end, void* user_data) {
+    const _spinebatch_update_t* update = (const _spinebatch_update_t*) user_data;
+    for (int i = start; i < end; i++) {
+        sspine_update_instance(update->instances[i], update->delta_time);
+    }
+}
+
+/* update a batch of instances in parallel, call from the main thread after jobs_setup() */
+static inline void spinebatch_update_instances(const sspine_instance* instances, int num_instances, float delta_time) {
+    assert(instances && (num_instances >= 0));
+    _spinebatch_update_t update = { .instances = instances, .delta_time = delta_time };
+    spinebatch_parallel_for(num_instances, _spinebatch_update_range, &update);
+}
@@ -0,0 +1,4 @@
+// builds the vecmath.h micro benchmarks as a commandline program, see the
+// BENCHMARKS section at the end of vecmath.h
+#define VECMATH_RUN_BENCHMARKS
+#include "vecmath.h"
@@ -20,11 +20,14 @@ Other parts of the library have been modelled after the D3DX parts of the
 DirectX SDK.
 
 The goal of vecmath.h is to be a complete and comprehensive vector math
-library. It makes no use of SIMD intrinsics or similar, but instead just
-implements each function in the most straightforward way. It uses no complex
-macro acrobatics to shorten the implementations, and no templates or the
-like. Many compilers do a decent job optimizing the functions, but if you
-need maximum speed, you are probably best off doing a custom SIMD intrinsics
+library. The core functions make no use of SIMD intrinsics or similar, but
+instead just implement each function in the most straightforward way. It uses
+no complex macro acrobatics to shorten the implementations, and no templates or
+the like. Many compilers do a decent job optimizing the functions. For the
+common case of transforming whole arrays of matrices, points or bounding boxes,
+there is an opt-in set of batch functions using SIMD intrinsics (see "Batch
+functions" below, enabled with `VECMATH_SIMD`). Beyond that, if you need
+maximum speed, you are probably best off doing a custom SIMD intrinsics
 implementation for your specific use case - but this also involves structuring
 your data to allow for maximum parallelization.
 
@@ -713,6 +716,90 @@ Finally, there are transform helpers mirroring the ones in D3DX:
 	vec4_t vec4_transform( vec4_t v, mat44_t m )
 
 
+Fast approximations
+-------------------
+
+For code where speed matters more than the last few bits of precision, like
+animation blending or particles, there is a set of approximations:
+
+	float vecmath_rsqrt_fast( float v )
+	float vecmath_sin_fast( float v )
+	float vecmath_cos_fast( float v )
+	float vecmath_atan2_fast( float y, float x )
+	vec2_t vec2_normalize_fast( vec2_t v )
+	vec3_t vec3_normalize_fast( vec3_t v )
+	vec4_t vec4_normalize_fast( vec4_t v )
+	vec4_t quat_normalize_fast( vec4_t q )
+	vec4_t quat_nlerp( vec4_t a, vec4_t b, float t )
+	vec4_t quat_slerp_fast( vec4_t a, vec4_t b, float t )
+
+`vecmath_rsqrt_fast` uses a bit-level estimate refined with two Newton-Raphson
+steps. With `VECMATH_SIMD` defined, it uses the hardware reciprocal square root
+estimate with one step on SSE and NEON instead. Either way, it has a maximum
+relative error of 5e-5. The normalize functions are based on it, and have the
+same error bound.
+
+`vecmath_sin_fast` and `vecmath_cos_fast` reduce the angle to [-pi/2, pi/2] and
+evaluate a minimax polynomial, with a maximum absolute error of 1e-6 for angles
+up to +/-10000 radians. When compiling with -ffast-math, the compiler may merge
+the two steps of the range reduction, and the error then grows with the size of
+the angle (about 1e-6 at 10 radians, 1e-4 at 1000 radians).
+
+`vecmath_atan2_fast` uses a minimax polynomial for atan on [0, 1], and has a
+maximum absolute error of 5e-6 radians. It returns 0 if both x and y are 0.
+
+`quat_nlerp` is a normalized linear interpolation along the shortest path. It is
+exact at t = 0, 0.5 and 1, but does not have a constant angular velocity.
+
+`quat_slerp_fast` evaluates the slerp weights as a polynomial (see David Eberly,
+"A Fast and Accurate Algorithm for Computing SLERP"), without any trigonometric
+functions, square roots or divisions. It takes the shortest path like
+`quat_slerp`, and for unit quaternions the maximum absolute error of each
+component compared to `quat_slerp` is 5e-5.
+
+These error bounds are checked by the unit tests, and the benchmarks (see the
+BENCHMARKS section at the end of the file) list the speedup compared to the
+exact functions.
+
+
+Batch functions
+---------------
+
+For transforming whole arrays at once, there is an opt-in set of batch
+functions, enabled by defining `VECMATH_SIMD` before including vecmath.h:
+
+	void mat44_mul_array( mat44_t* out, mat44_t const* a, mat44_t const* b, int count )
+	void mat44_mul_array_mat44( mat44_t* out, mat44_t const* a, mat44_t b, int count )
+	void mat44_transform_points( vec3_t* out, vec3_t const* points, int count, mat44_t m )
+	void mat44_transform_aabbs( vec3_t* out_min, vec3_t* out_max, vec3_t const* min, vec3_t const* max, int count, mat44_t m )
+	void quat_to_mat44_array( mat44_t* out, vec4_t const* q, int count )
+	char const* vecmath_simd_impl( void )
+
+`mat44_mul_array` computes `out[i] = a[i] * b[i]`, `mat44_mul_array_mat44`
+computes `out[i] = a[i] * b`, `mat44_transform_points` is the array version of
+`vec3_transform_coord` and `quat_to_mat44_array` the array version of
+`mat44_from_quat`. `mat44_transform_aabbs` transforms axis aligned bounding
+boxes (with min <= max) by an affine matrix, and returns the axis aligned
+bounds of the transformed boxes. For the matrix multiplications and
+`mat44_transform_points`, the output array may be the same as an input array.
+
+Together with `vecmath_rsqrt_fast` (see "Fast approximations" above), these are
+the only parts of vecmath.h which use SIMD intrinsics: SSE2 is used on x86/x64,
+and NEON on ARM. When compiling with AVX or AVX2 enabled (e.g. `-mavx2`), all
+batch functions use 256-bit AVX registers: two matrices, points or boxes at a
+time, or eight quaternions at a time. They only need float arithmetic and
+shuffles, so AVX2 builds use the same code (without fused multiply-add, see
+below). Other platforms use plain loops over the scalar functions.
+`vecmath_simd_impl` returns the name of the implementation in use ("avx",
+"sse2", "neon" or "scalar").
+
+The SIMD versions perform the same operations in the same order as the scalar
+functions, without fused multiply-add, so results are typically identical. As
+the compiler may contract the scalar code into fused multiply-adds, results
+are only guaranteed to match the scalar functions within a relative tolerance
+of 1e-5, which is what the unit tests check.
+
+
 Vector swizzling
 ----------------
 
@@ -896,6 +983,25 @@ and using clang (gcc and tcc use similar syntax):
 The executable produced can then be run, and it will perform all tests and
 print the result.
 
+To also test the batch functions against the scalar functions, define
+`VECMATH_SIMD` as well, and enable the instruction set to test:
+
+	clang -xc vecmath.h -DVECMATH_RUN_TESTS -DVECMATH_SIMD -mavx2
+
+### Benchmarks
+
+Defining `VECMATH_RUN_BENCHMARKS` instead of `VECMATH_RUN_TESTS` builds a small
+commandline benchmark, which times the most commonly used functions (and the
+batch functions, if `VECMATH_SIMD` is defined) over large randomized arrays and
+reports nanoseconds per call and throughput:
+
+	clang -O2 -xc vecmath.h -DVECMATH_RUN_BENCHMARKS
+
+Results can be written as CSV, and compared against a CSV from another build
+(for example with `VECMATH_EXT_VECTOR_TYPE` or `-ffast-math`), failing if any
+function got slower than a given threshold. See the BENCHMARKS section at the
+end of the file for details.
+
 ### DirectX D3D conformance tests
 
 To ensure the correctness of the library, it seemed appropriate to test some
@@ -2844,6 +2950,66 @@ VECMATH_INLINE vec3_t vec3_transform_normal( vec3_t v, mat44_t m ) { vec4_t t =
 VECMATH_INLINE vec4_t vec4_transform( vec4_t v, mat44_t m ) { return vec4_mul_mat44( v, m ); }
 
 
+// fast approximations
+
+#if defined( VECMATH_SIMD ) && ( defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 ) )
+	#ifdef __cplusplus
+		} // namespace vecmath
+	#endif
+	#include <xmmintrin.h>
+	#ifdef __cplusplus
+		namespace vecmath {
+	#endif
+	// hardware estimate (12 bits) refined with one Newton-Raphson step
+	VECMATH_INLINE float vecmath_rsqrt_fast( float v ) { float y = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( v ) ) ); return y * ( 1.5f - 0.5f * v * y * y ); }
+#elif defined( VECMATH_SIMD ) && ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ) || defined( _M_ARM64 ) )
+	#ifdef __cplusplus
+		} // namespace vecmath
+	#endif
+	#include <arm_neon.h>
+	#ifdef __cplusplus
+		namespace vecmath {
+	#endif
+	// hardware estimate (8 bits) refined with one Newton-Raphson step
+	VECMATH_INLINE float vecmath_rsqrt_fast( float v ) { float32x2_t x = vdup_n_f32( v ); float32x2_t y = vrsqrte_f32( x ); y = vmul_f32( y, vrsqrts_f32( vmul_f32( x, y ), y ) ); return vget_lane_f32( y, 0 ); }
+#else
+	// bit-level estimate refined with two Newton-Raphson steps
+	VECMATH_INLINE float vecmath_rsqrt_fast( float v ) { union { float f; unsigned int u; } c; c.f = v; c.u = 0x5f375a86u - ( c.u >> 1 ); float y = c.f; y = y * ( 1.5f - 0.5f * v * y * y ); return y * ( 1.5f - 0.5f * v * y * y ); }
+#endif
+
+// minimax polynomials, sin on [-pi/2, pi/2] and atan on [0, 1]
+VECMATH_INLINE float vecmath_sin_poly_fast( float v ) { float s = v * v; return v * ( 0.99999997659f + s * ( -0.16666647635f + s * ( 0.0083328998234f + s * ( -0.00019800897763f + s * 2.5904885014e-6f ) ) ) ); }
+VECMATH_INLINE float vecmath_atan_poly_fast( float v ) { float s = v * v; return v * ( 0.99997721908f + s * ( -0.33262282789f + s * ( 0.19354037608f + s * ( -0.11642648197f + s * ( 0.052647351466f + s * -0.011719135734f ) ) ) ) ); }
+
+// the angle is reduced to [-pi/2, pi/2] by subtracting k*pi in two parts to keep the precision, and k is rounded
+// with an offset (valid for |v| < 50000) and applied as a sign multiplication, so that there are no branches
+VECMATH_INLINE float vecmath_sin_fast( float v ) { int k = (int)( v * 0.31830988618f + 16384.5f ) - 16384; float kf = (float) k; float r = ( v - kf * 3.140625f ) - kf * 0.00096765358979f; return vecmath_sin_poly_fast( r ) * (float)( 1 - ( ( k & 1 ) << 1 ) ); }
+VECMATH_INLINE float vecmath_cos_fast( float v ) { int k = (int)( v * 0.31830988618f + 16384.0f ) - 16384; float kf = (float) k + 0.5f; float r = ( v - kf * 3.140625f ) - kf * 0.00096765358979f; return vecmath_sin_poly_fast( r ) * (float)( ( ( k & 1 ) << 1 ) - 1 ); }
+VECMATH_INLINE float vecmath_atan2_fast( float y, float x ) { float ax = x < 0.0f ? -x : x; float ay = y < 0.0f ? -y : y; float mx = ax > ay ? ax : ay; float mn = ax > ay ? ay : ax; if( mx == 0.0f ) return 0.0f; float r = vecmath_atan_poly_fast( mn / mx ); r = ay > ax ? 1.5707963268f - r : r; r = x < 0.0f ? 3.1415926536f - r : r; return y < 0.0f ? -r : r; }
+
+VECMATH_INLINE vec2_t vec2_normalize_fast( vec2_t v ) { float l = v.x * v.x + v.y * v.y; if( l == 0.0f ) return v; float s = vecmath_rsqrt_fast( l ); return vec2( v.x * s, v.y * s ); }
+VECMATH_INLINE vec3_t vec3_normalize_fast( vec3_t v ) { float l = v.x * v.x + v.y * v.y + v.z * v.z; if( l == 0.0f ) return v; float s = vecmath_rsqrt_fast( l ); return vec3( v.x * s, v.y * s, v.z * s ); }
+VECMATH_INLINE vec4_t vec4_normalize_fast( vec4_t v ) { float l = v.x * v.x + v.y * v.y + v.z * v.z + v.w * v.w; if( l == 0.0f ) return v; float s = vecmath_rsqrt_fast( l ); return vec4( v.x * s, v.y * s, v.z * s, v.w * s ); }
+VECMATH_INLINE vec4_t quat_normalize_fast( vec4_t q ) { return vec4_normalize_fast( q ); }
+
+VECMATH_INLINE vec4_t quat_nlerp( vec4_t a, vec4_t b, float t ) { float s = vec4_dot( a, b ) < 0.0f ? -t : t; return vec4_normalize_fast( vec4_add( vec4_mulf( a, 1.0f - t ), vec4_mulf( b, s ) ) ); }
+
+// slerp weights as truncated series in (cos(theta) - 1), see David Eberly, "A Fast and Accurate Algorithm for Computing SLERP"
+VECMATH_INLINE float vecmath_slerp_weight_fast( float t, float xm1 ) {
+	float tt = t * t;
+	float r = 1.0f + ( 0.013624861f * tt - 0.87199110f ) * xm1;
+	r = 1.0f + ( tt * ( 1.0f / 105.0f ) - 7.0f / 15.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 78.0f ) - 6.0f / 13.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 55.0f ) - 5.0f / 11.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 36.0f ) - 4.0f / 9.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 21.0f ) - 3.0f / 7.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 10.0f ) - 2.0f / 5.0f ) * xm1 * r;
+	r = 1.0f + ( tt * ( 1.0f / 3.0f ) - 1.0f / 3.0f ) * xm1 * r;
+	return t * r;
+}
+VECMATH_INLINE vec4_t quat_slerp_fast( vec4_t a, vec4_t b, float t ) { float dot = vec4_dot( a, b ); float sign = dot < 0.0f ? -1.0f : 1.0f; float xm1 = dot * sign - 1.0f; return vec4_add( vec4_mulf( a, vecmath_slerp_weight_fast( 1.0f - t, xm1 ) ), vec4_mulf( b, sign * vecmath_slerp_weight_fast( t, xm1 ) ) ); }
+
+
 // swizzling
 
 VECMATH_INLINE vec2_t vec2_xx( vec2_t v ) { return vec2( v.x, v.x ); }
@@ -3337,6 +3503,359 @@ VECMATH_INLINE vec4_t vec4_wwwz( vec4_t v ) { return vec4( v.w, v.w, v.w, v.z );
 VECMATH_INLINE vec4_t vec4_wwww( vec4_t v ) { return vec4( v.w, v.w, v.w, v.w ); }
 
 
+// batch functions
+#ifdef VECMATH_SIMD
+
+	#ifdef __cplusplus
+		} // namespace vecmath
+	#endif
+
+	#if defined( __AVX__ )
+		#include <immintrin.h>
+		#define VECMATH_SIMD_SSE2
+		#define VECMATH_SIMD_AVX
+	#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+		#include <emmintrin.h>
+		#define VECMATH_SIMD_SSE2
+	#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ ) || defined( _M_ARM64 )
+		#include <arm_neon.h>
+		#define VECMATH_SIMD_NEON
+	#endif
+
+	#ifdef __cplusplus
+		namespace vecmath {
+	#endif
+
+	#define VECMATH_BATCH static inline
+
+	// 4-wide float helpers, using separate mul and add (no fused multiply-add) to match the scalar functions
+	#if defined( VECMATH_SIMD_SSE2 )
+		typedef __m128 vecmath_simd_f4_t;
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_load( float const* p ) { return _mm_loadu_ps( p ); }
+		VECMATH_INLINE void vecmath_simd_f4_store( float* p, vecmath_simd_f4_t v ) { _mm_storeu_ps( p, v ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat( float f ) { return _mm_set1_ps( f ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_set( float x, float y, float z, float w ) { return _mm_setr_ps( x, y, z, w ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_add( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return _mm_add_ps( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_sub( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return _mm_sub_ps( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_mul( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return _mm_mul_ps( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_div( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return _mm_div_ps( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_abs( vecmath_simd_f4_t a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_x( vecmath_simd_f4_t a ) { return _mm_shuffle_ps( a, a, _MM_SHUFFLE( 0, 0, 0, 0 ) ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_y( vecmath_simd_f4_t a ) { return _mm_shuffle_ps( a, a, _MM_SHUFFLE( 1, 1, 1, 1 ) ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_z( vecmath_simd_f4_t a ) { return _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 2, 2, 2 ) ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_w( vecmath_simd_f4_t a ) { return _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 3, 3, 3 ) ); }
+		VECMATH_INLINE void vecmath_simd_f4_transpose( vecmath_simd_f4_t* r0, vecmath_simd_f4_t* r1, vecmath_simd_f4_t* r2, vecmath_simd_f4_t* r3 ) { _MM_TRANSPOSE4_PS( *r0, *r1, *r2, *r3 ); }
+	#elif defined( VECMATH_SIMD_NEON )
+		typedef float32x4_t vecmath_simd_f4_t;
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_load( float const* p ) { return vld1q_f32( p ); }
+		VECMATH_INLINE void vecmath_simd_f4_store( float* p, vecmath_simd_f4_t v ) { vst1q_f32( p, v ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat( float f ) { return vdupq_n_f32( f ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_set( float x, float y, float z, float w ) { float v[ 4 ] = { x, y, z, w }; return vld1q_f32( v ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_add( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return vaddq_f32( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_sub( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return vsubq_f32( a, b ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_mul( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return vmulq_f32( a, b ); }
+		#if defined( __aarch64__ ) || defined( _M_ARM64 )
+			VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_div( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { return vdivq_f32( a, b ); }
+		#else
+			VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_div( vecmath_simd_f4_t a, vecmath_simd_f4_t b ) { float va[ 4 ], vb[ 4 ]; vst1q_f32( va, a ); vst1q_f32( vb, b ); va[ 0 ] /= vb[ 0 ]; va[ 1 ] /= vb[ 1 ]; va[ 2 ] /= vb[ 2 ]; va[ 3 ] /= vb[ 3 ]; return vld1q_f32( va ); }
+		#endif
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_abs( vecmath_simd_f4_t a ) { return vabsq_f32( a ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_x( vecmath_simd_f4_t a ) { return vdupq_lane_f32( vget_low_f32( a ), 0 ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_y( vecmath_simd_f4_t a ) { return vdupq_lane_f32( vget_low_f32( a ), 1 ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_z( vecmath_simd_f4_t a ) { return vdupq_lane_f32( vget_high_f32( a ), 0 ); }
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_f4_splat_w( vecmath_simd_f4_t a ) { return vdupq_lane_f32( vget_high_f32( a ), 1 ); }
+		VECMATH_INLINE void vecmath_simd_f4_transpose( vecmath_simd_f4_t* r0, vecmath_simd_f4_t* r1, vecmath_simd_f4_t* r2, vecmath_simd_f4_t* r3 ) {
+			float32x4x2_t t01 = vtrnq_f32( *r0, *r1 );
+			float32x4x2_t t23 = vtrnq_f32( *r2, *r3 );
+			*r0 = vcombine_f32( vget_low_f32( t01.val[ 0 ] ), vget_low_f32( t23.val[ 0 ] ) );
+			*r1 = vcombine_f32( vget_low_f32( t01.val[ 1 ] ), vget_low_f32( t23.val[ 1 ] ) );
+			*r2 = vcombine_f32( vget_high_f32( t01.val[ 0 ] ), vget_high_f32( t23.val[ 0 ] ) );
+			*r3 = vcombine_f32( vget_high_f32( t01.val[ 1 ] ), vget_high_f32( t23.val[ 1 ] ) );
+		}
+	#endif
+
+	VECMATH_INLINE char const* vecmath_simd_impl( void ) {
+		#if defined( VECMATH_SIMD_AVX )
+			return "avx";
+		#elif defined( VECMATH_SIMD_SSE2 )
+			return "sse2";
+		#elif defined( VECMATH_SIMD_NEON )
+			return "neon";
+		#else
+			return "scalar";
+		#endif
+	}
+
+	#if defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+		// one row of a * b, with the row of a in a vector register and the rows of b in b0..b3
+		VECMATH_INLINE vecmath_simd_f4_t vecmath_simd_row_mul( vecmath_simd_f4_t a, vecmath_simd_f4_t b0, vecmath_simd_f4_t b1, vecmath_simd_f4_t b2, vecmath_simd_f4_t b3 ) {
+			vecmath_simd_f4_t r = vecmath_simd_f4_mul( vecmath_simd_f4_splat_x( a ), b0 );
+			r = vecmath_simd_f4_add( r, vecmath_simd_f4_mul( vecmath_simd_f4_splat_y( a ), b1 ) );
+			r = vecmath_simd_f4_add( r, vecmath_simd_f4_mul( vecmath_simd_f4_splat_z( a ), b2 ) );
+			return vecmath_simd_f4_add( r, vecmath_simd_f4_mul( vecmath_simd_f4_splat_w( a ), b3 ) );
+		}
+	#endif
+
+	#if defined( VECMATH_SIMD_AVX )
+		// two rows of a * b, with the rows of b broadcast to both 128-bit lanes
+		VECMATH_INLINE __m256 vecmath_simd_row2_mul( __m256 a, __m256 b0, __m256 b1, __m256 b2, __m256 b3 ) {
+			__m256 r = _mm256_mul_ps( _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 0, 0, 0, 0 ) ), b0 );
+			r = _mm256_add_ps( r, _mm256_mul_ps( _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 1, 1, 1, 1 ) ), b1 ) );
+			r = _mm256_add_ps( r, _mm256_mul_ps( _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 2, 2, 2, 2 ) ), b2 ) );
+			return _mm256_add_ps( r, _mm256_mul_ps( _mm256_shuffle_ps( a, a, _MM_SHUFFLE( 3, 3, 3, 3 ) ), b3 ) );
+		}
+
+		VECMATH_INLINE void vecmath_simd_mat44_mul_avx( float* out, float const* a, float const* b ) {
+			__m256 b0 = _mm256_broadcast_ps( (__m128 const*)( b + 0 ) );
+			__m256 b1 = _mm256_broadcast_ps( (__m128 const*)( b + 4 ) );
+			__m256 b2 = _mm256_broadcast_ps( (__m128 const*)( b + 8 ) );
+			__m256 b3 = _mm256_broadcast_ps( (__m128 const*)( b + 12 ) );
+			__m256 a01 = _mm256_loadu_ps( a + 0 );
+			__m256 a23 = _mm256_loadu_ps( a + 8 );
+			_mm256_storeu_ps( out + 0, vecmath_simd_row2_mul( a01, b0, b1, b2, b3 ) );
+			_mm256_storeu_ps( out + 8, vecmath_simd_row2_mul( a23, b0, b1, b2, b3 ) );
+		}
+
+		// one value per 128-bit lane, broadcast to the four floats of the lane
+		VECMATH_INLINE __m256 vecmath_simd_f8_splat2( float lo, float hi ) { return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_set1_ps( lo ) ), _mm_set1_ps( hi ), 1 ); }
+
+		// 4x4 transpose within each 128-bit lane, like _MM_TRANSPOSE4_PS
+		VECMATH_INLINE void vecmath_simd_f8_transpose( __m256* r0, __m256* r1, __m256* r2, __m256* r3 ) {
+			__m256 t0 = _mm256_unpacklo_ps( *r0, *r1 ), t1 = _mm256_unpacklo_ps( *r2, *r3 );
+			__m256 t2 = _mm256_unpackhi_ps( *r0, *r1 ), t3 = _mm256_unpackhi_ps( *r2, *r3 );
+			*r0 = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+			*r1 = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+			*r2 = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+			*r3 = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		}
+	#endif
+
+	VECMATH_BATCH void mat44_mul_array( mat44_t* out, mat44_t const* a, mat44_t const* b, int count ) {
+		for( int i = 0; i < count; ++i ) {
+			#if defined( VECMATH_SIMD_AVX )
+				vecmath_simd_mat44_mul_avx( (float*)( out + i ), (float const*)( a + i ), (float const*)( b + i ) );
+			#elif defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+				float const* pa = (float const*)( a + i );
+				float const* pb = (float const*)( b + i );
+				float* po = (float*)( out + i );
+				vecmath_simd_f4_t b0 = vecmath_simd_f4_load( pb + 0 ), b1 = vecmath_simd_f4_load( pb + 4 ), b2 = vecmath_simd_f4_load( pb + 8 ), b3 = vecmath_simd_f4_load( pb + 12 );
+				vecmath_simd_f4_t a0 = vecmath_simd_f4_load( pa + 0 ), a1 = vecmath_simd_f4_load( pa + 4 ), a2 = vecmath_simd_f4_load( pa + 8 ), a3 = vecmath_simd_f4_load( pa + 12 );
+				vecmath_simd_f4_store( po + 0, vecmath_simd_row_mul( a0, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 4, vecmath_simd_row_mul( a1, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 8, vecmath_simd_row_mul( a2, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 12, vecmath_simd_row_mul( a3, b0, b1, b2, b3 ) );
+			#else
+				out[ i ] = mat44_mul_mat44( a[ i ], b[ i ] );
+			#endif
+		}
+	}
+
+	VECMATH_BATCH void mat44_mul_array_mat44( mat44_t* out, mat44_t const* a, mat44_t b, int count ) {
+		#if defined( VECMATH_SIMD_AVX )
+			float const* pb = (float const*)&b;
+			for( int i = 0; i < count; ++i ) {
+				vecmath_simd_mat44_mul_avx( (float*)( out + i ), (float const*)( a + i ), pb );
+			}
+		#elif defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+			float const* pb = (float const*)&b;
+			vecmath_simd_f4_t b0 = vecmath_simd_f4_load( pb + 0 ), b1 = vecmath_simd_f4_load( pb + 4 ), b2 = vecmath_simd_f4_load( pb + 8 ), b3 = vecmath_simd_f4_load( pb + 12 );
+			for( int i = 0; i < count; ++i ) {
+				float const* pa = (float const*)( a + i );
+				float* po = (float*)( out + i );
+				vecmath_simd_f4_t a0 = vecmath_simd_f4_load( pa + 0 ), a1 = vecmath_simd_f4_load( pa + 4 ), a2 = vecmath_simd_f4_load( pa + 8 ), a3 = vecmath_simd_f4_load( pa + 12 );
+				vecmath_simd_f4_store( po + 0, vecmath_simd_row_mul( a0, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 4, vecmath_simd_row_mul( a1, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 8, vecmath_simd_row_mul( a2, b0, b1, b2, b3 ) );
+				vecmath_simd_f4_store( po + 12, vecmath_simd_row_mul( a3, b0, b1, b2, b3 ) );
+			}
+		#else
+			for( int i = 0; i < count; ++i ) {
+				out[ i ] = mat44_mul_mat44( a[ i ], b );
+			}
+		#endif
+	}
+
+	VECMATH_BATCH void mat44_transform_points( vec3_t* out, vec3_t const* points, int count, mat44_t m ) {
+		#if defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+			float const* pm = (float const*)&m;
+			int i = 0;
+			#if defined( VECMATH_SIMD_AVX )
+				// two points at a time, one per 128-bit lane
+				__m256 w0 = _mm256_broadcast_ps( (__m128 const*)( pm + 0 ) ), w1 = _mm256_broadcast_ps( (__m128 const*)( pm + 4 ) );
+				__m256 w2 = _mm256_broadcast_ps( (__m128 const*)( pm + 8 ) ), w3 = _mm256_broadcast_ps( (__m128 const*)( pm + 12 ) );
+				for( ; i + 2 <= count; i += 2 ) {
+					vec3_t p0 = points[ i ], p1 = points[ i + 1 ];
+					__m256 r = _mm256_mul_ps( vecmath_simd_f8_splat2( p0.x, p1.x ), w0 );
+					r = _mm256_add_ps( r, _mm256_mul_ps( vecmath_simd_f8_splat2( p0.y, p1.y ), w1 ) );
+					r = _mm256_add_ps( r, _mm256_mul_ps( vecmath_simd_f8_splat2( p0.z, p1.z ), w2 ) );
+					r = _mm256_add_ps( r, w3 );
+					r = _mm256_div_ps( r, _mm256_shuffle_ps( r, r, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+					float t[ 8 ];
+					_mm256_storeu_ps( t, r );
+					out[ i ] = vec3( t[ 0 ], t[ 1 ], t[ 2 ] );
+					out[ i + 1 ] = vec3( t[ 4 ], t[ 5 ], t[ 6 ] );
+				}
+			#endif
+			vecmath_simd_f4_t m0 = vecmath_simd_f4_load( pm + 0 ), m1 = vecmath_simd_f4_load( pm + 4 ), m2 = vecmath_simd_f4_load( pm + 8 ), m3 = vecmath_simd_f4_load( pm + 12 );
+			for( ; i < count; ++i ) {
+				vec3_t p = points[ i ];
+				vecmath_simd_f4_t r = vecmath_simd_f4_mul( vecmath_simd_f4_splat( p.x ), m0 );
+				r = vecmath_simd_f4_add( r, vecmath_simd_f4_mul( vecmath_simd_f4_splat( p.y ), m1 ) );
+				r = vecmath_simd_f4_add( r, vecmath_simd_f4_mul( vecmath_simd_f4_splat( p.z ), m2 ) );
+				r = vecmath_simd_f4_add( r, m3 );
+				r = vecmath_simd_f4_div( r, vecmath_simd_f4_splat_w( r ) );
+				float t[ 4 ];
+				vecmath_simd_f4_store( t, r );
+				out[ i ] = vec3( t[ 0 ], t[ 1 ], t[ 2 ] );
+			}
+		#else
+			for( int i = 0; i < count; ++i ) {
+				out[ i ] = vec3_transform_coord( points[ i ], m );
+			}
+		#endif
+	}
+
+	VECMATH_BATCH void mat44_transform_aabbs( vec3_t* out_min, vec3_t* out_max, vec3_t const* min, vec3_t const* max, int count, mat44_t m ) {
+		#if defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+			float const* pm = (float const*)&m;
+			vecmath_simd_f4_t m0 = vecmath_simd_f4_load( pm + 0 ), m1 = vecmath_simd_f4_load( pm + 4 ), m2 = vecmath_simd_f4_load( pm + 8 ), m3 = vecmath_simd_f4_load( pm + 12 );
+			vecmath_simd_f4_t a0 = vecmath_simd_f4_abs( m0 ), a1 = vecmath_simd_f4_abs( m1 ), a2 = vecmath_simd_f4_abs( m2 );
+			vecmath_simd_f4_t half = vecmath_simd_f4_splat( 0.5f );
+			int i = 0;
+			#if defined( VECMATH_SIMD_AVX )
+				// two boxes at a time, one per 128-bit lane
+				__m256 w0 = _mm256_broadcast_ps( (__m128 const*)( pm + 0 ) ), w1 = _mm256_broadcast_ps( (__m128 const*)( pm + 4 ) );
+				__m256 w2 = _mm256_broadcast_ps( (__m128 const*)( pm + 8 ) ), w3 = _mm256_broadcast_ps( (__m128 const*)( pm + 12 ) );
+				__m256 sign = _mm256_set1_ps( -0.0f );
+				__m256 b0 = _mm256_andnot_ps( sign, w0 ), b1 = _mm256_andnot_ps( sign, w1 ), b2 = _mm256_andnot_ps( sign, w2 );
+				__m256 half8 = _mm256_set1_ps( 0.5f );
+				for( ; i + 2 <= count; i += 2 ) {
+					vec3_t mn0 = min[ i ], mx0 = max[ i ], mn1 = min[ i + 1 ], mx1 = max[ i + 1 ];
+					__m256 vmin = _mm256_setr_ps( mn0.x, mn0.y, mn0.z, 0.0f, mn1.x, mn1.y, mn1.z, 0.0f );
+					__m256 vmax = _mm256_setr_ps( mx0.x, mx0.y, mx0.z, 0.0f, mx1.x, mx1.y, mx1.z, 0.0f );
+					__m256 c = _mm256_mul_ps( _mm256_add_ps( vmin, vmax ), half8 );
+					__m256 e = _mm256_mul_ps( _mm256_sub_ps( vmax, vmin ), half8 );
+					__m256 nc = _mm256_mul_ps( _mm256_shuffle_ps( c, c, _MM_SHUFFLE( 0, 0, 0, 0 ) ), w0 );
+					nc = _mm256_add_ps( nc, _mm256_mul_ps( _mm256_shuffle_ps( c, c, _MM_SHUFFLE( 1, 1, 1, 1 ) ), w1 ) );
+					nc = _mm256_add_ps( nc, _mm256_mul_ps( _mm256_shuffle_ps( c, c, _MM_SHUFFLE( 2, 2, 2, 2 ) ), w2 ) );
+					nc = _mm256_add_ps( nc, w3 );
+					__m256 ne = _mm256_mul_ps( _mm256_shuffle_ps( e, e, _MM_SHUFFLE( 0, 0, 0, 0 ) ), b0 );
+					ne = _mm256_add_ps( ne, _mm256_mul_ps( _mm256_shuffle_ps( e, e, _MM_SHUFFLE( 1, 1, 1, 1 ) ), b1 ) );
+					ne = _mm256_add_ps( ne, _mm256_mul_ps( _mm256_shuffle_ps( e, e, _MM_SHUFFLE( 2, 2, 2, 2 ) ), b2 ) );
+					float t0[ 8 ], t1[ 8 ];
+					_mm256_storeu_ps( t0, _mm256_sub_ps( nc, ne ) );
+					_mm256_storeu_ps( t1, _mm256_add_ps( nc, ne ) );
+					out_min[ i ] = vec3( t0[ 0 ], t0[ 1 ], t0[ 2 ] );
+					out_max[ i ] = vec3( t1[ 0 ], t1[ 1 ], t1[ 2 ] );
+					out_min[ i + 1 ] = vec3( t0[ 4 ], t0[ 5 ], t0[ 6 ] );
+					out_max[ i + 1 ] = vec3( t1[ 4 ], t1[ 5 ], t1[ 6 ] );
+				}
+			#endif
+			for( ; i < count; ++i ) {
+				vec3_t mn = min[ i ], mx = max[ i ];
+				vecmath_simd_f4_t vmin = vecmath_simd_f4_set( mn.x, mn.y, mn.z, 0.0f );
+				vecmath_simd_f4_t vmax = vecmath_simd_f4_set( mx.x, mx.y, mx.z, 0.0f );
+				vecmath_simd_f4_t c = vecmath_simd_f4_mul( vecmath_simd_f4_add( vmin, vmax ), half );
+				vecmath_simd_f4_t e = vecmath_simd_f4_mul( vecmath_simd_f4_sub( vmax, vmin ), half );
+				vecmath_simd_f4_t nc = vecmath_simd_f4_mul( vecmath_simd_f4_splat_x( c ), m0 );
+				nc = vecmath_simd_f4_add( nc, vecmath_simd_f4_mul( vecmath_simd_f4_splat_y( c ), m1 ) );
+				nc = vecmath_simd_f4_add( nc, vecmath_simd_f4_mul( vecmath_simd_f4_splat_z( c ), m2 ) );
+				nc = vecmath_simd_f4_add( nc, m3 );
+				vecmath_simd_f4_t ne = vecmath_simd_f4_mul( vecmath_simd_f4_splat_x( e ), a0 );
+				ne = vecmath_simd_f4_add( ne, vecmath_simd_f4_mul( vecmath_simd_f4_splat_y( e ), a1 ) );
+				ne = vecmath_simd_f4_add( ne, vecmath_simd_f4_mul( vecmath_simd_f4_splat_z( e ), a2 ) );
+				float t0[ 4 ], t1[ 4 ];
+				vecmath_simd_f4_store( t0, vecmath_simd_f4_sub( nc, ne ) );
+				vecmath_simd_f4_store( t1, vecmath_simd_f4_add( nc, ne ) );
+				out_min[ i ] = vec3( t0[ 0 ], t0[ 1 ], t0[ 2 ] );
+				out_max[ i ] = vec3( t1[ 0 ], t1[ 1 ], t1[ 2 ] );
+			}
+		#else
+			for( int i = 0; i < count; ++i ) {
+				vec3_t c = vec3_mulf( vec3_add( min[ i ], max[ i ] ), 0.5f );
+				vec3_t e = vec3_mulf( vec3_sub( max[ i ], min[ i ] ), 0.5f );
+				vec3_t nc = vec3( c.x * m.x.x + c.y * m.y.x + c.z * m.z.x + m.w.x, c.x * m.x.y + c.y * m.y.y + c.z * m.z.y + m.w.y, c.x * m.x.z + c.y * m.y.z + c.z * m.z.z + m.w.z );
+				vec3_t ne = vec3( e.x * vecmath_abs( m.x.x ) + e.y * vecmath_abs( m.y.x ) + e.z * vecmath_abs( m.z.x ), e.x * vecmath_abs( m.x.y ) + e.y * vecmath_abs( m.y.y ) + e.z * vecmath_abs( m.z.y ), e.x * vecmath_abs( m.x.z ) + e.y * vecmath_abs( m.y.z ) + e.z * vecmath_abs( m.z.z ) );
+				out_min[ i ] = vec3_sub( nc, ne );
+				out_max[ i ] = vec3_add( nc, ne );
+			}
+		#endif
+	}
+
+	VECMATH_BATCH void quat_to_mat44_array( mat44_t* out, vec4_t const* q, int count ) {
+		int i = 0;
+		#if defined( VECMATH_SIMD_AVX )
+			__m256 one8 = _mm256_set1_ps( 1.0f ), two8 = _mm256_set1_ps( 2.0f ), zero8 = _mm256_setzero_ps();
+			__m256 row_w8 = _mm256_setr_ps( 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f );
+			for( ; i + 8 <= count; i += 8 ) {
+				// eight quaternions at a time, transposed within the 128-bit lanes, so that the
+				// low lanes hold quaternions 0/2/4/6 and the high lanes quaternions 1/3/5/7
+				float const* pq = (float const*)( q + i );
+				__m256 x = _mm256_loadu_ps( pq + 0 ), y = _mm256_loadu_ps( pq + 8 ), z = _mm256_loadu_ps( pq + 16 ), w = _mm256_loadu_ps( pq + 24 );
+				vecmath_simd_f8_transpose( &x, &y, &z, &w );
+				__m256 xx = _mm256_mul_ps( x, x ), yy = _mm256_mul_ps( y, y ), zz = _mm256_mul_ps( z, z );
+				__m256 xy = _mm256_mul_ps( x, y ), xz = _mm256_mul_ps( x, z ), yz = _mm256_mul_ps( y, z );
+				__m256 wx = _mm256_mul_ps( w, x ), wy = _mm256_mul_ps( w, y ), wz = _mm256_mul_ps( w, z );
+				__m256 r[ 3 ][ 4 ] = {
+					{ _mm256_sub_ps( one8, _mm256_mul_ps( two8, _mm256_add_ps( yy, zz ) ) ), _mm256_mul_ps( two8, _mm256_add_ps( xy, wz ) ), _mm256_mul_ps( two8, _mm256_sub_ps( xz, wy ) ), zero8 },
+					{ _mm256_mul_ps( two8, _mm256_sub_ps( xy, wz ) ), _mm256_sub_ps( one8, _mm256_mul_ps( two8, _mm256_add_ps( xx, zz ) ) ), _mm256_mul_ps( two8, _mm256_add_ps( yz, wx ) ), zero8 },
+					{ _mm256_mul_ps( two8, _mm256_add_ps( xz, wy ) ), _mm256_mul_ps( two8, _mm256_sub_ps( yz, wx ) ), _mm256_sub_ps( one8, _mm256_mul_ps( two8, _mm256_add_ps( xx, yy ) ) ), zero8 },
+				};
+				// transpose back, afterwards r[ row ][ k ] holds that row of matrices 2k (low lane) and 2k+1 (high lane)
+				for( int row = 0; row < 3; ++row ) {
+					vecmath_simd_f8_transpose( &r[ row ][ 0 ], &r[ row ][ 1 ], &r[ row ][ 2 ], &r[ row ][ 3 ] );
+				}
+				float* po = (float*)( out + i );
+				for( int k = 0; k < 4; ++k ) {
+					_mm256_storeu_ps( po + 32 * k + 0, _mm256_permute2f128_ps( r[ 0 ][ k ], r[ 1 ][ k ], 0x20 ) );
+					_mm256_storeu_ps( po + 32 * k + 8, _mm256_permute2f128_ps( r[ 2 ][ k ], row_w8, 0x20 ) );
+					_mm256_storeu_ps( po + 32 * k + 16, _mm256_permute2f128_ps( r[ 0 ][ k ], r[ 1 ][ k ], 0x31 ) );
+					_mm256_storeu_ps( po + 32 * k + 24, _mm256_permute2f128_ps( r[ 2 ][ k ], row_w8, 0x31 ) );
+				}
+			}
+		#endif
+		#if defined( VECMATH_SIMD_SSE2 ) || defined( VECMATH_SIMD_NEON )
+			vecmath_simd_f4_t one = vecmath_simd_f4_splat( 1.0f ), two = vecmath_simd_f4_splat( 2.0f ), zero = vecmath_simd_f4_splat( 0.0f );
+			vecmath_simd_f4_t row_w = vecmath_simd_f4_set( 0.0f, 0.0f, 0.0f, 1.0f );
+			for( ; i + 4 <= count; i += 4 ) {
+				// four quaternions at a time, transposed into x/y/z/w vectors
+				float const* pq = (float const*)( q + i );
+				vecmath_simd_f4_t x = vecmath_simd_f4_load( pq + 0 ), y = vecmath_simd_f4_load( pq + 4 ), z = vecmath_simd_f4_load( pq + 8 ), w = vecmath_simd_f4_load( pq + 12 );
+				vecmath_simd_f4_transpose( &x, &y, &z, &w );
+				vecmath_simd_f4_t xx = vecmath_simd_f4_mul( x, x ), yy = vecmath_simd_f4_mul( y, y ), zz = vecmath_simd_f4_mul( z, z );
+				vecmath_simd_f4_t xy = vecmath_simd_f4_mul( x, y ), xz = vecmath_simd_f4_mul( x, z ), yz = vecmath_simd_f4_mul( y, z );
+				vecmath_simd_f4_t wx = vecmath_simd_f4_mul( w, x ), wy = vecmath_simd_f4_mul( w, y ), wz = vecmath_simd_f4_mul( w, z );
+				vecmath_simd_f4_t xx0 = vecmath_simd_f4_sub( one, vecmath_simd_f4_mul( two, vecmath_simd_f4_add( yy, zz ) ) );
+				vecmath_simd_f4_t xy0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_add( xy, wz ) );
+				vecmath_simd_f4_t xz0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_sub( xz, wy ) );
+				vecmath_simd_f4_t xw0 = zero;
+				vecmath_simd_f4_t yx0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_sub( xy, wz ) );
+				vecmath_simd_f4_t yy0 = vecmath_simd_f4_sub( one, vecmath_simd_f4_mul( two, vecmath_simd_f4_add( xx, zz ) ) );
+				vecmath_simd_f4_t yz0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_add( yz, wx ) );
+				vecmath_simd_f4_t yw0 = zero;
+				vecmath_simd_f4_t zx0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_add( xz, wy ) );
+				vecmath_simd_f4_t zy0 = vecmath_simd_f4_mul( two, vecmath_simd_f4_sub( yz, wx ) );
+				vecmath_simd_f4_t zz0 = vecmath_simd_f4_sub( one, vecmath_simd_f4_mul( two, vecmath_simd_f4_add( xx, yy ) ) );
+				vecmath_simd_f4_t zw0 = zero;
+				// transpose back, afterwards xx0/xy0/xz0/xw0 are the x rows of matrices 0/1/2/3 etc
+				vecmath_simd_f4_transpose( &xx0, &xy0, &xz0, &xw0 );
+				vecmath_simd_f4_transpose( &yx0, &yy0, &yz0, &yw0 );
+				vecmath_simd_f4_transpose( &zx0, &zy0, &zz0, &zw0 );
+				float* po = (float*)( out + i );
+				vecmath_simd_f4_store( po + 0, xx0 ); vecmath_simd_f4_store( po + 4, yx0 ); vecmath_simd_f4_store( po + 8, zx0 ); vecmath_simd_f4_store( po + 12, row_w );
+				vecmath_simd_f4_store( po + 16, xy0 ); vecmath_simd_f4_store( po + 20, yy0 ); vecmath_simd_f4_store( po + 24, zy0 ); vecmath_simd_f4_store( po + 28, row_w );
+				vecmath_simd_f4_store( po + 32, xz0 ); vecmath_simd_f4_store( po + 36, yz0 ); vecmath_simd_f4_store( po + 40, zz0 ); vecmath_simd_f4_store( po + 44, row_w );
+				vecmath_simd_f4_store( po + 48, xw0 ); vecmath_simd_f4_store( po + 52, yw0 ); vecmath_simd_f4_store( po + 56, zw0 ); vecmath_simd_f4_store( po + 60, row_w );
+			}
+		#endif
+		for( ; i < count; ++i ) {
+			out[ i ] = mat44_from_quat( q[ i ] );
+		}
+	}
+
+#endif /* VECMATH_SIMD */
+
+
 // c++ operators
 #ifdef __cplusplus
 	// vec2
@@ -20576,6 +21095,279 @@ void test_d3d_compliance( void ) {
 #endif /* VECMATH_RUN_D3DX_TESTS */
 
 
+// the fast approximations are checked against their documented maximum errors
+float test_fast_rand( unsigned int* seed ) { *seed = *seed * 1664525u + 1013904223u; return (float)( *seed >> 8 ) / 16777216.0f * 2.0f - 1.0f; }
+vec4_t test_fast_rand_quat( unsigned int* seed ) { float x = test_fast_rand( seed ); float y = test_fast_rand( seed ); float z = test_fast_rand( seed ); float w = test_fast_rand( seed ); return quat_normalize( vec4( x, y, z, w ) ); }
+
+#define TEST_FAST_COUNT 100000
+
+void test_fast_approximations( void ) {
+	// vecmath_rsqrt_fast
+	TESTFW_TEST_BEGIN( "vecmath_rsqrt_fast is within a relative error of 5e-5" )
+		unsigned int seed = 1;
+		double max_err = 0.0;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			float v = (float) pow( 10.0, test_fast_rand( &seed ) * 6.0 );
+			double err = fabs( vecmath_rsqrt_fast( v ) * sqrt( (double) v ) - 1.0 );
+			max_err = err > max_err ? err : max_err;
+		}
+		TESTFW_EXPECTED( max_err <= 5e-5 );
+	TESTFW_TEST_END();
+
+	// vecN_normalize_fast
+	TESTFW_TEST_BEGIN( "vec3_normalize_fast matches vec3_normalize within 5e-5" )
+		unsigned int seed = 2;
+		int ok = 1;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			float s = (float) pow( 10.0, test_fast_rand( &seed ) * 3.0 );
+			float x = test_fast_rand( &seed ) * s; float y = test_fast_rand( &seed ) * s; float z = test_fast_rand( &seed ) * s;
+			vec3_t a = vec3_normalize_fast( vec3( x, y, z ) );
+			vec3_t b = vec3_normalize( vec3( x, y, z ) );
+			ok = ok && fabsf( a.x - b.x ) <= 5e-5f && fabsf( a.y - b.y ) <= 5e-5f && fabsf( a.z - b.z ) <= 5e-5f;
+		}
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "vecN_normalize_fast returns zero vectors unchanged" )
+		vec2_t a = vec2_normalize_fast( vec2f( 0.0f ) );
+		vec3_t b = vec3_normalize_fast( vec3f( 0.0f ) );
+		vec4_t c = vec4_normalize_fast( vec4f( 0.0f ) );
+		TESTFW_EXPECTED( a.x == 0.0f && a.y == 0.0f );
+		TESTFW_EXPECTED( b.x == 0.0f && b.y == 0.0f && b.z == 0.0f );
+		TESTFW_EXPECTED( c.x == 0.0f && c.y == 0.0f && c.z == 0.0f && c.w == 0.0f );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "quat_normalize_fast returns unit length within 5e-5" )
+		unsigned int seed = 3;
+		int ok = 1;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			float x = test_fast_rand( &seed ); float y = test_fast_rand( &seed ); float z = test_fast_rand( &seed ); float w = test_fast_rand( &seed );
+			vec4_t q = quat_normalize_fast( vec4( x, y, z, w ) );
+			ok = ok && fabsf( vec4_length( q ) - 1.0f ) <= 5e-5f;
+		}
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	// vecmath_sin_fast / vecmath_cos_fast
+	TESTFW_TEST_BEGIN( "vecmath_sin_fast and vecmath_cos_fast are within 1e-6 for |v| <= 10000" )
+		unsigned int seed = 4;
+		// -ffast-math may fold the two-part range reduction, which only keeps the precision for small angles
+		#ifdef __FAST_MATH__
+			float range = 10.0f;
+		#else
+			float range = 10000.0f;
+		#endif
+		double max_err = 0.0;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			float v = test_fast_rand( &seed ) * ( i < TEST_FAST_COUNT / 2 ? 10.0f : range );
+			double s = fabs( vecmath_sin_fast( v ) - sin( (double) v ) );
+			double c = fabs( vecmath_cos_fast( v ) - cos( (double) v ) );
+			max_err = s > max_err ? s : max_err;
+			max_err = c > max_err ? c : max_err;
+		}
+		TESTFW_EXPECTED( max_err <= 1e-6 );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "vecmath_sin_fast and vecmath_cos_fast return expected values at multiples of pi/2" )
+		TESTFW_EXPECTED( vecmath_sin_fast( 0.0f ) == 0.0f );
+		TESTFW_EXPECTED( test_cmp( vecmath_cos_fast( 0.0f ), 1.0f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_sin_fast( VECMATH_PI * 0.5f ), 1.0f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_cos_fast( VECMATH_PI * 0.5f ), 0.0f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_sin_fast( -VECMATH_PI * 0.5f ), -1.0f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_cos_fast( VECMATH_PI ), -1.0f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_sin_fast( VECMATH_PI * 3.0f ), 0.0f ) );
+	TESTFW_TEST_END();
+
+	// vecmath_atan2_fast
+	TESTFW_TEST_BEGIN( "vecmath_atan2_fast is within 5e-6 radians" )
+		unsigned int seed = 5;
+		double max_err = 0.0;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			float y = test_fast_rand( &seed ) * 100.0f;
+			float x = test_fast_rand( &seed ) * 100.0f;
+			double err = fabs( vecmath_atan2_fast( y, x ) - atan2( (double) y, (double) x ) );
+			max_err = err > max_err ? err : max_err;
+		}
+		TESTFW_EXPECTED( max_err <= 5e-6 );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "vecmath_atan2_fast returns expected values on the axes" )
+		TESTFW_EXPECTED( vecmath_atan2_fast( 0.0f, 0.0f ) == 0.0f );
+		TESTFW_EXPECTED( vecmath_atan2_fast( 0.0f, 1.0f ) == 0.0f );
+		TESTFW_EXPECTED( test_cmp( vecmath_atan2_fast( 1.0f, 0.0f ), VECMATH_PI * 0.5f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_atan2_fast( -1.0f, 0.0f ), -VECMATH_PI * 0.5f ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_atan2_fast( 0.0f, -1.0f ), VECMATH_PI ) );
+		TESTFW_EXPECTED( test_cmp( vecmath_atan2_fast( -1.0f, -1.0f ), -VECMATH_PI * 0.75f ) );
+	TESTFW_TEST_END();
+
+	// quat_slerp_fast
+	TESTFW_TEST_BEGIN( "quat_slerp_fast matches quat_slerp within 5e-5" )
+		unsigned int seed = 6;
+		int ok = 1;
+		for( int i = 0; i < TEST_FAST_COUNT; ++i ) {
+			vec4_t a = test_fast_rand_quat( &seed );
+			vec4_t b = test_fast_rand_quat( &seed );
+			float t = test_fast_rand( &seed ) * 0.5f + 0.5f;
+			vec4_t r = quat_slerp_fast( a, b, t );
+			vec4_t e = quat_slerp( a, b, t );
+			ok = ok && fabsf( r.x - e.x ) <= 5e-5f && fabsf( r.y - e.y ) <= 5e-5f && fabsf( r.z - e.z ) <= 5e-5f && fabsf( r.w - e.w ) <= 5e-5f;
+		}
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "quat_slerp_fast returns a when t=0 and b when t=1" )
+		vec4_t a = quat_normalize( vec4( 0.1f, 0.2f, 0.3f, 0.9f ) );
+		vec4_t b = quat_normalize( vec4( -0.5f, 0.4f, 0.1f, 0.6f ) );
+		vec4_t r0 = quat_slerp_fast( a, b, 0.0f );
+		vec4_t r1 = quat_slerp_fast( a, b, 1.0f );
+		TESTFW_EXPECTED( test_cmp( r0.x, a.x ) && test_cmp( r0.y, a.y ) && test_cmp( r0.z, a.z ) && test_cmp( r0.w, a.w ) );
+		TESTFW_EXPECTED( test_cmp( r1.x, b.x ) && test_cmp( r1.y, b.y ) && test_cmp( r1.z, b.z ) && test_cmp( r1.w, b.w ) );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "quat_slerp_fast takes the shortest path" )
+		vec4_t a = quat_normalize( vec4( 0.1f, 0.2f, 0.3f, 0.9f ) );
+		vec4_t b = quat_normalize( vec4( -0.5f, 0.4f, 0.1f, 0.6f ) );
+		vec4_t r = quat_slerp_fast( a, b, 0.3f );
+		vec4_t n = quat_slerp_fast( a, vec4_neg( b ), 0.3f );
+		TESTFW_EXPECTED( test_cmp( r.x, n.x ) && test_cmp( r.y, n.y ) && test_cmp( r.z, n.z ) && test_cmp( r.w, n.w ) );
+	TESTFW_TEST_END();
+
+	// quat_nlerp
+	TESTFW_TEST_BEGIN( "quat_nlerp returns unit quaternions on the shortest path" )
+		vec4_t a = quat_normalize( vec4( 0.1f, 0.2f, 0.3f, 0.9f ) );
+		vec4_t b = quat_normalize( vec4( -0.5f, 0.4f, 0.1f, 0.6f ) );
+		vec4_t r0 = quat_nlerp( a, b, 0.0f );
+		vec4_t r1 = quat_nlerp( a, vec4_neg( b ), 1.0f );
+		vec4_t h = quat_nlerp( a, b, 0.5f );
+		vec4_t e = quat_slerp( a, b, 0.5f );
+		TESTFW_EXPECTED( test_cmp( r0.x, a.x ) && test_cmp( r0.y, a.y ) && test_cmp( r0.z, a.z ) && test_cmp( r0.w, a.w ) );
+		TESTFW_EXPECTED( test_cmp( r1.x, b.x ) && test_cmp( r1.y, b.y ) && test_cmp( r1.z, b.z ) && test_cmp( r1.w, b.w ) );
+		TESTFW_EXPECTED( test_cmp( h.x, e.x ) && test_cmp( h.y, e.y ) && test_cmp( h.z, e.z ) && test_cmp( h.w, e.w ) );
+	TESTFW_TEST_END();
+}
+
+
+#ifdef VECMATH_SIMD
+
+// batch results must match the scalar functions within a relative tolerance of 1e-5
+int test_cmp_batch( float a, float b ) { float d = a - b; float s = fabsf( b ) > 1.0f ? fabsf( b ) : 1.0f; return d > -0.00001f * s && d < 0.00001f * s; }
+int test_cmp_batch_vec3( vec3_t a, vec3_t b ) { return test_cmp_batch( a.x, b.x ) && test_cmp_batch( a.y, b.y ) && test_cmp_batch( a.z, b.z ); }
+int test_cmp_batch_vec4( vec4_t a, vec4_t b ) { return test_cmp_batch( a.x, b.x ) && test_cmp_batch( a.y, b.y ) && test_cmp_batch( a.z, b.z ) && test_cmp_batch( a.w, b.w ); }
+int test_cmp_batch_mat44( mat44_t a, mat44_t b ) { return test_cmp_batch_vec4( a.x, b.x ) && test_cmp_batch_vec4( a.y, b.y ) && test_cmp_batch_vec4( a.z, b.z ) && test_cmp_batch_vec4( a.w, b.w ); }
+
+float test_batch_rand( unsigned int* seed ) { *seed = *seed * 1664525u + 1013904223u; return (float)( *seed >> 8 ) / 16777216.0f * 20.0f - 10.0f; }
+vec3_t test_batch_rand_vec3( unsigned int* seed ) { float x = test_batch_rand( seed ); float y = test_batch_rand( seed ); float z = test_batch_rand( seed ); return vec3( x, y, z ); }
+vec4_t test_batch_rand_vec4( unsigned int* seed ) { float x = test_batch_rand( seed ); float y = test_batch_rand( seed ); float z = test_batch_rand( seed ); float w = test_batch_rand( seed ); return vec4( x, y, z, w ); }
+mat44_t test_batch_rand_mat44( unsigned int* seed ) { vec4_t x = test_batch_rand_vec4( seed ); vec4_t y = test_batch_rand_vec4( seed ); vec4_t z = test_batch_rand_vec4( seed ); vec4_t w = test_batch_rand_vec4( seed ); return mat44( x, y, z, w ); }
+mat44_t test_batch_rand_affine( unsigned int* seed ) { vec3_t axis = vec3_normalize( test_batch_rand_vec3( seed ) ); float angle = test_batch_rand( seed ); vec3_t t = test_batch_rand_vec3( seed ); float s = 0.5f + fabsf( test_batch_rand( seed ) ) * 0.2f; return mat44_mul_mat44( mat44_mul_mat44( mat44_scaling( s, s * 2.0f, s ), mat44_rotation_axis( axis, angle ) ), mat44_translation( t.x, t.y, t.z ) ); }
+
+#define TEST_BATCH_COUNT 37 // not a multiple of 4 or 8, to cover the remainder loops
+
+void test_batch( void ) {
+	printf( "SIMD batch functions: %s\n", vecmath_simd_impl() );
+
+	TESTFW_TEST_BEGIN( "mat44_mul_array matches mat44_mul_mat44" )
+		unsigned int seed = 1;
+		mat44_t a[ TEST_BATCH_COUNT ], b[ TEST_BATCH_COUNT ], r[ TEST_BATCH_COUNT ];
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { a[ i ] = test_batch_rand_mat44( &seed ); b[ i ] = test_batch_rand_mat44( &seed ); }
+		mat44_mul_array( r, a, b, TEST_BATCH_COUNT );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { ok = ok && test_cmp_batch_mat44( r[ i ], mat44_mul_mat44( a[ i ], b[ i ] ) ); }
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_mul_array allows the output to alias an input" )
+		unsigned int seed = 2;
+		mat44_t a[ TEST_BATCH_COUNT ], b[ TEST_BATCH_COUNT ], expected[ TEST_BATCH_COUNT ];
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { a[ i ] = test_batch_rand_mat44( &seed ); b[ i ] = test_batch_rand_mat44( &seed ); expected[ i ] = mat44_mul_mat44( a[ i ], b[ i ] ); }
+		mat44_mul_array( a, a, b, TEST_BATCH_COUNT );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { ok = ok && test_cmp_batch_mat44( a[ i ], expected[ i ] ); }
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_mul_array_mat44 matches mat44_mul_mat44" )
+		unsigned int seed = 3;
+		mat44_t a[ TEST_BATCH_COUNT ], r[ TEST_BATCH_COUNT ];
+		mat44_t b = test_batch_rand_mat44( &seed );
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { a[ i ] = test_batch_rand_mat44( &seed ); }
+		mat44_mul_array_mat44( r, a, b, TEST_BATCH_COUNT );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { ok = ok && test_cmp_batch_mat44( r[ i ], mat44_mul_mat44( a[ i ], b ) ); }
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_mul_array with count 0 does not write the output" )
+		mat44_t a = mat44f( 1.0f ), r = mat44f( 7.0f );
+		mat44_mul_array( &r, &a, &a, 0 );
+		mat44_mul_array_mat44( &r, &a, a, 0 );
+		TESTFW_EXPECTED( test_cmp( r.x.x, 7.0f ) && test_cmp( r.w.w, 7.0f ) );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_transform_points matches vec3_transform_coord" )
+		unsigned int seed = 4;
+		vec3_t p[ TEST_BATCH_COUNT ], r[ TEST_BATCH_COUNT ];
+		mat44_t m = mat44_mul_mat44( test_batch_rand_affine( &seed ), mat44_perspective_fov_rh( 1.0f, 1.5f, 0.1f, 100.0f ) );
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { p[ i ] = test_batch_rand_vec3( &seed ); }
+		mat44_transform_points( r, p, TEST_BATCH_COUNT, m );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { ok = ok && test_cmp_batch_vec3( r[ i ], vec3_transform_coord( p[ i ], m ) ); }
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_transform_points with identity returns the input points" )
+		vec3_t p[ 3 ] = { vec3( 1.0f, 2.0f, 3.0f ), vec3( -4.0f, 5.0f, -6.0f ), vec3( 0.0f, 0.0f, 0.0f ) };
+		vec3_t r[ 3 ];
+		mat44_transform_points( r, p, 3, mat44_identity() );
+		TESTFW_EXPECTED( test_cmp_batch_vec3( r[ 0 ], p[ 0 ] ) && test_cmp_batch_vec3( r[ 1 ], p[ 1 ] ) && test_cmp_batch_vec3( r[ 2 ], p[ 2 ] ) );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "mat44_transform_aabbs matches the bounds of the eight transformed corners" )
+		unsigned int seed = 5;
+		vec3_t mn[ TEST_BATCH_COUNT ], mx[ TEST_BATCH_COUNT ], rmn[ TEST_BATCH_COUNT ], rmx[ TEST_BATCH_COUNT ];
+		mat44_t m = test_batch_rand_affine( &seed );
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) {
+			vec3_t a = test_batch_rand_vec3( &seed ), b = test_batch_rand_vec3( &seed );
+			mn[ i ] = vec3_min( a, b );
+			mx[ i ] = vec3_max( a, b );
+		}
+		mat44_transform_aabbs( rmn, rmx, mn, mx, TEST_BATCH_COUNT, m );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) {
+			vec3_t emn = vec3f( FLT_MAX ), emx = vec3f( -FLT_MAX );
+			for( int c = 0; c < 8; ++c ) {
+				vec3_t corner = vec3( ( c & 1 ) ? mx[ i ].x : mn[ i ].x, ( c & 2 ) ? mx[ i ].y : mn[ i ].y, ( c & 4 ) ? mx[ i ].z : mn[ i ].z );
+				vec3_t t = vec3_transform_coord( corner, m );
+				emn = vec3_min( emn, t );
+				emx = vec3_max( emx, t );
+			}
+			ok = ok && test_cmp_batch_vec3( rmn[ i ], emn ) && test_cmp_batch_vec3( rmx[ i ], emx );
+		}
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "quat_to_mat44_array matches mat44_from_quat" )
+		unsigned int seed = 6;
+		vec4_t q[ TEST_BATCH_COUNT ];
+		mat44_t r[ TEST_BATCH_COUNT ];
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { q[ i ] = quat_normalize( test_batch_rand_vec4( &seed ) ); }
+		quat_to_mat44_array( r, q, TEST_BATCH_COUNT );
+		int ok = 1;
+		for( int i = 0; i < TEST_BATCH_COUNT; ++i ) { ok = ok && test_cmp_batch_mat44( r[ i ], mat44_from_quat( q[ i ] ) ); }
+		TESTFW_EXPECTED( ok );
+	TESTFW_TEST_END();
+
+	TESTFW_TEST_BEGIN( "quat_to_mat44_array of identity quaternions returns identity matrices" )
+		vec4_t q[ 5 ] = { quat_identity(), quat_identity(), quat_identity(), quat_identity(), quat_identity() };
+		mat44_t r[ 5 ];
+		quat_to_mat44_array( r, q, 5 );
+		TESTFW_EXPECTED( test_identity_mat44( r[ 0 ] ) && test_identity_mat44( r[ 3 ] ) && test_identity_mat44( r[ 4 ] ) );
+	TESTFW_TEST_END();
+}
+
+#endif /* VECMATH_SIMD */
+
+
 int main( int argc, char** argv ) {
     (void) argc, (void) argv;
 	TESTFW_INIT();
@@ -20600,11 +21392,16 @@ int main( int argc, char** argv ) {
 	test_matrix_multiplications();
 	test_quaternions();
 	test_matrix_utils();
+	test_fast_approximations();
 
 	test_swizzling_vec2();
 	test_swizzling_vec3();
 	test_swizzling_vec4();
 
+	#ifdef VECMATH_SIMD
+		test_batch();
+	#endif /* VECMATH_SIMD */
+
 	#if defined( VECMATH_GENERICS ) && ( defined( __cplusplus ) || ( ( defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L ) || defined(__TINYC__) ) )
 		test_generics();
 	#endif /* VECMATH_GENERICS */
@@ -20639,6 +21436,377 @@ int main( int argc, char** argv ) {
 #endif /* VECMATH_RUN_TESTS */
 
 
+/*
+-------------
+ BENCHMARKS
+-------------
+
+To build and run the micro benchmarks, compile with optimizations enabled and
+VECMATH_RUN_BENCHMARKS defined:
+
+	clang -O2 -xc vecmath.h -DVECMATH_RUN_BENCHMARKS -o vecmath-bench
+
+and then run it from the commandline:
+
+	vecmath-bench [--quick] [--csv] [--count n] [--filter text] [--compare file.csv] [--threshold f]
+
+Each benchmark calls a function over large arrays of randomized input, and
+reports the best time of several runs as nanoseconds per call and millions of
+calls per second. `--quick` uses fewer and shorter runs (e.g. for CI), `--csv`
+prints the results as CSV, `--count` sets the number of array elements and
+`--filter` only runs benchmarks with names containing the given text.
+Approximations, like `quat_slerp_fast`, also list their speedup compared to
+the exact function.
+
+The first output line describes the build (compiler, SIMD batch functions,
+VECMATH_EXT_VECTOR_TYPE and -ffast-math), to compare different builds, save
+the CSV of one and pass it to `--compare` of the other:
+
+	clang -O2 -xc vecmath.h -DVECMATH_RUN_BENCHMARKS -o bench-scalar
+	clang -O2 -xc vecmath.h -DVECMATH_RUN_BENCHMARKS -DVECMATH_EXT_VECTOR_TYPE -o bench-ext
+	clang -O2 -ffast-math -xc vecmath.h -DVECMATH_RUN_BENCHMARKS -o bench-fastmath
+	./bench-scalar --csv > scalar.csv
+	./bench-fastmath --compare scalar.csv
+
+`--compare` prints the speed ratio per benchmark, and exits with an error code
+if any benchmark is slower than the baseline by more than the `--threshold`
+factor (default 1.25), which makes it usable for catching regressions on CI.
+
+*/
+
+
+#ifdef VECMATH_RUN_BENCHMARKS
+
+#ifdef VECMATH_RUN_TESTS
+	#error "VECMATH_RUN_BENCHMARKS and VECMATH_RUN_TESTS can't be combined, both define main()"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined( _WIN32 )
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#ifdef __cplusplus
+	using namespace vecmath;
+#endif
+
+#define BENCH_DEFAULT_COUNT 16384
+#define BENCH_MAX_RESULTS 64
+
+typedef struct bench_data_t {
+	int count;
+	mat44_t* ma;
+	mat44_t* mb;
+	mat44_t* mout;
+	vec4_t* qa;
+	vec4_t* qb;
+	vec4_t* qout;
+	vec3_t* va;
+	vec3_t* vb;
+	vec3_t* vout;
+	vec3_t* vout2;
+	float* t;
+	float* angle;
+	float* fout;
+} bench_data_t;
+
+typedef struct bench_t {
+	char const* name;
+	void (*func)( bench_data_t* d );
+	char const* exact; // for approximations, the name of the exact function to report the speedup against
+} bench_t;
+
+typedef struct bench_result_t {
+	char const* name;
+	double ns_per_op;
+} bench_result_t;
+
+volatile float g_bench_sink;
+
+double bench_now_ns( void ) {
+	#if defined( _WIN32 )
+		LARGE_INTEGER freq, counter;
+		QueryPerformanceFrequency( &freq );
+		QueryPerformanceCounter( &counter );
+		return (double) counter.QuadPart * 1e9 / (double) freq.QuadPart;
+	#else
+		struct timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+	#endif
+}
+
+unsigned int g_bench_seed = 12345;
+float bench_rand( void ) { g_bench_seed = g_bench_seed * 1664525u + 1013904223u; return (float)( g_bench_seed >> 8 ) / 16777216.0f * 2.0f - 1.0f; }
+vec3_t bench_rand_vec3( void ) { float x = bench_rand(); float y = bench_rand(); float z = bench_rand(); return vec3( x, y, z ); }
+vec4_t bench_rand_quat( void ) { float x = bench_rand(); float y = bench_rand(); float z = bench_rand(); float w = bench_rand(); return quat_normalize( vec4( x, y, z, w + 2.0f ) ); }
+mat44_t bench_rand_transform( void ) {
+	vec3_t t = bench_rand_vec3();
+	float s = 1.0f + bench_rand() * 0.5f;
+	return mat44_mul_mat44( mat44_mul_mat44( mat44_scaling( s, s, s ), mat44_from_quat( bench_rand_quat() ) ), mat44_translation( t.x * 10.0f, t.y * 10.0f, t.z * 10.0f ) );
+}
+
+void bench_mat44_mul_mat44( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->mout[ i ] = mat44_mul_mat44( d->ma[ i ], d->mb[ i ] ); }
+void bench_mat44_inverse( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) mat44_inverse( &d->mout[ i ], NULL, d->ma[ i ] ); }
+void bench_mat44_determinant( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = mat44_determinant( d->ma[ i ] ); }
+void bench_mat44_transpose( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->mout[ i ] = mat44_transpose( d->ma[ i ] ); }
+void bench_mat44_from_quat( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->mout[ i ] = mat44_from_quat( d->qa[ i ] ); }
+void bench_quat_mul( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_mul( d->qa[ i ], d->qb[ i ] ); }
+void bench_quat_slerp( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_slerp( d->qa[ i ], d->qb[ i ], d->t[ i ] ); }
+void bench_quat_normalize( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_normalize( d->qa[ i ] ); }
+void bench_vec3_normalize( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->vout[ i ] = vec3_normalize( d->va[ i ] ); }
+void bench_vec3_cross( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->vout[ i ] = vec3_cross( d->va[ i ], d->vb[ i ] ); }
+void bench_vec3_transform_coord( bench_data_t* d ) { mat44_t m = d->ma[ 0 ]; for( int i = 0; i < d->count; ++i ) d->vout[ i ] = vec3_transform_coord( d->va[ i ], m ); }
+void bench_vec4_mul_mat44( bench_data_t* d ) { mat44_t m = d->ma[ 0 ]; for( int i = 0; i < d->count; ++i ) d->qout[ i ] = vec4_mul_mat44( d->qa[ i ], m ); }
+void bench_vecmath_sin( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_sin( d->angle[ i ] ); }
+void bench_vecmath_cos( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_cos( d->angle[ i ] ); }
+void bench_vecmath_atan2( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_atan2( d->va[ i ].y, d->va[ i ].x ); }
+void bench_vecmath_rsqrt( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_rsqrt( d->t[ i ] ); }
+void bench_quat_slerp_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_slerp_fast( d->qa[ i ], d->qb[ i ], d->t[ i ] ); }
+void bench_quat_nlerp( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_nlerp( d->qa[ i ], d->qb[ i ], d->t[ i ] ); }
+void bench_quat_normalize_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->qout[ i ] = quat_normalize_fast( d->qa[ i ] ); }
+void bench_vec3_normalize_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->vout[ i ] = vec3_normalize_fast( d->va[ i ] ); }
+void bench_vecmath_sin_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_sin_fast( d->angle[ i ] ); }
+void bench_vecmath_cos_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_cos_fast( d->angle[ i ] ); }
+void bench_vecmath_atan2_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_atan2_fast( d->va[ i ].y, d->va[ i ].x ); }
+void bench_vecmath_rsqrt_fast( bench_data_t* d ) { for( int i = 0; i < d->count; ++i ) d->fout[ i ] = vecmath_rsqrt_fast( d->t[ i ] ); }
+#ifdef VECMATH_SIMD
+	void bench_mat44_mul_array( bench_data_t* d ) { mat44_mul_array( d->mout, d->ma, d->mb, d->count ); }
+	void bench_mat44_mul_array_mat44( bench_data_t* d ) { mat44_mul_array_mat44( d->mout, d->ma, d->mb[ 0 ], d->count ); }
+	void bench_mat44_transform_points( bench_data_t* d ) { mat44_transform_points( d->vout, d->va, d->count, d->ma[ 0 ] ); }
+	void bench_mat44_transform_aabbs( bench_data_t* d ) { mat44_transform_aabbs( d->vout, d->vout2, d->va, d->vb, d->count, d->ma[ 0 ] ); }
+	void bench_quat_to_mat44_array( bench_data_t* d ) { quat_to_mat44_array( d->mout, d->qa, d->count ); }
+#endif /* VECMATH_SIMD */
+
+bench_t g_benchmarks[] = {
+	{ "mat44_mul_mat44", bench_mat44_mul_mat44, NULL },
+	{ "mat44_inverse", bench_mat44_inverse, NULL },
+	{ "mat44_determinant", bench_mat44_determinant, NULL },
+	{ "mat44_transpose", bench_mat44_transpose, NULL },
+	{ "mat44_from_quat", bench_mat44_from_quat, NULL },
+	{ "quat_mul", bench_quat_mul, NULL },
+	{ "quat_slerp", bench_quat_slerp, NULL },
+	{ "quat_normalize", bench_quat_normalize, NULL },
+	{ "vec3_normalize", bench_vec3_normalize, NULL },
+	{ "vec3_cross", bench_vec3_cross, NULL },
+	{ "vec3_transform_coord", bench_vec3_transform_coord, NULL },
+	{ "vec4_mul_mat44", bench_vec4_mul_mat44, NULL },
+	{ "vecmath_sin", bench_vecmath_sin, NULL },
+	{ "vecmath_cos", bench_vecmath_cos, NULL },
+	{ "vecmath_atan2", bench_vecmath_atan2, NULL },
+	{ "vecmath_rsqrt", bench_vecmath_rsqrt, NULL },
+	{ "quat_slerp_fast", bench_quat_slerp_fast, "quat_slerp" },
+	{ "quat_nlerp", bench_quat_nlerp, "quat_slerp" },
+	{ "quat_normalize_fast", bench_quat_normalize_fast, "quat_normalize" },
+	{ "vec3_normalize_fast", bench_vec3_normalize_fast, "vec3_normalize" },
+	{ "vecmath_sin_fast", bench_vecmath_sin_fast, "vecmath_sin" },
+	{ "vecmath_cos_fast", bench_vecmath_cos_fast, "vecmath_cos" },
+	{ "vecmath_atan2_fast", bench_vecmath_atan2_fast, "vecmath_atan2" },
+	{ "vecmath_rsqrt_fast", bench_vecmath_rsqrt_fast, "vecmath_rsqrt" },
+	#ifdef VECMATH_SIMD
+		{ "mat44_mul_array", bench_mat44_mul_array, NULL },
+		{ "mat44_mul_array_mat44", bench_mat44_mul_array_mat44, NULL },
+		{ "mat44_transform_points", bench_mat44_transform_points, NULL },
+		{ "mat44_transform_aabbs", bench_mat44_transform_aabbs, NULL },
+		{ "quat_to_mat44_array", bench_quat_to_mat44_array, NULL },
+	#endif /* VECMATH_SIMD */
+};
+
+void bench_build_desc( char* buf, size_t size ) {
+	char compiler[ 32 ];
+	#if defined( __clang__ )
+		snprintf( compiler, sizeof( compiler ), "clang-%d.%d", __clang_major__, __clang_minor__ );
+	#elif defined( __GNUC__ )
+		snprintf( compiler, sizeof( compiler ), "gcc-%d.%d", __GNUC__, __GNUC_MINOR__ );
+	#elif defined( _MSC_VER )
+		snprintf( compiler, sizeof( compiler ), "msvc-%d", _MSC_VER );
+	#else
+		snprintf( compiler, sizeof( compiler ), "unknown" );
+	#endif
+	char const* lang = "c";
+	#ifdef __cplusplus
+		lang = "c++";
+	#endif
+	char const* simd = "off";
+	#ifdef VECMATH_SIMD
+		simd = vecmath_simd_impl();
+	#endif
+	int ext_vector_type = 0;
+	#if defined( VECMATH_EXT_VECTOR_TYPE ) && !defined( __cplusplus ) && defined(__clang__) && __clang_major__ >= 3
+		ext_vector_type = 1;
+	#endif
+	int fast_math = 0;
+	#ifdef __FAST_MATH__
+		fast_math = 1;
+	#endif
+	snprintf( buf, size, "%s %s simd=%s ext_vector_type=%d fast_math=%d", compiler, lang, simd, ext_vector_type, fast_math );
+}
+
+// returns the best time of several runs, in nanoseconds per call
+double bench_run( bench_t const* bench, bench_data_t* d, int quick ) {
+	// calibrate the number of repetitions per run to roughly 10 ms (2 ms with --quick)
+	double target_ns = quick ? 2e6 : 1e7;
+	double t0 = bench_now_ns();
+	bench->func( d );
+	double once_ns = bench_now_ns() - t0;
+	int reps = once_ns > 0.0 ? (int)( target_ns / once_ns ) : 1;
+	if( reps < 1 ) reps = 1;
+	int runs = quick ? 3 : 7;
+	double best = 0.0;
+	for( int run = 0; run < runs; ++run ) {
+		double start = bench_now_ns();
+		for( int rep = 0; rep < reps; ++rep ) {
+			bench->func( d );
+		}
+		double ns = ( bench_now_ns() - start ) / ( (double) reps * (double) d->count );
+		if( run == 0 || ns < best ) best = ns;
+	}
+	// keep the results observable, so the calls are not optimized away
+	g_bench_sink += d->mout[ 0 ].x.x + d->qout[ 0 ].x + d->vout[ 0 ].x + d->fout[ 0 ];
+	return best;
+}
+
+// compares against a CSV file from a previous run, returns the number of regressions
+int bench_compare( char const* path, bench_result_t const* results, int count, double threshold ) {
+	FILE* fp = fopen( path, "r" );
+	if( !fp ) {
+		printf( "could not open '%s'\n", path );
+		return 1;
+	}
+	printf( "\ncompared to %s (threshold %.2f)\n\n", path, threshold );
+	printf( "%-28s %12s %12s %8s\n", "name", "base ns/op", "ns/op", "ratio" );
+	int regressions = 0;
+	char line[ 512 ];
+	while( fgets( line, sizeof( line ), fp ) ) {
+		// build,name,ns_per_op,mops_per_s
+		char* name = strchr( line, ',' );
+		if( !name ) continue;
+		++name;
+		char* ns = strchr( name, ',' );
+		if( !ns ) continue;
+		*ns++ = '\0';
+		double base_ns = atof( ns );
+		if( base_ns <= 0.0 ) continue;
+		for( int i = 0; i < count; ++i ) {
+			if( strcmp( results[ i ].name, name ) == 0 ) {
+				double ratio = results[ i ].ns_per_op / base_ns;
+				int regressed = ratio > threshold;
+				regressions += regressed;
+				printf( "%-28s %12.3f %12.3f %8.2f%s\n", name, base_ns, results[ i ].ns_per_op, ratio, regressed ? "  REGRESSION" : "" );
+			}
+		}
+	}
+	fclose( fp );
+	return regressions;
+}
+
+int main( int argc, char** argv ) {
+	int quick = 0, csv = 0, count = BENCH_DEFAULT_COUNT;
+	char const* filter = NULL;
+	char const* compare = NULL;
+	double threshold = 1.25;
+	for( int i = 1; i < argc; ++i ) {
+		if( strcmp( argv[ i ], "--quick" ) == 0 ) quick = 1;
+		else if( strcmp( argv[ i ], "--csv" ) == 0 ) csv = 1;
+		else if( strcmp( argv[ i ], "--count" ) == 0 && i + 1 < argc ) count = atoi( argv[ ++i ] );
+		else if( strcmp( argv[ i ], "--filter" ) == 0 && i + 1 < argc ) filter = argv[ ++i ];
+		else if( strcmp( argv[ i ], "--compare" ) == 0 && i + 1 < argc ) compare = argv[ ++i ];
+		else if( strcmp( argv[ i ], "--threshold" ) == 0 && i + 1 < argc ) threshold = atof( argv[ ++i ] );
+		else {
+			printf( "usage: %s [--quick] [--csv] [--count n] [--filter text] [--compare file.csv] [--threshold f]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+	if( count < 1 ) count = 1;
+
+	bench_data_t d;
+	d.count = count;
+	d.ma = (mat44_t*) malloc( sizeof( mat44_t ) * count );
+	d.mb = (mat44_t*) malloc( sizeof( mat44_t ) * count );
+	d.mout = (mat44_t*) malloc( sizeof( mat44_t ) * count );
+	d.qa = (vec4_t*) malloc( sizeof( vec4_t ) * count );
+	d.qb = (vec4_t*) malloc( sizeof( vec4_t ) * count );
+	d.qout = (vec4_t*) malloc( sizeof( vec4_t ) * count );
+	d.va = (vec3_t*) malloc( sizeof( vec3_t ) * count );
+	d.vb = (vec3_t*) malloc( sizeof( vec3_t ) * count );
+	d.vout = (vec3_t*) malloc( sizeof( vec3_t ) * count );
+	d.vout2 = (vec3_t*) malloc( sizeof( vec3_t ) * count );
+	d.t = (float*) malloc( sizeof( float ) * count );
+	d.angle = (float*) malloc( sizeof( float ) * count );
+	d.fout = (float*) malloc( sizeof( float ) * count );
+	for( int i = 0; i < count; ++i ) {
+		d.ma[ i ] = bench_rand_transform();
+		d.mb[ i ] = bench_rand_transform();
+		d.mout[ i ] = mat44_identity();
+		d.qa[ i ] = bench_rand_quat();
+		d.qb[ i ] = bench_rand_quat();
+		d.qout[ i ] = quat_identity();
+		// va/vb double as min/max of bounding boxes
+		vec3_t a = bench_rand_vec3(), b = bench_rand_vec3();
+		d.va[ i ] = vec3_min( a, b );
+		d.vb[ i ] = vec3_max( a, b );
+		d.vout[ i ] = vec3f( 0.0f );
+		d.vout2[ i ] = vec3f( 0.0f );
+		d.t[ i ] = bench_rand() * 0.5f + 0.5f;
+		d.angle[ i ] = bench_rand() * 10.0f;
+		d.fout[ i ] = 0.0f;
+	}
+
+	char build[ 128 ];
+	bench_build_desc( build, sizeof( build ) );
+	if( csv ) {
+		printf( "build,name,ns_per_op,mops_per_s\n" );
+	} else {
+		printf( "vecmath.h benchmarks\nbuild: %s\n%d elements, best of %d runs\n\n", build, count, quick ? 3 : 7 );
+		printf( "%-28s %12s %12s %10s\n", "name", "ns/op", "Mops/s", "speedup" );
+	}
+
+	bench_result_t results[ BENCH_MAX_RESULTS ];
+	int num_results = 0;
+	for( int i = 0; i < (int)( sizeof( g_benchmarks ) / sizeof( *g_benchmarks ) ); ++i ) {
+		bench_t const* bench = &g_benchmarks[ i ];
+		if( filter && !strstr( bench->name, filter ) ) continue;
+		double ns = bench_run( bench, &d, quick );
+		results[ num_results ].name = bench->name;
+		results[ num_results ].ns_per_op = ns;
+		++num_results;
+		if( csv ) {
+			printf( "%s,%s,%.4f,%.2f\n", build, bench->name, ns, 1e3 / ns );
+		} else {
+			// approximations list the speedup compared to the exact function, if that was run as well
+			char speedup[ 64 ] = "";
+			for( int j = 0; bench->exact && j < num_results - 1; ++j ) {
+				if( strcmp( results[ j ].name, bench->exact ) == 0 ) snprintf( speedup, sizeof( speedup ), "%.2fx", results[ j ].ns_per_op / ns );
+			}
+			printf( "%-28s %12.3f %12.2f %10s\n", bench->name, ns, 1e3 / ns, speedup );
+		}
+	}
+
+	int regressions = 0;
+	if( compare ) {
+		regressions = bench_compare( compare, results, num_results, threshold );
+	}
+
+	free( d.ma ); free( d.mb ); free( d.mout );
+	free( d.qa ); free( d.qb ); free( d.qout );
+	free( d.va ); free( d.vb ); free( d.vout ); free( d.vout2 );
+	free( d.t ); free( d.angle ); free( d.fout );
+	return regressions > 0 ? 1 : 0;
+}
+
+#endif /* VECMATH_RUN_BENCHMARKS */
+
+
 /*
 ------------------------------------------------------------------------------
 
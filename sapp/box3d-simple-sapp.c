@@ -8,14 +8,28 @@
 //    steps per second)
 //  - box-, ball- and ground-shapes created via sokol_shape.h
 //  - box and ball shapes are rendered via hardware-instancing
-//    (e.g. 1 draw call for all shapes of the same type, the shadow-map pass is
-//    2 draw calls, and the display pass is 3 draw calls (that one extra draw
-//    call is for the ground)
+//    (e.g. 1 draw call for all shapes of the same type, each shadow-map pass is
+//    up to 2 draw calls, and the display pass is 3 draw calls (that one extra
+//    draw call is for the ground)
+//  - cascaded shadow maps: the view frustum up to SHADOW_DISTANCE is split
+//    into NUM_CASCADES slices, each slice gets its own texel-snapped
+//    orthographic shadow map (one slice of a depth texture array), casters
+//    are culled against each cascade's light frustum and only the
+//    intersecting instances are uploaded and rendered, and a cascade is only
+//    re-rendered when its light matrix changed or a caster moved inside it
 //  - the per-instance data is a transposed 3x4 matrix (vec4[3]) for a body's
 //    world space transform and a vec4 for a unique color (e.g. 64 bytes of
 //    instance data)
 //  - each frame, only the transforms of active (non-sleeping) bodies are copied
 //    out of the physics world via Box3D's event system
+//  - when compute shaders are supported, the instance data lives in a persistent
+//    storage buffer, only the changed instances are uploaded into a compact
+//    staging buffer and scattered into place by a compute shader (so that the
+//    upload size depends on the number of awake bodies, not the total number
+//    of bodies), without compute shaders all instance data is uploaded each frame
+//  - Box3D's internal tasks run on the work-stealing job system in util/jobs.h
+//    (glue code in util/b3jobs.h), the number of threads can be changed
+//    at runtime, this recreates the physics world and moves all bodies over
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -35,17 +49,35 @@
 #include "vecmath/vecmath.h"
 #include "box3d/box3d.h"
 #include "util/camera.h"
+#include "util/jobs.h"
+#include "util/b3jobs.h"
+#include "util/shapecache.h"
 #include "box3d-simple-sapp.glsl.h"
+#include <float.h>
+#include <string.h>
+#include <stdlib.h>
 
-#define MAX_SHAPES (1024)
+#define MAX_SHAPES (32 * 1024)
 #define MAX_INSTANCES ((MAX_SHAPES / 2) + 1)
+#define NUM_INSTANCE_SLOTS (MAX_INSTANCES * 2)  // boxes in the first half, balls in the second half
 #define GROUND_SIZE (200.0f)
 #define BALL_RADIUS (1.0f)
 #define BOX_SIZE (1.5f)
-#define SHADOW_MAP_SIZE (2048)
+#define NUM_CASCADES (4)                    // must match the display_fs shader
+#define CASCADE_MAP_SIZE (1024)             // 4 cascades use as much memory as a single 2048x2048 shadow map
+#define CASCADE_SPLIT_LAMBDA (0.75f)        // blend between logarithmic (1) and uniform (0) split distances
+#define CASCADE_CASTER_DISTANCE (150.0f)    // extends the cascade depth range towards the light for casters outside the view
+#define CASCADE_BIAS_TEXELS (1.0f)          // depth bias in shadow map texels
+#define SHADOW_DISTANCE (300.0f)
+#define MIN_CULLED_CAPACITY (4096)          // initial size of the culled shadow caster arrays, grown on demand
+#define CAMERA_FOV (60.0f)
+#define CAMERA_NEAR (0.1f)
+#define CAMERA_FAR (500.0f)
 #define USEC_PER_SEC (1000000.0)
 #define PHYSICS_TICK_USEC ((1.0 / 250.0) * USEC_PER_SEC)
 #define SPAWN_INTERVAL_SEC (0.25)
+#define MAX_SPAWN_COUNT (64)
+#define NUM_STEP_TIME_SAMPLES (128)
 
 typedef struct {
     vec4_t xxxx;
@@ -57,18 +89,44 @@ typedef struct {
 static struct {
     sg_buffer vbuf;
     sg_buffer ibuf;
-    sg_buffer box_inst_buf;
-    sg_buffer ball_inst_buf;
+    sg_buffer inst_buf;         // per-instance data for boxes and balls
+    struct {
+        bool enabled;           // only if compute shaders are supported
+        sg_buffer staging_buf;  // compact array of changed instances
+        sg_view staging_view;
+        sg_view inst_view;
+        sg_pipeline pip;
+    } scatter;
+    struct {
+        int box;
+        int ball;
+    } inst_offsets;             // byte offsets of box and ball instances in inst_buf
     struct {
         sshape_element_range_t plane;
         sshape_element_range_t ball;
         sshape_element_range_t box;
     } shapes;
     struct {
-        sg_pass pass;
+        sg_pass passes[NUM_CASCADES];   // one pass per shadow map array slice
         sg_view tex_view;
         sg_sampler smp;
         sg_pipeline inst_pip;       // pipeline for hardware-instanced rendering of shapes in shadow pass
+        sg_buffer cull_buf;         // instances which survived caster culling, packed by cascade
+        int cull_buf_capacity;      // in instances
+        struct {
+            float split_near;
+            float split_far;
+            mat44_t view_proj;
+            cam_frustum_t frustum;
+            float bias;
+            bool valid;             // the shadow map slice matches view_proj and the caster positions
+            bool render;            // re-render the shadow map slice in this frame
+            sg_buffer inst_buf;     // cull_buf, or inst_buf without caster culling
+            int box_offset;
+            int ball_offset;
+            int num_boxes;
+            int num_balls;
+        } cascades[NUM_CASCADES];
     } shadow;
     struct {
         sg_pass_action pass_action;
@@ -78,16 +136,29 @@ static struct {
     double spawn_timer;
     camera_t camera;
     vec3_t light_pos;
-    mat44_t light_view_proj;
     mat44_t view_proj;
     struct {
         int64_t physics_world_step_time;
         int64_t copy_transforms_time;
+        int64_t shadow_cull_time;
+        int num_uploaded_instances;
+        int upload_bytes;
         int sub_steps_per_frame;
         int num_awake_bodies;
+        int num_tasks;
+        int step_time_index;
+        float step_time_ms[NUM_STEP_TIME_SAMPLES];
+        // smoothed step time per sub-step and body count, indexed by number of threads - 1
+        float sub_step_time_ms_by_threads[JOBS_MAX_THREADS + 1];
+        int num_bodies_by_threads[JOBS_MAX_THREADS + 1];
     } profiling;
     struct {
         bool show_sleeping;
+        bool cull_casters;
+        bool cache_cascades;
+        bool show_cascades;
+        int num_threads;    // including the main thread
+        int spawn_count;
     } ui;
     struct {
         b3WorldId world;
@@ -99,23 +170,38 @@ static struct {
     struct {
         int num_boxes;
         int num_balls;
-        instdata_t boxes[MAX_INSTANCES];
-        instdata_t balls[MAX_INSTANCES];
+        instdata_t slots[NUM_INSTANCE_SLOTS];   // CPU-side copy of the instance data
+        int num_dirty;
+        int dirty_slots[NUM_INSTANCE_SLOTS];    // instances changed in the current frame
+        bool dirty[NUM_INSTANCE_SLOTS];
+        staged_instance_t staged[NUM_INSTANCE_SLOTS];
+        vec3_t centers[NUM_INSTANCE_SLOTS];     // bounding spheres for shadow caster culling
+        float radii[NUM_INSTANCE_SLOTS];
+        int num_moved;
+        int moved_slots[NUM_INSTANCE_SLOTS];    // instances moved in the current frame...
+        vec3_t moved_from[NUM_INSTANCE_SLOTS];  // ...and their position before the move
+        bool moved[NUM_INSTANCE_SLOTS];
+        instdata_t* culled;     // surviving shadow casters of all re-rendered cascades
+        int culled_capacity;
     } inst_data;
 } state;
 
 static void gfx_init(void);
 static void ui_draw(void);
 static void physics_init(void);
+static void physics_set_num_threads(int num_threads);
 static void physics_update(void);
 static void physics_add_body(void);
 static bool physics_is_box(int index);
 static void physics_cleanup(void);
 static void update_instance_buffers(void);
 static void update_matrices(void);
-static void draw_instanced_shapes_shadow_pass(const sshape_element_range_t* shape, sg_buffer inst_buf, int num_instances);
+static void update_shadow_cascades(void);
+static int box_slot(int box_index);
+static int ball_slot(int ball_index);
+static void draw_instanced_shapes_shadow_pass(int cascade, const sshape_element_range_t* shape, int inst_offset, int num_instances);
 static void draw_shape_display_pass(const sshape_element_range_t* shape, mat44_t model, vec4_t color);
-static void draw_instanced_shapes_display_pass(const sshape_element_range_t* shape, sg_buffer inst_buf, int num_instances);
+static void draw_instanced_shapes_display_pass(const sshape_element_range_t* shape, int inst_offset, int num_instances);
 
 static void init(void) {
     stm_setup();
@@ -147,24 +233,32 @@ static void frame(void) {
     state.spawn_timer -= sapp_frame_duration();
     if (state.spawn_timer <= 0.0) {
         state.spawn_timer += SPAWN_INTERVAL_SEC;
-        physics_add_body();
+        for (int i = 0; i < state.ui.spawn_count; i++) {
+            physics_add_body();
+        }
     }
     physics_update();
     update_instance_buffers();
     update_matrices();
+    update_shadow_cascades();
     ui_draw();
 
-    // shadow pass (don't render ground, only the hardware-instanced physics body shapes)
-    sg_begin_pass(&state.shadow.pass);
-    draw_instanced_shapes_shadow_pass(&state.shapes.box, state.box_inst_buf, state.inst_data.num_boxes);
-    draw_instanced_shapes_shadow_pass(&state.shapes.ball, state.ball_inst_buf, state.inst_data.num_balls);
-    sg_end_pass();
+    // shadow passes for the cascades which need to be updated (don't render
+    // ground, only the hardware-instanced physics body shapes)
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        if (state.shadow.cascades[i].render) {
+            sg_begin_pass(&state.shadow.passes[i]);
+            draw_instanced_shapes_shadow_pass(i, &state.shapes.box, state.shadow.cascades[i].box_offset, state.shadow.cascades[i].num_boxes);
+            draw_instanced_shapes_shadow_pass(i, &state.shapes.ball, state.shadow.cascades[i].ball_offset, state.shadow.cascades[i].num_balls);
+            sg_end_pass();
+        }
+    }
 
     // display pass (render ground an hardware-instanced physics body shapes)
     sg_begin_pass(&(sg_pass){ .action = state.display.pass_action, .swapchain = sglue_swapchain() });
     draw_shape_display_pass(&state.shapes.plane, mat44_identity(), vec4(0.5f, 0.5f, 0.5f, 1.0f));
-    draw_instanced_shapes_display_pass(&state.shapes.box, state.box_inst_buf, state.inst_data.num_boxes);
-    draw_instanced_shapes_display_pass(&state.shapes.ball, state.ball_inst_buf, state.inst_data.num_balls);
+    draw_instanced_shapes_display_pass(&state.shapes.box, state.inst_offsets.box, state.inst_data.num_boxes);
+    draw_instanced_shapes_display_pass(&state.shapes.ball, state.inst_offsets.ball, state.inst_data.num_balls);
     simgui_render();
     sg_end_pass();
     sg_commit();
@@ -172,6 +266,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     physics_cleanup();
+    free(state.inst_data.culled);
     sgimgui_shutdown();
     sappimgui_shutdown();
     simgui_shutdown();
@@ -187,62 +282,297 @@ static void input(const sapp_event* ev) {
 }
 
 static void update_matrices(void) {
-    // calculate matrices for shadow pass
-    const mat44_t light_view = mat44_look_at_rh(state.light_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
-    const mat44_t light_proj = mat44_ortho_off_center_rh(-100.0f, 100.0f, -100.0f, 100.0f, 1.0f, 250.0f);
-    state.light_view_proj = vm_mul(light_view, light_proj);
-
     // calculate matrices for display pass
-    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), sapp_widthf()/sapp_heightf(), 0.1f, 500.0f);
+    const float aspect = sapp_widthf() / sapp_heightf();
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(CAMERA_FOV), aspect, CAMERA_NEAR, CAMERA_FAR);
     const mat44_t view = mat44_look_at_rh(state.camera.eye_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
     state.view_proj = vm_mul(view, proj);
+
+    // calculate the cascade matrices for the shadow passes, each cascade is
+    // fitted to the bounding sphere of its view frustum slice, which doesn't
+    // change size when the camera rotates, and the sphere center is snapped
+    // to shadow map texels, so that a static scene doesn't shimmer and the
+    // matrix (and the cached shadow map) only changes when the camera moved
+    // by at least a texel
+    const mat44_t light_view = mat44_look_at_rh(vm_normalize(state.light_pos), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const vec3_t forward = vm_normalize(vm_sub(vec3(0.0f, 0.0f, 0.0f), state.camera.eye_pos));
+    const float tan_half_fov = tanf(vm_radians(CAMERA_FOV) * 0.5f);
+    const float k2 = tan_half_fov * tan_half_fov * (1.0f + aspect * aspect);
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        // practical split scheme: blend of logarithmic and uniform split distances
+        const float t = (float)(i + 1) / (float)NUM_CASCADES;
+        const float log_split = CAMERA_NEAR * powf(SHADOW_DISTANCE / CAMERA_NEAR, t);
+        const float uni_split = CAMERA_NEAR + (SHADOW_DISTANCE - CAMERA_NEAR) * t;
+        const float n = (i == 0) ? CAMERA_NEAR : state.shadow.cascades[i - 1].split_far;
+        const float f = CASCADE_SPLIT_LAMBDA * log_split + (1.0f - CASCADE_SPLIT_LAMBDA) * uni_split;
+
+        // bounding sphere of the frustum slice from n to f
+        const float center_dist = fminf(0.5f * (n + f) * (1.0f + k2), f);
+        const float radius = ceilf(sqrtf((f - center_dist) * (f - center_dist) + f * f * k2));
+        const vec3_t center = vm_add(state.camera.eye_pos, vm_mul(forward, center_dist));
+
+        // snap the light space sphere center and depth range to texels
+        const float texel = (2.0f * radius) / (float)CASCADE_MAP_SIZE;
+        const vec4_t lc = vm_mul(vec4v3f(center, 1.0f), light_view);
+        const float x = floorf(lc.x / texel) * texel;
+        const float y = floorf(lc.y / texel) * texel;
+        const float depth_range = 2.0f * radius + CASCADE_CASTER_DISTANCE + texel;
+        const float zn = floorf((-lc.z - radius - CASCADE_CASTER_DISTANCE) / texel) * texel;
+        const mat44_t light_proj = mat44_ortho_off_center_rh(x - radius, x + radius, y - radius, y + radius, zn, zn + depth_range);
+        const mat44_t view_proj = vm_mul(light_view, light_proj);
+
+        state.shadow.cascades[i].split_near = n;
+        state.shadow.cascades[i].split_far = f;
+        state.shadow.cascades[i].bias = (CASCADE_BIAS_TEXELS * texel) / depth_range;
+        if (0 != memcmp(&state.shadow.cascades[i].view_proj, &view_proj, sizeof(view_proj))) {
+            state.shadow.cascades[i].view_proj = view_proj;
+            state.shadow.cascades[i].frustum = cam_frustum(view_proj);
+            state.shadow.cascades[i].valid = false;
+        }
+    }
 }
 
-static void update_instance_buffers(void) {
-    if (state.inst_data.num_boxes > 0) {
-        sg_update_buffer(state.box_inst_buf, &(sg_range){
-            .ptr = (const void*)&state.inst_data.boxes[0],
-            .size = sizeof(instdata_t) * (size_t)state.inst_data.num_boxes,
+// grow the culled instance array to hold at least num_instances
+static void reserve_culled(int num_instances) {
+    if (num_instances <= state.inst_data.culled_capacity) {
+        return;
+    }
+    int capacity = (state.inst_data.culled_capacity > 0) ? state.inst_data.culled_capacity : MIN_CULLED_CAPACITY;
+    while (capacity < num_instances) {
+        capacity *= 2;
+    }
+    state.inst_data.culled = (instdata_t*) realloc(state.inst_data.culled, (size_t)capacity * sizeof(instdata_t));
+    assert(state.inst_data.culled);
+    state.inst_data.culled_capacity = capacity;
+}
+
+// append the instances of a slot range which intersect the cascade to the culled instance array
+static int cull_shadow_casters(const cam_frustum_t* frustum, int first_slot, int num_slots, int* inout_num_culled) {
+    uint32_t mask[CAM_CULL_MASK_WORDS(MAX_INSTANCES)];
+    assert(num_slots <= MAX_INSTANCES);
+    cam_cull_spheres(frustum, &state.inst_data.centers[first_slot], &state.inst_data.radii[first_slot], num_slots, mask);
+    int num_visible = 0;
+    for (int i = 0; i < num_slots; i++) {
+        if (mask[i >> 5] & (1u << (i & 31))) {
+            state.inst_data.culled[(*inout_num_culled)++] = state.inst_data.slots[first_slot + i];
+            num_visible++;
+        }
+    }
+    return num_visible;
+}
+
+static void update_shadow_cascades(void) {
+    const uint64_t t = stm_now();
+
+    // a cascade needs to be re-rendered when its matrix has changed, or
+    // when a caster moved in, out of or inside the cascade
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        state.shadow.cascades[i].render = !(state.ui.cache_cascades && state.shadow.cascades[i].valid);
+    }
+    for (int i = 0; i < state.inst_data.num_moved; i++) {
+        const int slot = state.inst_data.moved_slots[i];
+        const float radius = state.inst_data.radii[slot];
+        for (int c = 0; c < NUM_CASCADES; c++) {
+            const cam_frustum_t* frustum = &state.shadow.cascades[c].frustum;
+            if (!state.shadow.cascades[c].render &&
+                (cam_sphere_visible(frustum, state.inst_data.moved_from[i], radius) ||
+                 cam_sphere_visible(frustum, state.inst_data.centers[slot], radius)))
+            {
+                state.shadow.cascades[c].render = true;
+            }
+        }
+        state.inst_data.moved[slot] = false;
+    }
+    state.inst_data.num_moved = 0;
+
+    // cull the casters of the re-rendered cascades, and upload the
+    // surviving instances with a single buffer update
+    int num_culled = 0;
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        if (!state.shadow.cascades[i].render) {
+            continue;
+        }
+        if (state.ui.cull_casters) {
+            const cam_frustum_t* frustum = &state.shadow.cascades[i].frustum;
+            reserve_culled(num_culled + state.inst_data.num_boxes + state.inst_data.num_balls);
+            state.shadow.cascades[i].box_offset = num_culled * (int)sizeof(instdata_t);
+            state.shadow.cascades[i].num_boxes = cull_shadow_casters(frustum, box_slot(0), state.inst_data.num_boxes, &num_culled);
+            state.shadow.cascades[i].ball_offset = num_culled * (int)sizeof(instdata_t);
+            state.shadow.cascades[i].num_balls = cull_shadow_casters(frustum, ball_slot(0), state.inst_data.num_balls, &num_culled);
+        } else {
+            state.shadow.cascades[i].inst_buf = state.inst_buf;
+            state.shadow.cascades[i].box_offset = state.inst_offsets.box;
+            state.shadow.cascades[i].num_boxes = state.inst_data.num_boxes;
+            state.shadow.cascades[i].ball_offset = state.inst_offsets.ball;
+            state.shadow.cascades[i].num_balls = state.inst_data.num_balls;
+        }
+        state.shadow.cascades[i].valid = true;
+    }
+    // the re-rendered cascades are packed from the start of the buffer, so
+    // it only needs to hold the casters of this frame's cascades
+    if (num_culled > state.shadow.cull_buf_capacity) {
+        sg_destroy_buffer(state.shadow.cull_buf);
+        state.shadow.cull_buf_capacity = state.inst_data.culled_capacity;
+        state.shadow.cull_buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.stream_update = true,
+            .size = (size_t)state.shadow.cull_buf_capacity * sizeof(instdata_t),
+            .label = "shadow-caster-buffer",
+        });
+    }
+    if (state.ui.cull_casters) {
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            if (state.shadow.cascades[i].render) {
+                state.shadow.cascades[i].inst_buf = state.shadow.cull_buf;
+            }
+        }
+    }
+    if (num_culled > 0) {
+        sg_update_buffer(state.shadow.cull_buf, &(sg_range){
+            .ptr = state.inst_data.culled,
+            .size = (size_t)num_culled * sizeof(instdata_t),
         });
     }
-    if (state.inst_data.num_balls > 0) {
-        sg_update_buffer(state.ball_inst_buf, &(sg_range){
-            .ptr = (const void*)&state.inst_data.balls[0],
-            .size = sizeof(instdata_t) * (size_t)state.inst_data.num_balls,
+    state.profiling.shadow_cull_time = stm_since(t);
+}
+
+static int box_slot(int box_index) {
+    return box_index;
+}
+
+static int ball_slot(int ball_index) {
+    return MAX_INSTANCES + ball_index;
+}
+
+// mark an instance as changed in the current frame
+static void mark_instance_dirty(const instdata_t* inst_data) {
+    const int slot = (int)(inst_data - state.inst_data.slots);
+    assert((slot >= 0) && (slot < NUM_INSTANCE_SLOTS));
+    if (!state.inst_data.dirty[slot]) {
+        state.inst_data.dirty[slot] = true;
+        state.inst_data.dirty_slots[state.inst_data.num_dirty++] = slot;
+    }
+}
+
+// remember the position of a moved instance before its first move in the current frame
+static void mark_instance_moved(const instdata_t* inst_data) {
+    const int slot = (int)(inst_data - state.inst_data.slots);
+    assert((slot >= 0) && (slot < NUM_INSTANCE_SLOTS));
+    if (!state.inst_data.moved[slot]) {
+        state.inst_data.moved[slot] = true;
+        state.inst_data.moved_from[state.inst_data.num_moved] = state.inst_data.centers[slot];
+        state.inst_data.moved_slots[state.inst_data.num_moved++] = slot;
+    }
+}
+
+static void update_instance_buffers(void) {
+    state.profiling.num_uploaded_instances = 0;
+    state.profiling.upload_bytes = 0;
+    if (state.scatter.enabled) {
+        // copy changed instances into a compact staging array...
+        const int num_staged = state.inst_data.num_dirty;
+        for (int i = 0; i < num_staged; i++) {
+            const int slot = state.inst_data.dirty_slots[i];
+            const instdata_t* src = &state.inst_data.slots[slot];
+            state.inst_data.staged[i] = (staged_instance_t){
+                .xxxx = src->xxxx,
+                .yyyy = src->yyyy,
+                .zzzz = src->zzzz,
+                .color = src->color,
+                .slot = slot,
+            };
+            state.inst_data.dirty[slot] = false;
+        }
+        state.inst_data.num_dirty = 0;
+        if (num_staged == 0) {
+            return;
+        }
+        // ...upload the staging array and scatter into the persistent instance buffer
+        const size_t num_bytes = (size_t)num_staged * sizeof(staged_instance_t);
+        sg_update_buffer(state.scatter.staging_buf, &(sg_range){
+            .ptr = state.inst_data.staged,
+            .size = num_bytes,
+        });
+        const scatter_params_t params = { .num_items = num_staged };
+        sg_begin_pass(&(sg_pass){ .compute = true, .label = "scatter-pass" });
+        sg_apply_pipeline(state.scatter.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views = {
+                [VIEW_staging_sbuf] = state.scatter.staging_view,
+                [VIEW_instances_sbuf] = state.scatter.inst_view,
+            },
         });
+        sg_apply_uniforms(UB_scatter_params, &SG_RANGE(params));
+        sg_dispatch((num_staged + 63) / 64, 1, 1);
+        sg_end_pass();
+        state.profiling.num_uploaded_instances = num_staged;
+        state.profiling.upload_bytes = (int)num_bytes;
+    } else {
+        // fallback without compute shaders: upload all instances
+        for (int i = 0; i < state.inst_data.num_dirty; i++) {
+            state.inst_data.dirty[state.inst_data.dirty_slots[i]] = false;
+        }
+        state.inst_data.num_dirty = 0;
+        if (state.inst_data.num_boxes > 0) {
+            state.inst_offsets.box = sg_append_buffer(state.inst_buf, &(sg_range){
+                .ptr = &state.inst_data.slots[box_slot(0)],
+                .size = sizeof(instdata_t) * (size_t)state.inst_data.num_boxes,
+            });
+        }
+        if (state.inst_data.num_balls > 0) {
+            state.inst_offsets.ball = sg_append_buffer(state.inst_buf, &(sg_range){
+                .ptr = &state.inst_data.slots[ball_slot(0)],
+                .size = sizeof(instdata_t) * (size_t)state.inst_data.num_balls,
+            });
+        }
+        state.profiling.num_uploaded_instances = state.inst_data.num_boxes + state.inst_data.num_balls;
+        state.profiling.upload_bytes = state.profiling.num_uploaded_instances * (int)sizeof(instdata_t);
     }
 }
 
-static void draw_instanced_shapes_shadow_pass(const sshape_element_range_t* shape, sg_buffer inst_buf, int num_instances) {
+static void draw_instanced_shapes_shadow_pass(int cascade, const sshape_element_range_t* shape, int inst_offset, int num_instances) {
     if (num_instances == 0) {
         return;
     }
     const shadow_inst_vs_params_t vs_params = {
-        .light_view_proj = state.light_view_proj,
+        .light_view_proj = state.shadow.cascades[cascade].view_proj,
     };
     sg_apply_pipeline(state.shadow.inst_pip);
     sg_apply_bindings(&(sg_bindings){
         .vertex_buffers = {
             [0] = state.vbuf,
-            [1] = inst_buf,
+            [1] = state.shadow.cascades[cascade].inst_buf,
         },
+        .vertex_buffer_offsets[1] = inst_offset,
         .index_buffer = state.ibuf,
     });
     sg_apply_uniforms(UB_shadow_inst_vs_params, &SG_RANGE(vs_params));
     sg_draw(shape->base_element, shape->num_elements, num_instances);
 }
 
+static display_fs_params_t display_fs_params(void) {
+    display_fs_params_t fs_params = {
+        .cascade_bias = vec4(
+            state.shadow.cascades[0].bias,
+            state.shadow.cascades[1].bias,
+            state.shadow.cascades[2].bias,
+            state.shadow.cascades[3].bias),
+        .light_dir = vm_normalize(state.light_pos),
+        .show_cascades = state.ui.show_cascades ? 1.0f : 0.0f,
+        .eye_pos = state.camera.eye_pos,
+    };
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        fs_params.cascade_view_proj[i] = state.shadow.cascades[i].view_proj;
+    }
+    return fs_params;
+}
+
 static void draw_shape_display_pass(const sshape_element_range_t* shape, mat44_t model, vec4_t color) {
     const display_vs_params_t vs_params = {
         .model = model,
         .mvp = vm_mul(model, state.view_proj),
-        .light_mvp = vm_mul(model, state.light_view_proj),
         .diff_color = color,
     };
-    const display_fs_params_t fs_params = {
-        .eye_pos = state.camera.eye_pos,
-        .light_dir = vm_normalize(state.light_pos),
-    };
+    const display_fs_params_t fs_params = display_fs_params();
     sg_apply_pipeline(state.display.pip);
     sg_apply_bindings(&(sg_bindings){
         .vertex_buffers[0] = state.vbuf,
@@ -255,25 +585,22 @@ static void draw_shape_display_pass(const sshape_element_range_t* shape, mat44_t
     sg_draw(shape->base_element, shape->num_elements, 1);
 }
 
-static void draw_instanced_shapes_display_pass(const sshape_element_range_t* shape, sg_buffer inst_buf, int num_instances) {
+static void draw_instanced_shapes_display_pass(const sshape_element_range_t* shape, int inst_offset, int num_instances) {
     if (num_instances == 0) {
         return;
     }
     const display_inst_vs_params_t vs_params = {
         .view_proj = state.view_proj,
-        .light_view_proj = state.light_view_proj,
         .awake_filter = state.ui.show_sleeping ? 1.0f : 0.0f,
     };
-    const display_fs_params_t fs_params = {
-        .eye_pos = state.camera.eye_pos,
-        .light_dir = vm_normalize(state.light_pos),
-    };
+    const display_fs_params_t fs_params = display_fs_params();
     sg_apply_pipeline(state.display.inst_pip);
     sg_apply_bindings(&(sg_bindings){
         .vertex_buffers = {
             [0] = state.vbuf,
-            [1] = inst_buf,
+            [1] = state.inst_buf,
         },
+        .vertex_buffer_offsets[1] = inst_offset,
         .index_buffer = state.ibuf,
         .views[VIEW_shadow_map] = state.shadow.tex_view,
         .samplers[SMP_shadow_sampler] = state.shadow.smp,
@@ -283,8 +610,10 @@ static void draw_instanced_shapes_display_pass(const sshape_element_range_t* sha
     sg_draw(shape->base_element, shape->num_elements, num_instances);
 }
 
-static void physics_init(void) {
+// create the physics world with the current number of job system threads and the ground body
+static void physics_create_world(void) {
     b3WorldDef world_def = b3DefaultWorldDef();
+    b3jobs_init_world_def(&world_def);
     state.physics.world = b3CreateWorld(&world_def);
 
     b3BodyDef ground_body_def = b3DefaultBodyDef();
@@ -297,6 +626,56 @@ static void physics_init(void) {
     b3CreateHullShape(state.physics.ground, &ground_shape_def, &ground_box.base);
 }
 
+static void physics_init(void) {
+    state.ui.num_threads = jobs_default_num_threads() + 1;
+    state.ui.spawn_count = 1;
+    state.ui.cull_casters = true;
+    state.ui.cache_cascades = true;
+    jobs_setup(&(jobs_desc_t){ .num_threads = (state.ui.num_threads > 1) ? (state.ui.num_threads - 1) : -1 });
+    physics_create_world();
+}
+
+// create a dynamic body with a box or ball shape
+static b3BodyId physics_create_body(int idx, const b3BodyDef* body_def) {
+    b3BodyId body = b3CreateBody(state.physics.world, body_def);
+    b3ShapeDef shape_def = b3DefaultShapeDef();
+    shape_def.density = 1.0f;
+    shape_def.baseMaterial.restitution = 0.25f;
+    if (physics_is_box(idx)) {
+        b3BoxHull hull = b3MakeCubeHull(BOX_SIZE * 0.5f);
+        b3CreateHullShape(body, &shape_def, &hull.base);
+    } else {
+        shape_def.baseMaterial.rollingResistance = 0.05f;
+        b3Sphere sphere = { .radius = BALL_RADIUS };
+        b3CreateSphereShape(body, &shape_def, &sphere);
+    }
+    return body;
+}
+
+// Box3D's worker count is fixed when the world is created, so changing
+// the number of threads restarts the job system, creates a new world
+// and moves all bodies over with their current state
+static void physics_set_num_threads(int num_threads) {
+    const b3WorldId old_world = state.physics.world;
+    jobs_shutdown();
+    jobs_setup(&(jobs_desc_t){ .num_threads = (num_threads > 1) ? (num_threads - 1) : -1 });
+    physics_create_world();
+    for (int i = 0; i < state.physics.num_bodies; i++) {
+        const b3BodyId old_body = state.physics.bodies[i];
+        const b3WorldTransform tf = b3Body_GetTransform(old_body);
+        b3BodyDef body_def = b3DefaultBodyDef();
+        body_def.type = b3_dynamicBody;
+        body_def.position = tf.p;
+        body_def.rotation = tf.q;
+        body_def.linearVelocity = b3Body_GetLinearVelocity(old_body);
+        body_def.angularVelocity = b3Body_GetAngularVelocity(old_body);
+        body_def.isAwake = b3Body_IsAwake(old_body);
+        body_def.userData = b3Body_GetUserData(old_body);
+        state.physics.bodies[i] = physics_create_body(i, &body_def);
+    }
+    b3DestroyWorld(old_world);
+}
+
 static void copy_instance_transform(instdata_t* inst_data, const b3WorldTransform* tf) {
     mat44_t rm = mat44_from_quat(vec4(tf->q.v.x, tf->q.v.y, tf->q.v.z, tf->q.s));
     mat44_t tm = mat44_translation(tf->p.x, tf->p.y, tf->p.z);
@@ -304,6 +683,7 @@ static void copy_instance_transform(instdata_t* inst_data, const b3WorldTransfor
     inst_data->xxxx = m.x;
     inst_data->yyyy = m.y;
     inst_data->zzzz = m.z;
+    state.inst_data.centers[inst_data - state.inst_data.slots] = vec3(tf->p.x, tf->p.y, tf->p.z);
 }
 
 static void physics_update(void) {
@@ -313,9 +693,22 @@ static void physics_update(void) {
     int64_t num_sub_steps = state.physics.tick_error_us / PHYSICS_TICK_USEC;
     state.physics.tick_error_us -= num_sub_steps * PHYSICS_TICK_USEC;
     uint64_t t = stm_now();
+    b3jobs_begin_step();
     b3World_Step(state.physics.world, (float)dt_sec, (int)num_sub_steps);
     state.profiling.physics_world_step_time = stm_since(t);
     state.profiling.sub_steps_per_frame = (int) num_sub_steps;
+    state.profiling.num_tasks = b3jobs_num_tasks();
+
+    // record step time history, and smoothed sub-step time for the current thread count
+    const float step_time_ms = (float) stm_ms(state.profiling.physics_world_step_time);
+    state.profiling.step_time_ms[state.profiling.step_time_index] = step_time_ms;
+    state.profiling.step_time_index = (state.profiling.step_time_index + 1) % NUM_STEP_TIME_SAMPLES;
+    if (num_sub_steps > 0) {
+        const float sub_step_time_ms = step_time_ms / (float)num_sub_steps;
+        float* avg = &state.profiling.sub_step_time_ms_by_threads[state.ui.num_threads - 1];
+        *avg = (*avg == 0.0f) ? sub_step_time_ms : (*avg * 0.95f + sub_step_time_ms * 0.05f);
+        state.profiling.num_bodies_by_threads[state.ui.num_threads - 1] = state.physics.num_bodies;
+    }
 
     // update moved body transform matrices
     t = stm_now();
@@ -323,7 +716,9 @@ static void physics_update(void) {
     for (int i = 0; i < events.moveCount; i++) {
         const b3BodyMoveEvent* ev = &events.moveEvents[i];
         instdata_t* inst_data = (instdata_t*)ev->userData;
+        mark_instance_moved(inst_data);
         copy_instance_transform(inst_data, &ev->transform);
+        mark_instance_dirty(inst_data);
     }
     state.profiling.copy_transforms_time = stm_since(t);
     state.profiling.num_awake_bodies = b3World_GetAwakeBodyCount(state.physics.world);
@@ -331,10 +726,10 @@ static void physics_update(void) {
     if (state.ui.show_sleeping) {
         for (int i = 0; i < state.physics.num_bodies; i++) {
             instdata_t* inst_data = (instdata_t*)b3Body_GetUserData(state.physics.bodies[i]);
-            if (b3Body_IsAwake(state.physics.bodies[i])) {
-                inst_data->color.w = 0.0f;
-            } else {
-                inst_data->color.w = 1.0f;
+            const float sleeping = b3Body_IsAwake(state.physics.bodies[i]) ? 0.0f : 1.0f;
+            if (inst_data->color.w != sleeping) {
+                inst_data->color.w = sleeping;
+                mark_instance_dirty(inst_data);
             }
         }
     }
@@ -372,35 +767,29 @@ static void physics_add_body(void) {
         return;
     }
     instdata_t* inst_data = 0;
+    float radius = 0.0f;
     if (physics_is_box(idx)) {
-        inst_data = &state.inst_data.boxes[state.inst_data.num_boxes++];
+        inst_data = &state.inst_data.slots[box_slot(state.inst_data.num_boxes++)];
+        radius = BOX_SIZE * 0.5f * 1.7320508f;    // half of the box diagonal
     } else {
-        inst_data = &state.inst_data.balls[state.inst_data.num_balls++];
+        inst_data = &state.inst_data.slots[ball_slot(state.inst_data.num_balls++)];
+        radius = BALL_RADIUS;
     }
+    state.inst_data.radii[inst_data - state.inst_data.slots] = radius;
 
     const vec3_t pos = vec3(0.0f, 15.0f, 0.0f);
     b3BodyDef body_def = b3DefaultBodyDef();
     body_def.type = b3_dynamicBody;
     body_def.position = (b3Vec3){ pos.x, pos.y, pos.z };
     body_def.userData = (void*)inst_data;
-    b3BodyId body = b3CreateBody(state.physics.world, &body_def);
-
-    b3ShapeDef shape_def = b3DefaultShapeDef();
-    shape_def.density = 1.0f;
-    shape_def.baseMaterial.restitution = 0.25f;
-    if (physics_is_box(idx)) {
-        b3BoxHull hull = b3MakeCubeHull(BOX_SIZE * 0.5f);
-        b3CreateHullShape(body, &shape_def, &hull.base);
-    } else {
-        shape_def.baseMaterial.rollingResistance = 0.05f;
-        b3Sphere sphere = { .radius = BALL_RADIUS };
-        b3CreateSphereShape(body, &shape_def, &sphere);
-    }
+    b3BodyId body = physics_create_body(idx, &body_def);
     state.physics.bodies[idx] = body;
     vec3_t c = rand_uvec3();
     inst_data->color = vec4(c.x, c.y, c.z, 1.0f);
     const b3WorldTransform tf = b3Body_GetTransform(body);
     copy_instance_transform(inst_data, &tf);
+    mark_instance_dirty(inst_data);
+    mark_instance_moved(inst_data);
 
     // apply linear and angular impulse to get a fountain effect
     vec3_t v = rand_ivec3();
@@ -415,6 +804,7 @@ static void physics_add_body(void) {
 
 static void physics_cleanup(void) {
     b3DestroyWorld(state.physics.world);
+    jobs_shutdown();
 }
 
 static void gfx_init(void) {
@@ -430,37 +820,31 @@ static void gfx_init(void) {
     };
 
     // plane, box and sphere shapes
-    uint8_t vertices[SSHAPE_MAX_VERTEX_SIZE * 4096];
-    uint16_t indices[4096];
-    sshape_state_t shp = {
-        .disable = {
+    shapecache_t cache;
+    shapecache_init(&cache, &(shapecache_desc_t){
+        .format.disable = {
             .texcoords = true,
             .colors = true,
         },
-        .vertices.buffer = SSHAPE_RANGE(vertices),
-        .indices.buffer = SSHAPE_RANGE(indices),
-    };
-    sshape_build_plane(&shp, &(sshape_plane_t){
+    });
+    state.shapes.plane = shapecache_plane(&cache, &(sshape_plane_t){
         .width = GROUND_SIZE,
         .depth = GROUND_SIZE,
     });
-    state.shapes.plane = sshape_element_range(&shp);
-    sshape_build_sphere(&shp, &(sshape_sphere_t){
+    state.shapes.ball = shapecache_sphere(&cache, &(sshape_sphere_t){
         .radius = BALL_RADIUS,
         .slices = 15,
         .stacks = 11,
     });
-    state.shapes.ball = sshape_element_range(&shp);
-    sshape_build_box(&shp, &(sshape_box_t){
+    state.shapes.box = shapecache_box(&cache, &(sshape_box_t){
         .width = BOX_SIZE,
         .height = BOX_SIZE,
         .depth = BOX_SIZE,
     });
-    state.shapes.box = sshape_element_range(&shp);
 
     // shape vertex and index buffer
-    const sg_buffer_desc vbuf_desc = sshape_vertex_buffer_desc(&shp);
-    const sg_buffer_desc ibuf_desc = sshape_index_buffer_desc(&shp);
+    const sg_buffer_desc vbuf_desc = shapecache_vertex_buffer_desc(&cache);
+    const sg_buffer_desc ibuf_desc = shapecache_index_buffer_desc(&cache);
     state.vbuf = sg_make_buffer(&vbuf_desc);
     state.ibuf = sg_make_buffer(&ibuf_desc);
 
@@ -468,17 +852,17 @@ static void gfx_init(void) {
     state.display.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = sg_make_shader(display_shader_desc(sg_query_backend())),
         .layout = {
-            .buffers[0] = sshape_vertex_buffer_layout_state(&shp),
+            .buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
             .attrs = {
-                [ATTR_display_pos] = sshape_position_vertex_attr_state(&shp),
-                [ATTR_display_normal] = sshape_normal_vertex_attr_state(&shp),
+                [ATTR_display_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_display_normal] = sshape_normal_vertex_attr_state(&cache.format),
             }
         },
         .depth = {
             .write_enabled = true,
             .compare = SG_COMPAREFUNC_LESS_EQUAL,
         },
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_BACK,
         .label = "display-pipeline"
     });
@@ -486,7 +870,7 @@ static void gfx_init(void) {
         .shader = sg_make_shader(display_instanced_shader_desc(sg_query_backend())),
         .layout = {
             .buffers = {
-                [0] = sshape_vertex_buffer_layout_state(&shp),
+                [0] = sshape_vertex_buffer_layout_state(&cache.format),
                 [1] = {
                     .step_func = SG_VERTEXSTEP_PER_INSTANCE,
                     .stride = sizeof(instdata_t),
@@ -496,8 +880,8 @@ static void gfx_init(void) {
                 // NOTE: since sshape helper functions return explicit offsets, the instance attribute
                 // offsets also must be explicitly provided (because the auto-offset computation only works
                 // when *all* vertex attribute offsets are 0)
-                [ATTR_display_instanced_pos] = sshape_position_vertex_attr_state(&shp),
-                [ATTR_display_instanced_normal] = sshape_normal_vertex_attr_state(&shp),
+                [ATTR_display_instanced_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_display_instanced_normal] = sshape_normal_vertex_attr_state(&cache.format),
                 [ATTR_display_instanced_inst_xxxx] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 0 },
                 [ATTR_display_instanced_inst_yyyy] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 16 },
                 [ATTR_display_instanced_inst_zzzz] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 32 },
@@ -508,16 +892,18 @@ static void gfx_init(void) {
             .write_enabled = true,
             .compare = SG_COMPAREFUNC_LESS_EQUAL,
         },
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_BACK,
         .label = "display-instanced-pipeline"
     });
 
-    // shadow pass resources
+    // shadow pass resources, one shadow map array slice per cascade
     sg_image shadow_map_img = sg_make_image(&(sg_image_desc){
+        .type = SG_IMAGETYPE_ARRAY,
         .usage.depth_stencil_attachment = true,
-        .width = SHADOW_MAP_SIZE,
-        .height = SHADOW_MAP_SIZE,
+        .width = CASCADE_MAP_SIZE,
+        .height = CASCADE_MAP_SIZE,
+        .num_slices = NUM_CASCADES,
         .pixel_format = SG_PIXELFORMAT_DEPTH,
         .sample_count = 1,
         .label = "shadow-map-image",
@@ -526,18 +912,28 @@ static void gfx_init(void) {
         .texture.image = shadow_map_img,
         .label = "shadow-map-texview"
     });
-    state.shadow.pass = (sg_pass){
-        .action.depth = {
-            .load_action = SG_LOADACTION_CLEAR,
-            .store_action = SG_STOREACTION_STORE,
-            .clear_value = 1.0f,
-        },
-        .attachments.depth_stencil = sg_make_view(&(sg_view_desc){
-            .depth_stencil_attachment.image = shadow_map_img,
-            .label = "shadow-map-dsview",
-        }),
-        .label = "shadow-pass",
-    };
+    for (int i = 0; i < NUM_CASCADES; i++) {
+        state.shadow.passes[i] = (sg_pass){
+            .action.depth = {
+                .load_action = SG_LOADACTION_CLEAR,
+                .store_action = SG_STOREACTION_STORE,
+                .clear_value = 1.0f,
+            },
+            .attachments.depth_stencil = sg_make_view(&(sg_view_desc){
+                .depth_stencil_attachment = { .image = shadow_map_img, .slice = i },
+                .label = "shadow-map-dsview",
+            }),
+            .label = "shadow-pass",
+        };
+    }
+    // grown in update_shadow_cascades() when needed
+    reserve_culled(MIN_CULLED_CAPACITY);
+    state.shadow.cull_buf_capacity = MIN_CULLED_CAPACITY;
+    state.shadow.cull_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.stream_update = true,
+        .size = MIN_CULLED_CAPACITY * sizeof(instdata_t),
+        .label = "shadow-caster-buffer",
+    });
     state.shadow.smp = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_LINEAR,
         .mag_filter = SG_FILTER_LINEAR,
@@ -550,14 +946,14 @@ static void gfx_init(void) {
         .shader = sg_make_shader(shadow_instanced_shader_desc(sg_query_backend())),
         .layout = {
             .buffers = {
-                [0] = sshape_vertex_buffer_layout_state(&shp),
+                [0] = sshape_vertex_buffer_layout_state(&cache.format),
                 [1] = {
                     .stride = sizeof(instdata_t),
                     .step_func = SG_VERTEXSTEP_PER_INSTANCE,
                 },
             },
             .attrs = {
-                [ATTR_shadow_instanced_pos] = sshape_position_vertex_attr_state(&shp),
+                [ATTR_shadow_instanced_pos] = sshape_position_vertex_attr_state(&cache.format),
                 [ATTR_shadow_instanced_inst_xxxx] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 0 },
                 [ATTR_shadow_instanced_inst_yyyy] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 16, },
                 [ATTR_shadow_instanced_inst_zzzz] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = 32 },
@@ -568,24 +964,58 @@ static void gfx_init(void) {
             .compare = SG_COMPAREFUNC_LESS_EQUAL,
             .write_enabled = true,
         },
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_FRONT,
         .sample_count = 1,
         .colors[0].pixel_format = SG_PIXELFORMAT_NONE,
         .label = "shadow-instanced-pipeline",
     });
+    shapecache_shutdown(&cache);
 
-    // instance buffers for box and sphere instances
-    state.box_inst_buf = sg_make_buffer(&(sg_buffer_desc){
-        .usage.stream_update = true,
-        .size = MAX_INSTANCES * sizeof(instdata_t),
-        .label = "box-instance-buffer",
-    });
-    state.ball_inst_buf = sg_make_buffer(&(sg_buffer_desc){
-        .usage.stream_update = true,
-        .size = MAX_INSTANCES * sizeof(instdata_t),
-        .label = "ball-instance-buffer",
-    });
+    // instance buffer for box and sphere instances, with compute shader
+    // support this is a persistent storage buffer which is only updated
+    // through the scatter compute shader, otherwise a stream-update
+    // vertex buffer which is completely overwritten each frame
+    state.scatter.enabled = sg_query_features().compute;
+    if (state.scatter.enabled) {
+        state.inst_buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = {
+                .vertex_buffer = true,
+                .storage_buffer = true,
+            },
+            .size = NUM_INSTANCE_SLOTS * sizeof(instdata_t),
+            .label = "instance-buffer",
+        });
+        state.inst_offsets.box = box_slot(0) * (int)sizeof(instdata_t);
+        state.inst_offsets.ball = ball_slot(0) * (int)sizeof(instdata_t);
+        state.scatter.inst_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer.buffer = state.inst_buf,
+            .label = "instance-buffer-view",
+        });
+        state.scatter.staging_buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = {
+                .storage_buffer = true,
+                .stream_update = true,
+            },
+            .size = NUM_INSTANCE_SLOTS * sizeof(staged_instance_t),
+            .label = "staging-buffer",
+        });
+        state.scatter.staging_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer.buffer = state.scatter.staging_buf,
+            .label = "staging-buffer-view",
+        });
+        state.scatter.pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(scatter_shader_desc(sg_query_backend())),
+            .label = "scatter-pipeline",
+        });
+    } else {
+        state.inst_buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.stream_update = true,
+            .size = NUM_INSTANCE_SLOTS * sizeof(instdata_t),
+            .label = "instance-buffer",
+        });
+    }
 }
 
 static void ui_draw(void) {
@@ -612,6 +1042,63 @@ static void ui_draw(void) {
         igText("Sub-steps per frame: %d", state.profiling.sub_steps_per_frame);
         igText("World Step Time: %.3fms", stm_ms(state.profiling.physics_world_step_time));
         igText("Copy Transforms Time: %.3fms", stm_ms(state.profiling.copy_transforms_time));
+        igText("Instance Update: %s", state.scatter.enabled ? "compute scatter" : "full upload");
+        igText("Uploaded Instances: %d", state.profiling.num_uploaded_instances);
+        igText("Upload Bytes: %d (full: %d)",
+            state.profiling.upload_bytes,
+            (state.inst_data.num_boxes + state.inst_data.num_balls) * (int)sizeof(instdata_t));
+        igText("Box3D tasks per frame: %d", state.profiling.num_tasks);
+        igCheckbox("Cull shadow casters", &state.ui.cull_casters);
+        igCheckbox("Cache shadow cascades", &state.ui.cache_cascades);
+        igCheckbox("Show cascades", &state.ui.show_cascades);
+        igText("Shadow Cull Time: %.3fms", stm_ms(state.profiling.shadow_cull_time));
+        int num_shadow_instances = 0;
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            const bool render = state.shadow.cascades[i].render;
+            const int num_boxes = render ? state.shadow.cascades[i].num_boxes : 0;
+            const int num_balls = render ? state.shadow.cascades[i].num_balls : 0;
+            igText("Cascade %d (%.1f..%.1f): %s, %d draws, %d instances",
+                i,
+                state.shadow.cascades[i].split_near,
+                state.shadow.cascades[i].split_far,
+                render ? "rendered" : "cached",
+                ((num_boxes > 0) ? 1 : 0) + ((num_balls > 0) ? 1 : 0),
+                num_boxes + num_balls);
+            num_shadow_instances += num_boxes + num_balls;
+        }
+        igText("Shadow Instances: %d (unculled and uncached: %d)",
+            num_shadow_instances,
+            NUM_CASCADES * (state.inst_data.num_boxes + state.inst_data.num_balls));
+        igSliderInt("Spawn Count", &state.ui.spawn_count, 1, MAX_SPAWN_COUNT);
+        const int max_threads = jobs_default_num_threads() + 1;
+        igSliderInt("Threads", &state.ui.num_threads, 1, max_threads);
+        if (igIsItemDeactivatedAfterEdit()) {
+            physics_set_num_threads(state.ui.num_threads);
+        }
+        igPlotLinesEx("##step_time",
+            state.profiling.step_time_ms,
+            NUM_STEP_TIME_SAMPLES,
+            state.profiling.step_time_index,
+            "World Step Time (ms)",
+            0.0f, FLT_MAX,
+            (ImVec2){ 300.0f, 60.0f },
+            sizeof(float));
+        igPlotHistogramEx("##step_time_by_threads",
+            state.profiling.sub_step_time_ms_by_threads,
+            max_threads,
+            0,
+            "Sub-step Time (ms) by Threads",
+            0.0f, FLT_MAX,
+            (ImVec2){ 300.0f, 60.0f },
+            sizeof(float));
+        for (int i = 0; i < max_threads; i++) {
+            if (state.profiling.sub_step_time_ms_by_threads[i] > 0.0f) {
+                igText("%2d threads: %.3fms per sub-step (%d bodies)",
+                    i + 1,
+                    state.profiling.sub_step_time_ms_by_threads[i],
+                    state.profiling.num_bodies_by_threads[i]);
+            }
+        }
     }
     igEnd();
 }
@@ -9,13 +9,13 @@ vec4 gamma(vec4 c) {
     return vec4(pow(c.xyz, vec3(p)), c.w);
 }
 
-float sample_shadow_pcf(texture2D tex, sampler smp, vec3 sm_pos) {
-    vec2 sm_size = vec2(textureSize(sampler2DShadow(tex, smp), 0));
+float sample_shadow_pcf(texture2DArray tex, sampler smp, vec3 sm_pos, int cascade) {
+    vec2 sm_size = vec2(textureSize(sampler2DArrayShadow(tex, smp), 0).xy);
     float result = 0.0;
     for (int x = -2; x <= 2; x++) {
         for (int y =- 2; y <= 2; y++) {
             vec2 offset = vec2(x, y) / sm_size;
-            result += texture(sampler2DShadow(tex, smp), vec3(sm_pos.xy + offset, sm_pos.z));
+            result += texture(sampler2DArrayShadow(tex, smp), vec4(sm_pos.xy + offset, float(cascade), sm_pos.z));
         }
     }
     return result / 25.0;
@@ -47,7 +47,6 @@ void main() {}
 layout(binding=0) uniform display_vs_params {
     mat4 mvp;
     mat4 model;
-    mat4 light_mvp;
     vec4 diff_color;
 };
 
@@ -55,16 +54,11 @@ layout(location=0) in vec4 pos;
 layout(location=1) in vec3 normal;
 
 out vec3 color;
-out vec4 light_proj_pos;    // light space position (for shadow mapping)
 out vec4 world_pos;
 out vec3 world_nrm;
 
 void main() {
     gl_Position = mvp * pos;
-    light_proj_pos = light_mvp * pos;
-    #if !SOKOL_GLSL
-        light_proj_pos.y = -light_proj_pos.y;
-    #endif
     world_pos = model * pos;
     world_nrm = (model * vec4(normal, 0)).xyz;
     color = diff_color.xyz;
@@ -74,7 +68,6 @@ void main() {
 @vs display_inst_vs
 layout(binding=0) uniform display_inst_vs_params {
     mat4 view_proj;
-    mat4 light_view_proj;
     float awake_filter;
 };
 
@@ -85,7 +78,6 @@ layout(location=3) in vec4 inst_yyyy;
 layout(location=4) in vec4 inst_zzzz;
 layout(location=5) in vec4 inst_color;
 out vec3 color;
-out vec4 light_proj_pos;    // light space position (for shadow mapping)
 out vec4 world_pos;
 out vec3 world_nrm;
 
@@ -94,10 +86,6 @@ void main() {
     vec4 nrm4 = vec4(normal, 0.0);
     vec3 wn = vec3(dot(nrm4, inst_xxxx), dot(nrm4, inst_yyyy), dot(nrm4, inst_zzzz));
     gl_Position = view_proj * wp;
-    light_proj_pos = light_view_proj * wp;
-    #if !SOKOL_GLSL
-        light_proj_pos.y = -light_proj_pos.y;
-    #endif
     world_pos = wp;
     world_nrm = wn;
     color = mix(inst_color.xyz, vec3(0.25f, 0.25f, 0.25f), awake_filter * inst_color.w);
@@ -106,16 +94,19 @@ void main() {
 
 @fs display_fs
 @include_block util
+// NOTE: the array size must match NUM_CASCADES in box3d-simple-sapp.c
 layout(binding=1) uniform display_fs_params {
+    mat4 cascade_view_proj[4];
+    vec4 cascade_bias;          // depth bias per cascade
     vec3 light_dir;
+    float show_cascades;
     vec3 eye_pos;
 };
 
-layout(binding=0) uniform texture2D shadow_map;
+layout(binding=0) uniform texture2DArray shadow_map;
 layout(binding=0) uniform sampler shadow_sampler;
 
 in vec3 color;
-in vec4 light_proj_pos;
 in vec4 world_pos;
 in vec3 world_nrm;
 
@@ -125,16 +116,39 @@ void main() {
     float spec_power = 16.0;
     float ambient_intensity = 0.25;
 
+    // pick the first (finest) cascade which covers the fragment, the
+    // margin keeps the PCF kernel inside the cascade
+    int cascade = -1;
+    vec3 light_pos = vec3(0.0);
+    for (int i = 0; i < 4; i++) {
+        light_pos = (cascade_view_proj[i] * world_pos).xyz;
+        #if !SOKOL_GLSL
+            light_pos.y = -light_pos.y;
+        #endif
+        if (all(lessThan(abs(light_pos.xy), vec2(0.995))) && (light_pos.z < 1.0)) {
+            cascade = i;
+            break;
+        }
+    }
+    vec3 cascade_tint = vec3(1.0);
+    if ((show_cascades > 0.0) && (cascade >= 0)) {
+        const vec3 tints[4] = vec3[4](vec3(1.0, 0.5, 0.5), vec3(0.5, 1.0, 0.5), vec3(0.5, 0.5, 1.0), vec3(1.0, 1.0, 0.5));
+        cascade_tint = tints[cascade];
+    }
+
     // diffuse lighting
     vec3 l = light_dir;
     vec3 n = normalize(world_nrm);
     float n_dot_l = dot(n, l);
     if (n_dot_l > 0) {
 
-        vec3 light_pos = light_proj_pos.xyz / light_proj_pos.w;
-        float depth_bias = max(0.0001 * (1.0 - n_dot_l), 0.00001);
-        vec3 sm_pos = vec3((light_pos.xy + 1.0) * 0.5, light_pos.z + depth_bias);
-        float s = sample_shadow_pcf(shadow_map, shadow_sampler, sm_pos);
+        // outside of all cascades is unshadowed
+        float s = 1.0;
+        if (cascade >= 0) {
+            float depth_bias = max(cascade_bias[cascade] * (1.0 - n_dot_l), cascade_bias[cascade] * 0.1);
+            vec3 sm_pos = vec3((light_pos.xy + 1.0) * 0.5, light_pos.z + depth_bias);
+            s = sample_shadow_pcf(shadow_map, shadow_sampler, sm_pos, cascade);
+        }
 
         float diff_intensity = max(n_dot_l * s, 0);
         vec3 v = normalize(eye_pos - world_pos.xyz);
@@ -142,10 +156,10 @@ void main() {
         float r_dot_v = max(dot(r, v), 0.0);
         float spec_intensity = pow(r_dot_v, spec_power) * n_dot_l * s;
 
-        frag_color = vec4(vec3(spec_intensity) + (diff_intensity + ambient_intensity) * color, 1);
+        frag_color = vec4(vec3(spec_intensity) + (diff_intensity + ambient_intensity) * color * cascade_tint, 1);
     } else {
         // FIXME: more interesting ambient color
-        frag_color = vec4(color * ambient_intensity, 1);
+        frag_color = vec4(color * cascade_tint * ambient_intensity, 1);
     }
     frag_color = gamma(frag_color);
 }
@@ -153,3 +167,45 @@ void main() {
 
 @program display display_vs display_fs
 @program display_instanced display_inst_vs display_fs
+
+// compute shader to scatter changed instances from a compact staging
+// buffer into the persistent instance buffer
+@cs scatter_cs
+struct staged_instance {
+    vec4 xxxx;
+    vec4 yyyy;
+    vec4 zzzz;
+    vec4 color;
+    int slot;
+    int pad0;
+    int pad1;
+    int pad2;
+};
+
+struct instance {
+    vec4 xxxx;
+    vec4 yyyy;
+    vec4 zzzz;
+    vec4 color;
+};
+
+layout(binding=0) uniform scatter_params {
+    int num_items;
+};
+layout(binding=0) readonly buffer staging_sbuf { staged_instance staged[]; };
+layout(binding=1) buffer instances_sbuf { instance inst[]; };
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+void main() {
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_items) {
+        return;
+    }
+    int slot = staged[idx].slot;
+    inst[slot].xxxx = staged[idx].xxxx;
+    inst[slot].yyyy = staged[idx].yyyy;
+    inst[slot].zzzz = staged[idx].zzzz;
+    inst[slot].color = staged[idx].color;
+}
+@end
+@program scatter scatter_cs
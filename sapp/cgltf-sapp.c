@@ -4,6 +4,18 @@
 //  A simple(!) GLTF viewer, cgltf + basisu + sokol_app.h + sokol_gfx.h + sokol_fetch.h.
 //  Doesn't support all GLTF features.
 //
+//  Loaded files go through a small pipeline to avoid frame hitches:
+//
+//  - sokol-fetch loads the file data and the fetch callback copies it
+//    into a heap buffer
+//  - a job on a worker thread decodes the data (basisu transcoding,
+//    widening 8-bit index buffers)
+//  - the frame thread creates the sokol-gfx resources from decoded data
+//    under a per-frame upload budget
+//  - each primitive tracks how many buffers and images it still waits
+//    for, primitives are only rendered once all their buffers exist,
+//    missing textures are replaced with placeholders
+//
 //  https://github.com/jkuhlmann/cgltf
 //------------------------------------------------------------------------------
 #define VECMATH_GENERICS
@@ -25,6 +37,9 @@
 #include "cgltf/cgltf.h"
 #include "util/camera.h"
 #include "util/fileutil.h"
+#include "util/jobs.h"
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -48,6 +63,10 @@ static const char* filename = "DamagedHelmet.gltf";
 #define MAX_FILE_SIZE (1024*1024)
 uint8_t sfetch_buffers[SFETCH_NUM_CHANNELS][SFETCH_NUM_LANES][MAX_FILE_SIZE];
 
+// max number of bytes to upload into sokol-gfx resources per frame (at least
+// one resource will be created per frame even if it exceeds the budget)
+#define MAX_UPLOAD_BYTES_PER_FRAME (2*1024*1024)
+
 // per-material texture indices into scene.images for metallic material
 typedef struct {
     int base_color;
@@ -103,6 +122,8 @@ typedef struct {
     int index_buffer;       // index into bufferview array for index buffer, or SCENE_INVALID_INDEX
     int base_element;       // index of first index or vertex to draw
     int num_elements;       // number of vertices or indices to draw
+    int pending_buffers;    // number of buffer references not yet created
+    int pending_images;     // number of material image references not yet created
 } primitive_t;
 
 // a mesh is just a group of primitives (aka submeshes)
@@ -149,6 +170,9 @@ typedef struct {
     int offset;
     int size;
     int gltf_buffer_index;
+    bool index_u8;          // 8-bit indices which must be widened to 16-bit
+    sg_range converted;     // widened index data, created by a worker thread
+    bool created;
 } buffer_creation_params_t;
 
 typedef struct {
@@ -158,8 +182,35 @@ typedef struct {
     sg_wrap wrap_s;
     sg_wrap wrap_t;
     int gltf_image_index;
+    bool created;
 } image_sampler_creation_params_t;
 
+// loading state of a GLTF buffer or image file
+typedef enum {
+    LOAD_STATE_PENDING,     // waiting for sokol-fetch
+    LOAD_STATE_DECODING,    // decode job is running on a worker thread
+    LOAD_STATE_DECODED,     // waiting for resource creation on the frame thread
+    LOAD_STATE_DONE,        // all resources created, file data has been freed
+} load_state_t;
+
+// a GLTF buffer file in flight
+typedef struct {
+    load_state_t state;
+    jobs_group_t job;
+    int gltf_buffer_index;
+    sg_range data;          // heap copy of the file data
+    int num_pending_views;  // buffer views not yet created from this buffer
+} buffer_load_t;
+
+// a GLTF image file in flight
+typedef struct {
+    load_state_t state;
+    jobs_group_t job;
+    sg_range data;          // heap copy of the file data
+    sg_image_desc desc;     // transcoded image data, created by a worker thread
+    sg_image img;           // shared by all textures using this image
+} image_load_t;
+
 // pipeline cache helper struct to avoid duplicate pipeline-state-objects
 typedef struct {
     sg_vertex_layout_state layout;
@@ -189,6 +240,18 @@ static struct {
         buffer_creation_params_t buffers[SCENE_MAX_BUFFERS];
         image_sampler_creation_params_t images[SCENE_MAX_IMAGES];
     } creation_params;
+    struct {
+        int num_buffers;
+        int num_images;
+        buffer_load_t buffers[SCENE_MAX_BUFFERS];
+        image_load_t images[SCENE_MAX_IMAGES];
+        struct {
+            int jobs_in_flight;
+            int upload_bytes;       // bytes uploaded in the current frame
+            int drawable_primitives;
+            int textured_primitives;
+        } stats;
+    } loader;
     struct {
         pipeline_cache_params_t items[SCENE_MAX_PIPELINES];
     } pip_cache;
@@ -211,14 +274,17 @@ static void gltf_fetch_callback(const sfetch_response_t*);
 static void gltf_buffer_fetch_callback(const sfetch_response_t*);
 static void gltf_image_fetch_callback(const sfetch_response_t*);
 
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data);
-static void create_sg_image_samplers_for_gltf_image(int gltf_image_index, sg_range data);
+static void decode_gltf_buffer(void* user_data);
+static void decode_gltf_image(void* user_data);
+static void update_loader(void);
 static vertex_buffer_mapping_t create_vertex_buffer_mapping_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim);
 static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map);
 static mat44_t build_transform_for_gltf_node(const cgltf_data* gltf, const cgltf_node* node);
 
 static void update_scene(void);
 static cgltf_vs_params_t vs_params_for_node(int node_index);
+static image_t scene_image(int image_index);
+static int num_metallic_images(const metallic_images_t* imgs);
 
 // sokol-app init callback, called once at startup
 static void init(void) {
@@ -240,6 +306,9 @@ static void init(void) {
     // initialize Basis Universal
     sbasisu_setup();
 
+    // start the worker threads for decoding loaded data
+    jobs_setup(&(jobs_desc_t){0});
+
     // setup sokol-debugtext
     sdtx_setup(&(sdtx_desc_t){
         .fonts = {
@@ -336,12 +405,20 @@ static void frame(void) {
     // pump the sokol-fetch message queue
     sfetch_dowork();
 
-    // print help text
+    // check for finished decode jobs and create resources
+    update_loader();
+
+    // print help text and loading progress
     sdtx_canvas(sapp_width() * 0.5f, sapp_height() * 0.5f);
     sdtx_color1i(0xFFFFFFFF);
     sdtx_origin(1.0f, 2.0f);
     sdtx_puts("LMB + drag:  rotate\n");
-    sdtx_puts("mouse wheel: zoom");
+    sdtx_puts("mouse wheel: zoom\n\n");
+    sdtx_printf("worker threads: %d\n", jobs_num_threads());
+    sdtx_printf("decode jobs:    %d\n", state.loader.stats.jobs_in_flight);
+    sdtx_printf("uploaded:       %d KB\n", state.loader.stats.upload_bytes / 1024);
+    sdtx_printf("drawable:       %d/%d\n", state.loader.stats.drawable_primitives, state.scene.num_primitives);
+    sdtx_printf("textured:       %d/%d", state.loader.stats.textured_primitives, state.scene.num_primitives);
 
     update_scene();
     const int fb_width = sapp_width();
@@ -362,6 +439,10 @@ static void frame(void) {
             const mesh_t* mesh = &state.scene.meshes[node->mesh];
             for (int i = 0; i < mesh->num_primitives; i++) {
                 const primitive_t* prim = &state.scene.primitives[i + mesh->first_primitive];
+                if (prim->pending_buffers > 0) {
+                    // vertex- or index-buffers not yet loaded
+                    continue;
+                }
                 const material_t* mat = &state.scene.materials[prim->material];
                 sg_apply_pipeline(state.scene.pipelines[prim->pipeline]);
                 sg_bindings bind = { 0 };
@@ -374,16 +455,16 @@ static void frame(void) {
                 sg_apply_uniforms(UB_cgltf_vs_params, &SG_RANGE(vs_params));
                 sg_apply_uniforms(UB_cgltf_light_params, &SG_RANGE(state.point_light));
                 if (mat->is_metallic) {
-                    sg_view base_color_tex = state.scene.images[mat->metallic.images.base_color].tex_view;
-                    sg_view metallic_roughness_tex = state.scene.images[mat->metallic.images.metallic_roughness].tex_view;
-                    sg_view normal_tex = state.scene.images[mat->metallic.images.normal].tex_view;
-                    sg_view occlusion_tex = state.scene.images[mat->metallic.images.occlusion].tex_view;
-                    sg_view emissive_tex = state.scene.images[mat->metallic.images.emissive].tex_view;
-                    sg_sampler base_color_smp = state.scene.images[mat->metallic.images.base_color].smp;
-                    sg_sampler metallic_roughness_smp = state.scene.images[mat->metallic.images.metallic_roughness].smp;
-                    sg_sampler normal_smp = state.scene.images[mat->metallic.images.normal].smp;
-                    sg_sampler occlusion_smp = state.scene.images[mat->metallic.images.occlusion].smp;
-                    sg_sampler emissive_smp = state.scene.images[mat->metallic.images.emissive].smp;
+                    sg_view base_color_tex = scene_image(mat->metallic.images.base_color).tex_view;
+                    sg_view metallic_roughness_tex = scene_image(mat->metallic.images.metallic_roughness).tex_view;
+                    sg_view normal_tex = scene_image(mat->metallic.images.normal).tex_view;
+                    sg_view occlusion_tex = scene_image(mat->metallic.images.occlusion).tex_view;
+                    sg_view emissive_tex = scene_image(mat->metallic.images.emissive).tex_view;
+                    sg_sampler base_color_smp = scene_image(mat->metallic.images.base_color).smp;
+                    sg_sampler metallic_roughness_smp = scene_image(mat->metallic.images.metallic_roughness).smp;
+                    sg_sampler normal_smp = scene_image(mat->metallic.images.normal).smp;
+                    sg_sampler occlusion_smp = scene_image(mat->metallic.images.occlusion).smp;
+                    sg_sampler emissive_smp = scene_image(mat->metallic.images.emissive).smp;
 
                     if (!base_color_tex.id) {
                         base_color_tex = state.placeholders.white;
@@ -438,6 +519,20 @@ static void frame(void) {
 // sokol-app cleanup callback, called once at shutdown
 static void cleanup(void) {
     sfetch_shutdown();
+    // this waits for running decode jobs to finish
+    jobs_shutdown();
+    for (int i = 0; i < state.scene.num_buffers; i++) {
+        free((void*)state.creation_params.buffers[i].converted.ptr);
+    }
+    for (int i = 0; i < state.loader.num_buffers; i++) {
+        free((void*)state.loader.buffers[i].data.ptr);
+    }
+    for (int i = 0; i < state.loader.num_images; i++) {
+        image_load_t* ld = &state.loader.images[i];
+        if ((ld->state == LOAD_STATE_DECODING) || (ld->state == LOAD_STATE_DECODED)) {
+            sbasisu_free(&ld->desc);
+        }
+    }
     __dbgui_shutdown();
     sbasisu_shutdown();
     sg_shutdown();
@@ -467,6 +562,15 @@ static void gltf_fetch_callback(const sfetch_response_t* response) {
     }
 }
 
+// copy fetched data into a heap buffer, the sokol-fetch buffers are
+// reused as soon as the fetch callback returns
+static sg_range copy_fetched_data(sfetch_range_t data) {
+    void* ptr = malloc(data.size);
+    assert(ptr);
+    memcpy(ptr, data.ptr, data.size);
+    return (sg_range){ .ptr = ptr, .size = data.size };
+}
+
 // load-callback for GLTF buffer files
 typedef struct {
     cgltf_size buffer_index;
@@ -477,8 +581,11 @@ static void gltf_buffer_fetch_callback(const sfetch_response_t* response) {
         sfetch_bind_buffer(response->handle, SFETCH_RANGE(sfetch_buffers[response->channel][response->lane]));
     } else if (response->fetched) {
         const gltf_buffer_fetch_userdata_t* user_data = (const gltf_buffer_fetch_userdata_t*)response->user_data;
-        int gltf_buffer_index = (int)user_data->buffer_index;
-        create_sg_buffers_for_gltf_buffer(gltf_buffer_index, (sg_range){response->data.ptr, response->data.size});
+        buffer_load_t* ld = &state.loader.buffers[user_data->buffer_index];
+        assert(ld->state == LOAD_STATE_PENDING);
+        ld->data = copy_fetched_data(response->data);
+        ld->state = LOAD_STATE_DECODING;
+        jobs_push(&ld->job, decode_gltf_buffer, ld);
     }
     if (response->finished) {
         if (response->failed) {
@@ -497,8 +604,11 @@ static void gltf_image_fetch_callback(const sfetch_response_t* response) {
         sfetch_bind_buffer(response->handle, SFETCH_RANGE(sfetch_buffers[response->channel][response->lane]));
     } else if (response->fetched) {
         const gltf_image_fetch_userdata_t* user_data = (const gltf_image_fetch_userdata_t*)response->user_data;
-        int gltf_image_index = (int)user_data->image_index;
-        create_sg_image_samplers_for_gltf_image(gltf_image_index, (sg_range){response->data.ptr, response->data.size});
+        image_load_t* ld = &state.loader.images[user_data->image_index];
+        assert(ld->state == LOAD_STATE_PENDING);
+        ld->data = copy_fetched_data(response->data);
+        ld->state = LOAD_STATE_DECODING;
+        jobs_push(&ld->job, decode_gltf_image, ld);
     }
     if (response->finished) {
         if (response->failed) {
@@ -538,8 +648,11 @@ static int gltf_image_index(const cgltf_data* gltf, const cgltf_image* img) {
     return (int) (img - gltf->images);
 }
 
+// returns SCENE_INVALID_INDEX for a material without the texture
 static int gltf_texture_index(const cgltf_data* gltf, const cgltf_texture* tex) {
-    assert(tex);
+    if (tex == 0) {
+        return SCENE_INVALID_INDEX;
+    }
     return (int) (tex - gltf->textures);
 }
 
@@ -555,7 +668,7 @@ static int gltf_mesh_index(const cgltf_data* gltf, const cgltf_mesh* mesh) {
 
 // parse the GLTF buffer definitions and start loading buffer blobs
 static void gltf_parse_buffers(const cgltf_data* gltf) {
-    if (gltf->buffer_views_count > SCENE_MAX_BUFFERS) {
+    if ((gltf->buffer_views_count > SCENE_MAX_BUFFERS) || (gltf->buffers_count > SCENE_MAX_BUFFERS)) {
         state.failed = true;
         return;
     }
@@ -577,6 +690,15 @@ static void gltf_parse_buffers(const cgltf_data* gltf) {
         state.scene.buffers[i] = sg_alloc_buffer();
     }
 
+    // setup the loader state for each buffer file
+    state.loader.num_buffers = (int) gltf->buffers_count;
+    for (int i = 0; i < state.loader.num_buffers; i++) {
+        state.loader.buffers[i].gltf_buffer_index = i;
+    }
+    for (int i = 0; i < state.scene.num_buffers; i++) {
+        state.loader.buffers[state.creation_params.buffers[i].gltf_buffer_index].num_pending_views++;
+    }
+
     // start loading all buffers
     for (cgltf_size i = 0; i < gltf->buffers_count; i++) {
         const cgltf_buffer* gltf_buf = &gltf->buffers[i];
@@ -636,7 +758,7 @@ static sg_wrap gltf_to_sg_wrap(int gltf_wrap) {
 }
 
 static void gltf_parse_images(const cgltf_data* gltf) {
-    if (gltf->textures_count > SCENE_MAX_IMAGES) {
+    if ((gltf->textures_count > SCENE_MAX_IMAGES) || (gltf->images_count > SCENE_MAX_IMAGES)) {
         state.failed = true;
         return;
     }
@@ -656,6 +778,7 @@ static void gltf_parse_images(const cgltf_data* gltf) {
         assert(SG_INVALID_ID == state.scene.images[i].tex_view.id);
         assert(SG_INVALID_ID == state.scene.images[i].smp.id);
     }
+    state.loader.num_images = (int) gltf->images_count;
 
     // start loading all images
     for (cgltf_size i = 0; i < gltf->images_count; i++) {
@@ -758,6 +881,10 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
                 prim->index_buffer = gltf_bufferview_index(gltf, gltf_prim->indices->buffer_view);
                 assert(state.creation_params.buffers[prim->index_buffer].usage.index_buffer);
                 assert(gltf_prim->indices->stride != 0);
+                if (gltf_prim->indices->component_type == cgltf_component_type_r_8u) {
+                    // sokol-gfx has no 8-bit indices, widened on a worker thread after loading
+                    state.creation_params.buffers[prim->index_buffer].index_u8 = true;
+                }
                 prim->base_element = 0;
                 prim->num_elements = (int) gltf_prim->indices->count;
             } else {
@@ -767,6 +894,10 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
                 prim->base_element = 0;
                 prim->num_elements = (int) gltf_prim->attributes->data->count;
             }
+            // the number of resources this primitive waits for until it can be rendered
+            prim->pending_buffers = prim->vertex_buffers.num + ((prim->index_buffer != SCENE_INVALID_INDEX) ? 1 : 0);
+            const material_t* mat = &state.scene.materials[prim->material];
+            prim->pending_images = mat->is_metallic ? num_metallic_images(&mat->metallic.images) : 0;
         }
     }
 }
@@ -789,37 +920,189 @@ static void gltf_parse_nodes(const cgltf_data* gltf) {
     }
 }
 
-// create the sokol-gfx buffer objects associated with a GLTF buffer view
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data) {
+// worker thread: post-process the buffer views of a loaded GLTF buffer
+static void decode_gltf_buffer(void* user_data) {
+    const buffer_load_t* ld = (const buffer_load_t*) user_data;
     for (int i = 0; i < state.scene.num_buffers; i++) {
-        const buffer_creation_params_t* p = &state.creation_params.buffers[i];
-        if (p->gltf_buffer_index == gltf_buffer_index) {
-            assert((size_t)(p->offset + p->size) <= data.size);
-            sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){
-                .usage = p->usage,
-                .data = {
-                    .ptr = (const uint8_t*)data.ptr + p->offset,
-                    .size = (size_t)p->size,
-                }
-            });
+        buffer_creation_params_t* p = &state.creation_params.buffers[i];
+        if ((p->gltf_buffer_index == ld->gltf_buffer_index) && p->index_u8) {
+            assert((size_t)(p->offset + p->size) <= ld->data.size);
+            const uint8_t* src = (const uint8_t*)ld->data.ptr + p->offset;
+            uint16_t* dst = (uint16_t*) malloc((size_t)p->size * sizeof(uint16_t));
+            assert(dst);
+            for (int idx = 0; idx < p->size; idx++) {
+                dst[idx] = src[idx];
+            }
+            p->converted = (sg_range){ .ptr = dst, .size = (size_t)p->size * sizeof(uint16_t) };
+        }
+    }
+}
+
+// worker thread: transcode a loaded basisu image, NOTE that sbasisu_transcode()
+// calls sg_query_pixelformat(), which only reads immutable sokol-gfx state
+static void decode_gltf_image(void* user_data) {
+    image_load_t* ld = (image_load_t*) user_data;
+    ld->desc = sbasisu_transcode(ld->data);
+    free((void*)ld->data.ptr);
+    ld->data = (sg_range){0};
+}
+
+// a buffer view's sokol-gfx buffer has been created, update the primitive dependencies
+static void on_buffer_created(int buffer_index) {
+    for (int i = 0; i < state.scene.num_primitives; i++) {
+        primitive_t* prim = &state.scene.primitives[i];
+        for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
+            if (prim->vertex_buffers.buffer[vb_slot] == buffer_index) {
+                prim->pending_buffers--;
+            }
+        }
+        if (prim->index_buffer == buffer_index) {
+            prim->pending_buffers--;
+        }
+        assert(prim->pending_buffers >= 0);
+    }
+}
+
+// a texture's sokol-gfx image has been created, update the primitive dependencies
+static void on_image_created(int image_index) {
+    for (int i = 0; i < state.scene.num_primitives; i++) {
+        primitive_t* prim = &state.scene.primitives[i];
+        const material_t* mat = &state.scene.materials[prim->material];
+        if (mat->is_metallic) {
+            const metallic_images_t* imgs = &mat->metallic.images;
+            prim->pending_images -= (imgs->base_color == image_index) ? 1 : 0;
+            prim->pending_images -= (imgs->metallic_roughness == image_index) ? 1 : 0;
+            prim->pending_images -= (imgs->normal == image_index) ? 1 : 0;
+            prim->pending_images -= (imgs->occlusion == image_index) ? 1 : 0;
+            prim->pending_images -= (imgs->emissive == image_index) ? 1 : 0;
+        }
+        assert(prim->pending_images >= 0);
+    }
+}
+
+// check if a resource of the given size still fits into this frame's upload budget
+static bool upload_budget_available(size_t size) {
+    const size_t uploaded = (size_t)state.loader.stats.upload_bytes;
+    return (uploaded == 0) || ((uploaded + size) <= MAX_UPLOAD_BYTES_PER_FRAME);
+}
+
+static size_t image_desc_size(const sg_image_desc* desc) {
+    size_t size = 0;
+    for (int i = 0; i < desc->num_mipmaps; i++) {
+        size += desc->data.mip_levels[i].size;
+    }
+    return size;
+}
+
+// check for finished decode jobs
+static void poll_decode_jobs(void) {
+    state.loader.stats.jobs_in_flight = 0;
+    for (int i = 0; i < state.loader.num_buffers; i++) {
+        buffer_load_t* ld = &state.loader.buffers[i];
+        if (ld->state == LOAD_STATE_DECODING) {
+            if (jobs_done(&ld->job)) {
+                ld->state = LOAD_STATE_DECODED;
+            } else {
+                state.loader.stats.jobs_in_flight++;
+            }
+        }
+    }
+    for (int i = 0; i < state.loader.num_images; i++) {
+        image_load_t* ld = &state.loader.images[i];
+        if (ld->state == LOAD_STATE_DECODING) {
+            if (jobs_done(&ld->job)) {
+                ld->state = LOAD_STATE_DECODED;
+            } else {
+                state.loader.stats.jobs_in_flight++;
+            }
         }
     }
 }
 
-// create the sokol-gfx image objects associated with a GLTF image
-static void create_sg_image_samplers_for_gltf_image(int gltf_image_index, sg_range data) {
+// create buffers from decoded buffer files, returns false when out of upload budget
+static bool create_pending_buffers(void) {
+    for (int i = 0; i < state.scene.num_buffers; i++) {
+        buffer_creation_params_t* p = &state.creation_params.buffers[i];
+        buffer_load_t* ld = &state.loader.buffers[p->gltf_buffer_index];
+        if (p->created || (ld->state != LOAD_STATE_DECODED)) {
+            continue;
+        }
+        sg_range data = p->converted;
+        if (!p->index_u8) {
+            assert((size_t)(p->offset + p->size) <= ld->data.size);
+            data = (sg_range){ .ptr = (const uint8_t*)ld->data.ptr + p->offset, .size = (size_t)p->size };
+        }
+        if (!upload_budget_available(data.size)) {
+            return false;
+        }
+        sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){ .usage = p->usage, .data = data });
+        state.loader.stats.upload_bytes += (int)data.size;
+        p->created = true;
+        if (p->index_u8) {
+            free((void*)p->converted.ptr);
+            p->converted = (sg_range){0};
+        }
+        on_buffer_created(i);
+        if (--ld->num_pending_views == 0) {
+            free((void*)ld->data.ptr);
+            ld->data = (sg_range){0};
+            ld->state = LOAD_STATE_DONE;
+        }
+    }
+    return true;
+}
+
+// create images, texture views and samplers from transcoded image files
+static bool create_pending_images(void) {
     for (int i = 0; i < state.scene.num_images; i++) {
         image_sampler_creation_params_t* p = &state.creation_params.images[i];
-        if (p->gltf_image_index == gltf_image_index) {
-            state.scene.images[i].img = sbasisu_make_image(data);
-            state.scene.images[i].tex_view = sg_make_view(&(sg_view_desc){
-                .texture = { .image = state.scene.images[i].img },
-            });
-            state.scene.images[i].smp = sg_make_sampler(&(sg_sampler_desc){
-                .min_filter = p->min_filter,
-                .mag_filter = p->mag_filter,
-                .mipmap_filter = p->mipmap_filter,
-            });
+        image_load_t* ld = &state.loader.images[p->gltf_image_index];
+        if (p->created || (ld->state < LOAD_STATE_DECODED)) {
+            continue;
+        }
+        if (ld->state == LOAD_STATE_DECODED) {
+            if (!upload_budget_available(image_desc_size(&ld->desc))) {
+                return false;
+            }
+            ld->img = sg_make_image(&ld->desc);
+            state.loader.stats.upload_bytes += (int)image_desc_size(&ld->desc);
+            sbasisu_free(&ld->desc);
+            ld->desc = (sg_image_desc){0};
+            ld->state = LOAD_STATE_DONE;
+        }
+        state.scene.images[i].img = ld->img;
+        state.scene.images[i].tex_view = sg_make_view(&(sg_view_desc){
+            .texture = { .image = ld->img },
+        });
+        state.scene.images[i].smp = sg_make_sampler(&(sg_sampler_desc){
+            .min_filter = p->min_filter,
+            .mag_filter = p->mag_filter,
+            .mipmap_filter = p->mipmap_filter,
+        });
+        p->created = true;
+        on_image_created(i);
+    }
+    return true;
+}
+
+// frame thread: pick up finished decode jobs and create sokol-gfx resources within the upload budget
+static void update_loader(void) {
+    poll_decode_jobs();
+    state.loader.stats.upload_bytes = 0;
+    if (create_pending_buffers()) {
+        create_pending_images();
+    }
+
+    // update the primitive stats
+    state.loader.stats.drawable_primitives = 0;
+    state.loader.stats.textured_primitives = 0;
+    for (int i = 0; i < state.scene.num_primitives; i++) {
+        const primitive_t* prim = &state.scene.primitives[i];
+        if (prim->pending_buffers == 0) {
+            state.loader.stats.drawable_primitives++;
+            if (prim->pending_images == 0) {
+                state.loader.stats.textured_primitives++;
+            }
         }
     }
 }
@@ -879,7 +1162,10 @@ static sg_primitive_type gltf_to_prim_type(cgltf_primitive_type prim_type) {
 
 static sg_index_type gltf_to_index_type(const cgltf_primitive* prim) {
     if (prim->indices) {
-        if (prim->indices->component_type == cgltf_component_type_r_16u) {
+        // NOTE: 8-bit indices are widened to 16-bit when loaded
+        if ((prim->indices->component_type == cgltf_component_type_r_8u) ||
+            (prim->indices->component_type == cgltf_component_type_r_16u))
+        {
             return SG_INDEXTYPE_UINT16;
         } else {
             return SG_INDEXTYPE_UINT32;
@@ -1040,6 +1326,23 @@ static cgltf_vs_params_t vs_params_for_node(int node_index) {
     };
 }
 
+// an image without a valid index has no view and sampler, and is replaced by a placeholder
+static image_t scene_image(int image_index) {
+    if (image_index == SCENE_INVALID_INDEX) {
+        return (image_t){ 0 };
+    }
+    return state.scene.images[image_index];
+}
+
+// the number of texture slots of a material which wait for an image
+static int num_metallic_images(const metallic_images_t* imgs) {
+    return ((imgs->base_color != SCENE_INVALID_INDEX) ? 1 : 0) +
+           ((imgs->metallic_roughness != SCENE_INVALID_INDEX) ? 1 : 0) +
+           ((imgs->normal != SCENE_INVALID_INDEX) ? 1 : 0) +
+           ((imgs->occlusion != SCENE_INVALID_INDEX) ? 1 : 0) +
+           ((imgs->emissive != SCENE_INVALID_INDEX) ? 1 : 0);
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
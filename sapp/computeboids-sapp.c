@@ -3,11 +3,30 @@
 //
 //  A port of the WebGPU compute-boids sample
 //  (https://webgpu.github.io/webgpu-samples/?sample=computeBoids)
+//
+//  Extended with a uniform grid neighbour search which scales to a
+//  million boids (the original brute force search visits all other
+//  boids and is limited to 10k boids), and a CPU reference implementation
+//  of both searches to check the grid algorithm against brute force.
+//
+//  The grid search only stays fast if the number of boids per cell stays
+//  small. The rule distances are tuned for about 1500 boids, so by default
+//  they are scaled down with the square root of the boid count, which keeps
+//  the number of neighbours per boid (and the look of the flocks) constant.
+//  Without scaling the grid mode is limited to 100k boids, where each boid
+//  already visits about 2000 neighbour candidates.
+//
+//  The self test compares the GPU grid passes against a CPU brute force
+//  step. sokol-gfx has no buffer readback, so the comparison itself runs in
+//  a compute shader, and its result is shown as a bar in the top right
+//  corner (green: passed, red: failed, the length is the maximum error).
 //------------------------------------------------------------------------------
+#include <math.h>
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
 #include "cimgui.h"
 #define SOKOL_IMGUI_IMPL
 #include "sokol_imgui.h"
@@ -17,15 +36,71 @@
 #include "sokol_app_imgui.h"
 #include "computeboids-sapp.glsl.h"
 
-#define MAX_PARTICLES (10000)
+#define MAX_PARTICLES (1000000)
+#define MAX_BRUTE_FORCE_PARTICLES (10000)
+#define MAX_UNSCALED_GRID_PARTICLES (100000)
+#define DISTANCE_REFERENCE_PARTICLES (1500)     // the rule distances are tuned for this many boids
+#define MAX_GRID_DIM (512)
+#define MAX_GRID_CELLS (MAX_GRID_DIM * MAX_GRID_DIM)
+#define SELF_TEST_PARTICLES (10000)
+#define SELF_TEST_TOLERANCE (1e-4f)
+// GPU vs. CPU: distance checks exactly at a rule distance may flip with different float rounding
+#define SELF_TEST_MAX_GPU_FAILED (SELF_TEST_PARTICLES / 1000)
+
+typedef enum {
+    SEARCH_BRUTE_FORCE,
+    SEARCH_GRID,
+    NUM_SEARCH_MODES,
+} search_mode_t;
+
+static const char* search_mode_names[NUM_SEARCH_MODES] = {
+    "Brute Force",
+    "Uniform Grid",
+};
 
 static struct {
-    sim_params_t sim_params;
+    sim_params_t sim_params;        // as set in the UI, see effective_sim_params()
+    search_mode_t search_mode;
+    bool scale_distances;
     struct {
         sg_buffer buf[2];
         sg_view view[2];
         sg_pipeline pip;
     } compute;
+    struct {
+        sg_buffer cell_buf;
+        sg_buffer prt_cell_buf;
+        sg_buffer sorted_buf;
+        sg_view cell_view;
+        sg_view prt_cell_view;
+        sg_view sorted_view;
+        sg_pipeline clear_pip;
+        sg_pipeline count_pip;
+        sg_pipeline scan_pip;
+        sg_pipeline scatter_pip;
+        sg_pipeline simulate_pip;
+    } grid;
+    struct {
+        bool valid;
+        bool passed;
+        float max_error;
+        double brute_force_ms;
+        double grid_ms;
+        bool gpu_pending;           // GPU passes run in the next frame
+        bool gpu_valid;
+        sim_params_t params;
+        self_test_params_t test_params;
+        sg_buffer in_buf;
+        sg_buffer out_buf;
+        sg_buffer ref_buf;
+        sg_buffer result_buf;
+        sg_view in_view;
+        sg_view out_view;
+        sg_view ref_view;
+        sg_view result_view;
+        sg_pipeline compare_pip;
+        sg_pipeline indicator_pip;
+    } self_test;
     struct {
         sg_pipeline pip;
         sg_pass_action pass_action;
@@ -41,6 +116,8 @@ static struct {
         .rule3_scale = 0.005f,
         .num_particles = 1500,
     },
+    .search_mode = SEARCH_GRID,
+    .scale_distances = true,
     .display = {
         .pass_action = {
             .colors[0] = {
@@ -51,6 +128,7 @@ static struct {
     }
 };
 static void draw_ui(void);
+static void run_self_test(void);
 
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
@@ -70,6 +148,7 @@ static void init(void) {
         .environment = sglue_environment(),
         .logger.func = slog_func,
     });
+    stm_setup();
     sappimgui_setup();
     sgimgui_setup(&(sgimgui_desc_t){0});
     simgui_setup(&(simgui_desc_t){
@@ -110,6 +189,109 @@ static void init(void) {
         .label = "compute-pipeline",
     });
 
+    // uniform grid storage buffers, these are written by compute shaders and don't need initial content
+    state.grid.cell_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .size = MAX_GRID_CELLS * sizeof(grid_cell_t),
+        .label = "grid-cell-buffer",
+    });
+    state.grid.prt_cell_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .size = MAX_PARTICLES * sizeof(particle_cell_t),
+        .label = "grid-particle-cell-buffer",
+    });
+    state.grid.sorted_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .size = MAX_PARTICLES * sizeof(particle_t),
+        .label = "grid-sorted-particle-buffer",
+    });
+    state.grid.cell_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.grid.cell_buf },
+        .label = "grid-cell-view",
+    });
+    state.grid.prt_cell_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.grid.prt_cell_buf },
+        .label = "grid-particle-cell-view",
+    });
+    state.grid.sorted_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.grid.sorted_buf },
+        .label = "grid-sorted-particle-view",
+    });
+
+    // uniform grid compute pipelines
+    state.grid.clear_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(grid_clear_shader_desc(sg_query_backend())),
+        .label = "grid-clear-pipeline",
+    });
+    state.grid.count_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(grid_count_shader_desc(sg_query_backend())),
+        .label = "grid-count-pipeline",
+    });
+    state.grid.scan_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(grid_scan_shader_desc(sg_query_backend())),
+        .label = "grid-scan-pipeline",
+    });
+    state.grid.scatter_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(grid_scatter_shader_desc(sg_query_backend())),
+        .label = "grid-scatter-pipeline",
+    });
+    state.grid.simulate_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(grid_simulate_shader_desc(sg_query_backend())),
+        .label = "grid-simulate-pipeline",
+    });
+
+    // GPU self test buffers, the input and CPU reference are uploaded when the test is started
+    state.self_test.in_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = { .storage_buffer = true, .dynamic_update = true },
+        .size = SELF_TEST_PARTICLES * sizeof(particle_t),
+        .label = "self-test-input-buffer",
+    });
+    state.self_test.out_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .size = SELF_TEST_PARTICLES * sizeof(particle_t),
+        .label = "self-test-output-buffer",
+    });
+    state.self_test.ref_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = { .storage_buffer = true, .dynamic_update = true },
+        .size = SELF_TEST_PARTICLES * sizeof(particle_t),
+        .label = "self-test-reference-buffer",
+    });
+    state.self_test.result_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = { .storage_buffer = true, .dynamic_update = true },
+        .size = sizeof(self_test_result_t),
+        .label = "self-test-result-buffer",
+    });
+    state.self_test.in_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.self_test.in_buf },
+        .label = "self-test-input-view",
+    });
+    state.self_test.out_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.self_test.out_buf },
+        .label = "self-test-output-view",
+    });
+    state.self_test.ref_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.self_test.ref_buf },
+        .label = "self-test-reference-view",
+    });
+    state.self_test.result_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.self_test.result_buf },
+        .label = "self-test-result-view",
+    });
+    state.self_test.compare_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(self_test_compare_shader_desc(sg_query_backend())),
+        .label = "self-test-compare-pipeline",
+    });
+    state.self_test.indicator_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(self_test_indicator_shader_desc(sg_query_backend())),
+        .label = "self-test-indicator-pipeline",
+    });
+
     // a render pipeline and shader, note that vertices for the boids will be
     // synthesized by the vertex shader, so there's no separate vertex buffer,
     // we also don't need any non-default render state since the boids are just 2D triangles
@@ -119,8 +301,101 @@ static void init(void) {
     });
 }
 
+// update the grid resolution from the rule distances, the cell size must be at least
+// the largest rule distance so that the 3x3 neighbour cells contain all neighbours
+// (the small margin avoids missing neighbours due to rounding at cell borders)
+static void update_grid_params(sim_params_t* params) {
+    float max_dist = params->rule1_distance;
+    if (params->rule2_distance > max_dist) { max_dist = params->rule2_distance; }
+    if (params->rule3_distance > max_dist) { max_dist = params->rule3_distance; }
+    int grid_dim = MAX_GRID_DIM;
+    if (max_dist > 0.0f) {
+        grid_dim = (int)floorf(2.0f / (max_dist * 1.01f));
+        if (grid_dim < 1) { grid_dim = 1; }
+        else if (grid_dim > MAX_GRID_DIM) { grid_dim = MAX_GRID_DIM; }
+    }
+    params->grid_dim = grid_dim;
+    params->num_cells = grid_dim * grid_dim;
+    params->cell_size = 2.0f / (float)grid_dim;
+}
+
+// the simulation parameters for the current boid count, optionally with rule distances
+// which shrink with the boid count, so that the number of neighbours per boid stays
+// roughly the same as with DISTANCE_REFERENCE_PARTICLES boids
+static sim_params_t effective_sim_params(void) {
+    sim_params_t params = state.sim_params;
+    if (state.scale_distances && (params.num_particles > DISTANCE_REFERENCE_PARTICLES)) {
+        const float scale = sqrtf((float)DISTANCE_REFERENCE_PARTICLES / (float)params.num_particles);
+        params.rule1_distance *= scale;
+        params.rule2_distance *= scale;
+        params.rule3_distance *= scale;
+    }
+    update_grid_params(&params);
+    return params;
+}
+
+// the grid neighbour search dispatches, the grid buffers are shared between the simulation and the self test
+static void dispatch_grid_step(const sim_params_t* params, sg_view in_view, sg_view out_view) {
+    const int num_particles = params->num_particles;
+
+    // clear cell counters
+    sg_apply_pipeline(state.grid.clear_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_clear_ssbo_cells] = state.grid.cell_view,
+    });
+    sg_apply_uniforms(UB_sim_params, &(sg_range){ params, sizeof(sim_params_t) });
+    sg_dispatch((params->num_cells+63)/64, 1, 1);
+
+    // compute particle cells and count particles per cell
+    sg_apply_pipeline(state.grid.count_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_count_ssbo_in] = in_view,
+            [VIEW_count_ssbo_cells] = state.grid.cell_view,
+            [VIEW_count_ssbo_prt_cells] = state.grid.prt_cell_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &(sg_range){ params, sizeof(sim_params_t) });
+    sg_dispatch((num_particles+63)/64, 1, 1);
+
+    // prefix sum over cell counters, runs in a single workgroup
+    sg_apply_pipeline(state.grid.scan_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_scan_ssbo_cells] = state.grid.cell_view,
+    });
+    sg_apply_uniforms(UB_sim_params, &(sg_range){ params, sizeof(sim_params_t) });
+    sg_dispatch(1, 1, 1);
+
+    // counting-sort particles by cell
+    sg_apply_pipeline(state.grid.scatter_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_scatter_ssbo_in] = in_view,
+            [VIEW_scatter_ssbo_cells] = state.grid.cell_view,
+            [VIEW_scatter_ssbo_prt_cells] = state.grid.prt_cell_view,
+            [VIEW_scatter_ssbo_sorted] = state.grid.sorted_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &(sg_range){ params, sizeof(sim_params_t) });
+    sg_dispatch((num_particles+63)/64, 1, 1);
+
+    // simulation step which only visits adjacent cells
+    sg_apply_pipeline(state.grid.simulate_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_sim_ssbo_sorted] = state.grid.sorted_view,
+            [VIEW_sim_ssbo_cells] = state.grid.cell_view,
+            [VIEW_sim_ssbo_out] = out_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &(sg_range){ params, sizeof(sim_params_t) });
+    sg_dispatch((num_particles+63)/64, 1, 1);
+}
+
 static void frame(void) {
     draw_ui();
+    const sim_params_t params = effective_sim_params();
+    const int num_particles = params.num_particles;
 
     // input- and output- storage-buffers for this frame
     const sg_view in_view = state.compute.view[sapp_frame_count() & 1];
@@ -129,15 +404,39 @@ static void frame(void) {
     // compute pass to update boid positions and velocities, this works with buffer-ping-ponging,
     // since the compute shader needs random access on the input parameters
     sg_begin_pass(&(sg_pass){ .compute = true, .label = "compute-pass" });
-    sg_apply_pipeline(state.compute.pip);
-    sg_apply_bindings(&(sg_bindings){
-        .views = {
-            [VIEW_cs_ssbo_in] = in_view,
-            [VIEW_cs_ssbo_out] = out_view,
-        },
-    });
-    sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
-    sg_dispatch((state.sim_params.num_particles+63)/64, 1, 1);
+    if (state.search_mode == SEARCH_BRUTE_FORCE) {
+        sg_apply_pipeline(state.compute.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views = {
+                [VIEW_cs_ssbo_in] = in_view,
+                [VIEW_cs_ssbo_out] = out_view,
+            },
+        });
+        sg_apply_uniforms(UB_sim_params, &SG_RANGE(params));
+        sg_dispatch((num_particles+63)/64, 1, 1);
+    } else {
+        dispatch_grid_step(&params, in_view, out_view);
+    }
+    if (state.self_test.gpu_pending) {
+        // run the grid passes on the self test boids, and compare the result against
+        // the CPU brute force reference (this reuses the grid buffers of the simulation)
+        dispatch_grid_step(&state.self_test.params, state.self_test.in_view, state.self_test.out_view);
+        sg_apply_pipeline(state.self_test.compare_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views = {
+                [VIEW_test_ssbo_out] = state.self_test.out_view,
+                [VIEW_test_ssbo_ref] = state.self_test.ref_view,
+                [VIEW_test_ssbo_cells] = state.grid.cell_view,
+                [VIEW_test_ssbo_prt_cells] = state.grid.prt_cell_view,
+                [VIEW_test_ssbo_result] = state.self_test.result_view,
+            },
+        });
+        sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.self_test.params));
+        sg_apply_uniforms(UB_self_test_params, &SG_RANGE(state.self_test.test_params));
+        sg_dispatch((SELF_TEST_PARTICLES+63)/64, 1, 1);
+        state.self_test.gpu_pending = false;
+        state.self_test.gpu_valid = true;
+    }
     sg_end_pass();
 
     // render pass for rendering the boids, instanced by the current output storage buffer
@@ -149,7 +448,15 @@ static void frame(void) {
     sg_apply_bindings(&(sg_bindings){
         .views[VIEW_vs_ssbo] = out_view,
     });
-    sg_draw(0, 3, state.sim_params.num_particles);
+    sg_draw(0, 3, num_particles);
+    if (state.self_test.gpu_valid) {
+        sg_apply_pipeline(state.self_test.indicator_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_ind_ssbo_result] = state.self_test.result_view,
+        });
+        sg_apply_uniforms(UB_self_test_params, &SG_RANGE(state.self_test.test_params));
+        sg_draw(0, 6, 1);
+    }
     simgui_render();
     sg_end_pass();
     sg_commit();
@@ -196,13 +503,238 @@ static void draw_ui(void) {
         igSliderFloat("Rule1 Scale", &state.sim_params.rule1_scale, 0.0f, 0.1f);
         igSliderFloat("Rule2 Scale", &state.sim_params.rule2_scale, 0.0f, 0.1f);
         igSliderFloat("Rule3 Scale", &state.sim_params.rule3_scale, 0.0f, 0.1f);
-        igSliderInt("Num Boids", &state.sim_params.num_particles, 0, MAX_PARTICLES);
+        igComboChar("Neighbour Search", (int*)&state.search_mode, search_mode_names, NUM_SEARCH_MODES);
+        igCheckbox("Scale Distances With Boid Count", &state.scale_distances);
+        int max_particles = MAX_PARTICLES;
+        if (state.search_mode == SEARCH_BRUTE_FORCE) {
+            max_particles = MAX_BRUTE_FORCE_PARTICLES;
+        } else if (!state.scale_distances) {
+            max_particles = MAX_UNSCALED_GRID_PARTICLES;
+        }
+        if (state.sim_params.num_particles > max_particles) {
+            state.sim_params.num_particles = max_particles;
+        }
+        igSliderIntEx("Num Boids", &state.sim_params.num_particles, 0, max_particles, "%d", ImGuiSliderFlags_Logarithmic);
+        if (state.search_mode == SEARCH_GRID) {
+            const sim_params_t params = effective_sim_params();
+            igText("Grid: %dx%d cells", params.grid_dim, params.grid_dim);
+            igText("Neighbour candidates per boid: ~%.0f", 9.0f * (float)params.num_particles / (float)params.num_cells);
+        }
+        igSeparator();
+        if (igButton("Run Self Test")) {
+            run_self_test();
+        }
+        if (state.self_test.valid) {
+            igText("%s (%d boids, max error: %.2e)",
+                state.self_test.passed ? "PASSED" : "FAILED",
+                SELF_TEST_PARTICLES,
+                state.self_test.max_error);
+            igText("CPU brute force: %.2f ms", state.self_test.brute_force_ms);
+            igText("CPU uniform grid: %.2f ms", state.self_test.grid_ms);
+        }
+        if (state.self_test.gpu_valid) {
+            igText("GPU uniform grid: see bar in the top right corner");
+            igText("(green: passed, length: max error from 1e-8 to 1)");
+        }
     }
     igEnd();
     sgimgui_draw();
     sappimgui_draw();
 }
 
+//=== CPU reference implementation, mirrors the compute shaders ==============
+
+typedef struct {
+    float c_mass[2];
+    float c_vel[2];
+    float col_vel[2];
+    int c_mass_count;
+    int c_vel_count;
+} rule_sums_t;
+
+static void cpu_rules_accumulate(const sim_params_t* params, rule_sums_t* sums, const particle_t* self, const particle_t* other) {
+    const float dx = other->pos[0] - self->pos[0];
+    const float dy = other->pos[1] - self->pos[1];
+    const float dist = sqrtf(dx * dx + dy * dy);
+    if (dist < params->rule1_distance) {
+        sums->c_mass[0] += other->pos[0];
+        sums->c_mass[1] += other->pos[1];
+        sums->c_mass_count++;
+    }
+    if (dist < params->rule2_distance) {
+        sums->col_vel[0] -= dx;
+        sums->col_vel[1] -= dy;
+    }
+    if (dist < params->rule3_distance) {
+        sums->c_vel[0] += other->vel[0];
+        sums->c_vel[1] += other->vel[1];
+        sums->c_vel_count++;
+    }
+}
+
+static float cpu_wrap(float v) {
+    if (v < -1.0f) { return 1.0f; }
+    else if (v > 1.0f) { return -1.0f; }
+    else { return v; }
+}
+
+static particle_t cpu_rules_integrate(const sim_params_t* params, const rule_sums_t* sums, const particle_t* self) {
+    float c_mass[2] = { sums->c_mass[0], sums->c_mass[1] };
+    float c_vel[2] = { sums->c_vel[0], sums->c_vel[1] };
+    if (sums->c_mass_count > 0) {
+        c_mass[0] = c_mass[0] / (float)sums->c_mass_count - self->pos[0];
+        c_mass[1] = c_mass[1] / (float)sums->c_mass_count - self->pos[1];
+    }
+    if (sums->c_vel_count > 0) {
+        c_vel[0] = c_vel[0] / (float)sums->c_vel_count;
+        c_vel[1] = c_vel[1] / (float)sums->c_vel_count;
+    }
+    float vel[2];
+    for (int i = 0; i < 2; i++) {
+        vel[i] = self->vel[i] + c_mass[i] * params->rule1_scale + sums->col_vel[i] * params->rule2_scale + c_vel[i] * params->rule3_scale;
+    }
+    // clamp velocity
+    const float len = sqrtf(vel[0] * vel[0] + vel[1] * vel[1]);
+    if (len > 0.1f) {
+        vel[0] *= 0.1f / len;
+        vel[1] *= 0.1f / len;
+    }
+    return (particle_t){
+        .pos = { cpu_wrap(self->pos[0] + vel[0] * params->dt), cpu_wrap(self->pos[1] + vel[1] * params->dt) },
+        .vel = { vel[0], vel[1] },
+    };
+}
+
+static void cpu_step_brute_force(const sim_params_t* params, const particle_t* prt_in, particle_t* prt_out) {
+    const int num = params->num_particles;
+    for (int idx = 0; idx < num; idx++) {
+        rule_sums_t sums = {0};
+        for (int i = 0; i < num; i++) {
+            if (i != idx) {
+                cpu_rules_accumulate(params, &sums, &prt_in[idx], &prt_in[i]);
+            }
+        }
+        prt_out[idx] = cpu_rules_integrate(params, &sums, &prt_in[idx]);
+    }
+}
+
+static int cpu_grid_coord(const sim_params_t* params, float v) {
+    int c = (int)((v + 1.0f) / params->cell_size);
+    if (c < 0) { c = 0; }
+    else if (c > (params->grid_dim - 1)) { c = params->grid_dim - 1; }
+    return c;
+}
+
+// same count / scan / scatter / simulate steps as the grid compute shaders,
+// out_index maps sorted output particles back to their input index
+static void cpu_step_grid(const sim_params_t* params, const particle_t* prt_in, particle_t* prt_out, int* out_index) {
+    const int num = params->num_particles;
+    grid_cell_t* cells = calloc((size_t)params->num_cells, sizeof(grid_cell_t));
+    particle_cell_t* prt_cells = calloc((size_t)num, sizeof(particle_cell_t));
+    particle_t* sorted = calloc((size_t)num, sizeof(particle_t));
+    for (int idx = 0; idx < num; idx++) {
+        const int cell = cpu_grid_coord(params, prt_in[idx].pos[1]) * params->grid_dim + cpu_grid_coord(params, prt_in[idx].pos[0]);
+        prt_cells[idx].cell = (uint32_t)cell;
+        prt_cells[idx].rank = cells[cell].count++;
+    }
+    uint32_t start = 0;
+    for (int i = 0; i < params->num_cells; i++) {
+        cells[i].start = start;
+        start += cells[i].count;
+    }
+    for (int idx = 0; idx < num; idx++) {
+        const uint32_t dst = cells[prt_cells[idx].cell].start + prt_cells[idx].rank;
+        sorted[dst] = prt_in[idx];
+        out_index[dst] = idx;
+    }
+    for (int idx = 0; idx < num; idx++) {
+        const int cx = cpu_grid_coord(params, sorted[idx].pos[0]);
+        const int cy = cpu_grid_coord(params, sorted[idx].pos[1]);
+        const int min_x = (cx > 0) ? cx - 1 : 0;
+        const int min_y = (cy > 0) ? cy - 1 : 0;
+        const int max_x = (cx < (params->grid_dim - 1)) ? cx + 1 : cx;
+        const int max_y = (cy < (params->grid_dim - 1)) ? cy + 1 : cy;
+        rule_sums_t sums = {0};
+        for (int y = min_y; y <= max_y; y++) {
+            for (int x = min_x; x <= max_x; x++) {
+                const grid_cell_t* cell = &cells[y * params->grid_dim + x];
+                for (uint32_t i = cell->start; i < (cell->start + cell->count); i++) {
+                    if (i != (uint32_t)idx) {
+                        cpu_rules_accumulate(params, &sums, &sorted[idx], &sorted[i]);
+                    }
+                }
+            }
+        }
+        prt_out[idx] = cpu_rules_integrate(params, &sums, &sorted[idx]);
+    }
+    free(sorted);
+    free(prt_cells);
+    free(cells);
+}
+
+// run one simulation step with both CPU implementations on the same random
+// boids and with the current simulation parameters, and compare the results
+// (the neighbour sums are accumulated in a different order, so the results
+// are only expected to match within a small tolerance), the same boids and
+// the brute force result are uploaded for the GPU comparison in the next frame
+static void run_self_test(void) {
+    sim_params_t params = effective_sim_params();
+    params.num_particles = SELF_TEST_PARTICLES;
+    update_grid_params(&params);
+
+    const size_t prt_size = SELF_TEST_PARTICLES * sizeof(particle_t);
+    particle_t* prt_in = malloc(prt_size);
+    particle_t* prt_ref = malloc(prt_size);
+    particle_t* prt_grid = malloc(prt_size);
+    int* grid_index = malloc(SELF_TEST_PARTICLES * sizeof(int));
+    for (int i = 0; i < SELF_TEST_PARTICLES; i++) {
+        prt_in[i] = (particle_t){
+            .pos = { rnd(), rnd() },
+            .vel = { rnd() * 0.1f, rnd() * 0.1f },
+        };
+    }
+
+    uint64_t t = stm_now();
+    cpu_step_brute_force(&params, prt_in, prt_ref);
+    state.self_test.brute_force_ms = stm_ms(stm_since(t));
+    t = stm_now();
+    cpu_step_grid(&params, prt_in, prt_grid, grid_index);
+    state.self_test.grid_ms = stm_ms(stm_since(t));
+
+    float max_error = 0.0f;
+    for (int i = 0; i < SELF_TEST_PARTICLES; i++) {
+        const particle_t* ref = &prt_ref[grid_index[i]];
+        const particle_t* res = &prt_grid[i];
+        for (int k = 0; k < 2; k++) {
+            // positions which wrapped around the boundary in only one result are counted as a full error
+            const float pos_err = fabsf(ref->pos[k] - res->pos[k]);
+            const float vel_err = fabsf(ref->vel[k] - res->vel[k]);
+            if (pos_err > max_error) { max_error = pos_err; }
+            if (vel_err > max_error) { max_error = vel_err; }
+        }
+    }
+    state.self_test.valid = true;
+    state.self_test.max_error = max_error;
+    state.self_test.passed = max_error <= SELF_TEST_TOLERANCE;
+
+    // the GPU result is compared in input order, the CPU brute force result is already in input order
+    sg_update_buffer(state.self_test.in_buf, &(sg_range){ prt_in, prt_size });
+    sg_update_buffer(state.self_test.ref_buf, &(sg_range){ prt_ref, prt_size });
+    const self_test_result_t zero_result = {0};
+    sg_update_buffer(state.self_test.result_buf, &SG_RANGE(zero_result));
+    state.self_test.params = params;
+    state.self_test.test_params = (self_test_params_t){
+        .tolerance = SELF_TEST_TOLERANCE,
+        .max_failed = SELF_TEST_MAX_GPU_FAILED,
+    };
+    state.self_test.gpu_pending = true;
+    state.self_test.gpu_valid = false;
+    free(grid_index);
+    free(prt_grid);
+    free(prt_ref);
+    free(prt_in);
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc; (void)argv;
     return (sapp_desc){
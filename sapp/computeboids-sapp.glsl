@@ -6,15 +6,35 @@ struct particle {
     vec2 pos;
     vec2 vel;
 };
-@end
 
-// compute shader for updating boid positions and velocities
-@cs cs
-@include_block common
+// a uniform grid cell, number of particles in the cell, and start index into the sorted particle buffer
+struct grid_cell {
+    uint count;
+    uint start;
+};
 
-layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
-layout(binding=1) buffer cs_ssbo_out { particle prt_out[]; };
+// the grid cell of a particle, and its rank inside the cell
+struct particle_cell {
+    uint cell;
+    uint rank;
+};
+
+// result of the GPU self test, the maximum error is stored as float bits
+// (the bits of positive floats sort like the floats themselves)
+struct self_test_result {
+    uint max_error_bits;
+    uint num_failed;
+};
+@end
 
+@block self_test_params
+layout(binding=1) uniform self_test_params {
+    float tolerance;
+    float max_failed;
+};
+@end
+
+@block sim_params
 layout(binding=0) uniform sim_params {
     float dt;
     float rule1_distance;
@@ -24,7 +44,78 @@ layout(binding=0) uniform sim_params {
     float rule2_scale;
     float rule3_scale;
     int num_particles;
+    int grid_dim;
+    int num_cells;
+    float cell_size;
 };
+@end
+
+// boid rules, shared between the brute force and grid neighbour search
+@block rules
+struct rule_sums {
+    vec2 c_mass;
+    vec2 c_vel;
+    vec2 col_vel;
+    int c_mass_count;
+    int c_vel_count;
+};
+
+void rules_accumulate(inout rule_sums sums, vec2 v_pos, vec2 pos, vec2 vel) {
+    const float dist = distance(pos, v_pos);
+    if (dist < rule1_distance) {
+        sums.c_mass += pos;
+        sums.c_mass_count++;
+    }
+    if (dist < rule2_distance) {
+        sums.col_vel -= (pos - v_pos);
+    }
+    if (dist < rule3_distance) {
+        sums.c_vel += vel;
+        sums.c_vel_count++;
+    }
+}
+
+particle rules_integrate(rule_sums sums, vec2 v_pos, vec2 v_vel) {
+    vec2 c_mass = sums.c_mass;
+    vec2 c_vel = sums.c_vel;
+    if (sums.c_mass_count > 0) {
+        c_mass = c_mass / sums.c_mass_count - v_pos;
+    }
+    if (sums.c_vel_count > 0) {
+        c_vel = c_vel / sums.c_vel_count;
+    }
+    v_vel += c_mass * rule1_scale + sums.col_vel * rule2_scale + c_vel * rule3_scale;
+
+    // clamp velocity for a more pleasing simulation
+    v_vel = normalize(v_vel) * clamp(length(v_vel), 0, 0.1);
+
+    // kinematic update
+    v_pos += v_vel * dt;
+    // wrap around boundary
+    if (v_pos.x < -1.0) { v_pos.x = 1.0; }
+    else if (v_pos.x > 1.0) { v_pos.x = -1.0; }
+    if (v_pos.y < -1.0) { v_pos.y = 1.0; }
+    else if (v_pos.y > 1.0) { v_pos.y = -1.0; }
+
+    particle p;
+    p.pos = v_pos;
+    p.vel = v_vel;
+    return p;
+}
+
+ivec2 grid_coord(vec2 pos) {
+    return clamp(ivec2((pos + 1.0) / cell_size), ivec2(0, 0), ivec2(grid_dim - 1, grid_dim - 1));
+}
+@end
+
+// compute shader for updating boid positions and velocities, brute force O(n^2) version
+@cs cs
+@include_block common
+@include_block sim_params
+@include_block rules
+
+layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
+layout(binding=1) buffer cs_ssbo_out { particle prt_out[]; };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
 void main() {
@@ -33,57 +124,230 @@ void main() {
         return;
     }
 
-    vec2 v_pos = prt_in[idx].pos;
-    vec2 v_vel = prt_in[idx].vel;
-    vec2 c_mass = vec2(0, 0);
-    vec2 c_vel = vec2(0, 0);
-    vec2 col_vel = vec2(0, 0);
-    int c_mass_count = 0;
-    int c_vel_count = 0;
+    const vec2 v_pos = prt_in[idx].pos;
+    const vec2 v_vel = prt_in[idx].vel;
+    rule_sums sums = rule_sums(vec2(0, 0), vec2(0, 0), vec2(0, 0), 0, 0);
     for (int i = 0; i < num_particles; i++) {
         if (i == idx) {
             continue;
         }
-        const vec2 pos = prt_in[i].pos;
-        const vec2 vel = prt_in[i].vel;
-        const float dist = distance(pos, v_pos);
-        if (dist < rule1_distance) {
-            c_mass += pos;
-            c_mass_count++;
-        }
-        if (dist < rule2_distance) {
-            col_vel -= (pos - v_pos);
-        }
-        if (dist < rule3_distance) {
-            c_vel += vel;
-            c_vel_count++;
+        rules_accumulate(sums, v_pos, prt_in[i].pos, prt_in[i].vel);
+    }
+    prt_out[idx] = rules_integrate(sums, v_pos, v_vel);
+}
+@end
+
+@program compute cs
+
+// The uniform grid neighbour search runs as a sequence of dispatches:
+//
+// - clear: reset the per-cell particle counters
+// - count: compute each particle's grid cell, and its rank inside the
+//   cell by atomically incrementing the cell's counter
+// - scan: exclusive prefix sum over the cell counters to get the start
+//   index of each cell in the sorted particle buffer
+// - scatter: counting-sort particles into the sorted particle buffer
+// - simulate: like the brute force shader, but only visits particles in the
+//   3x3 adjacent cells (the cell size is at least the largest rule distance)
+//
+@cs cs_grid_clear
+@include_block common
+@include_block sim_params
+
+layout(binding=0) buffer clear_ssbo_cells { grid_cell clear_cells[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_cells) {
+        return;
+    }
+    clear_cells[idx].count = 0;
+    clear_cells[idx].start = 0;
+}
+@end
+
+@cs cs_grid_count
+@include_block common
+@include_block sim_params
+@include_block rules
+
+layout(binding=0) readonly buffer count_ssbo_in { particle count_prt_in[]; };
+layout(binding=1) buffer count_ssbo_cells { grid_cell count_cells[]; };
+layout(binding=2) buffer count_ssbo_prt_cells { particle_cell count_prt_cells[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
+    }
+    const ivec2 coord = grid_coord(count_prt_in[idx].pos);
+    const uint cell = uint(coord.y * grid_dim + coord.x);
+    count_prt_cells[idx].cell = cell;
+    count_prt_cells[idx].rank = atomicAdd(count_cells[cell].count, 1u);
+}
+@end
+
+// a single workgroup, each invocation scans a contiguous range of cells
+@cs cs_grid_scan
+@include_block common
+@include_block sim_params
+
+layout(binding=0) buffer scan_ssbo_cells { grid_cell scan_cells[]; };
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+
+shared uint partial_sums[256];
+
+void main() {
+    const uint tid = gl_LocalInvocationID.x;
+    const uint cells_per_invocation = (uint(num_cells) + 255) / 256;
+    const uint begin = min(tid * cells_per_invocation, uint(num_cells));
+    const uint end = min(begin + cells_per_invocation, uint(num_cells));
+    uint sum = 0;
+    for (uint i = begin; i < end; i++) {
+        sum += scan_cells[i].count;
+    }
+    partial_sums[tid] = sum;
+    barrier();
+    if (tid == 0) {
+        uint acc = 0;
+        for (uint i = 0; i < 256; i++) {
+            const uint val = partial_sums[i];
+            partial_sums[i] = acc;
+            acc += val;
         }
     }
-    if (c_mass_count > 0) {
-        c_mass = c_mass / c_mass_count - v_pos;
+    barrier();
+    uint start = partial_sums[tid];
+    for (uint i = begin; i < end; i++) {
+        scan_cells[i].start = start;
+        start += scan_cells[i].count;
     }
-    if (c_vel_count > 0) {
-        c_vel = c_vel / c_vel_count;
+}
+@end
+
+@cs cs_grid_scatter
+@include_block common
+@include_block sim_params
+
+layout(binding=0) readonly buffer scatter_ssbo_in { particle scatter_prt_in[]; };
+layout(binding=1) readonly buffer scatter_ssbo_cells { grid_cell scatter_cells[]; };
+layout(binding=2) readonly buffer scatter_ssbo_prt_cells { particle_cell scatter_prt_cells[]; };
+layout(binding=3) buffer scatter_ssbo_sorted { particle scatter_prt_sorted[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
     }
-    v_vel += c_mass * rule1_scale + col_vel * rule2_scale + c_vel * rule3_scale;
+    const particle_cell pc = scatter_prt_cells[idx];
+    scatter_prt_sorted[scatter_cells[pc.cell].start + pc.rank] = scatter_prt_in[idx];
+}
+@end
 
-    // clamp velocity for a more pleasing simulation
-    v_vel = normalize(v_vel) * clamp(length(v_vel), 0, 0.1);
+@cs cs_grid_simulate
+@include_block common
+@include_block sim_params
+@include_block rules
 
-    // kinematic update
-    v_pos += v_vel * dt;
-    // wrap around boundary
-    if (v_pos.x < -1.0) { v_pos.x = 1.0; }
-    else if (v_pos.x > 1.0) { v_pos.x = -1.0; }
-    if (v_pos.y < -1.0) { v_pos.y = 1.0; }
-    else if (v_pos.y > 1.0) { v_pos.y = -1.0; }
+layout(binding=0) readonly buffer sim_ssbo_sorted { particle sim_prt_sorted[]; };
+layout(binding=1) readonly buffer sim_ssbo_cells { grid_cell sim_cells[]; };
+layout(binding=2) buffer sim_ssbo_out { particle sim_prt_out[]; };
 
-    prt_out[idx].pos = v_pos;
-    prt_out[idx].vel = v_vel;
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
+    }
+    const vec2 v_pos = sim_prt_sorted[idx].pos;
+    const vec2 v_vel = sim_prt_sorted[idx].vel;
+    const ivec2 coord = grid_coord(v_pos);
+    const ivec2 min_coord = max(coord - 1, ivec2(0, 0));
+    const ivec2 max_coord = min(coord + 1, ivec2(grid_dim - 1, grid_dim - 1));
+    rule_sums sums = rule_sums(vec2(0, 0), vec2(0, 0), vec2(0, 0), 0, 0);
+    for (int y = min_coord.y; y <= max_coord.y; y++) {
+        for (int x = min_coord.x; x <= max_coord.x; x++) {
+            const grid_cell cell = sim_cells[y * grid_dim + x];
+            const uint end = cell.start + cell.count;
+            for (uint i = cell.start; i < end; i++) {
+                if (i == idx) {
+                    continue;
+                }
+                rules_accumulate(sums, v_pos, sim_prt_sorted[i].pos, sim_prt_sorted[i].vel);
+            }
+        }
+    }
+    // the output stays sorted by grid cell, this improves memory locality in the next frame
+    sim_prt_out[idx] = rules_integrate(sums, v_pos, v_vel);
 }
 @end
 
-@program compute cs
+@program grid_clear cs_grid_clear
+@program grid_count cs_grid_count
+@program grid_scan cs_grid_scan
+@program grid_scatter cs_grid_scatter
+@program grid_simulate cs_grid_simulate
+
+// compare the grid simulation result against the CPU brute force reference,
+// the grid output is sorted by cell, the particle cells and cell starts of
+// the grid passes map each input particle to its sorted output position
+@cs cs_self_test_compare
+@include_block common
+@include_block sim_params
+@include_block self_test_params
+
+layout(binding=0) readonly buffer test_ssbo_out { particle test_prt_out[]; };
+layout(binding=1) readonly buffer test_ssbo_ref { particle test_prt_ref[]; };
+layout(binding=2) readonly buffer test_ssbo_cells { grid_cell test_cells[]; };
+layout(binding=3) readonly buffer test_ssbo_prt_cells { particle_cell test_prt_cells[]; };
+layout(binding=4) buffer test_ssbo_result { self_test_result test_result[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
+    }
+    const particle_cell pc = test_prt_cells[idx];
+    const particle res = test_prt_out[test_cells[pc.cell].start + pc.rank];
+    const particle ref = test_prt_ref[idx];
+    const vec2 pos_err = abs(res.pos - ref.pos);
+    const vec2 vel_err = abs(res.vel - ref.vel);
+    const float err = max(max(pos_err.x, pos_err.y), max(vel_err.x, vel_err.y));
+    atomicMax(test_result[0].max_error_bits, floatBitsToUint(err));
+    if (!(err <= tolerance)) {
+        atomicAdd(test_result[0].num_failed, 1u);
+    }
+}
+@end
+
+@program self_test_compare cs_self_test_compare
+
+// a bar in the top right corner which shows the self test result, green if passed,
+// the length is the maximum error on a log scale from 1e-8 to 1
+@vs vs_self_test_indicator
+@include_block common
+@include_block self_test_params
+
+layout(binding=0) readonly buffer ind_ssbo_result { self_test_result ind_result[]; };
+
+const vec2 corners[6] = { vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(0, 1) };
+
+out vec4 color;
+
+void main() {
+    const self_test_result result = ind_result[0];
+    const float max_error = max(uintBitsToFloat(result.max_error_bits), 1e-30);
+    const float len = clamp((log2(max_error) / log2(10.0) + 8.0) / 8.0, 0.02, 1.0);
+    const vec2 corner = corners[gl_VertexIndex];
+    gl_Position = vec4(0.5 + corner.x * 0.45 * len, 0.9 + corner.y * 0.05, 0, 1);
+    color = (float(result.num_failed) <= max_failed) ? vec4(0, 1, 0, 1) : vec4(1, 0, 0, 1);
+}
+@end
 
 // vertex- and fragment shader for rendering the boids, vertex data is looked
 // up from shader constants, per-instance data is coming from a storage buffer
@@ -125,3 +389,4 @@ void main() {
 @end
 
 @program display vs fs
+@program self_test_indicator vs_self_test_indicator fs
@@ -2,6 +2,9 @@
 //  cubemap-jpeg-sapp.c
 //
 //  Load and render cubemap from individual jpeg files.
+//
+//  The mipmaps are computed on the CPU with util/mipgen.h after all faces
+//  have been loaded (the compute shader path only writes 2D images).
 //------------------------------------------------------------------------------
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
@@ -15,6 +18,7 @@
 #include "dbgui/dbgui.h"
 #include "util/camera.h"
 #include "util/fileutil.h"
+#include "util/mipgen.h"
 #include "cubemap-jpeg-sapp.glsl.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -55,6 +59,7 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup();
+    mipgen_setup();
 
     sdtx_setup(&(sdtx_desc_t){
         .fonts[0] = sdtx_font_oric(),
@@ -144,10 +149,11 @@ static void init(void) {
     // long as the texture isn't loaded yet
     state.bind.views[VIEW_tex] = sg_alloc_view();
 
-    // a sampler object
+    // a sampler object which blends between mipmaps
     state.bind.samplers[SMP_smp] = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_LINEAR,
         .mag_filter = SG_FILTER_LINEAR,
+        .mipmap_filter = SG_FILTER_LINEAR,
         .label = "cubemap-sampler"
     });
 
@@ -197,13 +203,12 @@ static void fetch_cb(const sfetch_response_t* response) {
             stbi_image_free(decoded_pixels);
             // all 6 faces loaded?
             if (++state.load_count == NUM_FACES) {
-                // create a cubemap image
-                sg_image img = sg_make_image(&(sg_image_desc){
+                // create a cubemap image with a complete mipmap chain
+                sg_image img = mipgen_make_image(&(mipgen_image_desc_t){
                     .type = SG_IMAGETYPE_CUBE,
                     .width = width,
                     .height = height,
-                    .pixel_format = SG_PIXELFORMAT_RGBA8,
-                    .data.mip_levels[0] = state.pixels,
+                    .data = state.pixels,
                     .label = "cubemap-image",
                 });
                 free((void*)state.pixels.ptr); state.pixels.ptr = 0;
@@ -250,6 +255,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     __dbgui_shutdown();
+    mipgen_shutdown();
     sfetch_shutdown();
     sdtx_shutdown();
     sg_shutdown();
@@ -1,15 +1,33 @@
 //------------------------------------------------------------------------------
 //  cubemaprt-sapp.c
 //  Cubemap as render target.
+//
+//  Instead of re-rendering all 6 cubemap faces each frame, the faces can be
+//  scheduled to only update N faces per frame, either round-robin or
+//  prioritized by the faces the display camera actually sees in the
+//  reflection (invisible faces are still updated, just less often). The
+//  seen faces are found each frame from the sides of the rotating center
+//  cube which face the camera, and the cubemap directions sampled on them.
+//  Optionally each face pass only draws the shapes inside the face frustum.
+//
+//  Keys:
+//      M:      cycle face update mode (all / round-robin / prioritized)
+//      1..6:   number of faces updated per frame
+//      C:      toggle per-face culling
 //------------------------------------------------------------------------------
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
+#define SOKOL_DEBUGTEXT_IMPL
 #include "sokol_gfx.h"
 #include "sokol_app.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#define SOKOL_SHAPE_IMPL
+#include "sokol_shape.h"
+#include "sokol_debugtext.h"
 #include "dbgui/dbgui.h"
-#include <stddef.h> /* offsetof */
+#include "util/camera.h"
+#include "util/shapecache.h"
 #include "cubemaprt-sapp.glsl.h"
 #include <stdio.h> // snprintf
 
@@ -18,6 +36,29 @@
 #define DISPLAY_SAMPLE_COUNT (4)
 #define NUM_SHAPES (32)
 #define NUM_FACES (6)
+// bounding sphere radius of the little cubes (unit cube scaled by 0.25)
+#define SHAPE_RADIUS (0.25f * 1.7320508f)
+// grid of points per camera facing side of the center cube for finding the
+// seen cubemap faces, a face which only covers a sliver between the points
+// may be missed, but is still updated by the aging in the prioritized mode
+#define FACE_SAMPLE_GRID (8)
+// how much faster a seen face ages in the prioritized mode
+#define FACE_VISIBLE_WEIGHT (4)
+// smoothing factor for the displayed per-frame averages
+#define STATS_SMOOTHING (0.05f)
+
+typedef enum {
+    UPDATE_ALL,
+    UPDATE_ROUND_ROBIN,
+    UPDATE_PRIORITIZED,
+    NUM_UPDATE_MODES,
+} update_mode_t;
+
+static const char* update_mode_names[NUM_UPDATE_MODES] = {
+    "all faces",
+    "round-robin",
+    "prioritized",
+};
 
 /* state struct for the little cubes rotating around the big cube */
 typedef struct {
@@ -29,17 +70,11 @@ typedef struct {
     float angular_velocity;
 } shape_t;
 
-// vertex (normals for simple point lighting)
-typedef struct {
-    float pos[3];
-    float norm[3];
-} vertex_t;
-
 // a mesh consists of a vertex- and index-buffer
 typedef struct {
     sg_buffer vbuf;
     sg_buffer ibuf;
-    int num_elements;
+    sshape_element_range_t draw;
 } mesh_t;
 
 // the entire application state
@@ -59,11 +94,27 @@ typedef struct {
     vec4_t light_dir;
     float rx, ry;
     shape_t shapes[NUM_SHAPES];
+    struct {
+        update_mode_t mode;
+        int faces_per_frame;
+        bool culling;
+        int next_face;                  // round-robin
+        int age[NUM_FACES];             // frames since the last update of each face
+        bool visible[NUM_FACES];        // face is seen in the reflection
+    } sched;
+    struct {
+        int face_passes;
+        int face_draws;
+        float avg_passes_saved;
+        float avg_draws_saved;
+    } stats;
 } app_t;
 static app_t app;
 
-static void draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj);
-static mesh_t make_cube_mesh(void);
+static int draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj, const uint32_t* visible_mask);
+static int schedule_faces(vec3_t eye_pos, mat44_t cube_model, int* out_faces);
+static void draw_stats(void);
+static mesh_t make_cube_mesh(shapecache_t* cache);
 
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
@@ -83,6 +134,10 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup();
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
 
     // create a cubemap as render target, a texture view, and a matching depth-buffer texture
     app.cubemap = sg_make_image(&(sg_image_desc){
@@ -136,17 +191,24 @@ static void init(void) {
         }
     };
 
-    // vertex- and index-buffers for cube
-    app.cube = make_cube_mesh();
+    // vertex- and index-buffers for cube (only positions and normals for simple point lighting)
+    shapecache_t cache;
+    shapecache_init(&cache, &(shapecache_desc_t){
+        .format.disable = { .texcoords = true, .colors = true },
+    });
+    app.cube = make_cube_mesh(&cache);
 
     // shader and pipeline objects for offscreen-rendering
     sg_pipeline_desc pip_desc = {
         .shader = sg_make_shader(shapes_shader_desc(sg_query_backend())),
-        .layout.attrs = {
-            [ATTR_shapes_pos] = { .offset = offsetof(vertex_t, pos), .format = SG_VERTEXFORMAT_FLOAT3 },
-            [ATTR_shapes_norm] = { .offset=offsetof(vertex_t, norm), .format=SG_VERTEXFORMAT_FLOAT3 },
+        .layout = {
+            .buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
+            .attrs = {
+                [ATTR_shapes_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_shapes_norm] = sshape_normal_vertex_attr_state(&cache.format),
+            },
         },
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_BACK,
         .sample_count = OFFSCREEN_SAMPLE_COUNT,
         .depth = {
@@ -165,11 +227,14 @@ static void init(void) {
     // shader and pipeline objects for display-rendering
     app.display_cube_pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = sg_make_shader(cube_shader_desc(sg_query_backend())),
-        .layout.attrs = {
-            [ATTR_cube_pos] = { .offset = offsetof(vertex_t, pos), .format = SG_VERTEXFORMAT_FLOAT3 },
-            [ATTR_cube_norm] = { .offset=offsetof(vertex_t, norm), .format=SG_VERTEXFORMAT_FLOAT3 },
+        .layout = {
+            .buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
+            .attrs = {
+                [ATTR_cube_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_cube_norm] = sshape_normal_vertex_attr_state(&cache.format),
+            },
         },
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_BACK,
         .sample_count = DISPLAY_SAMPLE_COUNT,
         .depth = {
@@ -177,6 +242,7 @@ static void init(void) {
             .write_enabled = true,
         },
     });
+    shapecache_shutdown(&cache);
 
     // a sampler to sample the cubemap render target as texture
     app.smp = sg_make_sampler(&(sg_sampler_desc){
@@ -196,6 +262,15 @@ static void init(void) {
         app.shapes[i].angle = rnd(0.0f, 360.0f);
         app.shapes[i].angular_velocity = rnd(15.0f, 50.0f) * (rnd(-1.0f, 1.0f)>0.0f ? 1.0f : -1.0f);
     }
+
+    // initially all faces are updated each frame, a high age makes sure
+    // that every face has been rendered once after switching modes
+    app.sched.mode = UPDATE_ALL;
+    app.sched.faces_per_frame = 2;
+    app.sched.culling = true;
+    for (int i = 0; i < NUM_FACES; i++) {
+        app.sched.age[i] = 1 << 20;
+    }
 }
 
 static void frame(void) {
@@ -235,7 +310,26 @@ static void frame(void) {
         { { .x= 0.0f, .y= 0.0f, .z=-1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } }
     };
     #endif
-    for (int face = 0; face < NUM_FACES; face++) {
+    // the big cube in the middle with environment mapping
+    app.rx += 0.1f * 60.0f * t; app.ry += 0.2f * 60.0f * t;
+    mat44_t rxm = mat44_rotation_x(vm_radians(app.rx));
+    mat44_t rym = mat44_rotation_y(vm_radians(app.ry));
+    mat44_t model = vm_mul(mat44_scaling(2.0f, 2.0f, 2.f), vm_mul(rym, rxm));
+
+    // only re-render the scheduled faces, the others keep their content from earlier frames
+    const vec3_t eye_pos = vec3(0.0f, 0.0f, 20.0f);
+    int faces[NUM_FACES];
+    const int num_faces = schedule_faces(eye_pos, model, faces);
+    vec3_t centers[NUM_SHAPES];
+    float radii[NUM_SHAPES];
+    for (int i = 0; i < NUM_SHAPES; i++) {
+        centers[i] = vec3(app.shapes[i].model.w.x, app.shapes[i].model.w.y, app.shapes[i].model.w.z);
+        radii[i] = SHAPE_RADIUS;
+    }
+    app.stats.face_passes = num_faces;
+    app.stats.face_draws = 0;
+    for (int i = 0; i < num_faces; i++) {
+        const int face = faces[i];
         sg_begin_pass(&(sg_pass){
             .action = app.offscreen_pass_action,
             .attachments = {
@@ -245,28 +339,32 @@ static void frame(void) {
         });
         mat44_t view = mat44_look_at_rh(vec3(0.0f, 0.0f, 0.0f), center_and_up[face][0], center_and_up[face][1]);
         mat44_t view_proj = vm_mul(view, app.offscreen_proj);
-        draw_cubes(app.offscreen_shapes_pip, vec3(0.0f, 0.0f, 0.0f), view_proj);
+        uint32_t visible_mask[CAM_CULL_MASK_WORDS(NUM_SHAPES)];
+        if (app.sched.culling) {
+            const cam_frustum_t frustum = cam_frustum(view_proj);
+            cam_cull_spheres(&frustum, centers, radii, NUM_SHAPES, visible_mask);
+        }
+        app.stats.face_draws += draw_cubes(app.offscreen_shapes_pip, vec3(0.0f, 0.0f, 0.0f), view_proj, app.sched.culling ? visible_mask : 0);
         sg_end_pass();
     }
+    const float passes_saved = (float)(NUM_FACES - app.stats.face_passes);
+    const float draws_saved = (float)(NUM_FACES * NUM_SHAPES - app.stats.face_draws);
+    app.stats.avg_passes_saved += (passes_saved - app.stats.avg_passes_saved) * STATS_SMOOTHING;
+    app.stats.avg_draws_saved += (draws_saved - app.stats.avg_draws_saved) * STATS_SMOOTHING;
 
     // render the default pass
     const int w = sapp_width();
     const int h = sapp_height();
     sg_begin_pass(&(sg_pass){ .action = app.display_pass_action, .swapchain = sglue_swapchain() });
 
-    vec3_t eye_pos = vec3(0.0f, 0.0f, 20.0f);
     mat44_t proj = mat44_perspective_fov_rh(vm_radians(45.0f), (float)w/(float)h, 0.01f, 100.0f);
     mat44_t view = mat44_look_at_rh(eye_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
     mat44_t view_proj = vm_mul(view, proj);
 
     // render the orbiting cubes
-    draw_cubes(app.display_shapes_pip, eye_pos, view_proj);
+    draw_cubes(app.display_shapes_pip, eye_pos, view_proj, 0);
 
-    // render a big cube in the middle with environment mapping
-    app.rx += 0.1f * 60.0f * t; app.ry += 0.2f * 60.0f * t;
-    mat44_t rxm = mat44_rotation_x(vm_radians(app.rx));
-    mat44_t rym = mat44_rotation_y(vm_radians(app.ry));
-    mat44_t model = vm_mul(mat44_scaling(2.0f, 2.0f, 2.f), vm_mul(rym, rxm));
+    // render the big cube in the middle with environment mapping
     sg_apply_pipeline(app.display_cube_pip);
     sg_apply_bindings(&(sg_bindings){
         .vertex_buffers[0] = app.cube.vbuf,
@@ -282,8 +380,9 @@ static void frame(void) {
         .eye_pos = vec4v3f(eye_pos, 1.0f)
     };
     sg_apply_uniforms(UB_shape_uniforms, &SG_RANGE(uniforms));
-    sg_draw(0, app.cube.num_elements, 1);
+    sg_draw(app.cube.draw.base_element, app.cube.draw.num_elements, 1);
 
+    draw_stats();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
@@ -291,9 +390,26 @@ static void frame(void) {
 
 static void cleanup(void) {
     __dbgui_shutdown();
+    sdtx_shutdown();
     sg_shutdown();
 }
 
+static void input(const sapp_event* ev) {
+    if (__dbgui_event_with_retval(ev)) {
+        return;
+    }
+    if (ev->type != SAPP_EVENTTYPE_KEY_DOWN) {
+        return;
+    }
+    if (ev->key_code == SAPP_KEYCODE_M) {
+        app.sched.mode = (update_mode_t)((app.sched.mode + 1) % NUM_UPDATE_MODES);
+    } else if (ev->key_code == SAPP_KEYCODE_C) {
+        app.sched.culling = !app.sched.culling;
+    } else if ((ev->key_code >= SAPP_KEYCODE_1) && (ev->key_code <= SAPP_KEYCODE_6)) {
+        app.sched.faces_per_frame = 1 + (int)(ev->key_code - SAPP_KEYCODE_1);
+    }
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -301,7 +417,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 800,
         .height = 600,
         .sample_count = DISPLAY_SAMPLE_COUNT,
@@ -311,13 +427,120 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     };
 }
 
-static void draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj) {
+/* the cubemap face (in slice order) which is sampled with a world space direction */
+static int face_of_dir(vec3_t dir) {
+    const vec3_t a = vm_abs(dir);
+    if ((a.x >= a.y) && (a.x >= a.z)) {
+        return (dir.x >= 0.0f) ? 0 : 1;
+    } else if (a.y >= a.z) {
+        return (dir.y >= 0.0f) ? 2 : 3;
+    } else {
+        return (dir.z >= 0.0f) ? 4 : 5;
+    }
+}
+
+/*
+    find the cubemap faces seen on the center cube: fs_cube samples the
+    cubemap with the world space position of the surface point, so sample
+    a grid of points on each side of the cube which faces the camera
+*/
+static void find_visible_faces(vec3_t eye_pos, mat44_t cube_model, bool* out_visible) {
+    for (int face = 0; face < NUM_FACES; face++) {
+        out_visible[face] = false;
+    }
+    // the cube mesh has a size of 2, the side normals and tangents in model space,
+    // the points are at the grid cell centers, on the edges they'd also mark the
+    // neighbouring faces
+    const vec3_t axes[3] = { vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f) };
+    for (int side = 0; side < 6; side++) {
+        const int axis = side >> 1;
+        const vec3_t n = vm_mul(axes[axis], (side & 1) ? -1.0f : 1.0f);
+        const vec3_t u = axes[(axis + 1) % 3];
+        const vec3_t v = axes[(axis + 2) % 3];
+        const vec3_t world_center = vec3_transform_coord(n, cube_model);
+        const vec3_t world_normal = vec3_transform_normal(n, cube_model);
+        if (vm_dot(world_normal, vm_sub(eye_pos, world_center)) <= 0.0f) {
+            continue;
+        }
+        for (int iy = 0; iy < FACE_SAMPLE_GRID; iy++) {
+            const float sv = -1.0f + (float)(2 * iy + 1) / (float)FACE_SAMPLE_GRID;
+            for (int ix = 0; ix < FACE_SAMPLE_GRID; ix++) {
+                const float su = -1.0f + (float)(2 * ix + 1) / (float)FACE_SAMPLE_GRID;
+                const vec3_t pos = vm_add(n, vm_add(vm_mul(u, su), vm_mul(v, sv)));
+                out_visible[face_of_dir(vec3_transform_coord(pos, cube_model))] = true;
+            }
+        }
+    }
+}
+
+/* pick the cubemap faces to re-render this frame, returns the number of faces */
+static int schedule_faces(vec3_t eye_pos, mat44_t cube_model, int* out_faces) {
+    find_visible_faces(eye_pos, cube_model, app.sched.visible);
+    for (int face = 0; face < NUM_FACES; face++) {
+        app.sched.age[face] += app.sched.visible[face] ? FACE_VISIBLE_WEIGHT : 1;
+    }
+    int num_faces = 0;
+    if (app.sched.mode == UPDATE_ALL) {
+        for (int face = 0; face < NUM_FACES; face++) {
+            out_faces[num_faces++] = face;
+        }
+    } else if (app.sched.mode == UPDATE_ROUND_ROBIN) {
+        for (int i = 0; i < app.sched.faces_per_frame; i++) {
+            out_faces[num_faces++] = app.sched.next_face;
+            app.sched.next_face = (app.sched.next_face + 1) % NUM_FACES;
+        }
+    } else {
+        // the oldest faces, seen faces age faster
+        bool picked[NUM_FACES] = { false };
+        for (int i = 0; i < app.sched.faces_per_frame; i++) {
+            int oldest = -1;
+            for (int face = 0; face < NUM_FACES; face++) {
+                if (!picked[face] && ((oldest < 0) || (app.sched.age[face] > app.sched.age[oldest]))) {
+                    oldest = face;
+                }
+            }
+            picked[oldest] = true;
+            out_faces[num_faces++] = oldest;
+        }
+    }
+    for (int i = 0; i < num_faces; i++) {
+        app.sched.age[out_faces[i]] = 0;
+    }
+    return num_faces;
+}
+
+static void draw_stats(void) {
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1, 1);
+    sdtx_color3f(0.0f, 0.0f, 0.0f);
+    sdtx_printf("mode (M): %s\n", update_mode_names[app.sched.mode]);
+    if (app.sched.mode != UPDATE_ALL) {
+        sdtx_printf("faces per frame (1..6): %d\n", app.sched.faces_per_frame);
+    } else {
+        sdtx_puts("\n");
+    }
+    sdtx_printf("face culling (C): %s\n\n", app.sched.culling ? "on" : "off");
+    sdtx_printf("face passes: %d/%d (avg saved %.1f)\n", app.stats.face_passes, NUM_FACES, app.stats.avg_passes_saved);
+    sdtx_printf("face draws:  %d/%d (avg saved %.1f)\n\n", app.stats.face_draws, NUM_FACES * NUM_SHAPES, app.stats.avg_draws_saved);
+    sdtx_puts("seen faces: ");
+    for (int face = 0; face < NUM_FACES; face++) {
+        sdtx_putc(app.sched.visible[face] ? ('0' + face) : '-');
+    }
+    sdtx_draw();
+}
+
+/* draw the little cubes, optionally only those in the visible_mask, returns the number of draws */
+static int draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj, const uint32_t* visible_mask) {
     sg_apply_pipeline(pip);
     sg_apply_bindings(&(sg_bindings){
         .vertex_buffers[0] = app.cube.vbuf,
         .index_buffer = app.cube.ibuf
     });
+    int num_draws = 0;
     for (int i = 0; i < NUM_SHAPES; i++) {
+        if (visible_mask && !(visible_mask[i >> 5] & (1u << (i & 31)))) {
+            continue;
+        }
         const shape_t* shape = &app.shapes[i];
         shape_uniforms_t uniforms = {
             .mvp = vm_mul(shape->model, view_proj),
@@ -327,61 +550,26 @@ static void draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj) {
             .eye_pos = vec4v3f(eye_pos, 1.0f)
         };
         sg_apply_uniforms(UB_shape_uniforms, &SG_RANGE(uniforms));
-        sg_draw(0, app.cube.num_elements, 1);
+        sg_draw(app.cube.draw.base_element, app.cube.draw.num_elements, 1);
+        num_draws++;
     }
+    return num_draws;
 }
 
-static mesh_t make_cube_mesh(void) {
-    vertex_t vertices[] =  {
-        { { -1.0, -1.0, -1.0 }, { 0.0, 0.0, -1.0 } },
-        { {  1.0, -1.0, -1.0 }, { 0.0, 0.0, -1.0 } },
-        { {  1.0,  1.0, -1.0 }, { 0.0, 0.0, -1.0 } },
-        { { -1.0,  1.0, -1.0 }, { 0.0, 0.0, -1.0 } },
-
-        { { -1.0, -1.0,  1.0 }, { 0.0, 0.0, 1.0 } },
-        { {  1.0, -1.0,  1.0 }, { 0.0, 0.0, 1.0 } },
-        { {  1.0,  1.0,  1.0 }, { 0.0, 0.0, 1.0 } },
-        { { -1.0,  1.0,  1.0 }, { 0.0, 0.0, 1.0 } },
-
-        { { -1.0, -1.0, -1.0 }, { -1.0, 0.0, 0.0 } },
-        { { -1.0,  1.0, -1.0 }, { -1.0, 0.0, 0.0 } },
-        { { -1.0,  1.0,  1.0 }, { -1.0, 0.0, 0.0 } },
-        { { -1.0, -1.0,  1.0 }, { -1.0, 0.0, 0.0 } },
-
-        { { 1.0, -1.0, -1.0, }, { 1.0, 0.0, 0.0 } },
-        { { 1.0,  1.0, -1.0, }, { 1.0, 0.0, 0.0 } },
-        { { 1.0,  1.0,  1.0, }, { 1.0, 0.0, 0.0 } },
-        { { 1.0, -1.0,  1.0, }, { 1.0, 0.0, 0.0 } },
-
-        { { -1.0, -1.0, -1.0 }, { 0.0, -1.0, 0.0 } },
-        { { -1.0, -1.0,  1.0 }, { 0.0, -1.0, 0.0 } },
-        { {  1.0, -1.0,  1.0 }, { 0.0, -1.0, 0.0 } },
-        { {  1.0, -1.0, -1.0 }, { 0.0, -1.0, 0.0 } },
-
-        { { -1.0,  1.0, -1.0 }, { 0.0, 1.0, 0.0 } },
-        { { -1.0,  1.0,  1.0 }, { 0.0, 1.0, 0.0 } },
-        { {  1.0,  1.0,  1.0 }, { 0.0, 1.0, 0.0 } },
-        { {  1.0,  1.0, -1.0 }, { 0.0, 1.0, 0.0 } }
-    };
-    uint16_t indices[] = {
-        0, 1, 2,  0, 2, 3,
-        6, 5, 4,  7, 6, 4,
-        8, 9, 10,  8, 10, 11,
-        14, 13, 12,  15, 14, 12,
-        16, 17, 18,  16, 18, 19,
-        22, 21, 20,  23, 22, 20
-    };
+static mesh_t make_cube_mesh(shapecache_t* cache) {
+    const sshape_element_range_t draw = shapecache_box(cache, &(sshape_box_t){
+        .width = 2.0f,
+        .height = 2.0f,
+        .depth = 2.0f,
+    });
+    sg_buffer_desc vbuf_desc = shapecache_vertex_buffer_desc(cache);
+    vbuf_desc.label = "cube-vertices";
+    sg_buffer_desc ibuf_desc = shapecache_index_buffer_desc(cache);
+    ibuf_desc.label = "cube-indices";
     mesh_t mesh = {
-        .vbuf = sg_make_buffer(&(sg_buffer_desc){
-            .data = SG_RANGE(vertices),
-            .label = "cube-vertices"
-        }),
-        .ibuf = sg_make_buffer(&(sg_buffer_desc){
-            .usage.index_buffer = true,
-            .data = SG_RANGE(indices),
-            .label = "cube-indices"
-        }),
-        .num_elements = sizeof(indices) / sizeof(uint16_t)
+        .vbuf = sg_make_buffer(&vbuf_desc),
+        .ibuf = sg_make_buffer(&ibuf_desc),
+        .draw = draw,
     };
     return mesh;
 }
@@ -0,0 +1,506 @@
+//------------------------------------------------------------------------------
+//  drawcallperf-bench.c
+//
+//  Headless version of drawcallperf-sapp.c for tracking the CPU cost of the
+//  sokol-gfx submission path on machines without a GPU.
+//
+//  Runs sokol-gfx on the dummy backend (no window, no 3D API), sweeps over
+//  the draw modes of drawcallperf-sapp.c and a fixed set of instance counts
+//  and bind frequencies, submits the same draw loops as drawcallperf-sapp.c
+//  for a number of frames per step, and writes the average time spent per
+//  sg_apply_uniforms(), sg_apply_bindings() and sg_draw() call as CSV.
+//
+//  Usage:
+//
+//      drawcallperf-bench [--frames N] [--out results.csv]
+//
+//  Without --out the CSV is written to stdout.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// force the dummy backend, the build system defines the 3D backend of the active config
+#undef SOKOL_GLCORE
+#undef SOKOL_GLES3
+#undef SOKOL_D3D11
+#undef SOKOL_METAL
+#undef SOKOL_WGPU
+#undef SOKOL_VULKAN
+#define SOKOL_DUMMY_BACKEND
+#define SOKOL_GFX_IMPL
+#include "sokol_gfx.h"
+#define SOKOL_TIME_IMPL
+#include "sokol_time.h"
+#define SOKOL_LOG_IMPL
+#include "sokol_log.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "drawcallperf-sapp.glsl.h"
+
+#define NUM_IMAGES (3)
+#define IMG_WIDTH (8)
+#define IMG_HEIGHT (8)
+#define MAX_INSTANCES (100000)
+#define DEFAULT_NUM_FRAMES (100)
+#define NUM_WARMUP_FRAMES (4)
+#define DISPLAY_WIDTH (1024)
+#define DISPLAY_HEIGHT (768)
+
+typedef enum {
+    MODE_UNIFORMS,
+    MODE_STORAGE_BUFFER,
+    MODE_BASE_INSTANCE,
+    MODE_SINGLE_DRAW,
+    NUM_MODES,
+} draw_mode_t;
+
+static const char* mode_names[NUM_MODES] = {
+    "uniforms",
+    "storage_buffer",
+    "base_instance",
+    "single_draw",
+};
+
+static const int sweep_num_instances[] = { 100, 1000, 10000, 100000 };
+static const int sweep_bind_frequency[] = { 1, 10, 100, 1000 };
+
+typedef struct {
+    int num_uniform_updates;
+    int num_binding_updates;
+    int num_draw_calls;
+    uint64_t apply_uniforms_ticks;
+    uint64_t apply_bindings_ticks;
+    uint64_t draw_ticks;
+    uint64_t frame_ticks;
+} bench_stats_t;
+
+static struct {
+    sg_pass_action pass_action;
+    sg_view view[NUM_IMAGES];
+    sg_pipeline pip[NUM_MODES];
+    sg_bindings bind[NUM_MODES];
+    sg_buffer layered_sbuf;
+    bool mode_supported[NUM_MODES];
+    bench_stats_t stats;
+} state;
+
+static vs_per_instance_t positions[MAX_INSTANCES];
+static sb_layered_instance_t layered_positions[MAX_INSTANCES];
+
+static inline uint32_t xorshift32(void) {
+    static uint32_t x = 0x12345678;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+static vec4_t rand_pos(void) {
+    const float x = (((float)(xorshift32() & 0xFFFF)) / 0x10000) - 0.5f;
+    const float y = (((float)(xorshift32() & 0xFFFF)) / 0x10000) - 0.5f;
+    const float z = (((float)(xorshift32() & 0xFFFF)) / 0x10000) - 0.5f;
+    return vm_normalize(vec4(x, y, z, 0.0f));
+}
+
+// the dummy backend doesn't need shader code, but the generated shader
+// header only contains descs for the backends of the active build config,
+// so just use the first one (the reflection info is the same for all)
+typedef const sg_shader_desc* (*shader_desc_func_t)(sg_backend backend);
+
+static const sg_shader_desc* bench_shader_desc(shader_desc_func_t func) {
+    const sg_backend backends[] = {
+        SG_BACKEND_GLCORE,
+        SG_BACKEND_GLES3,
+        SG_BACKEND_D3D11,
+        SG_BACKEND_METAL_MACOS,
+        SG_BACKEND_METAL_IOS,
+        SG_BACKEND_METAL_SIMULATOR,
+        SG_BACKEND_WGPU,
+        SG_BACKEND_VULKAN,
+    };
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        const sg_shader_desc* desc = func(backends[i]);
+        if (desc) {
+            return desc;
+        }
+    }
+    return 0;
+}
+
+static bool init(void) {
+    stm_setup();
+    sg_setup(&(sg_desc){
+        .environment.defaults = {
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+            .sample_count = 1,
+        },
+        .logger.func = slog_func,
+        .uniform_buffer_size = MAX_INSTANCES * 256 + 1024,
+    });
+    state.pass_action = (sg_pass_action) {
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.5f, 0.75f, 1.0f } },
+    };
+
+    const sg_features features = sg_query_features();
+    state.mode_supported[MODE_UNIFORMS] = true;
+    state.mode_supported[MODE_STORAGE_BUFFER] = features.compute;
+    state.mode_supported[MODE_BASE_INSTANCE] = features.draw_base_instance;
+    state.mode_supported[MODE_SINGLE_DRAW] = features.compute;
+
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        positions[i].world_pos = rand_pos();
+    }
+
+    // same resources as drawcallperf-sapp.c, the content doesn't matter on the dummy backend
+    static const float vertices[24 * 6] = {0};
+    static const uint16_t indices[36] = {0};
+    sg_buffer vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .data = SG_RANGE(vertices)
+    });
+    sg_buffer ibuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.index_buffer = true,
+        .data = SG_RANGE(indices)
+    });
+    static uint32_t pixels[NUM_IMAGES][IMG_HEIGHT][IMG_WIDTH];
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        sg_image img = sg_make_image(&(sg_image_desc){
+            .width = IMG_WIDTH,
+            .height = IMG_HEIGHT,
+            .pixel_format = SG_PIXELFORMAT_RGBA8,
+            .data.mip_levels[0] = SG_RANGE(pixels[i]),
+        });
+        state.view[i] = sg_make_view(&(sg_view_desc){
+            .texture = { .image = img },
+        });
+    }
+    sg_sampler smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+    });
+    sg_buffer inst_vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .data = SG_RANGE(positions),
+    });
+    sg_view sbuf_view = {0};
+    sg_view layered_sbuf_view = {0};
+    sg_view array_view = {0};
+    if (features.compute) {
+        sbuf_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .data = SG_RANGE(positions),
+                }),
+            },
+        });
+        state.layered_sbuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = { .storage_buffer = true, .dynamic_update = true },
+            .size = sizeof(layered_positions),
+        });
+        layered_sbuf_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = { .buffer = state.layered_sbuf },
+        });
+        array_view = sg_make_view(&(sg_view_desc){
+            .texture = {
+                .image = sg_make_image(&(sg_image_desc){
+                    .type = SG_IMAGETYPE_ARRAY,
+                    .width = IMG_WIDTH,
+                    .height = IMG_HEIGHT,
+                    .num_slices = NUM_IMAGES,
+                    .pixel_format = SG_PIXELFORMAT_RGBA8,
+                    .data.mip_levels[0] = SG_RANGE(pixels),
+                }),
+            },
+        });
+    }
+    state.bind[MODE_UNIFORMS] = (sg_bindings){
+        .vertex_buffers[0] = vbuf,
+        .index_buffer = ibuf,
+        .samplers[SMP_smp] = smp,
+    };
+    state.bind[MODE_STORAGE_BUFFER] = (sg_bindings){
+        .vertex_buffers[0] = vbuf,
+        .index_buffer = ibuf,
+        .views[VIEW_instances] = sbuf_view,
+        .samplers[SMP_smp] = smp,
+    };
+    state.bind[MODE_BASE_INSTANCE] = (sg_bindings){
+        .vertex_buffers = { [0] = vbuf, [1] = inst_vbuf },
+        .index_buffer = ibuf,
+        .samplers[SMP_smp] = smp,
+    };
+    state.bind[MODE_SINGLE_DRAW] = (sg_bindings){
+        .vertex_buffers[0] = vbuf,
+        .index_buffer = ibuf,
+        .views = {
+            [VIEW_layered_instances] = layered_sbuf_view,
+            [VIEW_tex_array] = array_view,
+        },
+        .samplers[SMP_smp_array] = smp,
+    };
+
+    // pipelines, all vertex layouts start with the same per-vertex attributes
+    const shader_desc_func_t shader_funcs[NUM_MODES] = {
+        drawcallperf_shader_desc,
+        sbuf_shader_desc,
+        inst_shader_desc,
+        single_shader_desc,
+    };
+    for (int mode = 0; mode < NUM_MODES; mode++) {
+        if (!state.mode_supported[mode]) {
+            continue;
+        }
+        const sg_shader_desc* shd_desc = bench_shader_desc(shader_funcs[mode]);
+        if (!shd_desc) {
+            fprintf(stderr, "drawcallperf-bench: no shader desc in drawcallperf-sapp.glsl.h\n");
+            return false;
+        }
+        sg_pipeline_desc pip_desc = {
+            .layout = {
+                .attrs = {
+                    [0] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+                    [1] = { .format = SG_VERTEXFORMAT_FLOAT2, .buffer_index = 0 },
+                    [2] = { .format = SG_VERTEXFORMAT_FLOAT, .buffer_index = 0 },
+                }
+            },
+            .shader = sg_make_shader(shd_desc),
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+        };
+        if (mode == MODE_BASE_INSTANCE) {
+            pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+            pip_desc.layout.attrs[ATTR_inst_inst_world_pos] = (sg_vertex_attr_state){ .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 };
+        }
+        state.pip[mode] = sg_make_pipeline(&pip_desc);
+        if (sg_query_pipeline_state(state.pip[mode]) != SG_RESOURCESTATE_VALID) {
+            fprintf(stderr, "drawcallperf-bench: failed to create pipeline for mode '%s'\n", mode_names[mode]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void timed_apply_bindings(const sg_bindings* bind) {
+    const uint64_t t = stm_now();
+    sg_apply_bindings(bind);
+    state.stats.apply_bindings_ticks += stm_since(t);
+    state.stats.num_binding_updates++;
+}
+
+static void timed_apply_uniforms(int ub_slot, const sg_range* data) {
+    const uint64_t t = stm_now();
+    sg_apply_uniforms(ub_slot, data);
+    state.stats.apply_uniforms_ticks += stm_since(t);
+    state.stats.num_uniform_updates++;
+}
+
+static void timed_draw(int base_element, int num_elements, int num_instances, int base_instance) {
+    const uint64_t t = stm_now();
+    if (base_instance == 0) {
+        sg_draw(base_element, num_elements, num_instances);
+    } else {
+        sg_draw_ex(base_element, num_elements, num_instances, 0, base_instance);
+    }
+    state.stats.draw_ticks += stm_since(t);
+    state.stats.num_draw_calls++;
+}
+
+// see draw_uniforms() in drawcallperf-sapp.c
+static void draw_uniforms(int num_instances, int bind_frequency) {
+    sg_bindings* bind = &state.bind[MODE_UNIFORMS];
+    bind->views[VIEW_tex] = state.view[0];
+    timed_apply_bindings(bind);
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    for (int i = 0; i < num_instances; i++) {
+        if (++cur_bind_count == bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            bind->views[VIEW_tex] = state.view[cur_img++];
+            timed_apply_bindings(bind);
+        }
+        timed_apply_uniforms(UB_vs_per_instance, &SG_RANGE(positions[i]));
+        timed_draw(0, 36, 1, 0);
+    }
+}
+
+// see draw_run() in drawcallperf-sapp.c
+static void draw_run(draw_mode_t mode, sg_view tex_view, int base_instance, int num_instances) {
+    state.bind[mode].views[VIEW_tex] = tex_view;
+    timed_apply_bindings(&state.bind[mode]);
+    if (mode == MODE_STORAGE_BUFFER) {
+        const vs_per_batch_t vs_per_batch = { .base_instance = base_instance };
+        timed_apply_uniforms(UB_vs_per_batch, &SG_RANGE(vs_per_batch));
+        timed_draw(0, 36, num_instances, 0);
+    } else {
+        timed_draw(0, 36, num_instances, base_instance);
+    }
+}
+
+// see draw_runs() in drawcallperf-sapp.c
+static void draw_runs(draw_mode_t mode, int num_instances, int bind_frequency) {
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    int run_start = 0;
+    sg_view run_view = state.view[0];
+    for (int i = 0; i < num_instances; i++) {
+        if (++cur_bind_count == bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            if (i > run_start) {
+                draw_run(mode, run_view, run_start, i - run_start);
+            }
+            run_start = i;
+            run_view = state.view[cur_img++];
+        }
+    }
+    if (num_instances > run_start) {
+        draw_run(mode, run_view, run_start, num_instances - run_start);
+    }
+}
+
+// see update_layered_positions() in drawcallperf-sapp.c, this is not part of the measured frame time
+static void update_layered_positions(int bind_frequency) {
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    int layer = 0;
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        if (++cur_bind_count == bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            layer = cur_img++;
+        }
+        layered_positions[i].world_pos_layer = positions[i].world_pos;
+        layered_positions[i].world_pos_layer.w = (float)layer;
+    }
+    sg_update_buffer(state.layered_sbuf, &SG_RANGE(layered_positions));
+}
+
+// the same draw loops as drawcallperf-sapp.c, with each sokol-gfx call timed separately
+static void frame(draw_mode_t mode, int num_instances, int bind_frequency) {
+    const uint64_t frame_start = stm_now();
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), (float)DISPLAY_WIDTH / (float)DISPLAY_HEIGHT, 0.01f, 10.0f);
+    const mat44_t view = mat44_look_at_rh(vec3(0.0f, 1.5f, 4.5f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const vs_per_frame_t vs_per_frame = { .viewproj = vm_mul(view, proj) };
+
+    sg_begin_pass(&(sg_pass){
+        .action = state.pass_action,
+        .swapchain = {
+            .width = DISPLAY_WIDTH,
+            .height = DISPLAY_HEIGHT,
+            .sample_count = 1,
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+        },
+    });
+    sg_apply_pipeline(state.pip[mode]);
+    timed_apply_uniforms(UB_vs_per_frame, &SG_RANGE(vs_per_frame));
+    switch (mode) {
+        case MODE_UNIFORMS:
+            draw_uniforms(num_instances, bind_frequency);
+            break;
+        case MODE_SINGLE_DRAW:
+            timed_apply_bindings(&state.bind[MODE_SINGLE_DRAW]);
+            timed_draw(0, 36, num_instances, 0);
+            break;
+        default:
+            draw_runs(mode, num_instances, bind_frequency);
+            break;
+    }
+    sg_end_pass();
+    sg_commit();
+    state.stats.frame_ticks += stm_since(frame_start);
+}
+
+static double ns_per_call(uint64_t ticks, int num_calls) {
+    return (num_calls > 0) ? (stm_ns(ticks) / (double)num_calls) : 0.0;
+}
+
+static void run_step(FILE* fp, draw_mode_t mode, int num_instances, int bind_frequency, int num_frames) {
+    if (mode == MODE_SINGLE_DRAW) {
+        update_layered_positions(bind_frequency);
+    }
+    for (int i = 0; i < NUM_WARMUP_FRAMES; i++) {
+        frame(mode, num_instances, bind_frequency);
+    }
+    state.stats = (bench_stats_t){0};
+    for (int i = 0; i < num_frames; i++) {
+        frame(mode, num_instances, bind_frequency);
+    }
+    const bench_stats_t* s = &state.stats;
+    fprintf(fp, "dummy,%s,%d,%d,%d,%d,%d,%d,%.4f,%.2f,%.2f,%.2f\n",
+        mode_names[mode],
+        num_instances,
+        bind_frequency,
+        num_frames,
+        s->num_uniform_updates / num_frames,
+        s->num_binding_updates / num_frames,
+        s->num_draw_calls / num_frames,
+        stm_ms(s->frame_ticks) / num_frames,
+        ns_per_call(s->apply_uniforms_ticks, s->num_uniform_updates),
+        ns_per_call(s->apply_bindings_ticks, s->num_binding_updates),
+        ns_per_call(s->draw_ticks, s->num_draw_calls));
+    fflush(fp);
+}
+
+int main(int argc, char* argv[]) {
+    int num_frames = DEFAULT_NUM_FRAMES;
+    const char* out_path = 0;
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--frames")) && ((i + 1) < argc)) {
+            num_frames = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--out")) && ((i + 1) < argc)) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--out results.csv]\n", argv[0]);
+            return 10;
+        }
+    }
+    if (num_frames < 1) {
+        num_frames = 1;
+    }
+    FILE* fp = stdout;
+    if (out_path) {
+        fp = fopen(out_path, "w");
+        if (!fp) {
+            fprintf(stderr, "drawcallperf-bench: failed to open '%s'\n", out_path);
+            return 10;
+        }
+    }
+    if (!init()) {
+        sg_shutdown();
+        return 10;
+    }
+    fprintf(fp, "backend,mode,num_instances,bind_frequency,frames,"
+        "uniform_updates_per_frame,binding_updates_per_frame,draw_calls_per_frame,"
+        "frame_ms,apply_uniforms_ns,apply_bindings_ns,draw_ns\n");
+    const int num_instance_steps = (int)(sizeof(sweep_num_instances) / sizeof(sweep_num_instances[0]));
+    const int num_bind_steps = (int)(sizeof(sweep_bind_frequency) / sizeof(sweep_bind_frequency[0]));
+    for (int mode = 0; mode < NUM_MODES; mode++) {
+        if (!state.mode_supported[mode]) {
+            fprintf(stderr, "drawcallperf-bench: mode '%s' not supported, skipped\n", mode_names[mode]);
+            continue;
+        }
+        for (int i = 0; i < num_instance_steps; i++) {
+            for (int k = 0; k < num_bind_steps; k++) {
+                run_step(fp, (draw_mode_t)mode, sweep_num_instances[i], sweep_bind_frequency[k], num_frames);
+            }
+        }
+    }
+    sg_shutdown();
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    return 0;
+}
@@ -1,5 +1,20 @@
 //------------------------------------------------------------------------------
 //  drawcallperf-sapp.c
+//
+//  Measure draw call throughput with different ways to provide per-instance
+//  data (selectable at runtime):
+//
+//  - Uniforms: one sg_apply_uniforms() and sg_draw() per instance
+//  - Storage Buffer: per-instance data in a storage buffer indexed by the
+//    instance index, one instanced draw call per run of instances with the
+//    same texture binding (the run's first instance index is a uniform)
+//  - Base Instance: per-instance data in an instance-step vertex buffer,
+//    one sg_draw_ex() with a base instance per texture run
+//  - Single Draw: a storage buffer and a 2D array texture, all instances
+//    are rendered with one draw call
+//
+//  See drawcallperf-bench.c for a headless version which runs scripted
+//  sweeps on the sokol-gfx dummy backend and writes the results as CSV.
 //------------------------------------------------------------------------------
 #include "sokol_gfx.h"
 #include "sokol_app.h"
@@ -23,16 +38,39 @@
 #define MAX_INSTANCES (100000)
 #define MAX_BIND_FREQUENCY (1000)
 
+typedef enum {
+    MODE_UNIFORMS,
+    MODE_STORAGE_BUFFER,
+    MODE_BASE_INSTANCE,
+    MODE_SINGLE_DRAW,
+    NUM_MODES,
+} draw_mode_t;
+
+static const char* mode_names[NUM_MODES] = {
+    "Uniforms",
+    "Storage Buffer",
+    "Base Instance",
+    "Single Draw",
+};
+
 static struct {
     sg_pass_action pass_action;
     sg_image img[NUM_IMAGES];
     sg_view view[NUM_IMAGES];
-    sg_pipeline pip;
-    sg_bindings bind;
+    sg_pipeline pip[NUM_MODES];
+    sg_bindings bind;           // MODE_UNIFORMS
+    sg_bindings sbuf_bind;      // MODE_STORAGE_BUFFER
+    sg_bindings inst_bind;      // MODE_BASE_INSTANCE
+    sg_bindings single_bind;    // MODE_SINGLE_DRAW
+    sg_buffer layered_sbuf;
+    int layered_bind_frequency; // bind frequency the texture layers in layered_sbuf were computed for
+    bool mode_supported[NUM_MODES];
+    draw_mode_t mode;
     int num_instances;
     int bind_frequency;
     float angle;
     uint64_t last_time;
+    double submit_ms[NUM_MODES];    // smoothed CPU time for recording the draw calls, zero if not measured yet
     struct {
         int num_uniform_updates;
         int num_binding_updates;
@@ -42,6 +80,7 @@ static struct {
 } state;
 
 static vs_per_instance_t positions[MAX_INSTANCES];
+static sb_layered_instance_t layered_positions[MAX_INSTANCES];
 
 static void drawui(void);
 
@@ -65,6 +104,7 @@ static void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
         .logger.func = slog_func,
+        // only needed for MODE_UNIFORMS, each uniform update takes up to 256 bytes
         .uniform_buffer_size = MAX_INSTANCES * 256 + 1024,
     });
     sgimgui_setup(&(sgimgui_desc_t){0});
@@ -77,6 +117,11 @@ static void init(void) {
     };
     state.num_instances = 100;
     state.bind_frequency = MAX_BIND_FREQUENCY;
+    const sg_features features = sg_query_features();
+    state.mode_supported[MODE_UNIFORMS] = true;
+    state.mode_supported[MODE_STORAGE_BUFFER] = features.compute;
+    state.mode_supported[MODE_BASE_INSTANCE] = features.draw_base_instance;
+    state.mode_supported[MODE_SINGLE_DRAW] = features.compute;
 
     switch (sg_query_backend()) {
         case SG_BACKEND_GLCORE: state.backend = "GLCORE"; break;
@@ -163,13 +208,14 @@ static void init(void) {
             .texture = { .image = state.img[i] },
         });
     }
-    state.bind.samplers[SMP_smp] = sg_make_sampler(&(sg_sampler_desc){
+    sg_sampler smp = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_NEAREST,
         .mag_filter = SG_FILTER_NEAREST,
     });
+    state.bind.samplers[SMP_smp] = smp;
 
     // a pipeline object
-    state.pip = sg_make_pipeline(&(sg_pipeline_desc){
+    state.pip[MODE_UNIFORMS] = sg_make_pipeline(&(sg_pipeline_desc){
         .layout = {
             .attrs = {
                 [ATTR_drawcallperf_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3 },
@@ -190,6 +236,139 @@ static void init(void) {
     for (int i = 0; i < MAX_INSTANCES; i++) {
         positions[i].world_pos = rand_pos();
     }
+
+    // per-instance vertex buffer and pipeline for MODE_BASE_INSTANCE
+    if (state.mode_supported[MODE_BASE_INSTANCE]) {
+        state.inst_bind = (sg_bindings){
+            .vertex_buffers = {
+                [0] = state.bind.vertex_buffers[0],
+                [1] = sg_make_buffer(&(sg_buffer_desc){
+                    .data = SG_RANGE(positions),
+                    .label = "instance-vertices",
+                }),
+            },
+            .index_buffer = state.bind.index_buffer,
+            .samplers[SMP_smp] = smp,
+        };
+        state.pip[MODE_BASE_INSTANCE] = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+                .attrs = {
+                    [ATTR_inst_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+                    [ATTR_inst_in_uv] = { .format = SG_VERTEXFORMAT_FLOAT2, .buffer_index = 0 },
+                    [ATTR_inst_in_bright] = { .format = SG_VERTEXFORMAT_FLOAT, .buffer_index = 0 },
+                    [ATTR_inst_inst_world_pos] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+                }
+            },
+            .shader = sg_make_shader(inst_shader_desc(sg_query_backend())),
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+            .label = "base-instance-pipeline",
+        });
+    }
+
+    // storage buffer and pipeline for MODE_STORAGE_BUFFER
+    if (state.mode_supported[MODE_STORAGE_BUFFER]) {
+        sg_buffer sbuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage.storage_buffer = true,
+            .data = SG_RANGE(positions),
+            .label = "instance-storage-buffer",
+        });
+        state.sbuf_bind = (sg_bindings){
+            .vertex_buffers[0] = state.bind.vertex_buffers[0],
+            .index_buffer = state.bind.index_buffer,
+            .views[VIEW_instances] = sg_make_view(&(sg_view_desc){
+                .storage_buffer = { .buffer = sbuf },
+                .label = "instance-storage-buffer-view",
+            }),
+            .samplers[SMP_smp] = smp,
+        };
+        state.pip[MODE_STORAGE_BUFFER] = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_sbuf_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3 },
+                    [ATTR_sbuf_in_uv] = { .format = SG_VERTEXFORMAT_FLOAT2 },
+                    [ATTR_sbuf_in_bright] = { .format = SG_VERTEXFORMAT_FLOAT },
+                }
+            },
+            .shader = sg_make_shader(sbuf_shader_desc(sg_query_backend())),
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+            .label = "storage-buffer-pipeline",
+        });
+    }
+
+    // storage buffer with texture layer indices, array texture and pipeline for MODE_SINGLE_DRAW,
+    // the texture layers depend on the bind frequency, so the storage buffer is updated when
+    // the bind frequency changes
+    if (state.mode_supported[MODE_SINGLE_DRAW]) {
+        static uint32_t array_pixels[NUM_IMAGES][IMG_HEIGHT][IMG_WIDTH];
+        for (int i = 0; i < NUM_IMAGES; i++) {
+            for (int y = 0; y < IMG_HEIGHT; y++) {
+                for (int x = 0; x < IMG_WIDTH; x++) {
+                    switch (i) {
+                        case 0: array_pixels[i][y][x] = 0xFF0000FF; break;
+                        case 1: array_pixels[i][y][x] = 0xFF00FF00; break;
+                        default: array_pixels[i][y][x] = 0xFFFF0000; break;
+                    }
+                }
+            }
+        }
+        sg_image array_img = sg_make_image(&(sg_image_desc){
+            .type = SG_IMAGETYPE_ARRAY,
+            .width = IMG_WIDTH,
+            .height = IMG_HEIGHT,
+            .num_slices = NUM_IMAGES,
+            .pixel_format = SG_PIXELFORMAT_RGBA8,
+            .data.mip_levels[0] = SG_RANGE(array_pixels),
+            .label = "array-texture",
+        });
+        state.layered_sbuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = { .storage_buffer = true, .dynamic_update = true },
+            .size = sizeof(layered_positions),
+            .label = "layered-instance-storage-buffer",
+        });
+        state.single_bind = (sg_bindings){
+            .vertex_buffers[0] = state.bind.vertex_buffers[0],
+            .index_buffer = state.bind.index_buffer,
+            .views = {
+                [VIEW_layered_instances] = sg_make_view(&(sg_view_desc){
+                    .storage_buffer = { .buffer = state.layered_sbuf },
+                    .label = "layered-instance-storage-buffer-view",
+                }),
+                [VIEW_tex_array] = sg_make_view(&(sg_view_desc){
+                    .texture = { .image = array_img },
+                    .label = "array-texture-view",
+                }),
+            },
+            .samplers[SMP_smp_array] = smp,
+        };
+        state.pip[MODE_SINGLE_DRAW] = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_single_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3 },
+                    [ATTR_single_in_uv] = { .format = SG_VERTEXFORMAT_FLOAT2 },
+                    [ATTR_single_in_bright] = { .format = SG_VERTEXFORMAT_FLOAT },
+                }
+            },
+            .shader = sg_make_shader(single_shader_desc(sg_query_backend())),
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+            .label = "single-draw-pipeline",
+        });
+    }
 }
 
 static mat44_t compute_viewproj(void) {
@@ -203,6 +382,101 @@ static mat44_t compute_viewproj(void) {
     return vm_mul(view, proj);
 }
 
+// one uniform update and draw call per instance
+static void draw_uniforms(void) {
+    state.bind.views[VIEW_tex] = state.view[0];
+    sg_apply_bindings(&state.bind);
+    state.stats.num_binding_updates++;
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    for (int i = 0; i < state.num_instances; i++) {
+        if (++cur_bind_count == state.bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            state.bind.views[VIEW_tex] = state.view[cur_img++];
+            sg_apply_bindings(&state.bind);
+            state.stats.num_binding_updates++;
+        }
+        sg_apply_uniforms(UB_vs_per_instance, &SG_RANGE(positions[i]));
+        state.stats.num_uniform_updates++;
+        sg_draw(0, 36, 1);
+        state.stats.num_draw_calls++;
+    }
+}
+
+// draw a run of instances with the same texture binding
+static void draw_run(sg_view tex_view, int base_instance, int num_instances) {
+    if (state.mode == MODE_STORAGE_BUFFER) {
+        state.sbuf_bind.views[VIEW_tex] = tex_view;
+        sg_apply_bindings(&state.sbuf_bind);
+        state.stats.num_binding_updates++;
+        const vs_per_batch_t vs_per_batch = { .base_instance = base_instance };
+        sg_apply_uniforms(UB_vs_per_batch, &SG_RANGE(vs_per_batch));
+        state.stats.num_uniform_updates++;
+        sg_draw(0, 36, num_instances);
+    } else {
+        state.inst_bind.views[VIEW_tex] = tex_view;
+        sg_apply_bindings(&state.inst_bind);
+        state.stats.num_binding_updates++;
+        sg_draw_ex(0, 36, num_instances, 0, base_instance);
+    }
+    state.stats.num_draw_calls++;
+}
+
+// same texture binding pattern as draw_uniforms(), but with one instanced draw per run of instances
+static void draw_runs(void) {
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    int run_start = 0;
+    sg_view run_view = state.view[0];
+    for (int i = 0; i < state.num_instances; i++) {
+        if (++cur_bind_count == state.bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            if (i > run_start) {
+                draw_run(run_view, run_start, i - run_start);
+            }
+            run_start = i;
+            run_view = state.view[cur_img++];
+        }
+    }
+    if (state.num_instances > run_start) {
+        draw_run(run_view, run_start, state.num_instances - run_start);
+    }
+}
+
+// update texture layers for the single-draw storage buffer, same pattern as draw_uniforms()
+static void update_layered_positions(void) {
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    int layer = 0;
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        if (++cur_bind_count == state.bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            layer = cur_img++;
+        }
+        layered_positions[i].world_pos_layer = positions[i].world_pos;
+        layered_positions[i].world_pos_layer.w = (float)layer;
+    }
+    sg_update_buffer(state.layered_sbuf, &SG_RANGE(layered_positions));
+    state.layered_bind_frequency = state.bind_frequency;
+}
+
+// all instances with a single draw call
+static void draw_single(void) {
+    sg_apply_bindings(&state.single_bind);
+    state.stats.num_binding_updates++;
+    sg_draw(0, 36, state.num_instances);
+    state.stats.num_draw_calls++;
+}
+
 static void frame(void) {
     drawui();
 
@@ -211,6 +485,12 @@ static void frame(void) {
     } else if (state.num_instances > MAX_INSTANCES) {
         state.num_instances = MAX_INSTANCES;
     }
+    if (!state.mode_supported[state.mode]) {
+        state.mode = MODE_UNIFORMS;
+    }
+    if ((state.mode == MODE_SINGLE_DRAW) && (state.layered_bind_frequency != state.bind_frequency)) {
+        update_layered_positions();
+    }
 
     // view-proj matrix for the frame
     const vs_per_frame_t vs_per_frame = {
@@ -222,30 +502,18 @@ static void frame(void) {
     state.stats.num_draw_calls = 0;
 
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
-    sg_apply_pipeline(state.pip);
+    const uint64_t submit_start = stm_now();
+    sg_apply_pipeline(state.pip[state.mode]);
     sg_apply_uniforms(UB_vs_per_frame, &SG_RANGE(vs_per_frame));
     state.stats.num_uniform_updates++;
-
-    state.bind.views[VIEW_tex] = state.view[0];
-    sg_apply_bindings(&state.bind);
-    state.stats.num_binding_updates++;
-    int cur_bind_count = 0;
-    int cur_img = 0;
-    for (int i = 0; i < state.num_instances; i++) {
-        if (++cur_bind_count == state.bind_frequency) {
-            cur_bind_count = 0;
-            if (cur_img == NUM_IMAGES) {
-                cur_img = 0;
-            }
-            state.bind.views[VIEW_tex] = state.view[cur_img++];
-            sg_apply_bindings(&state.bind);
-            state.stats.num_binding_updates++;
-        }
-        sg_apply_uniforms(UB_vs_per_instance, &SG_RANGE(positions[i]));
-        state.stats.num_uniform_updates++;
-        sg_draw(0, 36, 1);
-        state.stats.num_draw_calls++;
+    switch (state.mode) {
+        case MODE_UNIFORMS: draw_uniforms(); break;
+        case MODE_SINGLE_DRAW: draw_single(); break;
+        default: draw_runs(); break;
     }
+    const double submit_ms = stm_ms(stm_since(submit_start));
+    double* avg_ms = &state.submit_ms[state.mode];
+    *avg_ms = (*avg_ms == 0.0) ? submit_ms : (*avg_ms * 0.95 + submit_ms * 0.05);
     simgui_render();
     sg_end_pass();
     sg_commit();
@@ -282,10 +550,15 @@ static void drawui(void) {
 
     // control ui
     igSetNextWindowPos((ImVec2){20,20}, ImGuiCond_Once);
-    igSetNextWindowSize((ImVec2){600,200}, ImGuiCond_Once);
+    igSetNextWindowSize((ImVec2){600,340}, ImGuiCond_Once);
     if (igBegin("Controls", 0, ImGuiWindowFlags_NoResize)) {
-        igText("Each cube/instance is 1 16-byte uniform update and 1 draw call\n");
-        igText("DC/texture is the number of adjacent draw calls with the same texture binding\n");
+        igText("In Uniforms mode each cube/instance is 1 16-byte uniform update and 1 draw call\n");
+        igText("DC/texture is the number of adjacent instances with the same texture binding\n");
+        if (igComboChar("Mode", (int*)&state.mode, mode_names, NUM_MODES)) {
+            if (!state.mode_supported[state.mode]) {
+                state.mode = MODE_UNIFORMS;
+            }
+        }
         igSliderIntEx("Num Instances", &state.num_instances, 100, MAX_INSTANCES, "%d", ImGuiSliderFlags_Logarithmic);
         igSliderIntEx("DC/texture", &state.bind_frequency, 1, MAX_BIND_FREQUENCY, "%d", ImGuiSliderFlags_Logarithmic);
         igText("Backend: %s", state.backend);
@@ -293,6 +566,16 @@ static void drawui(void) {
         igText("sg_apply_bindings(): %d\n", state.stats.num_binding_updates);
         igText("sg_apply_uniforms(): %d\n", state.stats.num_uniform_updates);
         igText("sg_draw(): %d\n", state.stats.num_draw_calls);
+        igSeparatorText("CPU time to record draw calls");
+        for (int i = 0; i < NUM_MODES; i++) {
+            if (!state.mode_supported[i]) {
+                igText("%s: not supported", mode_names[i]);
+            } else if (state.submit_ms[i] > 0.0) {
+                igText("%s: %.4fms", mode_names[i], state.submit_ms[i]);
+            } else {
+                igText("%s: -", mode_names[i]);
+            }
+        }
     }
     igEnd();
     sgimgui_draw();
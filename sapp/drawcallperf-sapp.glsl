@@ -1,28 +1,102 @@
 @ctype mat4 mat44_t
 @ctype vec4 vec4_t
 
-@vs vs
+@block per_frame
 layout(binding=0) uniform vs_per_frame {
     mat4 viewproj;
 };
+@end
 
-layout(binding=1) uniform vs_per_instance {
-    vec4 world_pos;
-};
-
+@block vs_outputs
 in vec3 in_pos;
 in vec2 in_uv;
 in float in_bright;
 out vec2 uv;
 out float bright;
+@end
+
+// one uniform update per instance
+@vs vs
+@include_block per_frame
+
+layout(binding=1) uniform vs_per_instance {
+    vec4 world_pos;
+};
+
+@include_block vs_outputs
+
+void main() {
+    gl_Position = viewproj * (world_pos + vec4(in_pos * 0.05, 1.0));
+    uv = in_uv;
+    bright = in_bright;
+}
+@end
+
+// per-instance data in a storage buffer, one instanced draw per texture run
+@vs vs_sbuf
+@include_block per_frame
+
+layout(binding=1) uniform vs_per_batch {
+    int base_instance;
+};
+
+struct sb_instance {
+    vec4 world_pos;
+};
+
+layout(binding=1) readonly buffer instances {
+    sb_instance inst[];
+};
+
+@include_block vs_outputs
 
 void main() {
+    const vec4 world_pos = inst[base_instance + gl_InstanceIndex].world_pos;
     gl_Position = viewproj * (world_pos + vec4(in_pos * 0.05, 1.0));
     uv = in_uv;
     bright = in_bright;
 }
 @end
 
+// per-instance data in an instance-step vertex buffer, drawn with a base instance
+@vs vs_inst
+@include_block per_frame
+
+in vec4 inst_world_pos;
+
+@include_block vs_outputs
+
+void main() {
+    gl_Position = viewproj * (inst_world_pos + vec4(in_pos * 0.05, 1.0));
+    uv = in_uv;
+    bright = in_bright;
+}
+@end
+
+// storage buffer with the texture layer in world_pos.w, a single draw for all instances
+@vs vs_single
+@include_block per_frame
+
+struct sb_layered_instance {
+    vec4 world_pos_layer;
+};
+
+layout(binding=1) readonly buffer layered_instances {
+    sb_layered_instance layered_inst[];
+};
+
+@include_block vs_outputs
+out float layer;
+
+void main() {
+    const vec4 world_pos_layer = layered_inst[gl_InstanceIndex].world_pos_layer;
+    gl_Position = viewproj * (vec4(world_pos_layer.xyz, 0.0) + vec4(in_pos * 0.05, 1.0));
+    uv = in_uv;
+    bright = in_bright;
+    layer = world_pos_layer.w;
+}
+@end
+
 @fs fs
 layout(binding=0) uniform texture2D tex;
 layout(binding=0) uniform sampler smp;
@@ -36,4 +110,21 @@ void main() {
 }
 @end
 
+@fs fs_single
+layout(binding=0) uniform texture2DArray tex_array;
+layout(binding=0) uniform sampler smp_array;
+
+in vec2 uv;
+in float bright;
+in float layer;
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(texture(sampler2DArray(tex_array, smp_array), vec3(uv, layer)).xyz * bright, 1.0);
+}
+@end
+
 @program drawcallperf vs fs
+@program sbuf vs_sbuf fs
+@program inst vs_inst fs
+@program single vs_single fs_single
@@ -1,34 +1,73 @@
 //------------------------------------------------------------------------------
 //  dyntex-sapp.c
 //  Update dynamic texture with CPU-generated data each frame.
+//
+//  The texture content is a Game-of-Life simulation, with the cells
+//  bit-packed into 64-bit words (64 cells per word, the leftmost cell in
+//  the least significant bit). The 8 neighbours of 64 cells are counted at
+//  once with a bit-sliced adder, and the rows of the grid are split across
+//  threads of the job system in util/jobs.h. Only for the final upload are
+//  the cell bits expanded into an R8 texture, the shader maps them to colors.
+//
+//  Keys:
+//      up/down:    change grid size (64x64 up to 4096x4096)
+//      left/right: change number of generations per frame
 //------------------------------------------------------------------------------
-#include <stdlib.h> /* rand */
+#include <stdlib.h>
+#include <string.h>
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
+#include "util/jobs.h"
 #include "dbgui/dbgui.h"
 #include "dyntex-sapp.glsl.h"
 
-#define IMAGE_WIDTH (64)
-#define IMAGE_HEIGHT (64)
-#define LIVING (0xFFFFFFFF)
-#define DEAD (0xFF000000)
+#define MIN_GRID_SIZE (64)
+#define MAX_GRID_SIZE (4096)
+#define MAX_GENERATIONS_PER_FRAME (64)
+#define RESET_GENERATIONS (240)
+#define MAX_CHUNKS (4 * (JOBS_MAX_THREADS + 1))
+
+// a range of grid rows processed by one job
+typedef struct {
+    int y0, y1;
+} row_chunk_t;
 
 static struct {
     sg_pass_action pass_action;
     sg_pipeline pip;
     sg_image img;
+    sg_view tex_view;
     sg_bindings bind;
     float rx, ry;
     int update_count;
-    uint32_t pixels[IMAGE_WIDTH][IMAGE_HEIGHT];
-} state;
+    int grid_size;              // width and height in cells, a power of two
+    int words_per_row;
+    int cur;                    // index of the current generation in cells[]
+    uint64_t* cells[2];         // double-buffered bit-packed cell state
+    uint8_t* pixels;            // one byte per cell for the texture upload
+    int generations_per_frame;
+    double step_ms;             // smoothed time per generation
+    double upload_ms;           // smoothed time to expand and upload the texture
+    int num_chunks;
+    row_chunk_t chunks[MAX_CHUNKS];
+} state = {
+    .grid_size = MIN_GRID_SIZE,
+    .generations_per_frame = 1,
+};
+
+static uint64_t expand_lut[256];
 
-static void game_of_life_init();
-static void game_of_life_update();
+static void game_of_life_init(void);
+static void game_of_life_update(void);
+static void create_grid(int grid_size);
+static void expand_pixels(void);
 static vs_params_t compute_vsparams(float rx, float ry);
 
 static void init(void) {
@@ -37,20 +76,30 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup();
-
-    // a 128x128 image and texture view with streaming update strategy
-    state.img = sg_make_image(&(sg_image_desc){
-        .width = IMAGE_WIDTH,
-        .height = IMAGE_HEIGHT,
-        .pixel_format = SG_PIXELFORMAT_RGBA8,
-        .usage.stream_update = true,
-        .label = "dynamic-texture"
-    });
-    sg_view tex_view = sg_make_view(&(sg_view_desc){
-        .texture = { .image = state.img },
-        .label = "dynamic-texture-view",
+    stm_setup();
+    jobs_setup(&(jobs_desc_t){0});
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
     });
 
+    // lookup table to expand 8 cell bits into 8 bytes
+    for (int i = 0; i < 256; i++) {
+        uint64_t val = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (i & (1 << bit)) {
+                val |= (uint64_t)0xFF << (bit * 8);
+            }
+        }
+        expand_lut[i] = val;
+    }
+
+    // cell buffers for the largest grid size
+    const size_t max_words = (MAX_GRID_SIZE / 64) * MAX_GRID_SIZE;
+    state.cells[0] = calloc(max_words, sizeof(uint64_t));
+    state.cells[1] = calloc(max_words, sizeof(uint64_t));
+    state.pixels = calloc(MAX_GRID_SIZE * MAX_GRID_SIZE, 1);
+
     // a sampler object
     sg_sampler smp = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_LINEAR,
@@ -133,15 +182,57 @@ static void init(void) {
         .label = "cube-pipelin"
     });
 
-    // setup the resource bindings
+    // setup the resource bindings, the texture view is created in create_grid()
     state.bind = (sg_bindings) {
         .vertex_buffers[0] = vbuf,
         .index_buffer = ibuf,
-        .views[VIEW_tex] = tex_view,
         .samplers[SMP_smp] = smp,
     };
 
-    // initialize the game-of-life state
+    // create the texture and initialize the game-of-life state
+    create_grid(state.grid_size);
+}
+
+// (re-)create the dynamic texture for a grid size, and split the rows into chunks for the job system
+static void create_grid(int grid_size) {
+    state.grid_size = grid_size;
+    state.words_per_row = grid_size / 64;
+    if (state.img.id != SG_INVALID_ID) {
+        sg_destroy_view(state.tex_view);
+        sg_destroy_image(state.img);
+    }
+
+    // a single-channel image and texture view with streaming update strategy
+    state.img = sg_make_image(&(sg_image_desc){
+        .width = grid_size,
+        .height = grid_size,
+        .pixel_format = SG_PIXELFORMAT_R8,
+        .usage.stream_update = true,
+        .label = "dynamic-texture"
+    });
+    state.tex_view = sg_make_view(&(sg_view_desc){
+        .texture = { .image = state.img },
+        .label = "dynamic-texture-view",
+    });
+    state.bind.views[VIEW_tex] = state.tex_view;
+
+    // more chunks than threads to balance the work
+    int num_chunks = (jobs_num_threads() + 1) * 4;
+    if (num_chunks > MAX_CHUNKS) {
+        num_chunks = MAX_CHUNKS;
+    }
+    if (num_chunks > grid_size) {
+        num_chunks = grid_size;
+    }
+    state.num_chunks = num_chunks;
+    for (int i = 0; i < num_chunks; i++) {
+        state.chunks[i] = (row_chunk_t){
+            .y0 = (grid_size * i) / num_chunks,
+            .y1 = (grid_size * (i + 1)) / num_chunks,
+        };
+    }
+    state.step_ms = 0.0;
+    state.upload_ms = 0.0;
     game_of_life_init();
 }
 
@@ -151,12 +242,32 @@ static void frame(void) {
     const vs_params_t vs_params = compute_vsparams(state.rx, state.ry);
 
     // update game-of-life state
-    game_of_life_update();
+    uint64_t start = stm_now();
+    for (int i = 0; i < state.generations_per_frame; i++) {
+        game_of_life_update();
+    }
+    const double step_ms = stm_ms(stm_since(start)) / state.generations_per_frame;
+    state.step_ms = (state.step_ms == 0.0) ? step_ms : (state.step_ms * 0.95 + step_ms * 0.05);
 
-    // update the texture
+    // expand the cell bits into bytes and update the texture
+    start = stm_now();
+    expand_pixels();
     sg_update_image(state.img, &(sg_image_data){
-        .mip_levels[0] = SG_RANGE(state.pixels)
+        .mip_levels[0] = { .ptr = state.pixels, .size = (size_t)(state.grid_size * state.grid_size) }
     });
+    const double upload_ms = stm_ms(stm_since(start));
+    state.upload_ms = (state.upload_ms == 0.0) ? upload_ms : (state.upload_ms * 0.95 + upload_ms * 0.05);
+
+    // performance readout
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 2.0f);
+    sdtx_printf("grid:        %dx%d\n", state.grid_size, state.grid_size);
+    sdtx_printf("threads:     %d\n", jobs_num_threads() + 1);
+    sdtx_printf("gens/frame:  %d\n", state.generations_per_frame);
+    sdtx_printf("step:        %.3f ms\n", state.step_ms);
+    sdtx_printf("gens/sec:    %.0f\n", (state.step_ms > 0.0) ? (1000.0 / state.step_ms) : 0.0);
+    sdtx_printf("upload:      %.3f ms\n\n", state.upload_ms);
+    sdtx_puts("up/down:    grid size\nleft/right: gens/frame");
 
     // render the frame
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
@@ -164,14 +275,50 @@ static void frame(void) {
     sg_apply_bindings(&state.bind);
     sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
     sg_draw(0, 36, 1);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
 }
 
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        switch (ev->key_code) {
+            case SAPP_KEYCODE_UP:
+                if (state.grid_size < MAX_GRID_SIZE) {
+                    create_grid(state.grid_size * 2);
+                }
+                break;
+            case SAPP_KEYCODE_DOWN:
+                if (state.grid_size > MIN_GRID_SIZE) {
+                    create_grid(state.grid_size / 2);
+                }
+                break;
+            case SAPP_KEYCODE_RIGHT:
+                if (state.generations_per_frame < MAX_GENERATIONS_PER_FRAME) {
+                    state.generations_per_frame *= 2;
+                }
+                break;
+            case SAPP_KEYCODE_LEFT:
+                if (state.generations_per_frame > 1) {
+                    state.generations_per_frame /= 2;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    __dbgui_event(ev);
+}
+
 static void cleanup(void) {
     __dbgui_shutdown();
+    sdtx_shutdown();
+    jobs_shutdown();
     sg_shutdown();
+    free(state.cells[0]);
+    free(state.cells[1]);
+    free(state.pixels);
 }
 
 static vs_params_t compute_vsparams(float rx, float ry) {
@@ -186,53 +333,130 @@ static vs_params_t compute_vsparams(float rx, float ry) {
     return (vs_params_t){ .mvp = vm_mul(model, view_proj) };
 }
 
-static void game_of_life_init() {
-    for (int y = 0; y < IMAGE_HEIGHT; y++) {
-        for (int x = 0; x < IMAGE_WIDTH; x++) {
-            if ((rand() & 255) > 230) {
-                state.pixels[y][x] = LIVING;
-            } else {
-                state.pixels[y][x] = DEAD;
-            }
+static inline uint64_t xorshift64(void) {
+    static uint64_t x = 0x2545F4914F6CDD1DULL;
+    x ^= x<<13;
+    x ^= x>>7;
+    x ^= x<<17;
+    return x;
+}
+
+// initialize a random grid with roughly 12.5% living cells
+static void game_of_life_init(void) {
+    const int num_words = state.words_per_row * state.grid_size;
+    uint64_t* cells = state.cells[state.cur];
+    for (int i = 0; i < num_words; i++) {
+        cells[i] = xorshift64() & xorshift64() & xorshift64();
+    }
+}
+
+// the 8 neighbour bits of 64 cells, each neighbour shifted into the cell's bit position
+typedef struct {
+    uint64_t n[8];
+} neighbours_t;
+
+static inline void half_add(uint64_t a, uint64_t b, uint64_t* sum, uint64_t* carry) {
+    *sum = a ^ b;
+    *carry = a & b;
+}
+
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t* sum, uint64_t* carry) {
+    const uint64_t t = a ^ b;
+    *sum = t ^ c;
+    *carry = (a & b) | (t & c);
+}
+
+// compute the next state of 64 cells from their neighbour bits with a bit-sliced adder
+static inline uint64_t life_rule(uint64_t alive, const neighbours_t* nb) {
+    // add up the upper, lower and middle neighbour rows into 2-bit sums
+    uint64_t up_ones, up_twos, down_ones, down_twos, mid_ones, mid_twos;
+    full_add(nb->n[0], nb->n[1], nb->n[2], &up_ones, &up_twos);
+    full_add(nb->n[5], nb->n[6], nb->n[7], &down_ones, &down_twos);
+    half_add(nb->n[3], nb->n[4], &mid_ones, &mid_twos);
+    // add the three 2-bit sums
+    uint64_t ones, ones_carry;
+    full_add(up_ones, down_ones, mid_ones, &ones, &ones_carry);
+    uint64_t twos_sum, fours_a;
+    full_add(up_twos, down_twos, mid_twos, &twos_sum, &fours_a);
+    uint64_t twos, fours_b;
+    half_add(twos_sum, ones_carry, &twos, &fours_b);
+    // a cell lives with exactly 3 neighbours, or with 2 neighbours if it was alive
+    const uint64_t four_or_more = fours_a | fours_b;
+    return twos & ~four_or_more & (ones | alive);
+}
+
+// gather the 8 neighbours of 64 cells from the rows above, at and below, the grid wraps around at the edges
+static inline void gather_neighbours(const uint64_t* up, const uint64_t* mid, const uint64_t* down, int x, int wx_mask, neighbours_t* nb) {
+    const int xl = (x - 1) & wx_mask;
+    const int xr = (x + 1) & wx_mask;
+    const uint64_t* rows[3] = { up, mid, down };
+    uint64_t west[3], east[3];
+    for (int i = 0; i < 3; i++) {
+        const uint64_t c = rows[i][x];
+        west[i] = (c << 1) | (rows[i][xl] >> 63);
+        east[i] = (c >> 1) | (rows[i][xr] << 63);
+    }
+    nb->n[0] = west[0]; nb->n[1] = up[x];   nb->n[2] = east[0];
+    nb->n[3] = west[1];                     nb->n[4] = east[1];
+    nb->n[5] = west[2]; nb->n[6] = down[x]; nb->n[7] = east[2];
+}
+
+static void step_rows(void* user_data) {
+    const row_chunk_t* chunk = (const row_chunk_t*) user_data;
+    const int wpr = state.words_per_row;
+    const int y_mask = state.grid_size - 1;
+    const uint64_t* src = state.cells[state.cur];
+    uint64_t* dst = state.cells[state.cur ^ 1];
+    for (int y = chunk->y0; y < chunk->y1; y++) {
+        const uint64_t* up = &src[((y - 1) & y_mask) * wpr];
+        const uint64_t* mid = &src[y * wpr];
+        const uint64_t* down = &src[((y + 1) & y_mask) * wpr];
+        uint64_t* out = &dst[y * wpr];
+        for (int x = 0; x < wpr; x++) {
+            neighbours_t nb;
+            gather_neighbours(up, mid, down, x, wpr - 1, &nb);
+            out[x] = life_rule(mid[x], &nb);
         }
     }
 }
 
-static void game_of_life_update() {
-    for (int y = 0; y < IMAGE_HEIGHT; y++) {
-        for (int x = 0; x < IMAGE_WIDTH; x++) {
-            int num_living_neighbours = 0;
-            for (int ny = -1; ny < 2; ny++) {
-                for (int nx = -1; nx < 2; nx++) {
-                    if ((nx == 0) && (ny == 0)) {
-                        continue;
-                    }
-                    if (state.pixels[(y+ny)&(IMAGE_HEIGHT-1)][(x+nx)&(IMAGE_WIDTH-1)] == LIVING) {
-                        num_living_neighbours++;
-                    }
-                }
-            }
-            // any live cell...
-            if (state.pixels[y][x] == LIVING) {
-                if (num_living_neighbours < 2) {
-                    /* ... with fewer than 2 living neighbours dies, as if caused by underpopulation */
-                    state.pixels[y][x] = DEAD;
-                } else if (num_living_neighbours > 3) {
-                    /* ... with more than 3 living neighbours dies, as if caused by overpopulation */
-                    state.pixels[y][x] = DEAD;
-                }
-            } else if (num_living_neighbours == 3) {
-                // any dead cell with exactly 3 living neighbours becomes a live cell, as if by reproduction
-                state.pixels[y][x] = LIVING;
+static void expand_rows(void* user_data) {
+    const row_chunk_t* chunk = (const row_chunk_t*) user_data;
+    const int wpr = state.words_per_row;
+    const uint64_t* src = state.cells[state.cur];
+    for (int y = chunk->y0; y < chunk->y1; y++) {
+        uint8_t* dst = &state.pixels[y * state.grid_size];
+        for (int x = 0; x < wpr; x++) {
+            const uint64_t bits = src[y * wpr + x];
+            for (int i = 0; i < 8; i++) {
+                const uint64_t bytes = expand_lut[(bits >> (i * 8)) & 0xFF];
+                memcpy(&dst[x * 64 + i * 8], &bytes, sizeof(bytes));
             }
         }
     }
-    if (state.update_count++ > 240) {
+}
+
+static void run_chunks(jobs_func_t func) {
+    jobs_group_t group = {0};
+    for (int i = 0; i < state.num_chunks; i++) {
+        jobs_push(&group, func, &state.chunks[i]);
+    }
+    jobs_wait(&group);
+}
+
+static void game_of_life_update(void) {
+    run_chunks(step_rows);
+    state.cur ^= 1;
+    if (state.update_count++ > RESET_GENERATIONS) {
         game_of_life_init();
         state.update_count = 0;
     }
 }
 
+static void expand_pixels(void) {
+    run_chunks(expand_rows);
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -240,7 +464,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 800,
         .height = 600,
         .sample_count = 4,
@@ -30,7 +30,8 @@ layout(location=1) in vec2 uv;
 out vec4 frag_color;
 
 void main() {
-    frag_color = texture(sampler2D(tex, smp), uv) * color;
+    // the texture is a single-channel cell state, living cells are white, dead cells black
+    frag_color = vec4(texture(sampler2D(tex, smp), uv).rrr, 1.0) * color;
 }
 @end
 
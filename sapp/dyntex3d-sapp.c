@@ -3,6 +3,13 @@
 //
 //  Test/demo immutable and dynamically updated 3D texture for various
 //  texture sizes.
+//
+//  sokol-gfx can only update an entire image, so the 'Dirty Regions' update
+//  mode tracks a small list of dirty rectangles per slice in the drawing
+//  functions (each changed line span adds a rectangle), and only uploads
+//  the texels inside those rectangles: they are gathered into a stream
+//  vertex buffer (one RGBA8 color per texel) and rendered as points into
+//  the matching slice of the 3D texture via per-slice color attachment views.
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -18,14 +25,40 @@
 #include "sokol_app_imgui.h"
 #include <assert.h> // assert()
 #include <string.h> // memset()
+#include <stdlib.h> // calloc(), free()
+#include <limits.h> // INT_MAX
 
 #define MIN_WIDTH_HEIGHT (16)
-#define MAX_WIDTH_HEIGHT (256)
+#define MAX_WIDTH_HEIGHT (1024)
 #define DEPTH (3)
+#define MAX_DIRTY_RECTS (8)     // per slice, more rectangles are merged
 #define RED 0xFF0000FF
 #define GREEN 0xFF00FF00
 #define BLUE 0xFFFF0000
 
+typedef enum {
+    UPDATE_IMMUTABLE,       // initialize once at creation time
+    UPDATE_STREAM,          // upload the whole image each frame
+    UPDATE_DIRTY_REGIONS,   // only upload changed texels
+    NUM_UPDATE_MODES,
+} update_mode_t;
+
+static const char* update_mode_names[NUM_UPDATE_MODES] = {
+    "Immutable",
+    "Stream (Full)",
+    "Dirty Regions",
+};
+
+// a dirty rectangle in one slice, x1/y1 are exclusive
+typedef struct {
+    int x0, y0, x1, y1;
+} dirty_rect_t;
+
+typedef struct {
+    int num;
+    dirty_rect_t rects[MAX_DIRTY_RECTS];
+} dirty_list_t;
+
 static struct {
     sg_pass_action pass_action;
     sg_pipeline pip;
@@ -33,16 +66,31 @@ static struct {
     sg_view texview;
     sg_bindings bind;
     int width_height;
-    bool immutable;
+    int update_mode;
+    struct {
+        sg_pass_action pass_action;
+        sg_pipeline pip;
+        sg_buffer vbuf;
+        sg_view att_views[DEPTH];
+        dirty_list_t dirty[DEPTH];
+    } upload;
+    int line_pos[DEPTH];        // position of the moving lines, -1 if not drawn yet
+    size_t bytes_uploaded;      // in the current frame
+    double avg_bytes_uploaded;
 } state = {
     .width_height = 16,
-    .immutable = false,
+    .update_mode = UPDATE_DIRTY_REGIONS,
 };
 
-static uint32_t pixels[DEPTH * MAX_WIDTH_HEIGHT * MAX_WIDTH_HEIGHT];
+// sized for the current image size in recreate_image()
+static uint32_t* pixels;
+// dirty texels gathered for the upload, in the order they are drawn as points
+static uint32_t* staging;
 
 static void recreate_image(void);
 static void update_pixels(uint64_t frame_count);
+static void upload_dirty_regions(void);
+static void clear_dirty(void);
 static void draw_ui(void);
 static sg_range pixels_as_range(void);
 
@@ -72,8 +120,25 @@ static void init(void) {
         .label = "pipeline",
     });
 
+    // resources for uploading dirty regions, one point per texel rendered into a 3D texture slice
+    state.upload.pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_LOAD },
+    };
+    state.upload.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(upload_shader_desc(sg_query_backend())),
+        .layout.attrs[ATTR_upload_color0].format = SG_VERTEXFORMAT_UBYTE4N,
+        .primitive_type = SG_PRIMITIVETYPE_POINTS,
+        .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+        .depth.pixel_format = SG_PIXELFORMAT_NONE,
+        .sample_count = 1,
+        .label = "upload-pipeline",
+    });
+    state.upload.vbuf = sg_alloc_buffer();
     state.img = sg_alloc_image();
     state.texview = sg_alloc_view();
+    for (int i = 0; i < DEPTH; i++) {
+        state.upload.att_views[i] = sg_alloc_view();
+    }
     state.bind.views[VIEW_tex] = state.texview;
     recreate_image();
 
@@ -88,10 +153,18 @@ static void init(void) {
 }
 
 static void frame(void) {
-    if (!state.immutable) {
+    state.bytes_uploaded = 0;
+    if (state.update_mode == UPDATE_STREAM) {
+        update_pixels(sapp_frame_count());
+        const sg_range range = pixels_as_range();
+        sg_update_image(state.img, &(sg_image_data){ .mip_levels[0] = range });
+        state.bytes_uploaded = range.size;
+        clear_dirty();
+    } else if (state.update_mode == UPDATE_DIRTY_REGIONS) {
         update_pixels(sapp_frame_count());
-        sg_update_image(state.img, &(sg_image_data){ .mip_levels[0] = pixels_as_range() });
+        upload_dirty_regions();
     }
+    state.avg_bytes_uploaded = state.avg_bytes_uploaded * 0.95 + (double)state.bytes_uploaded * 0.05;
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
     sg_apply_pipeline(state.pip);
     sg_apply_bindings(&state.bind);
@@ -111,6 +184,8 @@ static void input(const sapp_event* ev) {
 }
 
 static void cleanup(void) {
+    free(pixels);
+    free(staging);
     sappimgui_shutdown();
     sgimgui_shutdown();
     simgui_shutdown();
@@ -131,15 +206,17 @@ static void draw_ui(void) {
         igEndMainMenuBar();
     }
     igSetNextWindowPos((ImVec2){20, 40}, ImGuiCond_Once);
-    igSetNextWindowSize((ImVec2){220, 150}, ImGuiCond_Once);
+    igSetNextWindowSize((ImVec2){260, 150}, ImGuiCond_Once);
     igSetNextWindowBgAlpha(0.35f);
     if (igBegin("Controls", 0, ImGuiWindowFlags_NoDecoration|ImGuiWindowFlags_AlwaysAutoResize)) {
         if (igSliderIntEx("Size", &state.width_height, MIN_WIDTH_HEIGHT, MAX_WIDTH_HEIGHT, "%d", ImGuiSliderFlags_Logarithmic)) {
             recreate_image();
         }
-        if (igCheckbox("Immutable", &state.immutable)) {
+        if (igComboChar("Update", &state.update_mode, update_mode_names, NUM_UPDATE_MODES)) {
             recreate_image();
         }
+        igText("Uploaded: %.1f KB/frame", (double)state.bytes_uploaded / 1024.0);
+        igText("Average:  %.1f KB/frame", state.avg_bytes_uploaded / 1024.0);
     }
     igEnd();
     sgimgui_draw();
@@ -147,11 +224,12 @@ static void draw_ui(void) {
     simgui_render();
 }
 
+static size_t image_num_bytes(void) {
+    return DEPTH * (size_t)(state.width_height * state.width_height) * sizeof(uint32_t);
+}
+
 static sg_range pixels_as_range(void) {
-    return (sg_range){
-        .ptr = pixels,
-        .size = DEPTH * (size_t)(state.width_height * state.width_height) * sizeof(uint32_t)
-    };
+    return (sg_range){ .ptr = pixels, .size = image_num_bytes() };
 }
 
 static void recreate_image(void) {
@@ -159,25 +237,167 @@ static void recreate_image(void) {
         sg_uninit_image(state.img);
         sg_uninit_view(state.texview);
     }
+    for (int i = 0; i < DEPTH; i++) {
+        if (sg_query_view_state(state.upload.att_views[i]) == SG_RESOURCESTATE_VALID) {
+            sg_uninit_view(state.upload.att_views[i]);
+        }
+    }
+    if (sg_query_buffer_state(state.upload.vbuf) == SG_RESOURCESTATE_VALID) {
+        sg_uninit_buffer(state.upload.vbuf);
+    }
+    // start from scratch, the first update marks everything that's drawn as dirty
+    free(pixels);
+    free(staging);
+    pixels = (uint32_t*) calloc(1, image_num_bytes());
+    staging = 0;
+    assert(pixels);
+    for (int i = 0; i < DEPTH; i++) {
+        state.line_pos[i] = -1;
+    }
+    clear_dirty();
     update_pixels(sapp_frame_count());
+
+    const bool immutable = state.update_mode == UPDATE_IMMUTABLE;
+    const bool dirty_regions = state.update_mode == UPDATE_DIRTY_REGIONS;
     sg_init_image(state.img, &(sg_image_desc){
         .type = SG_IMAGETYPE_3D,
         .usage = {
-            .immutable = state.immutable,
-            .stream_update = !state.immutable,
+            .immutable = state.update_mode != UPDATE_STREAM,
+            .stream_update = state.update_mode == UPDATE_STREAM,
+            .color_attachment = dirty_regions,
         },
         .width = state.width_height,
         .height = state.width_height,
         .num_slices = DEPTH,
         .num_mipmaps = 1,
         .pixel_format = SG_PIXELFORMAT_RGBA8,
-        .data.mip_levels[0] = state.immutable ? pixels_as_range() : (sg_range){0},
+        .data.mip_levels[0] = immutable ? pixels_as_range() : (sg_range){0},
         .label = "image",
     });
     sg_init_view(state.texview, &(sg_view_desc){
         .texture = { .image = state.img },
         .label = "texture-view",
     });
+    if (dirty_regions) {
+        // staging memory is sized for the full-image upload on the first frame
+        staging = (uint32_t*) malloc(image_num_bytes());
+        assert(staging);
+        sg_init_buffer(state.upload.vbuf, &(sg_buffer_desc){
+            .usage.stream_update = true,
+            .size = image_num_bytes(),
+            .label = "upload-staging-buffer",
+        });
+        // render attachments have undefined content, so upload the entire image on the first frame
+        for (int i = 0; i < DEPTH; i++) {
+            sg_init_view(state.upload.att_views[i], &(sg_view_desc){
+                .color_attachment = { .image = state.img, .slice = i },
+                .label = "upload-attachment-view",
+            });
+            state.upload.dirty[i].num = 1;
+            state.upload.dirty[i].rects[0] = (dirty_rect_t){ 0, 0, state.width_height, state.width_height };
+        }
+    }
+}
+
+static void clear_dirty(void) {
+    for (int i = 0; i < DEPTH; i++) {
+        state.upload.dirty[i].num = 0;
+    }
+}
+
+static inline int rect_area(dirty_rect_t r) {
+    return (r.x1 - r.x0) * (r.y1 - r.y0);
+}
+
+static inline dirty_rect_t rect_union(dirty_rect_t a, dirty_rect_t b) {
+    return (dirty_rect_t){
+        (a.x0 < b.x0) ? a.x0 : b.x0,
+        (a.y0 < b.y0) ? a.y0 : b.y0,
+        (a.x1 > b.x1) ? a.x1 : b.x1,
+        (a.y1 > b.y1) ? a.y1 : b.y1,
+    };
+}
+
+// add a dirty rectangle to a slice, merged into an existing rectangle if that doesn't
+// add any clean texels (e.g. the same line erased and redrawn), or if the list is full
+// into the rectangle which grows the least
+static void mark_dirty(int z, dirty_rect_t rect) {
+    dirty_list_t* list = &state.upload.dirty[z];
+    int best = -1;
+    int best_growth = 0;
+    for (int i = 0; i < list->num; i++) {
+        const dirty_rect_t merged = rect_union(list->rects[i], rect);
+        const int growth = rect_area(merged) - rect_area(list->rects[i]) - rect_area(rect);
+        if (growth <= 0) {
+            list->rects[i] = merged;
+            return;
+        }
+        if ((best < 0) || (growth < best_growth)) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    if (list->num < MAX_DIRTY_RECTS) {
+        list->rects[list->num++] = rect;
+    } else {
+        list->rects[best] = rect_union(list->rects[best], rect);
+    }
+}
+
+// gather the dirty rectangles into the staging buffer and render them into the 3D texture slices
+static void upload_dirty_regions(void) {
+    const int wh = state.width_height;
+    int rect_offsets[DEPTH][MAX_DIRTY_RECTS];
+    size_t num_texels = 0;
+    for (int z = 0; z < DEPTH; z++) {
+        const dirty_list_t* list = &state.upload.dirty[z];
+        for (int i = 0; i < list->num; i++) {
+            const dirty_rect_t* rect = &list->rects[i];
+            rect_offsets[z][i] = (int)(num_texels * sizeof(uint32_t));
+            const int rect_width = rect->x1 - rect->x0;
+            for (int y = rect->y0; y < rect->y1; y++) {
+                memcpy(&staging[num_texels], &pixels[z * wh * wh + y * wh + rect->x0], (size_t)rect_width * sizeof(uint32_t));
+                num_texels += (size_t)rect_width;
+            }
+        }
+    }
+    if (num_texels == 0) {
+        return;
+    }
+    const int base_offset = sg_append_buffer(state.upload.vbuf, &(sg_range){ .ptr = staging, .size = num_texels * sizeof(uint32_t) });
+    state.bytes_uploaded = num_texels * sizeof(uint32_t);
+
+    const float y_flip = sg_query_features().origin_top_left ? -1.0f : 1.0f;
+    for (int z = 0; z < DEPTH; z++) {
+        const dirty_list_t* list = &state.upload.dirty[z];
+        if (list->num == 0) {
+            continue;
+        }
+        sg_begin_pass(&(sg_pass){
+            .action = state.upload.pass_action,
+            .attachments.colors[0] = state.upload.att_views[z],
+        });
+        sg_apply_pipeline(state.upload.pip);
+        for (int i = 0; i < list->num; i++) {
+            const dirty_rect_t* rect = &list->rects[i];
+            const int rect_width = rect->x1 - rect->x0;
+            const int rect_height = rect->y1 - rect->y0;
+            const vs_upload_params_t vs_params = {
+                .box_pos = { (float)rect->x0, (float)rect->y0 },
+                .tex_size = { (float)wh, (float)wh },
+                .box_width = rect_width,
+                .y_flip = y_flip,
+            };
+            sg_apply_bindings(&(sg_bindings){
+                .vertex_buffers[0] = state.upload.vbuf,
+                .vertex_buffer_offsets[0] = base_offset + rect_offsets[z][i],
+            });
+            sg_apply_uniforms(UB_vs_upload_params, &SG_RANGE(vs_params));
+            sg_draw(0, rect_width * rect_height, 1);
+        }
+        sg_end_pass();
+    }
+    clear_dirty();
 }
 
 // put these into macros instead of functions so we don't get an unused warning in release mode
@@ -185,22 +405,43 @@ static void recreate_image(void) {
 #define valid_y(y) ((y >= 0) && (y < state.width_height))
 #define valid_z(z) ((z >= 0) && (z < DEPTH))
 
-static inline void set_pixel(int x, int y, int z, uint32_t color) {
+// returns true if the pixel changed
+static inline bool set_pixel(int x, int y, int z, uint32_t color) {
     const int wh = state.width_height;
-    pixels[z * wh * wh + y * wh + x] = color;
+    uint32_t* dst = &pixels[z * wh * wh + y * wh + x];
+    if (*dst != color) {
+        *dst = color;
+        return true;
+    }
+    return false;
 }
 
+// the line functions mark the span of actually changed pixels as dirty
 static void hori_line(int x0, int y, int z, int len, uint32_t color) {
     assert(valid_x(x0) && valid_y(y) && valid_z(z) && valid_x((x0 + len) - 1));
+    int min_x = INT_MAX, max_x = -1;
     for (int x = x0; x < (x0 + len); x++) {
-        set_pixel(x, y, z, color);
+        if (set_pixel(x, y, z, color)) {
+            if (x < min_x) { min_x = x; }
+            max_x = x;
+        }
+    }
+    if (max_x >= 0) {
+        mark_dirty(z, (dirty_rect_t){ min_x, y, max_x + 1, y + 1 });
     }
 }
 
 static void vert_line(int x, int y0, int z, int len, uint32_t color) {
     assert(valid_x(x) && valid_y(y0) && valid_z(z) && valid_y((y0 + len) - 1));
+    int min_y = INT_MAX, max_y = -1;
     for (int y = y0; y < (y0 + len); y++) {
-        set_pixel(x, y, z, color);
+        if (set_pixel(x, y, z, color)) {
+            if (y < min_y) { min_y = y; }
+            max_y = y;
+        }
+    }
+    if (max_y >= 0) {
+        mark_dirty(z, (dirty_rect_t){ x, min_y, x + 1, max_y + 1 });
     }
 }
 
@@ -212,25 +453,26 @@ static void border(int offset, int z, uint32_t color) {
     vert_line(wh - 1 - offset, offset, z, wh - 2 * offset, color);
 }
 
+// only modifies the pixels which actually change, erases the previous moving lines instead of clearing the image
 static void update_pixels(uint64_t frame_count) {
-    memset(pixels, 0, sizeof(pixels));
     static const uint32_t colors[3] = { RED, GREEN, BLUE };
     const int wh = state.width_height;
     for (int i = 0; i < DEPTH; i++) {
-        border(i, i, colors[i]);
         int len = wh - 2 * i;
         assert(len > 0);
         int z = i;
-        {
-            int x = i;
-            int y = ((int)((frame_count / 8) % (uint64_t)len) + i);
-            hori_line(x, y, z, len, colors[i]);
+        const int pos = (int)((frame_count / 8) % (uint64_t)len) + i;
+        if (pos == state.line_pos[i]) {
+            continue;
         }
-        {
-            int y = i;
-            int x = ((int)((frame_count / 8) % (uint64_t)len) + i);
-            vert_line(x, y, z, len, colors[i]);
+        if (state.line_pos[i] >= 0) {
+            hori_line(i, state.line_pos[i], z, len, 0);
+            vert_line(state.line_pos[i], i, z, len, 0);
         }
+        state.line_pos[i] = pos;
+        border(i, i, colors[i]);
+        hori_line(i, pos, z, len, colors[i]);
+        vert_line(pos, i, z, len, colors[i]);
     }
 }
 
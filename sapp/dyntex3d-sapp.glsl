@@ -32,3 +32,39 @@ void main() {
 @end
 
 @program dyntex3d vs fs
+
+// render dirty texels as points into a 3D texture slice, the vertex buffer
+// contains one color per texel of the dirty box in row-major order
+@vs vs_upload
+layout(binding=0) uniform vs_upload_params {
+    vec2 box_pos;
+    vec2 tex_size;
+    int box_width;
+    float y_flip;
+};
+
+in vec4 color0;
+out vec4 color;
+
+void main() {
+    const vec2 texel = box_pos + vec2(gl_VertexIndex % box_width, gl_VertexIndex / box_width);
+    const vec2 pos = ((texel + 0.5) / tex_size) * 2.0 - 1.0;
+    gl_Position = vec4(pos.x, pos.y * y_flip, 0.5, 1.0);
+    // WebGPU doesn't support point size
+    #ifndef SOKOL_WGSL
+    gl_PointSize = 1.0;
+    #endif
+    color = color0;
+}
+@end
+
+@fs fs_upload
+in vec4 color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = color;
+}
+@end
+
+@program upload vs_upload fs_upload
@@ -2,6 +2,12 @@
 //  fontstash-sapp.c
 //
 //  Text rendering via fontstash, stb_truetype and sokol_fontstash.h
+//
+//  Press P to switch to the optional multi-page LRU glyph cache in
+//  util/fonspages.h (also on top of sokol-gl), and SPACE to toggle a
+//  stress test which renders lots of changing CJK glyphs in different
+//  sizes each frame. With the single sokol_fontstash.h atlas the stress
+//  test quickly fills the atlas and new glyphs are no longer rendered.
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -28,9 +34,17 @@
 #include "sokol_fontstash.h"
 #include "dbgui/dbgui.h"
 #include "util/fileutil.h"
+#include "util/fonspages.h"
+
+#define STRESS_ROWS (24)
+#define STRESS_GLYPHS_PER_ROW (32)
+#define STRESS_FIRST_CODEPOINT (0x4E00)
+#define STRESS_NUM_CODEPOINTS (0x5000)
 
 typedef struct {
-    FONScontext* fons;
+    FONScontext* fons;          // the currently used context, either sfons or paged
+    FONScontext* sfons;         // sokol_fontstash.h with a single atlas
+    FONScontext* paged;         // util/fonspages.h with multiple atlas pages
     float dpi_scale;
     int font_normal;
     int font_italic;
@@ -40,6 +54,10 @@ typedef struct {
     uint8_t font_italic_data[256 * 1024];
     uint8_t font_bold_data[256 * 1024];
     uint8_t font_japanese_data[2 * 1024 * 1024];
+    bool stress;
+    uint32_t stress_base;
+    float frame_ms;
+    fonspages_stats_t stats;
 } state_t;
 static state_t state;
 
@@ -54,28 +72,37 @@ static void my_free(void* ptr, void* user_data) {
     free(ptr);
 }
 
+// the font data is shared by both contexts, fonts are always added to both
+// in the same order, so the font ids are the same in both contexts
+static int add_font(const char* name, const sfetch_response_t* response) {
+    const int font = fonsAddFontMem(state.sfons, name, (void*)response->data.ptr, (int)response->data.size, false);
+    const int paged_font = fonsAddFontMem(state.paged, name, (void*)response->data.ptr, (int)response->data.size, false);
+    assert(font == paged_font); (void)paged_font;
+    return font;
+}
+
 // sokol-fetch load callbacks
 static void font_normal_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        state.font_normal = fonsAddFontMem(state.fons, "sans", (void*)response->data.ptr, (int)response->data.size,  false);
+        state.font_normal = add_font("sans", response);
     }
 }
 
 static void font_italic_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        state.font_italic = fonsAddFontMem(state.fons, "sans-italic", (void*)response->data.ptr, (int)response->data.size, false);
+        state.font_italic = add_font("sans-italic", response);
     }
 }
 
 static void font_bold_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        state.font_bold = fonsAddFontMem(state.fons, "sans-bold", (void*)response->data.ptr, (int)response->data.size, false);
+        state.font_bold = add_font("sans-bold", response);
     }
 }
 
 static void font_japanese_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
-        state.font_japanese = fonsAddFontMem(state.fons, "sans-japanese", (void*)response->data.ptr, (int)response->data.size, false);
+        state.font_japanese = add_font("sans-japanese", response);
     }
 }
 
@@ -101,7 +128,7 @@ static void init(void) {
 
     // make sure the fontstash atlas width/height is pow-2
     const int atlas_dim = round_pow2(512.0f * state.dpi_scale);
-    FONScontext* fons_context = sfons_create(&(sfons_desc_t){
+    state.sfons = sfons_create(&(sfons_desc_t){
         .width = atlas_dim,
         .height = atlas_dim,
         // allocator functions are optional, just check if it works
@@ -110,7 +137,13 @@ static void init(void) {
             .free_fn = my_free,
         }
     });
-    state.fons = fons_context;
+    // the same size per page for the optional multi-page glyph cache
+    state.paged = fonspages_create(&(fonspages_desc_t){
+        .page_width = atlas_dim,
+        .page_height = atlas_dim,
+        .max_pages = 4,
+    });
+    state.fons = state.sfons;
     state.font_normal = FONS_INVALID;
     state.font_italic = FONS_INVALID;
     state.font_bold = FONS_INVALID;
@@ -153,28 +186,82 @@ static void line(float sx, float sy, float ex, float ey) {
     sgl_end();
 }
 
-static void frame(void) {
-    const float dpis = state.dpi_scale;
+static int utf8_encode(uint32_t cp, char* dst) {
+    if (cp < 0x80) {
+        dst[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        dst[0] = (char)(0xC0 | (cp >> 6));
+        dst[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else {
+        dst[0] = (char)(0xE0 | (cp >> 12));
+        dst[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+}
 
-    // pump sokol_fetch message queues
-    sfetch_dowork();
+// rows of CJK glyphs in different sizes, the window of codepoints moves
+// by one each frame so that every row needs one new glyph per frame
+static void draw_stress(FONScontext* fs, float dpis) {
+    if (state.font_japanese == FONS_INVALID) {
+        return;
+    }
+    fonsSetFont(fs, state.font_japanese);
+    fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_TOP);
+    float y = 10.0f * dpis;
+    for (int row = 0; row < STRESS_ROWS; row++) {
+        char text[STRESS_GLYPHS_PER_ROW * 3 + 1];
+        int len = 0;
+        for (int i = 0; i < STRESS_GLYPHS_PER_ROW; i++) {
+            const uint32_t offset = (state.stress_base + (uint32_t)(row * STRESS_GLYPHS_PER_ROW + i)) % STRESS_NUM_CODEPOINTS;
+            len += utf8_encode(STRESS_FIRST_CODEPOINT + offset, &text[len]);
+        }
+        const float size = (12.0f + (float)((row % 4) * 4)) * dpis;
+        fonsSetSize(fs, size);
+        fonsSetColor(fs, sfons_rgba(255, 255 - (uint8_t)(row * 8), (uint8_t)(row * 8), 255));
+        fonsDrawText(fs, 10.0f * dpis, y, text, text + len);
+        y += size * 1.1f;
+    }
+    state.stress_base++;
+}
 
-    // text rendering via fontstash.h
+static void draw_stats(FONScontext* fs, float dpis) {
+    if (state.font_normal == FONS_INVALID) {
+        return;
+    }
+    char buf[256];
+    const fonspages_stats_t* s = &state.stats;
+    if (fs == state.paged) {
+        snprintf(buf, sizeof(buf), "fonspages: %d/%d pages  hits: %d  misses: %d  evictions: %d  uploads: %d (%d KB)  frame: %.2f ms",
+            s->num_pages, s->max_pages, s->hits, s->misses, s->evictions,
+            s->uploaded_pages, (int)(s->uploaded_bytes / 1024), state.frame_ms);
+    } else {
+        snprintf(buf, sizeof(buf), "sokol_fontstash: single atlas  hits: %d  misses: %d  frame: %.2f ms",
+            s->hits, s->misses, state.frame_ms);
+    }
+    fonsSetFont(fs, state.font_normal);
+    fonsSetSize(fs, 14.0f * dpis);
+    fonsSetSpacing(fs, 0.0f);
+    fonsSetBlur(fs, 0.0f);
+    fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_BOTTOM);
+    fonsSetColor(fs, sfons_rgba(255, 255, 255, 255));
+    fonsDrawText(fs, 10.0f * dpis, sapp_heightf() - 10.0f * dpis, buf, NULL);
+    snprintf(buf, sizeof(buf), "press P to switch the glyph cache, SPACE to toggle the stress test");
+    fonsDrawText(fs, 10.0f * dpis, sapp_heightf() - 30.0f * dpis, buf, NULL);
+}
+
+static void draw_demo(FONScontext* fs, float dpis) {
     float sx, sy, dx, dy, lh = 0.0f;
     uint32_t white = sfons_rgba(255, 255, 255, 255);
     uint32_t black = sfons_rgba(0, 0, 0, 255);
     uint32_t brown = sfons_rgba(192, 128, 0, 128);
     uint32_t blue  = sfons_rgba(0, 192, 255, 255);
-    fonsClearState(state.fons);
-
-    sgl_defaults();
-    sgl_matrix_mode_projection();
-    sgl_ortho(0.0f, sapp_widthf(), sapp_heightf(), 0.0f, -1.0f, +1.0f);
 
     sx = 50*dpis; sy = 50*dpis;
     dx = sx; dy = sy;
 
-    FONScontext* fs = state.fons;
     if (state.font_normal != FONS_INVALID) {
         fonsSetFont(fs, state.font_normal);
         fonsSetSize(fs, 124.0f*dpis);
@@ -286,9 +373,44 @@ static void frame(void) {
         fonsSetBlur(fs, 0);
         fonsDrawText(fs, dx,dy,"DROP THAT SHADOW",NULL);
     }
+}
+
+static void frame(void) {
+    const float dpis = state.dpi_scale;
+    state.frame_ms = state.frame_ms * 0.95f + (float)(sapp_frame_duration() * 1000.0) * 0.05f;
 
-    // flush fontstash's font atlas to sokol-gfx texture
-    sfons_flush(fs);
+    // pump sokol_fetch message queues
+    sfetch_dowork();
+
+    // glyph cache counters of the previous frame
+    FONScontext* fs = state.fons;
+    if (fs == state.paged) {
+        state.stats = fonspages_stats(fs);
+    } else {
+        FONScacheStats cache;
+        fonsGetCacheStats(fs, &cache);
+        state.stats = (fonspages_stats_t){ .hits = cache.hits, .misses = cache.misses };
+    }
+    fonsResetCacheStats(fs);
+
+    // text rendering via fontstash.h
+    fonsClearState(fs);
+    sgl_defaults();
+    sgl_matrix_mode_projection();
+    sgl_ortho(0.0f, sapp_widthf(), sapp_heightf(), 0.0f, -1.0f, +1.0f);
+    if (state.stress) {
+        draw_stress(fs, dpis);
+    } else {
+        draw_demo(fs, dpis);
+    }
+    draw_stats(fs, dpis);
+
+    // upload changed glyph cache pages to their sokol-gfx textures
+    if (fs == state.paged) {
+        fonspages_flush(fs);
+    } else {
+        sfons_flush(fs);
+    }
 
     // render pass
     sg_begin_pass(&(sg_pass){
@@ -306,10 +428,21 @@ static void frame(void) {
     sg_commit();
 }
 
+static void input(const sapp_event* ev) {
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_SPACE)) {
+        state.stress = !state.stress;
+    }
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_P)) {
+        state.fons = (state.fons == state.sfons) ? state.paged : state.sfons;
+    }
+    __dbgui_event(ev);
+}
+
 static void cleanup(void) {
     __dbgui_shutdown();
     sfetch_shutdown();
-    sfons_destroy(state.fons);
+    fonspages_destroy(state.paged);
+    sfons_destroy(state.sfons);
     sgl_shutdown();
     sg_shutdown();
 }
@@ -321,7 +454,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 800,
         .height = 600,
         .high_dpi = true,
@@ -0,0 +1,185 @@
+//------------------------------------------------------------------------------
+//  frustumcull-bench.c
+//
+//  Micro-benchmark for the view frustum culling helpers in util/camera.h.
+//
+//  Generates randomized bounding spheres and boxes around the origin, culls
+//  them against the frustum of a camera looking at the origin, both one by
+//  one with cam_sphere_visible() / cam_aabb_visible() and batched with
+//  cam_cull_spheres() / cam_cull_aabbs(), and prints the best time of
+//  several runs in milliseconds per 1M tests. The batched results are
+//  checked against the single-object tests.
+//
+//  Usage:
+//
+//      frustumcull-bench [--count N] [--runs N]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sokol_app.h"
+#include "sokol_time.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/camera.h"
+
+#define DEFAULT_COUNT (1<<20)
+#define DEFAULT_RUNS (10)
+#define WORLD_EXTENT (60.0f)
+
+static struct {
+    int count;
+    cam_frustum_t frustum;
+    vec3_t* centers;
+    float* radii;
+    vec3_t* mins;
+    vec3_t* maxs;
+    uint32_t* mask;
+    uint32_t* ref_mask;
+} state;
+
+static uint32_t rand_seed = 0x12345678;
+static float rnd(float min_val, float max_val) {
+    rand_seed = rand_seed * 1664525u + 1013904223u;
+    return min_val + ((float)(rand_seed >> 8) / 16777216.0f) * (max_val - min_val);
+}
+
+static int cull_spheres_single(uint32_t* mask) {
+    memset(mask, 0, CAM_CULL_MASK_WORDS(state.count) * sizeof(uint32_t));
+    int num_visible = 0;
+    for (int i = 0; i < state.count; i++) {
+        if (cam_sphere_visible(&state.frustum, state.centers[i], state.radii[i])) {
+            mask[i >> 5] |= 1u << (i & 31);
+            num_visible++;
+        }
+    }
+    return num_visible;
+}
+
+static int cull_aabbs_single(uint32_t* mask) {
+    memset(mask, 0, CAM_CULL_MASK_WORDS(state.count) * sizeof(uint32_t));
+    int num_visible = 0;
+    for (int i = 0; i < state.count; i++) {
+        if (cam_aabb_visible(&state.frustum, state.mins[i], state.maxs[i])) {
+            mask[i >> 5] |= 1u << (i & 31);
+            num_visible++;
+        }
+    }
+    return num_visible;
+}
+
+static int cull_spheres_batched(uint32_t* mask) {
+    return cam_cull_spheres(&state.frustum, state.centers, state.radii, state.count, mask);
+}
+
+static int cull_aabbs_batched(uint32_t* mask) {
+    return cam_cull_aabbs(&state.frustum, state.mins, state.maxs, state.count, mask);
+}
+
+// run a culling function several times, print the best time, returns the number of visible objects
+static int bench(const char* name, int (*func)(uint32_t* mask), uint32_t* mask, int num_runs) {
+    double best_ms = 0.0;
+    int num_visible = 0;
+    for (int run = 0; run < num_runs; run++) {
+        const uint64_t start = stm_now();
+        num_visible = func(mask);
+        const double ms = stm_ms(stm_since(start));
+        if ((run == 0) || (ms < best_ms)) {
+            best_ms = ms;
+        }
+    }
+    const double ms_per_million = best_ms * 1000000.0 / (double)state.count;
+    const double mtests_per_sec = (double)state.count / (best_ms * 1000.0);
+    printf("%-16s %12.3f %14.3f %12.1f %10d\n", name, best_ms, ms_per_million, mtests_per_sec, num_visible);
+    return num_visible;
+}
+
+static int count_mismatches(void) {
+    int num_mismatches = 0;
+    for (int i = 0; i < CAM_CULL_MASK_WORDS(state.count); i++) {
+        uint32_t diff = state.mask[i] ^ state.ref_mask[i];
+        while (diff) {
+            num_mismatches += (int)(diff & 1);
+            diff >>= 1;
+        }
+    }
+    return num_mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    int num_runs = DEFAULT_RUNS;
+    state.count = DEFAULT_COUNT;
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--count")) && ((i + 1) < argc)) {
+            state.count = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--runs")) && ((i + 1) < argc)) {
+            num_runs = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--count N] [--runs N]\n", argv[0]);
+            return 10;
+        }
+    }
+    if (state.count < 1) {
+        state.count = 1;
+    }
+    if (num_runs < 1) {
+        num_runs = 1;
+    }
+    stm_setup();
+    // camera.h event handling isn't needed here
+    (void)cam_handle_event;
+
+    // a camera looking at the origin from 30 units away
+    camera_t cam;
+    cam_init(&cam, &(camera_desc_t){
+        .max_dist = 50.0f,
+        .distance = 30.0f,
+        .latitude = 20.0f,
+        .longitude = 30.0f,
+    });
+    cam_update(&cam, 1280, 720);
+    state.frustum = cam_frustum(cam.view_proj);
+
+    state.centers = (vec3_t*) malloc((size_t)state.count * sizeof(vec3_t));
+    state.radii = (float*) malloc((size_t)state.count * sizeof(float));
+    state.mins = (vec3_t*) malloc((size_t)state.count * sizeof(vec3_t));
+    state.maxs = (vec3_t*) malloc((size_t)state.count * sizeof(vec3_t));
+    state.mask = (uint32_t*) malloc(CAM_CULL_MASK_WORDS(state.count) * sizeof(uint32_t));
+    state.ref_mask = (uint32_t*) malloc(CAM_CULL_MASK_WORDS(state.count) * sizeof(uint32_t));
+    for (int i = 0; i < state.count; i++) {
+        const vec3_t c = vec3(rnd(-WORLD_EXTENT, WORLD_EXTENT), rnd(-WORLD_EXTENT, WORLD_EXTENT), rnd(-WORLD_EXTENT, WORLD_EXTENT));
+        const vec3_t e = vec3(rnd(0.1f, 2.0f), rnd(0.1f, 2.0f), rnd(0.1f, 2.0f));
+        state.centers[i] = c;
+        state.radii[i] = vec3_length(e);
+        state.mins[i] = vec3_sub(c, e);
+        state.maxs[i] = vec3_add(c, e);
+    }
+
+    #if defined(_CAM_SIMD_AVX)
+    const char* impl = "avx";
+    #elif defined(_CAM_SIMD_SSE2)
+    const char* impl = "sse2";
+    #elif defined(_CAM_SIMD_NEON)
+    const char* impl = "neon";
+    #else
+    const char* impl = "scalar";
+    #endif
+    printf("frustumcull-bench: %d objects, best of %d runs, batched tests: %s\n\n", state.count, num_runs, impl);
+    printf("%-16s %12s %14s %12s %10s\n", "test", "ms", "ms/1M tests", "Mtests/s", "visible");
+
+    bench("spheres single", cull_spheres_single, state.ref_mask, num_runs);
+    bench("spheres batched", cull_spheres_batched, state.mask, num_runs);
+    const int sphere_mismatches = count_mismatches();
+    bench("aabbs single", cull_aabbs_single, state.ref_mask, num_runs);
+    bench("aabbs batched", cull_aabbs_batched, state.mask, num_runs);
+    const int aabb_mismatches = count_mismatches();
+    printf("\nmismatches between single and batched tests: spheres %d, aabbs %d\n", sphere_mismatches, aabb_mismatches);
+
+    free(state.centers);
+    free(state.radii);
+    free(state.mins);
+    free(state.maxs);
+    free(state.mask);
+    free(state.ref_mask);
+    return ((sphere_mismatches + aabb_mismatches) > 0) ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+//------------------------------------------------------------------------------
+//  imageblur-ref.c
+//
+//  CPU reference for the blur modes in imageblur-sapp.c (see util/boxblur.h),
+//  for checking the compute shader results without a GPU.
+//
+//  - checks that the running-sum box blur gives exactly the same result as
+//    summing up the whole kernel for each pixel
+//  - measures both for increasing radius, the running-sum time should stay
+//    flat while the naive time grows with the kernel size
+//  - compares the 3-pass box blur gaussian approximation with a true
+//    gaussian blur and reports the max and mean error in 8-bit steps
+//  - optionally writes the results as binary PPM files for comparing them
+//    with a screenshot of imageblur-sapp
+//
+//  Without --image a procedural 512x512 test image is used.
+//
+//  Usage:
+//
+//      imageblur-ref [--image file.png] [--radius N] [--sigma S] [--runs N] [--out prefix]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sokol_time.h"
+#include "util/boxblur.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define DEFAULT_RADIUS (8)
+#define DEFAULT_SIGMA (6.0f)
+#define DEFAULT_RUNS (5)
+#define TEST_IMAGE_SIZE (512)
+// max allowed mean error of the gaussian approximation in 8-bit steps
+#define MAX_GAUSS_MEAN_ERROR (1.0)
+
+static struct {
+    int width;
+    int height;
+    uint8_t* src;
+    uint8_t* dst;
+    uint8_t* ref;
+} state;
+
+static uint32_t rand_seed = 0x12345678;
+static uint32_t rnd(void) {
+    rand_seed = rand_seed * 1664525u + 1013904223u;
+    return rand_seed >> 8;
+}
+
+// gradients, a checkerboard and some noise to have both flat areas and hard edges
+static void make_test_image(void) {
+    state.width = TEST_IMAGE_SIZE;
+    state.height = TEST_IMAGE_SIZE;
+    state.src = (uint8_t*) malloc((size_t)(state.width * state.height * 4));
+    for (int y = 0; y < state.height; y++) {
+        for (int x = 0; x < state.width; x++) {
+            uint8_t* p = &state.src[(y * state.width + x) * 4];
+            const int checker = (((x >> 5) ^ (y >> 5)) & 1) ? 255 : 0;
+            p[0] = (uint8_t)checker;
+            p[1] = (uint8_t)((x * 255) / (state.width - 1));
+            p[2] = (uint8_t)((y < state.height / 2) ? (rnd() & 0xFF) : ((x + y) & 0xFF));
+            p[3] = 255;
+        }
+    }
+}
+
+static bool load_image(const char* path) {
+    int num_channels;
+    stbi_uc* pixels = stbi_load(path, &state.width, &state.height, &num_channels, 4);
+    if (!pixels) {
+        return false;
+    }
+    state.src = (uint8_t*) malloc((size_t)(state.width * state.height * 4));
+    memcpy(state.src, pixels, (size_t)(state.width * state.height * 4));
+    stbi_image_free(pixels);
+    return true;
+}
+
+static bool write_ppm(const char* prefix, const char* name, const uint8_t* pixels) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%s.ppm", prefix, name);
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "failed to write %s\n", path);
+        return false;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", state.width, state.height);
+    for (int i = 0; i < state.width * state.height; i++) {
+        fwrite(&pixels[i * 4], 1, 3, fp);
+    }
+    fclose(fp);
+    printf("wrote %s\n", path);
+    return true;
+}
+
+// max and mean absolute difference of the RGB channels (alpha is always 1 on the GPU)
+static void diff_rgb(const uint8_t* a, const uint8_t* b, int* out_max, double* out_mean) {
+    int max_diff = 0;
+    uint64_t sum_diff = 0;
+    for (int i = 0; i < state.width * state.height; i++) {
+        for (int c = 0; c < 3; c++) {
+            const int d = abs((int)a[i * 4 + c] - (int)b[i * 4 + c]);
+            max_diff = (d > max_diff) ? d : max_diff;
+            sum_diff += (uint64_t)d;
+        }
+    }
+    *out_max = max_diff;
+    *out_mean = (double)sum_diff / (double)(state.width * state.height * 3);
+}
+
+// a true separable gaussian blur in float precision, kernel radius is 3 sigma
+static void gauss_ref(uint8_t* dst, const uint8_t* src, float sigma) {
+    const int radius = (int)ceilf(3.0f * sigma);
+    float* weights = (float*) malloc((size_t)(2 * radius + 1) * sizeof(float));
+    float weight_sum = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        weights[i + radius] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+        weight_sum += weights[i + radius];
+    }
+    for (int i = 0; i <= 2 * radius; i++) {
+        weights[i] /= weight_sum;
+    }
+    const int w = state.width;
+    const int h = state.height;
+    float* tmp = (float*) malloc((size_t)(w * h * 4) * sizeof(float));
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            for (int c = 0; c < 4; c++) {
+                float acc = 0.0f;
+                for (int i = -radius; i <= radius; i++) {
+                    acc += weights[i + radius] * (float)src[(y * w + _boxblur_clamp(x + i, w - 1)) * 4 + c];
+                }
+                tmp[(y * w + x) * 4 + c] = acc;
+            }
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            for (int c = 0; c < 4; c++) {
+                float acc = 0.0f;
+                for (int i = -radius; i <= radius; i++) {
+                    acc += weights[i + radius] * tmp[(_boxblur_clamp(y + i, h - 1) * w + x) * 4 + c];
+                }
+                dst[(y * w + x) * 4 + c] = (uint8_t)(acc + 0.5f);
+            }
+        }
+    }
+    free(tmp);
+    free(weights);
+}
+
+// best time of several runs in milliseconds
+static double bench(void (*func)(uint8_t*, const uint8_t*, int, int, int), uint8_t* dst, int radius, int num_runs) {
+    double best_ms = 0.0;
+    for (int run = 0; run < num_runs; run++) {
+        const uint64_t start = stm_now();
+        func(dst, state.src, state.width, state.height, radius);
+        const double ms = stm_ms(stm_since(start));
+        if ((run == 0) || (ms < best_ms)) {
+            best_ms = ms;
+        }
+    }
+    return best_ms;
+}
+
+int main(int argc, char* argv[]) {
+    const char* image_path = 0;
+    const char* out_prefix = 0;
+    int radius = DEFAULT_RADIUS;
+    float sigma = DEFAULT_SIGMA;
+    int num_runs = DEFAULT_RUNS;
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--image")) && ((i + 1) < argc)) {
+            image_path = argv[++i];
+        } else if ((0 == strcmp(argv[i], "--radius")) && ((i + 1) < argc)) {
+            radius = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--sigma")) && ((i + 1) < argc)) {
+            sigma = (float)atof(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--runs")) && ((i + 1) < argc)) {
+            num_runs = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--out")) && ((i + 1) < argc)) {
+            out_prefix = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--image file.png] [--radius N] [--sigma S] [--runs N] [--out prefix]\n", argv[0]);
+            return 10;
+        }
+    }
+    radius = (radius < 0) ? 0 : radius;
+    sigma = (sigma < BOXBLUR_GAUSS_MIN_SIGMA) ? BOXBLUR_GAUSS_MIN_SIGMA : sigma;
+    num_runs = (num_runs < 1) ? 1 : num_runs;
+    stm_setup();
+
+    if (image_path) {
+        if (!load_image(image_path)) {
+            fprintf(stderr, "failed to load %s\n", image_path);
+            return 10;
+        }
+    } else {
+        make_test_image();
+    }
+    const size_t num_bytes = (size_t)(state.width * state.height * 4);
+    state.dst = (uint8_t*) malloc(num_bytes);
+    state.ref = (uint8_t*) malloc(num_bytes);
+    printf("image: %s (%dx%d)\n\n", image_path ? image_path : "procedural", state.width, state.height);
+
+    int num_failed = 0;
+    int max_diff;
+    double mean_diff;
+
+    // running-sum vs naive box blur, must match exactly
+    printf("%-8s %14s %14s %10s\n", "radius", "sliding (ms)", "naive (ms)", "max diff");
+    const int radii[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for (int i = 0; i < (int)(sizeof(radii) / sizeof(radii[0])); i++) {
+        const int r = radii[i];
+        const double sliding_ms = bench(boxblur_box, state.dst, r, num_runs);
+        const double naive_ms = bench(boxblur_box_naive, state.ref, r, (r > 16) ? 1 : num_runs);
+        diff_rgb(state.dst, state.ref, &max_diff, &mean_diff);
+        printf("%-8d %14.3f %14.3f %10d\n", r, sliding_ms, naive_ms, max_diff);
+        if (max_diff != 0) {
+            num_failed++;
+        }
+    }
+
+    // 3-pass box gaussian approximation vs true gaussian
+    int sizes[BOXBLUR_GAUSS_NUM_BOXES];
+    boxblur_gauss_sizes(sigma, BOXBLUR_GAUSS_NUM_BOXES, sizes);
+    boxblur_gauss(state.dst, state.src, state.width, state.height, sigma);
+    gauss_ref(state.ref, state.src, sigma);
+    diff_rgb(state.dst, state.ref, &max_diff, &mean_diff);
+    printf("\ngaussian sigma=%.2f boxes=%d,%d,%d: max diff %d, mean diff %.3f\n", sigma, sizes[0], sizes[1], sizes[2], max_diff, mean_diff);
+    if (mean_diff > MAX_GAUSS_MEAN_ERROR) {
+        num_failed++;
+    }
+
+    if (out_prefix) {
+        write_ppm(out_prefix, "gauss3", state.dst);
+        write_ppm(out_prefix, "gauss", state.ref);
+        boxblur_box(state.dst, state.src, state.width, state.height, radius);
+        write_ppm(out_prefix, "box", state.dst);
+    }
+
+    printf("\n%s\n", (num_failed == 0) ? "OK" : "FAILED");
+    free(state.src);
+    free(state.dst);
+    free(state.ref);
+    return (num_failed == 0) ? 0 : 1;
+}
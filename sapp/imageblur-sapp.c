@@ -4,6 +4,13 @@
 //  Image-blur running in a compute shader writing to a storage texture. Also
 //  demonstrates using shader-shared memory and shader barriers.
 //
+//  Besides the original tiled blur which gets more expensive with the
+//  filter size, there's a sliding-window box blur where each compute shader
+//  thread keeps a running sum over a segment of a row or column (constant
+//  cost per pixel for any radius), and a gaussian blur approximated by 3
+//  such box blurs. The imageblur-ref command line tool computes the same
+//  results on the CPU (see util/boxblur.h).
+//
 //  Ported from WebGPU sample: https://webgpu.github.io/webgpu-samples/?sample=imageBlur
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
@@ -19,17 +26,33 @@
 #define SOKOL_APP_IMGUI_IMPL
 #include "sokol_app_imgui.h"
 #include "util/fileutil.h"
+#include "util/boxblur.h"
 #include "imageblur-sapp.glsl.h"
-#include <math.h> // ceilf()
+#include <math.h> // ceilf(), sqrtf()
+#include <string.h> // memset()
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+typedef enum {
+    MODE_TILED,
+    MODE_SLIDING_BOX,
+    MODE_GAUSSIAN,
+    NUM_MODES,
+} blur_mode_t;
+
+static const char* mode_names[NUM_MODES] = {
+    "Tiled",
+    "Sliding Box",
+    "Gaussian (3 Boxes)",
+};
+
 static struct {
     int src_width;
     int src_height;
     sg_sampler smp;
     struct {
         sg_pipeline pip;
+        sg_pipeline sliding_pip;
         sg_image src_image;
         sg_view src_tex_view;
         sg_image storage_image[2];
@@ -41,9 +64,19 @@ static struct {
         sg_pass_action pass_action;
     } display;
     struct {
+        int mode;
         int filter_size;
         int iterations;
+        int radius;
+        float sigma;
     } ui;
+    // work done by the blur passes in the last frame, computed on the CPU
+    struct {
+        int num_dispatches;
+        int num_workgroups;
+        float taps_per_pixel;
+        float variance;
+    } stats;
     struct {
         bool succeeded;
         bool failed;
@@ -53,13 +86,17 @@ static struct {
         .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0, 0, 0, 1 } },
     },
     .ui = {
+        .mode = MODE_TILED,
         .filter_size = 1,
         .iterations = 2,
+        .radius = 8,
+        .sigma = 6.0f,
     },
 };
 static uint8_t file_buffer[256 * 1024];
 
 static void blur(int flip, sg_view dst_simg_view, sg_view src_tex_view);
+static void sliding_blur(int flip, int radius, sg_view dst_simg_view, sg_view src_tex_view);
 static void fetch_callback(const sfetch_response_t* response);
 static void draw_ui(void);
 
@@ -104,6 +141,11 @@ static void init(void) {
         .shader = sg_make_shader(compute_shader_desc(sg_query_backend())),
         .label = "compute-pipeline",
     });
+    state.compute.sliding_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(compute_sliding_shader_desc(sg_query_backend())),
+        .label = "sliding-compute-pipeline",
+    });
 
     // a shader and pipeline to display the result (we'll
     // synthesize the fullscreen vertices in the vertex shader so we
@@ -128,14 +170,41 @@ static void frame(void) {
         return;
     }
 
-    // ping-pong blur passes starting with the source image
+    // ping-pong horizontal and vertical blur passes starting with the source image,
+    // the result always ends up in storage image 1
+    memset(&state.stats, 0, sizeof(state.stats));
     sg_begin_pass(&(sg_pass){ .compute = true, .label = "blur-pass"});
-    sg_apply_pipeline(state.compute.pip);
-    blur(0, state.compute.storage_simg_views[0], state.compute.src_tex_view);
-    blur(1, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
-    for (int i = 0; i < state.ui.iterations - 1; i++) {
-        blur(0, state.compute.storage_simg_views[0], state.compute.storage_tex_views[1]);
-        blur(1, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
+    switch (state.ui.mode) {
+        case MODE_TILED:
+            sg_apply_pipeline(state.compute.pip);
+            blur(0, state.compute.storage_simg_views[0], state.compute.src_tex_view);
+            blur(1, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
+            for (int i = 0; i < state.ui.iterations - 1; i++) {
+                blur(0, state.compute.storage_simg_views[0], state.compute.storage_tex_views[1]);
+                blur(1, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
+            }
+            break;
+        case MODE_SLIDING_BOX:
+            sg_apply_pipeline(state.compute.sliding_pip);
+            for (int i = 0; i < state.ui.iterations; i++) {
+                const sg_view src_tex_view = (i == 0) ? state.compute.src_tex_view : state.compute.storage_tex_views[1];
+                sliding_blur(0, state.ui.radius, state.compute.storage_simg_views[0], src_tex_view);
+                sliding_blur(1, state.ui.radius, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
+            }
+            break;
+        default: {
+            int sizes[BOXBLUR_GAUSS_NUM_BOXES];
+            // the slider can be ctrl-clicked to enter values below the minimum
+            const float sigma = (state.ui.sigma < BOXBLUR_GAUSS_MIN_SIGMA) ? BOXBLUR_GAUSS_MIN_SIGMA : state.ui.sigma;
+            boxblur_gauss_sizes(sigma, BOXBLUR_GAUSS_NUM_BOXES, sizes);
+            sg_apply_pipeline(state.compute.sliding_pip);
+            for (int i = 0; i < BOXBLUR_GAUSS_NUM_BOXES; i++) {
+                const sg_view src_tex_view = (i == 0) ? state.compute.src_tex_view : state.compute.storage_tex_views[1];
+                const int radius = (sizes[i] - 1) / 2;
+                sliding_blur(0, radius, state.compute.storage_simg_views[0], src_tex_view);
+                sliding_blur(1, radius, state.compute.storage_simg_views[1], state.compute.storage_tex_views[0]);
+            }
+        } break;
     }
     sg_end_pass();
 
@@ -187,6 +256,45 @@ void blur(int flip, sg_view dst_simg_view, sg_view src_tex_view) {
     });
     sg_apply_uniforms(UB_cs_params, &SG_RANGE(cs_params));
     sg_dispatch(num_workgroups_x, num_workgroups_y, 1);
+
+    state.stats.num_dispatches++;
+    state.stats.num_workgroups += num_workgroups_x * num_workgroups_y;
+    state.stats.taps_per_pixel += (float)filter_size;
+    state.stats.variance += (float)(filter_size * filter_size - 1) / 12.0f;
+}
+
+// perform a horizontal or vertical sliding-window box blur pass, one thread per segment of a row or column
+void sliding_blur(int flip, int radius, sg_view dst_simg_view, sg_view src_tex_view) {
+    const int threads_per_workgroup = 64;   // must match shader
+    const int min_seg_len = 32;
+    // the initial sum of a segment costs filter_size taps, keep that below
+    // a quarter of the 2 taps per pixel for the rest of the segment
+    const int filter_size = 2 * radius + 1;
+    const int seg_len = (2 * filter_size > min_seg_len) ? (2 * filter_size) : min_seg_len;
+    const cs_sliding_params_t cs_params = {
+        .radius = radius,
+        .flip = flip,
+        .seg_len = seg_len,
+    };
+    const int line_len = flip ? state.src_height : state.src_width;
+    const int num_lines = flip ? state.src_width : state.src_height;
+    const int num_workgroups_x = (num_lines + threads_per_workgroup - 1) / threads_per_workgroup;
+    const int num_workgroups_y = (line_len + seg_len - 1) / seg_len;
+
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_cs_sliding_inp_tex] = src_tex_view,
+        .views[VIEW_cs_sliding_outp_tex] = dst_simg_view,
+        .samplers[SMP_cs_sliding_smp] = state.smp,
+    });
+    sg_apply_uniforms(UB_cs_sliding_params, &SG_RANGE(cs_params));
+    sg_dispatch(num_workgroups_x, num_workgroups_y, 1);
+
+    // 2 taps per pixel for updating the running sum, plus the initial
+    // sum at the start of each segment spread over the segment
+    state.stats.num_dispatches++;
+    state.stats.num_workgroups += num_workgroups_x * num_workgroups_y;
+    state.stats.taps_per_pixel += 2.0f + (float)filter_size / (float)((seg_len < line_len) ? seg_len : line_len);
+    state.stats.variance += (float)(filter_size * filter_size - 1) / 12.0f;
 }
 
 // called when texture file has finished loading, this creates a
@@ -272,8 +380,26 @@ static void draw_ui(void) {
         } else if (state.io.failed) {
             igText("Failed to load source texture!");
         } else {
-            igSliderInt("Filter Size", &state.ui.filter_size, 1, 33);
-            igSliderInt("Iterations", &state.ui.iterations, 1, 10);
+            igComboChar("Mode", &state.ui.mode, mode_names, NUM_MODES);
+            switch (state.ui.mode) {
+                case MODE_TILED:
+                    igSliderInt("Filter Size", &state.ui.filter_size, 1, 33);
+                    igSliderInt("Iterations", &state.ui.iterations, 1, 10);
+                    break;
+                case MODE_SLIDING_BOX:
+                    igSliderInt("Radius", &state.ui.radius, 0, 64);
+                    igSliderInt("Iterations", &state.ui.iterations, 1, 10);
+                    break;
+                default:
+                    igSliderFloat("Sigma", &state.ui.sigma, BOXBLUR_GAUSS_MIN_SIGMA, 32.0f);
+                    break;
+            }
+            igSeparator();
+            // variances of box filters add up, sum of horizontal and vertical passes halved
+            igText("Dispatches: %d", state.stats.num_dispatches);
+            igText("Workgroups: %d", state.stats.num_workgroups);
+            igText("Taps per pixel: %.1f", state.stats.taps_per_pixel);
+            igText("Effective sigma: %.2f", sqrtf(0.5f * state.stats.variance));
         }
     }
     igEnd();
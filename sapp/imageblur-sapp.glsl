@@ -54,6 +54,65 @@ void main() {
 
 @program compute cs
 
+// sliding-window box blur: each thread keeps a running sum over one segment
+// of a row (or column if flipped), so the cost per pixel doesn't depend on
+// the filter radius. Each segment starts with summing up a whole kernel, so
+// longer segments have less overhead, shorter segments give more threads:
+// with one thread per line a 512x512 image only had 8 workgroups per pass.
+//
+// gl_GlobalInvocationID.x is the line and .y the segment, so neighbouring
+// threads work on neighbouring lines at the same position. In the vertical
+// pass that's neighbouring texels of a row, in the horizontal pass a column,
+// which is less cache friendly but mostly served by the tiled texture layout.
+@cs cs_sliding
+
+layout(binding=0) uniform cs_sliding_params {
+    int radius;
+    int flip;
+    int seg_len;
+};
+
+layout(binding=0) uniform texture2D cs_sliding_inp_tex;
+layout(binding=1, rgba8) uniform writeonly image2D cs_sliding_outp_tex;
+layout(binding=0) uniform sampler cs_sliding_smp;
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+ivec2 line_pos(int line_index, int i) {
+    return (flip != 0) ? ivec2(line_index, i) : ivec2(i, line_index);
+}
+
+// sum up 8-bit integers so that the running sum doesn't drift
+ivec3 load(int line_index, int i) {
+    vec3 c = texelFetch(sampler2D(cs_sliding_inp_tex, cs_sliding_smp), line_pos(line_index, i), 0).rgb;
+    return ivec3(c * 255.0 + 0.5);
+}
+
+void main() {
+    ivec2 dims = textureSize(sampler2D(cs_sliding_inp_tex, cs_sliding_smp), 0);
+    int line_len = (flip != 0) ? dims.y : dims.x;
+    int num_lines = (flip != 0) ? dims.x : dims.y;
+    int line_index = int(gl_GlobalInvocationID.x);
+    int seg_start = int(gl_GlobalInvocationID.y) * seg_len;
+    if ((line_index >= num_lines) || (seg_start >= line_len)) {
+        return;
+    }
+    int seg_end = min(seg_start + seg_len, line_len);
+    int last = line_len - 1;
+    float scale = 1.0 / (255.0 * float(2 * radius + 1));
+    ivec3 sum = ivec3(0);
+    for (int i = seg_start - radius; i <= seg_start + radius; i++) {
+        sum += load(line_index, clamp(i, 0, last));
+    }
+    for (int i = seg_start; i < seg_end; i++) {
+        imageStore(cs_sliding_outp_tex, line_pos(line_index, i), vec4(vec3(sum) * scale, 1));
+        sum += load(line_index, min(i + radius + 1, last)) - load(line_index, max(i - radius, 0));
+    }
+}
+@end
+
+@program compute_sliding cs_sliding
+
 // a regular vertex/fragment shader pair to display the result
 @vs vs
 const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
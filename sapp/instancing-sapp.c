@@ -2,18 +2,122 @@
 //  instancing.c
 //  Demonstrate simple hardware-instancing using a static geometry buffer
 //  and a dynamic instance-data buffer.
+//
+//  The particle state is stored as separate x/y/z float arrays (SoA),
+//  which allows to update several particles at once with SIMD instructions
+//  (SSE/AVX/NEON/WASM-SIMD, depending on the compile target), and to
+//  upload the position arrays directly into three per-instance vertex
+//  buffers. The particle update can be run scalar, SIMD or SIMD on
+//  multiple threads to compare the update time.
 //------------------------------------------------------------------------------
+#include <stdlib.h>
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
+#include "util/jobs.h"
 #include "dbgui/dbgui.h"
 #include "instancing-sapp.glsl.h"
 
-#define MAX_PARTICLES (512 * 1024)
-#define NUM_PARTICLES_EMITTED_PER_FRAME (10)
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define SIMD_NAME "AVX"
+    #define SIMD_WIDTH (8)
+    typedef __m256 simd_t;
+    typedef __m256 simd_mask_t;
+    static inline simd_t simd_load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void simd_store(float* p, simd_t v) { _mm256_storeu_ps(p, v); }
+    static inline simd_t simd_set1(float f) { return _mm256_set1_ps(f); }
+    static inline simd_t simd_add(simd_t a, simd_t b) { return _mm256_add_ps(a, b); }
+    static inline simd_t simd_sub(simd_t a, simd_t b) { return _mm256_sub_ps(a, b); }
+    static inline simd_t simd_mul(simd_t a, simd_t b) { return _mm256_mul_ps(a, b); }
+    static inline simd_mask_t simd_lt(simd_t a, simd_t b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static inline simd_t simd_select(simd_mask_t m, simd_t a, simd_t b) { return _mm256_blendv_ps(b, a, m); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define SIMD_NAME "SSE2"
+    #define SIMD_WIDTH (4)
+    typedef __m128 simd_t;
+    typedef __m128 simd_mask_t;
+    static inline simd_t simd_load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void simd_store(float* p, simd_t v) { _mm_storeu_ps(p, v); }
+    static inline simd_t simd_set1(float f) { return _mm_set1_ps(f); }
+    static inline simd_t simd_add(simd_t a, simd_t b) { return _mm_add_ps(a, b); }
+    static inline simd_t simd_sub(simd_t a, simd_t b) { return _mm_sub_ps(a, b); }
+    static inline simd_t simd_mul(simd_t a, simd_t b) { return _mm_mul_ps(a, b); }
+    static inline simd_mask_t simd_lt(simd_t a, simd_t b) { return _mm_cmplt_ps(a, b); }
+    static inline simd_t simd_select(simd_mask_t m, simd_t a, simd_t b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define SIMD_NAME "NEON"
+    #define SIMD_WIDTH (4)
+    typedef float32x4_t simd_t;
+    typedef uint32x4_t simd_mask_t;
+    static inline simd_t simd_load(const float* p) { return vld1q_f32(p); }
+    static inline void simd_store(float* p, simd_t v) { vst1q_f32(p, v); }
+    static inline simd_t simd_set1(float f) { return vdupq_n_f32(f); }
+    static inline simd_t simd_add(simd_t a, simd_t b) { return vaddq_f32(a, b); }
+    static inline simd_t simd_sub(simd_t a, simd_t b) { return vsubq_f32(a, b); }
+    static inline simd_t simd_mul(simd_t a, simd_t b) { return vmulq_f32(a, b); }
+    static inline simd_mask_t simd_lt(simd_t a, simd_t b) { return vcltq_f32(a, b); }
+    static inline simd_t simd_select(simd_mask_t m, simd_t a, simd_t b) { return vbslq_f32(m, a, b); }
+#elif defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define SIMD_NAME "WASM-SIMD"
+    #define SIMD_WIDTH (4)
+    typedef v128_t simd_t;
+    typedef v128_t simd_mask_t;
+    static inline simd_t simd_load(const float* p) { return wasm_v128_load(p); }
+    static inline void simd_store(float* p, simd_t v) { wasm_v128_store(p, v); }
+    static inline simd_t simd_set1(float f) { return wasm_f32x4_splat(f); }
+    static inline simd_t simd_add(simd_t a, simd_t b) { return wasm_f32x4_add(a, b); }
+    static inline simd_t simd_sub(simd_t a, simd_t b) { return wasm_f32x4_sub(a, b); }
+    static inline simd_t simd_mul(simd_t a, simd_t b) { return wasm_f32x4_mul(a, b); }
+    static inline simd_mask_t simd_lt(simd_t a, simd_t b) { return wasm_f32x4_lt(a, b); }
+    static inline simd_t simd_select(simd_mask_t m, simd_t a, simd_t b) { return wasm_v128_bitselect(a, b, m); }
+#else
+    // fallback for targets without SIMD support
+    #define SIMD_NAME "none"
+    #define SIMD_WIDTH (1)
+    typedef float simd_t;
+    typedef bool simd_mask_t;
+    static inline simd_t simd_load(const float* p) { return *p; }
+    static inline void simd_store(float* p, simd_t v) { *p = v; }
+    static inline simd_t simd_set1(float f) { return f; }
+    static inline simd_t simd_add(simd_t a, simd_t b) { return a + b; }
+    static inline simd_t simd_sub(simd_t a, simd_t b) { return a - b; }
+    static inline simd_t simd_mul(simd_t a, simd_t b) { return a * b; }
+    static inline simd_mask_t simd_lt(simd_t a, simd_t b) { return a < b; }
+    static inline simd_t simd_select(simd_mask_t m, simd_t a, simd_t b) { return m ? a : b; }
+#endif
+
+#define MAX_PARTICLES (2 * 1024 * 1024)
+#define MIN_PARTICLES_EMITTED_PER_FRAME (10)
+#define MAX_PARTICLES_EMITTED_PER_FRAME (100000)
+
+typedef enum {
+    UPDATE_SCALAR,
+    UPDATE_SIMD,
+    UPDATE_SIMD_THREADED,
+    NUM_UPDATE_MODES,
+} update_mode_t;
+
+static const char* update_mode_names[NUM_UPDATE_MODES] = {
+    "scalar",
+    "SIMD (" SIMD_NAME ")",
+    "SIMD + threads",
+};
+
+typedef struct {
+    int start;
+    int end;
+    float dt;
+} update_chunk_t;
 
 static struct {
     sg_pass_action pass_action;
@@ -21,9 +125,21 @@ static struct {
     sg_bindings bind;
     float ry;
     int cur_num_particles;
-    vec3_t pos[MAX_PARTICLES];
-    vec3_t vel[MAX_PARTICLES];
-} state;
+    int num_emitted_per_frame;
+    update_mode_t update_mode;
+    double update_ms[NUM_UPDATE_MODES];     // smoothed update time per mode, zero if not measured yet
+    update_chunk_t chunks[JOBS_MAX_THREADS + 1];
+    // particle state as separate component arrays
+    float* pos_x;
+    float* pos_y;
+    float* pos_z;
+    float* vel_x;
+    float* vel_y;
+    float* vel_z;
+} state = {
+    .num_emitted_per_frame = MIN_PARTICLES_EMITTED_PER_FRAME,
+    .update_mode = UPDATE_SIMD_THREADED,
+};
 
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
@@ -39,6 +155,21 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup();
+    stm_setup();
+    jobs_setup(&(jobs_desc_t){0});
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+
+    // particle state arrays
+    const size_t array_size = MAX_PARTICLES * sizeof(float);
+    state.pos_x = malloc(array_size);
+    state.pos_y = malloc(array_size);
+    state.pos_z = malloc(array_size);
+    state.vel_x = malloc(array_size);
+    state.vel_y = malloc(array_size);
+    state.vel_z = malloc(array_size);
 
     // a pass action for the default render pass
     state.pass_action = (sg_pass_action) {
@@ -75,12 +206,16 @@ static void init(void) {
         .label = "geometry-indices"
     });
 
-    // empty, dynamic instance-data vertex buffer, goes into vertex-buffer-slot 1
-    state.bind.vertex_buffers[1] = sg_make_buffer(&(sg_buffer_desc){
-        .size = MAX_PARTICLES * sizeof(vec3_t),
-        .usage.stream_update = true,
-        .label = "instance-data"
-    });
+    // empty, dynamic instance-data vertex buffers for the x, y and z
+    // position components, go into vertex-buffer-slots 1, 2 and 3
+    const char* inst_labels[3] = { "instance-data-x", "instance-data-y", "instance-data-z" };
+    for (int i = 0; i < 3; i++) {
+        state.bind.vertex_buffers[1 + i] = sg_make_buffer(&(sg_buffer_desc){
+            .size = MAX_PARTICLES * sizeof(float),
+            .usage.stream_update = true,
+            .label = inst_labels[i],
+        });
+    }
 
     // a shader
     sg_shader shd = sg_make_shader(instancing_shader_desc(sg_query_backend()));
@@ -88,12 +223,18 @@ static void init(void) {
     // a pipeline object
     state.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .layout = {
-            // vertex buffer at slot 1 must step per instance
-            .buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+            // vertex buffers at slot 1..3 must step per instance
+            .buffers = {
+                [1].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+                [2].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+                [3].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+            },
             .attrs = {
-                [ATTR_instancing_pos]      = { .format=SG_VERTEXFORMAT_FLOAT3, .buffer_index=0 },
-                [ATTR_instancing_color0]   = { .format=SG_VERTEXFORMAT_FLOAT4, .buffer_index=0 },
-                [ATTR_instancing_inst_pos] = { .format=SG_VERTEXFORMAT_FLOAT3, .buffer_index=1 }
+                [ATTR_instancing_pos]        = { .format=SG_VERTEXFORMAT_FLOAT3, .buffer_index=0 },
+                [ATTR_instancing_color0]     = { .format=SG_VERTEXFORMAT_FLOAT4, .buffer_index=0 },
+                [ATTR_instancing_inst_pos_x] = { .format=SG_VERTEXFORMAT_FLOAT, .buffer_index=1 },
+                [ATTR_instancing_inst_pos_y] = { .format=SG_VERTEXFORMAT_FLOAT, .buffer_index=2 },
+                [ATTR_instancing_inst_pos_z] = { .format=SG_VERTEXFORMAT_FLOAT, .buffer_index=3 },
             }
         },
         .shader = shd,
@@ -107,42 +248,121 @@ static void init(void) {
     });
 }
 
+// update particle positions one at a time
+static void update_particles_scalar(int start, int end, float dt) {
+    for (int i = start; i < end; i++) {
+        state.vel_y[i] -= 1.0f * dt;
+        state.pos_x[i] += state.vel_x[i] * dt;
+        state.pos_y[i] += state.vel_y[i] * dt;
+        state.pos_z[i] += state.vel_z[i] * dt;
+        // bounce back from 'ground'
+        if (state.pos_y[i] < -2.0f) {
+            state.pos_y[i] = -1.8f;
+            state.vel_y[i] = -state.vel_y[i];
+            state.vel_x[i] *= 0.8f; state.vel_y[i] *= 0.8f; state.vel_z[i] *= 0.8f;
+        }
+    }
+}
+
+// same as update_particles_scalar() but SIMD_WIDTH particles at a time,
+// the ground bounce is done with a compare mask and select instead of a branch
+static void update_particles_simd(int start, int end, float dt) {
+    const simd_t vdt = simd_set1(dt);
+    const simd_t ground = simd_set1(-2.0f);
+    const simd_t bounce_y = simd_set1(-1.8f);
+    const simd_t damping = simd_set1(0.8f);
+    const simd_t neg_damping = simd_set1(-0.8f);
+    int i = start;
+    for (; (i + SIMD_WIDTH) <= end; i += SIMD_WIDTH) {
+        simd_t vx = simd_load(&state.vel_x[i]);
+        simd_t vy = simd_load(&state.vel_y[i]);
+        simd_t vz = simd_load(&state.vel_z[i]);
+        simd_t px = simd_load(&state.pos_x[i]);
+        simd_t py = simd_load(&state.pos_y[i]);
+        simd_t pz = simd_load(&state.pos_z[i]);
+        vy = simd_sub(vy, vdt);
+        px = simd_add(px, simd_mul(vx, vdt));
+        py = simd_add(py, simd_mul(vy, vdt));
+        pz = simd_add(pz, simd_mul(vz, vdt));
+        const simd_mask_t bounce = simd_lt(py, ground);
+        py = simd_select(bounce, bounce_y, py);
+        vx = simd_select(bounce, simd_mul(vx, damping), vx);
+        vy = simd_select(bounce, simd_mul(vy, neg_damping), vy);
+        vz = simd_select(bounce, simd_mul(vz, damping), vz);
+        simd_store(&state.vel_x[i], vx);
+        simd_store(&state.vel_y[i], vy);
+        simd_store(&state.vel_z[i], vz);
+        simd_store(&state.pos_x[i], px);
+        simd_store(&state.pos_y[i], py);
+        simd_store(&state.pos_z[i], pz);
+    }
+    // remaining particles
+    update_particles_scalar(i, end, dt);
+}
+
+static void update_chunk(void* user_data) {
+    const update_chunk_t* chunk = (const update_chunk_t*) user_data;
+    update_particles_simd(chunk->start, chunk->end, chunk->dt);
+}
+
+// split the particle range into one SIMD-aligned chunk per thread (including the main thread)
+static void update_particles_threaded(int num, float dt) {
+    const int num_chunks = jobs_num_threads() + 1;
+    int per_chunk = (num + num_chunks - 1) / num_chunks;
+    per_chunk = (per_chunk + SIMD_WIDTH - 1) & ~(SIMD_WIDTH - 1);
+    jobs_group_t group = {0};
+    for (int i = 0; i < num_chunks; i++) {
+        const int start = i * per_chunk;
+        if (start >= num) {
+            break;
+        }
+        const int end = ((start + per_chunk) < num) ? (start + per_chunk) : num;
+        state.chunks[i] = (update_chunk_t){ .start = start, .end = end, .dt = dt };
+        jobs_push(&group, update_chunk, &state.chunks[i]);
+    }
+    jobs_wait(&group);
+}
+
 static void frame(void) {
     const float frame_time = (float)(sapp_frame_duration());
 
     // emit new particles
-    for (int i = 0; i < NUM_PARTICLES_EMITTED_PER_FRAME; i++) {
+    for (int i = 0; i < state.num_emitted_per_frame; i++) {
         if (state.cur_num_particles < MAX_PARTICLES) {
-            state.pos[state.cur_num_particles] = vec3(0.0, 0.0, 0.0);
-            state.vel[state.cur_num_particles] = vec3(
-                ((float)(xorshift32() & 0x7FFF) / 0x7FFF) - 0.5f,
-                ((float)(xorshift32() & 0x7FFF) / 0x7FFF) * 0.5f + 2.0f,
-                ((float)(xorshift32() & 0x7FFF) / 0x7FFF) - 0.5f);
-            state.cur_num_particles++;
+            const int idx = state.cur_num_particles++;
+            state.pos_x[idx] = 0.0f;
+            state.pos_y[idx] = 0.0f;
+            state.pos_z[idx] = 0.0f;
+            state.vel_x[idx] = ((float)(xorshift32() & 0x7FFF) / 0x7FFF) - 0.5f;
+            state.vel_y[idx] = ((float)(xorshift32() & 0x7FFF) / 0x7FFF) * 0.5f + 2.0f;
+            state.vel_z[idx] = ((float)(xorshift32() & 0x7FFF) / 0x7FFF) - 0.5f;
         } else {
             break;
         }
     }
 
     // update particle positions
-    for (int i = 0; i < state.cur_num_particles; i++) {
-        state.vel[i].y -= 1.0f * frame_time;
-        state.pos[i].x += state.vel[i].x * frame_time;
-        state.pos[i].y += state.vel[i].y * frame_time;
-        state.pos[i].z += state.vel[i].z * frame_time;
-        // bounce back from 'ground'
-        if (state.pos[i].y < -2.0f) {
-            state.pos[i].y = -1.8f;
-            state.vel[i].y = -state.vel[i].y;
-            state.vel[i].x *= 0.8f; state.vel[i].y *= 0.8f; state.vel[i].z *= 0.8f;
-        }
+    const uint64_t update_start = stm_now();
+    switch (state.update_mode) {
+        case UPDATE_SCALAR:
+            update_particles_scalar(0, state.cur_num_particles, frame_time);
+            break;
+        case UPDATE_SIMD:
+            update_particles_simd(0, state.cur_num_particles, frame_time);
+            break;
+        default:
+            update_particles_threaded(state.cur_num_particles, frame_time);
+            break;
     }
+    const double update_ms = stm_ms(stm_since(update_start));
+    double* avg_ms = &state.update_ms[state.update_mode];
+    *avg_ms = (*avg_ms == 0.0) ? update_ms : (*avg_ms * 0.95 + update_ms * 0.05);
 
     // update instance data
-    sg_update_buffer(state.bind.vertex_buffers[1], &(sg_range){
-        .ptr = state.pos,
-        .size = (size_t)state.cur_num_particles * sizeof(vec3_t)
-    });
+    const size_t inst_data_size = (size_t)state.cur_num_particles * sizeof(float);
+    sg_update_buffer(state.bind.vertex_buffers[1], &(sg_range){ .ptr = state.pos_x, .size = inst_data_size });
+    sg_update_buffer(state.bind.vertex_buffers[2], &(sg_range){ .ptr = state.pos_y, .size = inst_data_size });
+    sg_update_buffer(state.bind.vertex_buffers[3], &(sg_range){ .ptr = state.pos_z, .size = inst_data_size });
 
     // model-view-projection matrix
     const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), sapp_widthf()/sapp_heightf(), 0.01f, 50.0f);
@@ -151,20 +371,68 @@ static void frame(void) {
     state.ry += 60.0f * frame_time;
     const vs_params_t vs_params = { .mvp = vm_mul(mat44_rotation_y(vm_radians(state.ry)), view_proj) };
 
+    // timing readout
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 2.0f);
+    sdtx_printf("particles: %d (%d per frame)\n", state.cur_num_particles, state.num_emitted_per_frame);
+    sdtx_printf("threads:   %d\n\n", jobs_num_threads() + 1);
+    for (int i = 0; i < NUM_UPDATE_MODES; i++) {
+        sdtx_color3b(0xFF, (i == (int)state.update_mode) ? 0xFF : 0x80, (i == (int)state.update_mode) ? 0x00 : 0x80);
+        if (state.update_ms[i] > 0.0) {
+            sdtx_printf("%d: %-16s %7.3f ms\n", i + 1, update_mode_names[i], state.update_ms[i]);
+        } else {
+            sdtx_printf("%d: %-16s       - ms\n", i + 1, update_mode_names[i]);
+        }
+    }
+    sdtx_color3b(0xFF, 0xFF, 0xFF);
+    sdtx_puts("\nkeys 1..3: update mode\nup/down: emit rate\nspace: reset");
+
     // ...and draw
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
     sg_apply_pipeline(state.pip);
     sg_apply_bindings(&state.bind);
     sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
     sg_draw(0, 24, state.cur_num_particles);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
 }
 
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        switch (ev->key_code) {
+            case SAPP_KEYCODE_1: state.update_mode = UPDATE_SCALAR; break;
+            case SAPP_KEYCODE_2: state.update_mode = UPDATE_SIMD; break;
+            case SAPP_KEYCODE_3: state.update_mode = UPDATE_SIMD_THREADED; break;
+            case SAPP_KEYCODE_UP:
+                if (state.num_emitted_per_frame < MAX_PARTICLES_EMITTED_PER_FRAME) {
+                    state.num_emitted_per_frame *= 10;
+                }
+                break;
+            case SAPP_KEYCODE_DOWN:
+                if (state.num_emitted_per_frame > MIN_PARTICLES_EMITTED_PER_FRAME) {
+                    state.num_emitted_per_frame /= 10;
+                }
+                break;
+            case SAPP_KEYCODE_SPACE: state.cur_num_particles = 0; break;
+            default: break;
+        }
+    }
+    __dbgui_event(ev);
+}
+
 static void cleanup(void) {
     __dbgui_shutdown();
+    sdtx_shutdown();
+    jobs_shutdown();
     sg_shutdown();
+    free(state.pos_x);
+    free(state.pos_y);
+    free(state.pos_z);
+    free(state.vel_x);
+    free(state.vel_y);
+    free(state.vel_z);
 }
 
 sapp_desc sokol_main(int argc, char* argv[]) {
@@ -173,7 +441,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 800,
         .height = 600,
         .sample_count = 4,
@@ -10,12 +10,14 @@ layout(binding=0) uniform vs_params {
 
 in vec3 pos;
 in vec4 color0;
-in vec3 inst_pos;
+in float inst_pos_x;
+in float inst_pos_y;
+in float inst_pos_z;
 
 out vec4 color;
 
 void main() {
-    vec4 pos = vec4(pos + inst_pos, 1.0);
+    vec4 pos = vec4(pos + vec3(inst_pos_x, inst_pos_y, inst_pos_z), 1.0);
     gl_Position = mvp * pos;
     color = color0;
 }
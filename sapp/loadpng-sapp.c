@@ -2,7 +2,9 @@
 //  loadpng-sapp.c
 //  Asynchronously load a png file via sokol_fetch.h, decode via stb_image.h
 //  (this is non-perfect since it happens on the main thread)
-//  and create a sokol-gfx texture from the decoded pixel data.
+//  and create a sokol-gfx texture with a complete mipmap chain from the
+//  decoded pixel data (see util/mipgen.h, the mipmaps are computed with a
+//  compute shader if supported, otherwise on the CPU).
 //
 //  The CMakeLists.txt entry for loadpng-sapp.c also demonstrates the
 //  sokol_file_copy() macro to copy assets into the fips deployment directory.
@@ -19,6 +21,10 @@
 #include "dbgui/dbgui.h"
 #include "util/fileutil.h"
 #include "loadpng-sapp.glsl.h"
+#if defined(MIPGEN_COMPUTE)
+#include "mipgen.glsl.h"
+#endif
+#include "util/mipgen.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -45,6 +51,7 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __dbgui_setup();
+    mipgen_setup();
 
     // setup sokol-fetch with the minimal "resource limits"
     sfetch_setup(&(sfetch_desc_t){
@@ -66,10 +73,11 @@ static void init(void) {
     */
     state.bind.views[VIEW_tex] = sg_alloc_view();
 
-    // a sampler object
+    // a sampler object which blends between mipmaps
     state.bind.samplers[SMP_smp] = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_LINEAR,
         .mag_filter = SG_FILTER_LINEAR,
+        .mipmap_filter = SG_FILTER_LINEAR,
         .label = "png-sampler",
     });
 
@@ -184,6 +192,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     __dbgui_shutdown();
+    mipgen_shutdown();
     sfetch_shutdown();
     sg_shutdown();
 }
@@ -204,12 +213,14 @@ static void fetch_callback(const sfetch_response_t* response) {
             &png_width, &png_height,
             &num_channels, desired_channels);
         if (pixels) {
-            // create an image object from the loaded texture date
-            sg_image img = sg_make_image(&(sg_image_desc){
+            /* create an image object with a complete mipmap chain from the
+               loaded texture data, this is called from sfetch_dowork()
+               outside of a pass, so mipgen_make_image() can run a compute pass
+            */
+            sg_image img = mipgen_make_image(&(mipgen_image_desc_t){
                 .width = png_width,
                 .height = png_height,
-                .pixel_format = SG_PIXELFORMAT_RGBA8,
-                .data.mip_levels[0] = {
+                .data = {
                     .ptr = pixels,
                     .size = (size_t)(png_width * png_height * 4),
                 },
@@ -3,32 +3,255 @@
 //
 //  Render Mandelbrot fractal in pixel shader. Ported back to C
 //  from the sokol_mandelbrot.mc sample in https://minc.dev/
+//
+//  Press D to switch to the deep zoom mode: a reference orbit is computed
+//  on the CPU in double-double precision and the fragment shader iterates
+//  the difference of each pixel to the reference orbit in float precision
+//  (perturbation, see util/mandelorbit.h), this goes down to a view width
+//  of about 1e-26 instead of about 1e-7.
+//
+//  In deep zoom mode the iteration counts are rendered into an offscreen
+//  image, which is only colored when the view doesn't change. After a view
+//  change, a coarse preview is rendered first, followed by tiles starting
+//  in the screen center, as many per frame as fit into a frame time budget.
+//
+//  Mouse wheel zooms, dragging with the left mouse button moves the view,
+//  A toggles auto-zoom, P toggles progressive rendering, R resets the view.
 //------------------------------------------------------------------------------
+#define SOKOL_DEBUGTEXT_IMPL
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
+#include "sokol_debugtext.h"
 #include "mandelbrot-sapp.glsl.h"
 #include "dbgui/dbgui.h"
+#include "util/mandelorbit.h"
 #include <math.h>
+#include <stdlib.h> // qsort()
+
+#define ORBIT_TEX_WIDTH (1024)  // must match shader
+#define ORBIT_TEX_HEIGHT (8)
+#define MAX_ITER (ORBIT_TEX_WIDTH * ORBIT_TEX_HEIGHT - 1)
+#define COARSE_SCALE (4)        // must match shader
+#define TILE_SIZE (64)
+#define MAX_TILES (8192)
+#define DEEP_MIN_WIDTH (1e-26)
+#define DEEP_MAX_WIDTH (4.0)
+#define NUM_REFERENCE_CANDIDATES (5)
+// tiles per frame are halved if the frame takes longer than this, and
+// slowly raised otherwise (there's no way to time the GPU work directly)
+#define FRAME_BUDGET_MS (20.0)
+
+typedef struct {
+    int index;
+    int dist_sq;
+} tile_order_t;
 
 static struct {
     sg_pipeline pip;
     float time;
-} state;
+    bool deep_mode;
+    struct {
+        sg_pipeline pip;
+        sg_pipeline upscale_pip;
+        sg_pipeline display_pip;
+        sg_sampler smp;
+        sg_image orbit_img;
+        sg_view orbit_tex_view;
+        // iteration images, same size as the framebuffer and 1/COARSE_SCALE of that
+        int width, height;
+        sg_image iter_img;
+        sg_view iter_att_view;
+        sg_view iter_tex_view;
+        sg_image coarse_img;
+        sg_view coarse_att_view;
+        sg_view coarse_tex_view;
+        // the view
+        mandelorbit_dd_t center_re;
+        mandelorbit_dd_t center_im;
+        double width_scale;
+        bool auto_zoom;
+        bool progressive;
+        bool dragging;
+        bool dirty;
+        // reference orbit and perturbation params for the current view
+        float orbit[ORBIT_TEX_WIDTH * ORBIT_TEX_HEIGHT * 2];
+        int orbit_len;
+        double orbit_ms;
+        fs_deep_params_t params;
+        // progressive rendering, tiles sorted by distance to the screen center
+        int num_tiles_x;
+        int num_tiles;
+        tile_order_t tile_order[MAX_TILES];
+        int next_tile;
+        int tiles_per_frame;
+        int rendered_tiles;
+    } deep;
+} state = {
+    .deep = {
+        .progressive = true,
+        .tiles_per_frame = 4,
+    },
+};
+
+static void reset_deep_view(void) {
+    state.deep.center_re = mandelorbit_dd(-0.7756838);
+    state.deep.center_im = mandelorbit_dd(0.1364674);
+    state.deep.width_scale = 4.0;
+    state.deep.dirty = true;
+}
 
 static void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
         .logger.func = slog_func,
     });
+    stm_setup();
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
     __dbgui_setup();
     state.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = sg_make_shader(mandelbrot_shader_desc(sg_query_backend())),
     });
+
+    // resources for the deep zoom mode, the iteration images are created in frame()
+    state.deep.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(deep_shader_desc(sg_query_backend())),
+        .depth.pixel_format = SG_PIXELFORMAT_NONE,
+        .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "deep-pipeline",
+    });
+    state.deep.upscale_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(upscale_shader_desc(sg_query_backend())),
+        .depth.pixel_format = SG_PIXELFORMAT_NONE,
+        .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "upscale-pipeline",
+    });
+    state.deep.display_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(display_shader_desc(sg_query_backend())),
+        .label = "display-pipeline",
+    });
+    state.deep.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "nearest-sampler",
+    });
+    state.deep.orbit_img = sg_make_image(&(sg_image_desc){
+        .usage.stream_update = true,
+        .width = ORBIT_TEX_WIDTH,
+        .height = ORBIT_TEX_HEIGHT,
+        .pixel_format = SG_PIXELFORMAT_RG32F,
+        .label = "orbit-image",
+    });
+    state.deep.orbit_tex_view = sg_make_view(&(sg_view_desc){
+        .texture.image = state.deep.orbit_img,
+        .label = "orbit-texture-view",
+    });
+    reset_deep_view();
 }
 
-static void frame(void) {
+static int compare_tiles(const void* a, const void* b) {
+    return ((const tile_order_t*)a)->dist_sq - ((const tile_order_t*)b)->dist_sq;
+}
+
+// (re-)create the iteration images when the framebuffer size changes
+static void update_iter_images(void) {
+    const int width = sapp_width();
+    const int height = sapp_height();
+    if ((width == state.deep.width) && (height == state.deep.height)) {
+        return;
+    }
+    if (state.deep.width > 0) {
+        sg_destroy_view(state.deep.iter_att_view);
+        sg_destroy_view(state.deep.iter_tex_view);
+        sg_destroy_image(state.deep.iter_img);
+        sg_destroy_view(state.deep.coarse_att_view);
+        sg_destroy_view(state.deep.coarse_tex_view);
+        sg_destroy_image(state.deep.coarse_img);
+    }
+    state.deep.width = width;
+    state.deep.height = height;
+    state.deep.iter_img = sg_make_image(&(sg_image_desc){
+        .usage.color_attachment = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "iteration-image",
+    });
+    state.deep.iter_att_view = sg_make_view(&(sg_view_desc){ .color_attachment.image = state.deep.iter_img });
+    state.deep.iter_tex_view = sg_make_view(&(sg_view_desc){ .texture.image = state.deep.iter_img });
+    state.deep.coarse_img = sg_make_image(&(sg_image_desc){
+        .usage.color_attachment = true,
+        .width = (width + COARSE_SCALE - 1) / COARSE_SCALE,
+        .height = (height + COARSE_SCALE - 1) / COARSE_SCALE,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "coarse-iteration-image",
+    });
+    state.deep.coarse_att_view = sg_make_view(&(sg_view_desc){ .color_attachment.image = state.deep.coarse_img });
+    state.deep.coarse_tex_view = sg_make_view(&(sg_view_desc){ .texture.image = state.deep.coarse_img });
+
+    // tiles closest to the screen center are rendered first
+    state.deep.num_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int num_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    state.deep.num_tiles = state.deep.num_tiles_x * num_tiles_y;
+    if (state.deep.num_tiles > MAX_TILES) {
+        state.deep.num_tiles = MAX_TILES;
+    }
+    for (int i = 0; i < state.deep.num_tiles; i++) {
+        const int dx = (i % state.deep.num_tiles_x) * TILE_SIZE + TILE_SIZE / 2 - width / 2;
+        const int dy = (i / state.deep.num_tiles_x) * TILE_SIZE + TILE_SIZE / 2 - height / 2;
+        state.deep.tile_order[i] = (tile_order_t){ .index = i, .dist_sq = dx * dx + dy * dy };
+    }
+    qsort(state.deep.tile_order, (size_t)state.deep.num_tiles, sizeof(tile_order_t), compare_tiles);
+    state.deep.dirty = true;
+}
+
+static void view_extent(double* out_re, double* out_im) {
+    const double aspect = (double)sapp_widthf() / (double)sapp_heightf();
+    *out_re = state.deep.width_scale * ((aspect >= 1.0) ? aspect : 1.0);
+    *out_im = state.deep.width_scale * ((aspect >= 1.0) ? 1.0 : 1.0 / aspect);
+}
+
+// compute a new reference orbit and upload it
+static void update_reference(void) {
+    double ext_re, ext_im;
+    view_extent(&ext_re, &ext_im);
+    int iter_max = 64 + (int)(log2(4.0 / state.deep.width_scale) * 32.0);
+    if (iter_max > MAX_ITER) {
+        iter_max = MAX_ITER;
+    }
+    const uint64_t start = stm_now();
+    double ref_re, ref_im;
+    state.deep.orbit_len = mandelorbit_find_reference(
+        state.deep.center_re, state.deep.center_im,
+        ext_re, ext_im,
+        NUM_REFERENCE_CANDIDATES,
+        iter_max + 1,
+        state.deep.orbit,
+        &ref_re, &ref_im);
+    state.deep.orbit_ms = stm_ms(stm_since(start));
+    state.deep.params = (fs_deep_params_t){
+        .delta_scale = { (float)ext_re, (float)ext_im },
+        .delta_offset = { (float)-ref_re, (float)-ref_im },
+        .iter_max = iter_max,
+        .orbit_len = state.deep.orbit_len,
+    };
+    sg_update_image(state.deep.orbit_img, &(sg_image_data){
+        .mip_levels[0] = SG_RANGE(state.deep.orbit),
+    });
+}
+
+static void frame_float(void) {
     // loop time to prevent a too deep mandelbrot zoom
     state.time = fmodf(state.time + (float)sapp_frame_duration(), 20.0);
     float aspect = sapp_widthf() / sapp_heightf();
@@ -49,6 +272,10 @@ static void frame(void) {
         },
     };
 
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1, 1);
+    sdtx_puts("D: deep zoom mode");
+
     // rendering happens via a 'fullscreen triangle' synthesized in the vertex shader
     sg_begin_pass(&(sg_pass){
         .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
@@ -57,23 +284,223 @@ static void frame(void) {
     sg_apply_pipeline(state.pip);
     sg_apply_uniforms(UB_fs_params, &SG_RANGE(fs_params));
     sg_draw(0, 3, 1);
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+// adapt the number of tiles per frame to the frame time of the last frame
+static void update_tile_budget(void) {
+    if (state.deep.rendered_tiles == 0) {
+        return;
+    }
+    const double frame_ms = sapp_frame_duration() * 1000.0;
+    if (frame_ms > FRAME_BUDGET_MS) {
+        state.deep.tiles_per_frame /= 2;
+    } else {
+        state.deep.tiles_per_frame += 1 + state.deep.tiles_per_frame / 4;
+    }
+    if (state.deep.tiles_per_frame < 1) {
+        state.deep.tiles_per_frame = 1;
+    } else if (state.deep.tiles_per_frame > state.deep.num_tiles) {
+        state.deep.tiles_per_frame = state.deep.num_tiles;
+    }
+}
+
+static void frame_deep(void) {
+    state.time += (float)sapp_frame_duration();
+    update_iter_images();
+    update_tile_budget();
+    if (state.deep.auto_zoom && !state.deep.dragging) {
+        state.deep.width_scale *= pow(0.6, sapp_frame_duration());
+        if (state.deep.width_scale < DEEP_MIN_WIDTH) {
+            state.deep.width_scale = DEEP_MIN_WIDTH;
+            state.deep.auto_zoom = false;
+        }
+        state.deep.dirty = true;
+    }
+
+    // after a view change, start with a coarse preview and restart the tiles,
+    // without progressive rendering all tiles are rendered in one frame
+    if (state.deep.dirty) {
+        state.deep.dirty = false;
+        update_reference();
+        state.deep.next_tile = 0;
+        if (state.deep.progressive) {
+            sg_begin_pass(&(sg_pass){
+                .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
+                .attachments.colors[0] = state.deep.coarse_att_view,
+                .label = "coarse-pass",
+            });
+            sg_apply_pipeline(state.deep.pip);
+            sg_apply_bindings(&(sg_bindings){
+                .views[VIEW_orbit_tex] = state.deep.orbit_tex_view,
+                .samplers[SMP_orbit_smp] = state.deep.smp,
+            });
+            sg_apply_uniforms(UB_fs_deep_params, &SG_RANGE(state.deep.params));
+            sg_draw(0, 3, 1);
+            sg_end_pass();
+            sg_begin_pass(&(sg_pass){
+                .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
+                .attachments.colors[0] = state.deep.iter_att_view,
+                .label = "upscale-pass",
+            });
+            sg_apply_pipeline(state.deep.upscale_pip);
+            sg_apply_bindings(&(sg_bindings){
+                .views[VIEW_coarse_tex] = state.deep.coarse_tex_view,
+                .samplers[SMP_coarse_smp] = state.deep.smp,
+            });
+            sg_draw(0, 3, 1);
+            sg_end_pass();
+        }
+    }
+
+    // render the next tiles over the preview
+    state.deep.rendered_tiles = 0;
+    if (state.deep.next_tile < state.deep.num_tiles) {
+        const int num_tiles = state.deep.progressive ? state.deep.tiles_per_frame : state.deep.num_tiles;
+        sg_begin_pass(&(sg_pass){
+            .action.colors[0].load_action = SG_LOADACTION_LOAD,
+            .attachments.colors[0] = state.deep.iter_att_view,
+            .label = "tiles-pass",
+        });
+        sg_apply_pipeline(state.deep.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_orbit_tex] = state.deep.orbit_tex_view,
+            .samplers[SMP_orbit_smp] = state.deep.smp,
+        });
+        sg_apply_uniforms(UB_fs_deep_params, &SG_RANGE(state.deep.params));
+        while ((state.deep.rendered_tiles < num_tiles) && (state.deep.next_tile < state.deep.num_tiles)) {
+            const int tile = state.deep.tile_order[state.deep.next_tile++].index;
+            const int x = (tile % state.deep.num_tiles_x) * TILE_SIZE;
+            const int y = (tile / state.deep.num_tiles_x) * TILE_SIZE;
+            sg_apply_scissor_rect(x, y, TILE_SIZE, TILE_SIZE, true);
+            sg_draw(0, 3, 1);
+            state.deep.rendered_tiles++;
+        }
+        sg_end_pass();
+    }
+
+    double ext_re, ext_im;
+    view_extent(&ext_re, &ext_im);
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1, 1);
+    sdtx_printf("deep zoom, width: %.3e\n", ext_re);
+    sdtx_printf("iterations: %d\n", state.deep.params.iter_max);
+    sdtx_printf("reference: %d (%.2f ms)\n", state.deep.orbit_len - 1, state.deep.orbit_ms);
+    sdtx_printf("tiles: %d/%d (%d per frame)\n", state.deep.next_tile, state.deep.num_tiles, state.deep.rendered_tiles);
+    sdtx_printf("\nA: auto zoom %s\n", state.deep.auto_zoom ? "on" : "off");
+    sdtx_printf("P: progressive %s\n", state.deep.progressive ? "on" : "off");
+    sdtx_puts("R: reset\nD: float mode");
+
+    // color the iteration image
+    const fs_display_params_t display_params = { .phase = state.time * 0.33f };
+    sg_begin_pass(&(sg_pass){
+        .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
+        .swapchain = sglue_swapchain(),
+    });
+    sg_apply_pipeline(state.deep.display_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_iter_tex] = state.deep.iter_tex_view,
+        .samplers[SMP_iter_smp] = state.deep.smp,
+    });
+    sg_apply_uniforms(UB_fs_display_params, &SG_RANGE(display_params));
+    sg_draw(0, 3, 1);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
 }
 
+static void frame(void) {
+    if (state.deep_mode) {
+        frame_deep();
+    } else {
+        frame_float();
+    }
+}
+
 static void cleanup(void) {
     __dbgui_shutdown();
+    sdtx_shutdown();
     sg_shutdown();
 }
 
+// zoom by a factor around a point in normalized screen coordinates
+static void zoom_at(float x, float y, double factor) {
+    double new_width = state.deep.width_scale * factor;
+    if (new_width < DEEP_MIN_WIDTH) {
+        new_width = DEEP_MIN_WIDTH;
+    } else if (new_width > DEEP_MAX_WIDTH) {
+        new_width = DEEP_MAX_WIDTH;
+    }
+    double ext_re, ext_im;
+    view_extent(&ext_re, &ext_im);
+    const double keep = 1.0 - new_width / state.deep.width_scale;
+    state.deep.center_re = mandelorbit_dd_add(state.deep.center_re, mandelorbit_dd((x - 0.5) * ext_re * keep));
+    state.deep.center_im = mandelorbit_dd_add(state.deep.center_im, mandelorbit_dd((y - 0.5) * ext_im * keep));
+    state.deep.width_scale = new_width;
+    state.deep.dirty = true;
+}
+
+static void input(const sapp_event* ev) {
+    if (__dbgui_event_with_retval(ev)) {
+        return;
+    }
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_D)) {
+        state.deep_mode = !state.deep_mode;
+        state.deep.dirty = true;
+        return;
+    }
+    if (!state.deep_mode) {
+        return;
+    }
+    switch (ev->type) {
+        case SAPP_EVENTTYPE_KEY_DOWN:
+            if (ev->key_code == SAPP_KEYCODE_A) {
+                state.deep.auto_zoom = !state.deep.auto_zoom;
+            } else if (ev->key_code == SAPP_KEYCODE_P) {
+                state.deep.progressive = !state.deep.progressive;
+                state.deep.dirty = true;
+            } else if (ev->key_code == SAPP_KEYCODE_R) {
+                reset_deep_view();
+            }
+            break;
+        case SAPP_EVENTTYPE_MOUSE_SCROLL:
+            zoom_at(ev->mouse_x / sapp_widthf(), ev->mouse_y / sapp_heightf(), pow(0.8, ev->scroll_y));
+            break;
+        case SAPP_EVENTTYPE_MOUSE_DOWN:
+            if (ev->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.deep.dragging = true;
+            }
+            break;
+        case SAPP_EVENTTYPE_MOUSE_UP:
+            if (ev->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.deep.dragging = false;
+            }
+            break;
+        case SAPP_EVENTTYPE_MOUSE_MOVE:
+            if (state.deep.dragging) {
+                double ext_re, ext_im;
+                view_extent(&ext_re, &ext_im);
+                state.deep.center_re = mandelorbit_dd_sub(state.deep.center_re, mandelorbit_dd(ev->mouse_dx / sapp_widthf() * ext_re));
+                state.deep.center_im = mandelorbit_dd_sub(state.deep.center_im, mandelorbit_dd(ev->mouse_dy / sapp_heightf() * ext_im));
+                state.deep.dirty = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc; (void)argv;
     return (sapp_desc){
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 512,
         .height = 512,
         .depth_format = SAPP_PIXELFORMAT_NONE,
@@ -46,3 +46,104 @@ void main() {
 @end
 
 @program mandelbrot vs fs
+
+// deep zoom mode: iterate the difference to a reference orbit computed on
+// the CPU in double-double precision (see util/mandelorbit.h), and write
+// the iteration count into an offscreen image
+@fs fs_deep
+@image_sample_type orbit_tex unfilterable_float
+layout(binding=0) uniform texture2D orbit_tex;
+@sampler_type orbit_smp nonfiltering
+layout(binding=0) uniform sampler orbit_smp;
+
+layout(binding=0) uniform fs_deep_params {
+    vec2 delta_scale;   // view size in the complex plane
+    vec2 delta_offset;  // view center minus reference point
+    int iter_max;
+    int orbit_len;
+};
+
+in vec2 uv;
+out vec4 frag_color;
+
+// the orbit texture is 1024 entries wide
+vec2 orbit(int i) {
+    return texelFetch(sampler2D(orbit_tex, orbit_smp), ivec2(i & 1023, i >> 10), 0).xy;
+}
+
+// same as mandelorbit_iterations()
+void main() {
+    vec2 dc = (uv - 0.5) * delta_scale + delta_offset;
+    vec2 dz = vec2(0.0);
+    vec2 ref_z = vec2(0.0);
+    int m = 0;
+    int n = 0;
+    for (; n < iter_max; n++) {
+        // dz = (2*Z + dz) * dz + dc
+        vec2 a = 2.0 * ref_z + dz;
+        dz = vec2(a.x * dz.x - a.y * dz.y, a.x * dz.y + a.y * dz.x) + dc;
+        m++;
+        ref_z = orbit(m);
+        vec2 z = ref_z + dz;
+        float z_sq = dot(z, z);
+        if (z_sq > 4.0) {
+            break;
+        }
+        // rebase to the start of the reference orbit
+        if ((z_sq < dot(dz, dz)) || (m >= (orbit_len - 1))) {
+            dz = z;
+            ref_z = vec2(0.0);
+            m = 0;
+        }
+    }
+    // n / iter_max as 16 bits in red and green, blue is set for escaped pixels
+    uint t = uint(float(n) / float(iter_max) * 65535.0 + 0.5);
+    frag_color = vec4(float(t >> 8) / 255.0, float(t & 255u) / 255.0, (n < iter_max) ? 1.0 : 0.0, 1.0);
+}
+@end
+
+@program deep vs fs_deep
+
+// scale up the coarse preview image, it is rendered with 1/4 resolution
+@fs fs_upscale
+layout(binding=0) uniform texture2D coarse_tex;
+layout(binding=0) uniform sampler coarse_smp;
+
+in vec2 uv;
+out vec4 frag_color;
+
+void main() {
+    ivec2 size = textureSize(sampler2D(coarse_tex, coarse_smp), 0);
+    ivec2 pos = min(ivec2(gl_FragCoord.xy) / 4, size - 1);
+    frag_color = texelFetch(sampler2D(coarse_tex, coarse_smp), pos, 0);
+}
+@end
+
+@program upscale vs fs_upscale
+
+// color the iteration image, only the color phase changes between frames
+@fs fs_display
+layout(binding=0) uniform texture2D iter_tex;
+layout(binding=0) uniform sampler iter_smp;
+
+layout(binding=0) uniform fs_display_params {
+    float phase;
+};
+
+in vec2 uv;
+out vec4 frag_color;
+
+void main() {
+    vec4 v = texelFetch(sampler2D(iter_tex, iter_smp), ivec2(gl_FragCoord.xy), 0);
+    float t = (floor(v.x * 255.0 + 0.5) * 256.0 + floor(v.y * 255.0 + 0.5)) / 65535.0;
+    float r = 0.0, g = 0.0, b = 0.0;
+    if (v.z > 0.5) {
+        r = 0.5 + 0.5 * cos(6.28 * (t * 2.0 + phase));
+        g = 0.5 + 0.5 * cos(6.28 * (t * 2.0 + phase + 0.33));
+        b = 0.5 + 0.5 * cos(6.28 * (t * 2.0 + phase + 0.67));
+    }
+    frag_color = vec4(r, g, b, 1.0);
+}
+@end
+
+@program display vs fs_display
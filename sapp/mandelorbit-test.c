@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+//  mandelorbit-test.c
+//
+//  CPU unit tests for the deep zoom reference orbit and perturbation math
+//  in util/mandelorbit.h used by mandelbrot-sapp.c.
+//
+//  The perturbation results are compared against a plain double-double
+//  iteration of each pixel, at a shallow zoom, with a reference orbit which
+//  escapes early (rebasing), and at a zoom depth of 1e-24 where a plain
+//  float or double iteration would only produce noise.
+//
+//  Returns a non-zero exit code if a test fails.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "util/mandelorbit.h"
+
+#define GRID_SIZE (32)
+#define NUM_REFERENCE_CANDIDATES (5)
+// min fraction of pixels with the same iteration count as the double-double
+// iteration, pixels close to the boundary are chaotic and differ with any
+// precision
+#define MIN_EXACT_MATCHES (0.97)
+// min fraction of pixels within 1% of the max iteration count
+#define MIN_CLOSE_MATCHES (0.99)
+
+static int num_checks;
+static int num_failed;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+static void check(bool cond, const char* expr, int line) {
+    num_checks++;
+    if (!cond) {
+        num_failed++;
+        printf("  FAILED (line %d): %s\n", line, expr);
+    }
+}
+
+static bool dd_equal(mandelorbit_dd_t a, double hi, double lo) {
+    return (a.hi == hi) && (a.lo == lo);
+}
+
+static void test_dd_arithmetic(void) {
+    printf("dd arithmetic\n");
+    const double eps = ldexp(1.0, -70);
+
+    // a tiny value survives adding and removing a large one
+    mandelorbit_dd_t a = mandelorbit_dd_add(mandelorbit_dd(1.0), mandelorbit_dd(eps));
+    CHECK(dd_equal(a, 1.0, eps));
+    a = mandelorbit_dd_sub(a, mandelorbit_dd(1.0));
+    CHECK(dd_equal(a, eps, 0.0));
+
+    // (1 + 2^-30)^2 = 1 + 2^-29 + 2^-60
+    const mandelorbit_dd_t b = mandelorbit_dd(1.0 + ldexp(1.0, -30));
+    CHECK(dd_equal(mandelorbit_dd_mul(b, b), 1.0 + ldexp(1.0, -29), ldexp(1.0, -60)));
+
+    // (2^40 + 1) * (2^40 + 3) = 2^80 + 2^42 + 3, exact in double-double
+    const mandelorbit_dd_t c = mandelorbit_dd_mul(mandelorbit_dd(ldexp(1.0, 40) + 1.0), mandelorbit_dd(ldexp(1.0, 40) + 3.0));
+    CHECK(dd_equal(c, ldexp(1.0, 80) + ldexp(1.0, 42), 3.0));
+
+    // multiplying with a double uses the low part
+    const mandelorbit_dd_t d = mandelorbit_dd_mul_d(mandelorbit_dd_add(mandelorbit_dd(1.0), mandelorbit_dd(eps)), 3.0);
+    CHECK(dd_equal(d, 3.0, 3.0 * eps));
+
+    // 0.1 * 10 - 1 is the representation error of 0.1 instead of 0
+    const mandelorbit_dd_t e = mandelorbit_dd_sub(mandelorbit_dd_mul_d(mandelorbit_dd(0.1), 10.0), mandelorbit_dd(1.0));
+    CHECK(fabs(mandelorbit_dd_to_double(e) - 5.551115123125783e-17) < 1e-30);
+}
+
+static void test_orbit(void) {
+    printf("reference orbit\n");
+    static float orbit[2 * 256];
+    // a point in the main cardioid never escapes
+    int len = mandelorbit_compute(mandelorbit_dd(-0.1), mandelorbit_dd(0.1), 256, orbit);
+    CHECK(len == 256);
+    CHECK((orbit[0] == 0.0f) && (orbit[1] == 0.0f));
+    CHECK((orbit[2] == -0.1f) && (orbit[3] == 0.1f));
+    // the first entries match a double iteration
+    double z_re = 0.0, z_im = 0.0;
+    bool match = true;
+    for (int i = 0; i < 32; i++) {
+        match &= fabs(orbit[i * 2 + 0] - z_re) < 1e-6;
+        match &= fabs(orbit[i * 2 + 1] - z_im) < 1e-6;
+        const double t = z_re * z_re - z_im * z_im - 0.1;
+        z_im = 2.0 * z_re * z_im + 0.1;
+        z_re = t;
+    }
+    CHECK(match);
+    // 1+1i escapes after 2 iterations: 0, 1+1i, 1+3i
+    len = mandelorbit_compute(mandelorbit_dd(1.0), mandelorbit_dd(1.0), 256, orbit);
+    CHECK(len == 3);
+    CHECK((orbit[4] == 1.0f) && (orbit[5] == 3.0f));
+}
+
+// plain float iteration like the original mandelbrot-sapp shader
+static int float_iterations(float c_re, float c_im, int iter_max) {
+    float z_re = 0.0f, z_im = 0.0f;
+    int n = 0;
+    for (; n < iter_max; n++) {
+        const float t = z_re * z_re - z_im * z_im + c_re;
+        z_im = 2.0f * z_re * z_im + c_im;
+        z_re = t;
+        if ((z_re * z_re + z_im * z_im) > 4.0f) {
+            break;
+        }
+    }
+    return n;
+}
+
+// compare perturbation against full double-double iteration on a grid around the view center
+static void compare_grid(const char* name, mandelorbit_dd_t c_re, mandelorbit_dd_t c_im, double width, int iter_max, bool find_reference) {
+    float* orbit = (float*) malloc((size_t)(iter_max + 1) * 2 * sizeof(float));
+    double ref_re = 0.0, ref_im = 0.0;
+    int orbit_len;
+    if (find_reference) {
+        orbit_len = mandelorbit_find_reference(c_re, c_im, width, width, NUM_REFERENCE_CANDIDATES, iter_max + 1, orbit, &ref_re, &ref_im);
+    } else {
+        orbit_len = mandelorbit_compute(c_re, c_im, iter_max + 1, orbit);
+    }
+    int num_exact = 0;
+    int num_close = 0;
+    int num_float_exact = 0;
+    int min_iter = iter_max;
+    int max_iter = 0;
+    for (int y = 0; y < GRID_SIZE; y++) {
+        for (int x = 0; x < GRID_SIZE; x++) {
+            const double ofs_re = (((double)x + 0.5) / GRID_SIZE - 0.5) * width;
+            const double ofs_im = (((double)y + 0.5) / GRID_SIZE - 0.5) * width;
+            const int n = mandelorbit_iterations(orbit, orbit_len, (float)(ofs_re - ref_re), (float)(ofs_im - ref_im), iter_max);
+            const int n_ref = mandelorbit_iterations_dd(
+                mandelorbit_dd_add(c_re, mandelorbit_dd(ofs_re)),
+                mandelorbit_dd_add(c_im, mandelorbit_dd(ofs_im)),
+                iter_max);
+            const int n_float = float_iterations(
+                (float)(mandelorbit_dd_to_double(c_re) + ofs_re),
+                (float)(mandelorbit_dd_to_double(c_im) + ofs_im),
+                iter_max);
+            num_exact += (n == n_ref) ? 1 : 0;
+            num_close += (abs(n - n_ref) <= (iter_max / 100)) ? 1 : 0;
+            num_float_exact += (n_float == n_ref) ? 1 : 0;
+            min_iter = (n_ref < min_iter) ? n_ref : min_iter;
+            max_iter = (n_ref > max_iter) ? n_ref : max_iter;
+        }
+    }
+    const double num_pixels = GRID_SIZE * GRID_SIZE;
+    printf("%s: width %.1e, orbit length %d, iterations %d..%d, exact %.2f%% (float %.2f%%), close %.2f%%\n",
+        name, width, orbit_len, min_iter, max_iter,
+        100.0 * num_exact / num_pixels, 100.0 * num_float_exact / num_pixels, 100.0 * num_close / num_pixels);
+    CHECK(num_exact >= MIN_EXACT_MATCHES * num_pixels);
+    CHECK(num_close >= MIN_CLOSE_MATCHES * num_pixels);
+    CHECK(num_exact >= num_float_exact);
+    // the view must not be a single flat color, otherwise the test is meaningless
+    CHECK(max_iter > min_iter);
+    free(orbit);
+}
+
+// find a point on the boundary between escaping within iter_max and not along the ray 0..(dir_re,dir_im)
+static void find_boundary(double dir_re, double dir_im, int iter_max, mandelorbit_dd_t* out_re, mandelorbit_dd_t* out_im) {
+    mandelorbit_dd_t t_in = mandelorbit_dd(0.0);
+    mandelorbit_dd_t t_out = mandelorbit_dd(1.0);
+    for (int i = 0; i < 100; i++) {
+        const mandelorbit_dd_t t = mandelorbit_dd_mul_d(mandelorbit_dd_add(t_in, t_out), 0.5);
+        if (mandelorbit_iterations_dd(mandelorbit_dd_mul_d(t, dir_re), mandelorbit_dd_mul_d(t, dir_im), iter_max) < iter_max) {
+            t_out = t;
+        } else {
+            t_in = t;
+        }
+    }
+    *out_re = mandelorbit_dd_mul_d(t_in, dir_re);
+    *out_im = mandelorbit_dd_mul_d(t_in, dir_im);
+}
+
+static void test_perturbation(void) {
+    printf("perturbation\n");
+    // the default view of mandelbrot-sapp
+    compare_grid("  shallow", mandelorbit_dd(-0.7756838), mandelorbit_dd(0.1364674), 1e-3, 256, true);
+    // the reference point escapes after a few iterations, most pixels need rebasing
+    compare_grid("  escaping reference", mandelorbit_dd(-0.7756838 + 0.02), mandelorbit_dd(0.1364674 + 0.02), 0.05, 256, false);
+    // deep zoom near the boundary, the view center escapes earlier than other pixels
+    mandelorbit_dd_t c_re, c_im;
+    find_boundary(-1.0, 0.75, 1000, &c_re, &c_im);
+    compare_grid("  deep", c_re, c_im, 1e-24, 1200, true);
+}
+
+int main(void) {
+    test_dd_arithmetic();
+    test_orbit();
+    test_perturbation();
+    printf("\n%s (%d checks, %d failed)\n", (num_failed == 0) ? "OK" : "FAILED", num_checks, num_failed);
+    return (num_failed == 0) ? 0 : 1;
+}
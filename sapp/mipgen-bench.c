@@ -0,0 +1,306 @@
+//------------------------------------------------------------------------------
+//  mipgen-bench.c
+//
+//  Benchmarks for util/mipgen.h:
+//
+//  - the CPU mip chain generation with box and Kaiser filter for a few
+//    power-of-two and non-power-of-two image sizes
+//  - the GPU-side work of building a mip chain with the compute shader
+//    (one compute pass, one dispatch per level) compared to one render
+//    pass per level like miprender-sapp.c: texel reads per level from the
+//    filter taps, shader invocations including the partially used 8x8
+//    workgroups and 2x2 fragment quads, passes and dependent levels
+//  - as a secondary column, the sokol-gfx submission cost of both
+//    variants including the creation and destruction of the temporary views
+//
+//  The benchmark runs on the dummy backend (no window, no 3D API), so the
+//  GPU-side work is computed from the filter and the dispatch/draw sizes,
+//  and only the CPU side is timed. The GPU time of both variants must be
+//  measured with a GPU profiler in loadpng-sapp.
+//
+//  Usage:
+//
+//      mipgen-bench [--runs N]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// force the dummy backend, the build system defines the 3D backend of the active config
+#undef SOKOL_GLCORE
+#undef SOKOL_GLES3
+#undef SOKOL_D3D11
+#undef SOKOL_METAL
+#undef SOKOL_WGPU
+#undef SOKOL_VULKAN
+#define SOKOL_DUMMY_BACKEND
+#define SOKOL_GFX_IMPL
+#include "sokol_gfx.h"
+#define SOKOL_TIME_IMPL
+#include "sokol_time.h"
+#define SOKOL_LOG_IMPL
+#include "sokol_log.h"
+#include "mipgen-bench.glsl.h"
+#include "util/mipgen.h"
+
+#define DEFAULT_RUNS (5)
+#define NUM_SUBMIT_ITERATIONS (1000)
+#define SUBMIT_IMAGE_SIZE (2048)
+
+static const struct { int width, height; } sizes[] = {
+    { 512, 512 },
+    { 1000, 600 },
+    { 2048, 2048 },
+};
+static const char* filter_names[MIPGEN_NUM_FILTERS] = { "box", "kaiser" };
+
+static struct {
+    sg_pipeline blit_pip;
+} state;
+
+static uint32_t rand_seed = 0x12345678;
+static uint32_t rnd(void) {
+    rand_seed = rand_seed * 1664525u + 1013904223u;
+    return rand_seed >> 8;
+}
+
+// best time of several runs in milliseconds
+static double bench_cpu(uint8_t* const levels[], int width, int height, mipgen_filter_t filter, int num_runs) {
+    const int num_mipmaps = mipgen_num_mipmaps(width, height);
+    double best_ms = 0.0;
+    for (int run = 0; run < num_runs; run++) {
+        const uint64_t start = stm_now();
+        mipgen_cpu_chain(levels, width, height, num_mipmaps, filter, true);
+        const double ms = stm_ms(stm_since(start));
+        if ((run == 0) || (ms < best_ms)) {
+            best_ms = ms;
+        }
+    }
+    return best_ms;
+}
+
+static void run_cpu_bench(int num_runs) {
+    printf("CPU mip chain (sRGB)\n\n");
+    printf("%-12s %-8s %12s %14s\n", "size", "filter", "time (ms)", "MPixel/s");
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        const int w = sizes[i].width;
+        const int h = sizes[i].height;
+        const int num_mipmaps = mipgen_num_mipmaps(w, h);
+        uint8_t* levels[MIPGEN_MAX_MIPMAPS];
+        for (int level = 0; level < num_mipmaps; level++) {
+            levels[level] = (uint8_t*) malloc((size_t)(mipgen_level_dim(w, level) * mipgen_level_dim(h, level) * 4));
+        }
+        for (int k = 0; k < w * h * 4; k++) {
+            levels[0][k] = (uint8_t)rnd();
+        }
+        for (int filter = 0; filter < MIPGEN_NUM_FILTERS; filter++) {
+            const double ms = bench_cpu(levels, w, h, (mipgen_filter_t)filter, num_runs);
+            char size_str[32];
+            snprintf(size_str, sizeof(size_str), "%dx%d", w, h);
+            printf("%-12s %-8s %12.3f %14.1f\n", size_str, filter_names[filter], ms, ((double)(w * h) / 1000000.0) / (ms / 1000.0));
+        }
+        for (int level = 0; level < num_mipmaps; level++) {
+            free(levels[level]);
+        }
+    }
+}
+
+// the same work as _mipgen_make_image_gpu() with one render pass per mip level
+static sg_image make_image_render_passes(const mipgen_image_desc_t* desc) {
+    const int num_mipmaps = mipgen_num_mipmaps(desc->width, desc->height);
+    sg_image src_img = sg_make_image(&(sg_image_desc){
+        .width = desc->width,
+        .height = desc->height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .data.mip_levels[0] = desc->data,
+    });
+    sg_image img = sg_make_image(&(sg_image_desc){
+        .usage.color_attachment = true,
+        .width = desc->width,
+        .height = desc->height,
+        .num_mipmaps = num_mipmaps,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+    });
+    sg_view src_views[MIPGEN_MAX_MIPMAPS];
+    sg_view att_views[MIPGEN_MAX_MIPMAPS];
+    for (int i = 0; i < num_mipmaps; i++) {
+        if (i < 2) {
+            src_views[i] = sg_make_view(&(sg_view_desc){ .texture = { .image = src_img } });
+        } else {
+            src_views[i] = sg_make_view(&(sg_view_desc){
+                .texture = { .image = img, .mip_levels = { .base = i - 1, .count = 1 } },
+            });
+        }
+        att_views[i] = sg_make_view(&(sg_view_desc){
+            .color_attachment = { .image = img, .mip_level = i },
+        });
+    }
+    for (int i = 0; i < num_mipmaps; i++) {
+        const int src_level = (i < 2) ? 0 : (i - 1);
+        const mipgen_params_t params = {
+            .size = {
+                mipgen_level_dim(desc->width, src_level),
+                mipgen_level_dim(desc->height, src_level),
+                mipgen_level_dim(desc->width, i),
+                mipgen_level_dim(desc->height, i),
+            },
+            .mode = { (int)desc->filter, desc->linear ? 0 : 1, (i == 0) ? 1 : 0, 0 },
+        };
+        sg_begin_pass(&(sg_pass){
+            .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
+            .attachments.colors[0] = att_views[i],
+        });
+        sg_apply_pipeline(state.blit_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_mipgen_src_tex] = src_views[i],
+            .samplers[SMP_mipgen_smp] = _mipgen.smp,
+        });
+        sg_apply_uniforms(UB_mipgen_params, &SG_RANGE(params));
+        sg_draw(0, 3, 1);
+        sg_end_pass();
+    }
+    for (int i = 0; i < num_mipmaps; i++) {
+        sg_destroy_view(src_views[i]);
+        sg_destroy_view(att_views[i]);
+    }
+    sg_destroy_image(src_img);
+    return img;
+}
+
+// texel reads for one level with the same filter taps as util/mipgen.glsl,
+// the filter is separable but the shader reads all num_x * num_y taps
+static uint64_t level_texel_reads(mipgen_filter_t filter, int level, int width, int height) {
+    const int dst_w = mipgen_level_dim(width, level);
+    const int dst_h = mipgen_level_dim(height, level);
+    if (level == 0) {
+        // level 0 is copied from the source texture
+        return (uint64_t)dst_w * (uint64_t)dst_h;
+    }
+    const int src_level = (level < 2) ? 0 : (level - 1);
+    const int src_w = mipgen_level_dim(width, src_level);
+    const int src_h = mipgen_level_dim(height, src_level);
+    float weights[MIPGEN_MAX_TAPS];
+    int first;
+    uint64_t taps_x = 0, taps_y = 0;
+    for (int x = 0; x < dst_w; x++) {
+        taps_x += (uint64_t)_mipgen_weights(filter, x, src_w, dst_w, &first, weights);
+    }
+    for (int y = 0; y < dst_h; y++) {
+        taps_y += (uint64_t)_mipgen_weights(filter, y, src_h, dst_h, &first, weights);
+    }
+    return taps_x * taps_y;
+}
+
+static inline uint64_t round_up(int val, int multiple) {
+    return (uint64_t)(((val + multiple - 1) / multiple) * multiple);
+}
+
+// per-level GPU work of both variants, the texel reads and writes are the same,
+// compute runs whole 8x8 workgroups, fragment shaders run in 2x2 quads
+static void print_gpu_work(int width, int height, uint64_t* out_reads, uint64_t* out_cs_invocations, uint64_t* out_fs_invocations) {
+    const int num_mipmaps = mipgen_num_mipmaps(width, height);
+    printf("\nGPU work per %dx%d mip chain\n\n", width, height);
+    printf("%-6s %-12s %16s %16s %16s %16s\n", "level", "size", "reads (box)", "reads (kaiser)", "cs invocations", "fs invocations");
+    *out_reads = *out_cs_invocations = *out_fs_invocations = 0;
+    uint64_t kaiser_reads = 0;
+    for (int level = 0; level < num_mipmaps; level++) {
+        const int w = mipgen_level_dim(width, level);
+        const int h = mipgen_level_dim(height, level);
+        const uint64_t box = level_texel_reads(MIPGEN_FILTER_BOX, level, width, height);
+        const uint64_t kaiser = level_texel_reads(MIPGEN_FILTER_KAISER, level, width, height);
+        const uint64_t cs = round_up(w, 8) * round_up(h, 8);
+        const uint64_t fs = round_up(w, 2) * round_up(h, 2);
+        char size_str[32];
+        snprintf(size_str, sizeof(size_str), "%dx%d", w, h);
+        printf("%-6d %-12s %16llu %16llu %16llu %16llu\n", level, size_str,
+            (unsigned long long)box, (unsigned long long)kaiser, (unsigned long long)cs, (unsigned long long)fs);
+        *out_reads += box;
+        kaiser_reads += kaiser;
+        *out_cs_invocations += cs;
+        *out_fs_invocations += fs;
+    }
+    printf("%-6s %-12s %16llu %16llu %16llu %16llu\n", "total", "",
+        (unsigned long long)*out_reads, (unsigned long long)kaiser_reads,
+        (unsigned long long)*out_cs_invocations, (unsigned long long)*out_fs_invocations);
+}
+
+static void run_submit_bench(void) {
+    if (!mipgen_gpu_supported()) {
+        printf("\nmip chain GPU work and submission: compute not supported, skipped\n");
+        return;
+    }
+    state.blit_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(blit_shader_desc(sg_query_backend())),
+        .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+        .depth.pixel_format = SG_PIXELFORMAT_NONE,
+        .sample_count = 1,
+    });
+    // the pixel content doesn't matter on the dummy backend
+    const size_t num_bytes = (size_t)(SUBMIT_IMAGE_SIZE * SUBMIT_IMAGE_SIZE * 4);
+    void* pixels = calloc(1, num_bytes);
+    const mipgen_image_desc_t desc = {
+        .width = SUBMIT_IMAGE_SIZE,
+        .height = SUBMIT_IMAGE_SIZE,
+        .data = { pixels, num_bytes },
+    };
+    uint64_t reads, cs_invocations, fs_invocations;
+    print_gpu_work(SUBMIT_IMAGE_SIZE, SUBMIT_IMAGE_SIZE, &reads, &cs_invocations, &fs_invocations);
+
+    // both variants apply one set of bindings per level, levels 2 and up read the
+    // previous level, which needs a barrier (compute) or an attachment to texture
+    // transition between passes (render passes)
+    const int num_mipmaps = mipgen_num_mipmaps(SUBMIT_IMAGE_SIZE, SUBMIT_IMAGE_SIZE);
+    const int num_dependent_levels = num_mipmaps - 2;
+    printf("\nvariant summary (box filter), CPU submission cost on the dummy backend (%d iterations)\n\n", NUM_SUBMIT_ITERATIONS);
+    printf("%-14s %7s %11s %6s %11s %11s %12s %12s\n",
+        "variant", "passes", "dispatches", "draws", "dependent", "reads (M)", "invocs (M)", "CPU us");
+    for (int variant = 0; variant < 2; variant++) {
+        uint64_t ticks = 0;
+        for (int i = 0; i < NUM_SUBMIT_ITERATIONS; i++) {
+            const uint64_t start = stm_now();
+            sg_image img = (variant == 0) ? mipgen_make_image(&desc) : make_image_render_passes(&desc);
+            ticks += stm_since(start);
+            sg_destroy_image(img);
+            sg_commit();
+        }
+        const bool compute = (variant == 0);
+        printf("%-14s %7d %11d %6d %11d %11.2f %12.2f %12.2f\n",
+            compute ? "compute" : "render passes",
+            compute ? 1 : num_mipmaps,
+            compute ? num_mipmaps : 0,
+            compute ? 0 : num_mipmaps,
+            num_dependent_levels,
+            (double)reads / 1000000.0,
+            (double)(compute ? cs_invocations : fs_invocations) / 1000000.0,
+            stm_us(ticks) / NUM_SUBMIT_ITERATIONS);
+    }
+    free(pixels);
+}
+
+int main(int argc, char* argv[]) {
+    int num_runs = DEFAULT_RUNS;
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--runs")) && ((i + 1) < argc)) {
+            num_runs = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--runs N]\n", argv[0]);
+            return 10;
+        }
+    }
+    num_runs = (num_runs < 1) ? 1 : num_runs;
+    stm_setup();
+    sg_setup(&(sg_desc){
+        .environment.defaults = {
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+            .sample_count = 1,
+        },
+        .logger.func = slog_func,
+    });
+    mipgen_setup();
+    run_cpu_bench(num_runs);
+    run_submit_bench();
+    mipgen_shutdown();
+    sg_shutdown();
+    return 0;
+}
@@ -0,0 +1,32 @@
+//------------------------------------------------------------------------------
+//  Shaders for mipgen-bench.c: the util/mipgen.h compute shader, and the
+//  same filter in a fragment shader for rendering one mip level per pass.
+//------------------------------------------------------------------------------
+@include ../libs/util/mipgen.glsl
+
+@vs vs_blit
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs fs_blit
+layout(binding=0) uniform mipgen_params {
+    ivec4 size;
+    ivec4 mode;
+};
+layout(binding=0) uniform texture2D mipgen_src_tex;
+layout(binding=0) uniform sampler mipgen_smp;
+
+out vec4 frag_color;
+
+@include_block mipgen_filter
+
+void main() {
+    frag_color = mipgen_sample(ivec2(gl_FragCoord.xy));
+}
+@end
+
+@program blit vs_blit fs_blit
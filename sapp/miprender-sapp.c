@@ -9,6 +9,7 @@
 #include "sokol_glue.h"
 #define SOKOL_SHAPE_IMPL
 #include "sokol_shape.h"
+#include "util/shapecache.h"
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
 #include "dbgui/dbgui.h"
@@ -60,27 +61,19 @@ static void init(void) {
     __dbgui_setup();
 
     // setup a couple of shape geometries
-    static uint8_t vertices[SSHAPE_MAX_VERTEX_SIZE * 4 * 1024];
-    static uint16_t indices[12 * 1024];
-    sshape_state_t shp = {
-        .disable.colors = true,
-        .vertices.buffer = SSHAPE_RANGE(vertices),
-        .indices.buffer = SSHAPE_RANGE(indices),
-    };
-    sshape_build_box(&shp, &(sshape_box_t){ .width = 1.5f, .height = 1.5f, .depth = 1.5f });
-    state.offscreen.shapes[SHAPE_BOX] = sshape_element_range(&shp);
-    sshape_build_torus(&shp, &(sshape_torus_t){ .radius = 1.0f, .ring_radius = 0.3f, .rings = 36, .sides = 18 });
-    state.offscreen.shapes[SHAPE_DONUT] = sshape_element_range(&shp);
-    sshape_build_sphere(&shp, &(sshape_sphere_t){ .radius = 1.0f, .slices = 36, .stacks = 20 });
-    state.offscreen.shapes[SHAPE_SPHERE] = sshape_element_range(&shp);
-    sshape_build_plane(&shp, &(sshape_plane_t){ .width = 2.0f, .depth = 2.0f });
-    state.display.plane = sshape_element_range(&shp);
-    assert(shp.valid);
+    shapecache_t cache;
+    shapecache_init(&cache, &(shapecache_desc_t){
+        .format.disable.colors = true,
+    });
+    state.offscreen.shapes[SHAPE_BOX] = shapecache_box(&cache, &(sshape_box_t){ .width = 1.5f, .height = 1.5f, .depth = 1.5f });
+    state.offscreen.shapes[SHAPE_DONUT] = shapecache_torus(&cache, &(sshape_torus_t){ .radius = 1.0f, .ring_radius = 0.3f, .rings = 36, .sides = 18 });
+    state.offscreen.shapes[SHAPE_SPHERE] = shapecache_sphere(&cache, &(sshape_sphere_t){ .radius = 1.0f, .slices = 36, .stacks = 20 });
+    state.display.plane = shapecache_plane(&cache, &(sshape_plane_t){ .width = 2.0f, .depth = 2.0f });
 
     // create one vertex- and one index-buffer for all shapes
-    sg_buffer_desc vbuf_desc = sshape_vertex_buffer_desc(&shp);
+    sg_buffer_desc vbuf_desc = shapecache_vertex_buffer_desc(&cache);
     vbuf_desc.label = "shape-vertices";
-    sg_buffer_desc ibuf_desc = sshape_index_buffer_desc(&shp);
+    sg_buffer_desc ibuf_desc = shapecache_index_buffer_desc(&cache);
     ibuf_desc.label = "shape-indices";
     state.vbuf = sg_make_buffer(&vbuf_desc);
     state.ibuf = sg_make_buffer(&ibuf_desc);
@@ -142,14 +135,14 @@ static void init(void) {
     // a pipeline object for the offscreen passes
     state.offscreen.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .layout = {
-            .buffers[0] = sshape_vertex_buffer_layout_state(&shp),
+            .buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
             .attrs = {
-                [ATTR_offscreen_in_pos] = sshape_position_vertex_attr_state(&shp),
-                [ATTR_offscreen_in_nrm] = sshape_normal_vertex_attr_state(&shp),
+                [ATTR_offscreen_in_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_offscreen_in_nrm] = sshape_normal_vertex_attr_state(&cache.format),
             },
         },
         .shader = sg_make_shader(offscreen_shader_desc(sg_query_backend())),
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_BACK,
         .sample_count = 1,
         .depth = {
@@ -164,14 +157,14 @@ static void init(void) {
     // ...and a pipeline object for the display pass
     state.display.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .layout = {
-            .buffers[0] = sshape_vertex_buffer_layout_state(&shp),
+            .buffers[0] = sshape_vertex_buffer_layout_state(&cache.format),
             .attrs = {
-                [ATTR_display_in_pos] = sshape_position_vertex_attr_state(&shp),
-                [ATTR_display_in_uv] = sshape_texcoord_vertex_attr_state(&shp),
+                [ATTR_display_in_pos] = sshape_position_vertex_attr_state(&cache.format),
+                [ATTR_display_in_uv] = sshape_texcoord_vertex_attr_state(&cache.format),
             },
         },
         .shader = sg_make_shader(display_shader_desc(sg_query_backend())),
-        .index_type = SG_INDEXTYPE_UINT16,
+        .index_type = SG_INDEXTYPE_UINT32,
         .cull_mode = SG_CULLMODE_NONE,
         .depth = {
             .write_enabled = true,
@@ -179,6 +172,7 @@ static void init(void) {
         },
         .label = "display-pipeline",
     });
+    shapecache_shutdown(&cache);
 
     // initialize resource bindings
     state.offscreen.bindings = (sg_bindings) {
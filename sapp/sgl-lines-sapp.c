@@ -1,26 +1,64 @@
 //------------------------------------------------------------------------------
 //  sgl-lines-sapp.c
 //  Line rendering with sokol_gl.h
+//
+//  Press space to switch between immediate mode rendering through
+//  sokol-gl (all vertices are submitted each frame), and recorded display
+//  lists from util/sgllist.h: the grid and floaty thingies are recorded
+//  once and only drawn with different transforms and vertex ranges,
+//  the hairball only patches the few lines which change each frame.
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
 #define SOKOL_GL_IMPL
 #include "sokol_gl.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/sgllist.h"
 #include "dbgui/dbgui.h"
+#include "sgl-lines-sapp.glsl.h"
+
+#define GRID_NUM (64)
+#define GRID_DIST (4.0f)
+#define FLOATY_NUM_SEGS (32)
+#define RING_NUM (1024)
+#define RING_MASK (RING_NUM-1)
 
 static struct {
     sg_pass_action pass_action;
     sgl_pipeline depth_test_pip;
+    bool retained;
+    struct {
+        sg_pipeline pip;
+        sgllist_t* grid;        // x lines followed by z lines, at y = 0
+        sgllist_t* floaty;      // a yellow and a green floaty thingy
+        sgllist_t* hairball;    // one line per ring entry
+    } lists;
+    struct {
+        double cpu_ms;
+        int num_vertices;
+        size_t uploaded_bytes;
+    } stats;
 } state;
 
+static void record_display_lists(void);
+
 static void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
         .logger.func = slog_func,
     });
     __dbgui_setup();
+    stm_setup();
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
 
     // setup sokol-gl
     sgl_setup(&(sgl_desc_t){
@@ -35,6 +73,19 @@ static void init(void) {
         }
     });
 
+    // a pipeline for rendering display lists, with the same depth-test state
+    state.lists.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(displaylist_shader_desc(sg_query_backend())),
+        .layout = sgllist_vertex_layout(),
+        .primitive_type = SG_PRIMITIVETYPE_LINES,
+        .depth = {
+            .write_enabled = true,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL
+        },
+        .label = "display-list-pipeline",
+    });
+    record_display_lists();
+
     // a default pass action
     state.pass_action = (sg_pass_action) {
         .colors[0] = {
@@ -44,10 +95,32 @@ static void init(void) {
     };
 }
 
+// record the grid at y = 0 without the animated z offset
+static void grid_record(sgllist_t* list) {
+    const int num = GRID_NUM;
+    const float dist = GRID_DIST;
+    sgllist_begin_lines(list);
+    for (int i = 0; i < num; i++) {
+        float x = i * dist - num * dist * 0.5f;
+        sgllist_v3f(list, x, 0.0f, -num * dist);
+        sgllist_v3f(list, x, 0.0f, 0.0f);
+    }
+    for (int i = 0; i < num; i++) {
+        float z = i * dist - num * dist;
+        sgllist_v3f(list, -num * dist * 0.5f, 0.0f, z);
+        sgllist_v3f(list, num * dist * 0.5f, 0.0f, z);
+    }
+    sgllist_end(list);
+}
+
+static float grid_z_offset(uint32_t frame_count) {
+    return (GRID_DIST / 8) * (frame_count & 7);
+}
+
 static void grid(float y, uint32_t frame_count) {
-    const int num = 64;
-    const float dist = 4.0f;
-    const float z_offset = (dist / 8) * (frame_count & 7);
+    const int num = GRID_NUM;
+    const float dist = GRID_DIST;
+    const float z_offset = grid_z_offset(frame_count);
     sgl_begin_lines();
     for (int i = 0; i < num; i++) {
         float x = i * dist - num * dist * 0.5f;
@@ -62,8 +135,9 @@ static void grid(float y, uint32_t frame_count) {
     sgl_end();
 }
 
-static void floaty_thingy(uint32_t frame_count) {
-    const uint32_t num_segs = 32;
+// the range of visible floaty thingy segments
+static void floaty_range(uint32_t frame_count, uint32_t* out_start, uint32_t* out_end) {
+    const uint32_t num_segs = FLOATY_NUM_SEGS;
     uint32_t start = frame_count % (num_segs * 2);
     if (start < num_segs) {
         start = 0;
@@ -75,6 +149,14 @@ static void floaty_thingy(uint32_t frame_count) {
     if (end > num_segs) {
         end = num_segs;
     }
+    *out_start = start;
+    *out_end = end;
+}
+
+static void floaty_thingy(uint32_t frame_count) {
+    const uint32_t num_segs = FLOATY_NUM_SEGS;
+    uint32_t start, end;
+    floaty_range(frame_count, &start, &end);
     const float dx = 0.25f;
     const float dy = 0.25f;
     const float x0 = -(num_segs * dx * 0.5f);
@@ -93,6 +175,27 @@ static void floaty_thingy(uint32_t frame_count) {
     sgl_end();
 }
 
+// record all segments of a floaty thingy
+static void floaty_record(sgllist_t* list) {
+    const uint32_t num_segs = FLOATY_NUM_SEGS;
+    const float dx = 0.25f;
+    const float dy = 0.25f;
+    const float x0 = -(num_segs * dx * 0.5f);
+    const float x1 = -x0;
+    const float y0 = -(num_segs * dy * 0.5f);
+    const float y1 = -y0;
+    sgllist_begin_lines(list);
+    for (uint32_t i = 0; i < num_segs; i++) {
+        float x = i * dx;
+        float y = i * dy;
+        sgllist_v2f(list, x0 + x, y0); sgllist_v2f(list, x1, y0 + y);
+        sgllist_v2f(list, x1 - x, y1); sgllist_v2f(list, x0, y1 - y);
+        sgllist_v2f(list, x0 + x, y1); sgllist_v2f(list, x1, y1 - y);
+        sgllist_v2f(list, x1 - x, y0); sgllist_v2f(list, x0, y0 + y);
+    }
+    sgllist_end(list);
+}
+
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
     x ^= x<<13;
@@ -105,12 +208,10 @@ static inline float rnd(void) {
     return (((float)(xorshift32() & 0xFFFF)) / 0x10000) * 2.0f - 1.0f;
 }
 
-#define RING_NUM (1024)
-#define RING_MASK (RING_NUM-1)
-static void hairball(void) {
-    static float ring[RING_NUM][6];
-    static uint32_t head = 0;
+static float ring[RING_NUM][6];
+static uint32_t head = 0;
 
+static void hairball_update(void) {
     float vx = rnd();
     float vy = rnd();
     float vz = rnd();
@@ -127,7 +228,9 @@ static void hairball(void) {
     ring[head][3] = r;
     ring[head][4] = g;
     ring[head][5] = b;
+}
 
+static void hairball(void) {
     sgl_begin_line_strip();
     for (uint32_t i = (head + 1) & RING_MASK; i != head; i = (i + 1) & RING_MASK) {
         sgl_c3f(ring[i][3], ring[i][4], ring[i][5]);
@@ -136,11 +239,114 @@ static void hairball(void) {
     sgl_end();
 }
 
-static void frame(void) {
+// the line from ring entry i to i+1, or a degenerate line if it's not part of the visible strip
+static void hairball_line(uint32_t i, sgllist_vertex_t out[2]) {
+    // the visible strip goes from head+1 to head-1
+    const bool visible = (i != head) && (((i + 1) & RING_MASK) != head);
+    for (int v = 0; v < 2; v++) {
+        const uint32_t ri = visible ? ((i + (uint32_t)v) & RING_MASK) : i;
+        out[v] = (sgllist_vertex_t){
+            .pos = { ring[ri][0], ring[ri][1], ring[ri][2] },
+            .rgba = sgllist_pack_rgba(ring[ri][3], ring[ri][4], ring[ri][5], 1.0f),
+        };
+    }
+}
+
+// after hairball_update(), only the lines around the new head change
+static void hairball_patch(void) {
+    for (uint32_t i = (head - 2) & RING_MASK; i != ((head + 1) & RING_MASK); i = (i + 1) & RING_MASK) {
+        sgllist_vertex_t line[2];
+        hairball_line(i, line);
+        sgllist_patch(state.lists.hairball, (int)i * 2, 2, line);
+    }
+}
+
+static void hairball_patch_all(void) {
+    for (uint32_t i = 0; i < RING_NUM; i++) {
+        sgllist_vertex_t line[2];
+        hairball_line(i, line);
+        sgllist_patch(state.lists.hairball, (int)i * 2, 2, line);
+    }
+}
+
+static void record_display_lists(void) {
+    // the grid without z offset, the z lines are moved with a transform
+    state.lists.grid = sgllist_make(&(sgllist_desc_t){ .max_vertices = GRID_NUM * 4, .label = "grid-list" });
+    sgllist_c3f(state.lists.grid, 1.0f, 0.0f, 1.0f);
+    grid_record(state.lists.grid);
+
+    // the floaty thingies are drawn with a range of segments, 8 vertices per segment
+    state.lists.floaty = sgllist_make(&(sgllist_desc_t){ .max_vertices = FLOATY_NUM_SEGS * 16, .label = "floaty-list" });
+    sgllist_c3f(state.lists.floaty, 1.0f, 1.0f, 0.0f);
+    floaty_record(state.lists.floaty);
+    sgllist_c3f(state.lists.floaty, 0.0f, 1.0f, 0.0f);
+    floaty_record(state.lists.floaty);
+
+    // the hairball is recorded as one (initially degenerate) line per ring entry, and patched each frame
+    state.lists.hairball = sgllist_make(&(sgllist_desc_t){ .max_vertices = RING_NUM * 2, .segment_vertices = 256, .label = "hairball-list" });
+    sgllist_begin_lines(state.lists.hairball);
+    for (int i = 0; i < RING_NUM * 2; i++) {
+        sgllist_v3f(state.lists.hairball, 0.0f, 0.0f, 0.0f);
+    }
+    sgllist_end(state.lists.hairball);
+    hairball_patch_all();
+}
+
+// same transforms as the sokol-gl matrix stack in draw_immediate()
+static mat44_t axis_rotation(float angle, float x, float y, float z) {
+    return mat44_rotation_axis(vec3(x, y, z), angle);
+}
+
+static void draw_list_range(const sgllist_t* list, int first, int num, mat44_t model, mat44_t view_proj) {
+    const vs_params_t vs_params = { .mvp = vm_mul(model, view_proj) };
+    sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+    sgllist_draw(list, first, num);
+    state.stats.num_vertices += num;
+}
+
+// patch and upload the display lists, must be called outside a render pass
+static void update_retained(void) {
+    hairball_update();
+    hairball_patch();
+    state.stats.uploaded_bytes = sgllist_update(state.lists.grid);
+    state.stats.uploaded_bytes += sgllist_update(state.lists.floaty);
+    state.stats.uploaded_bytes += sgllist_update(state.lists.hairball);
+}
+
+static void draw_retained(uint32_t frame_count) {
     const float aspect = sapp_widthf() / sapp_heightf();
-    static uint32_t frame_count = 0;
-    frame_count++;
+    const mat44_t proj = mat44_perspective_fov_rh(sgl_rad(45.0f), aspect, 0.1f, 1000.0f);
+    const mat44_t view = mat44_translation(sinf(frame_count * 0.02f) * 16.0f, sinf(frame_count * 0.01f) * 4.0f, 0.0f);
+    const mat44_t view_proj = vm_mul(view, proj);
+
+    state.stats.num_vertices = 0;
+    sg_apply_pipeline(state.lists.pip);
+    const int grid_half = GRID_NUM * 2;
+    const float z_offset = grid_z_offset(frame_count);
+    draw_list_range(state.lists.grid, 0, grid_half, mat44_translation(0.0f, -7.0f, 0.0f), view_proj);
+    draw_list_range(state.lists.grid, grid_half, grid_half, mat44_translation(0.0f, -7.0f, z_offset), view_proj);
+    draw_list_range(state.lists.grid, 0, grid_half, mat44_translation(0.0f, +7.0f, 0.0f), view_proj);
+    draw_list_range(state.lists.grid, grid_half, grid_half, mat44_translation(0.0f, +7.0f, z_offset), view_proj);
+
+    uint32_t start, end;
+    floaty_range(frame_count, &start, &end);
+    mat44_t model = vm_mul(axis_rotation(frame_count * 0.05f, 0.0f, 1.0f, 1.0f), mat44_translation(0.0f, 0.0f, -30.0f));
+    draw_list_range(state.lists.floaty, (int)start * 8, (int)(end - start) * 8, model, view_proj);
+    floaty_range(frame_count + 32, &start, &end);
+    model = vm_mul(
+        axis_rotation(frame_count * 0.05f, 0.0f, -1.0f, 1.0f),
+        mat44_translation(-sinf(frame_count * 0.02f) * 32.0f, 0.0f, -70.0f + cosf(frame_count * 0.01f) * 50.0f));
+    draw_list_range(state.lists.floaty, (FLOATY_NUM_SEGS + (int)start) * 8, (int)(end - start) * 8, model, view_proj);
 
+    model = vm_mul(
+        axis_rotation(frame_count * 0.01f, sinf(frame_count * 0.005f), 0.0f, 1.0f),
+        mat44_translation(-sinf(frame_count * 0.02f) * 16.0f, 0.0f, -30.0f));
+    draw_list_range(state.lists.hairball, 0, sgllist_num_vertices(state.lists.hairball), model, view_proj);
+}
+
+static void draw_immediate(uint32_t frame_count) {
+    const float aspect = sapp_widthf() / sapp_heightf();
+    hairball_update();
     sgl_defaults();
     sgl_push_pipeline();
     sgl_load_pipeline(state.depth_test_pip);
@@ -170,17 +376,58 @@ static void frame(void) {
         hairball();
     sgl_pop_matrix();
     sgl_pop_pipeline();
+    state.stats.num_vertices = sgl_num_vertices();
+    state.stats.uploaded_bytes = 0;
+}
 
-    // sokol-gfx default pass with the actual sokol-gl drawing
-    sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
-    sgl_draw();
+static void frame(void) {
+    static uint32_t frame_count = 0;
+    frame_count++;
+
+    // sokol-gfx default pass with the actual line drawing
+    const uint64_t start = stm_now();
+    if (state.retained) {
+        update_retained();
+        sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
+        draw_retained(frame_count);
+    } else {
+        draw_immediate(frame_count);
+        sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
+        sgl_draw();
+    }
+    const double cpu_ms = stm_ms(stm_since(start));
+    state.stats.cpu_ms = (state.stats.cpu_ms == 0.0) ? cpu_ms : (state.stats.cpu_ms * 0.95 + cpu_ms * 0.05);
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("%s (space to toggle)\n\n", state.retained ? "display lists" : "sokol-gl immediate");
+    sdtx_printf("vertices: %d\n", state.stats.num_vertices);
+    sdtx_printf("uploaded: %d bytes\n", (int)state.stats.uploaded_bytes);
+    sdtx_printf("cpu:      %.3f ms\n", state.stats.cpu_ms);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
 }
 
+static void input(const sapp_event* ev) {
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_SPACE)) {
+        state.retained = !state.retained;
+        state.stats.cpu_ms = 0.0;
+        if (state.retained) {
+            // the immediate-mode path didn't patch the hairball list
+            hairball_patch_all();
+        }
+    }
+    __dbgui_event(ev);
+}
+
 static void cleanup(void) {
     __dbgui_shutdown();
+    sgllist_destroy(state.lists.hairball);
+    sgllist_destroy(state.lists.floaty);
+    sgllist_destroy(state.lists.grid);
+    sdtx_shutdown();
     sgl_shutdown();
     sg_shutdown();
 }
@@ -191,7 +438,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 512,
         .height = 512,
         .sample_count = 4,
@@ -0,0 +1,31 @@
+//------------------------------------------------------------------------------
+//  shaders for rendering util/sgllist.h display lists in sgl-lines-sapp
+//------------------------------------------------------------------------------
+@ctype mat4 mat44_t
+
+@vs vs
+layout(binding=0) uniform vs_params {
+    mat4 mvp;
+};
+
+layout(location=0) in vec3 position;
+layout(location=1) in vec4 color0;
+
+out vec4 color;
+
+void main() {
+    gl_Position = mvp * vec4(position, 1.0);
+    color = color0;
+}
+@end
+
+@fs fs
+in vec4 color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = color;
+}
+@end
+
+@program displaylist vs fs
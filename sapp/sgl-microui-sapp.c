@@ -6,35 +6,61 @@
 //
 //  NOTE: for the debugging UI, cimgui is used via sokol_gfx_cimgui.h
 //  (C bindings to Dear ImGui instead of the ImGui C++ API)
+//
+//  The microui commands can be rendered either through sokol-gl, or
+//  through a batched renderer which writes one instance per quad into a
+//  pre-allocated arena, merges consecutive quads with the same clip rect
+//  into one instanced draw call, and optionally skips regenerating
+//  the instance data when the microui command list didn't change.
 //------------------------------------------------------------------------------
 #include "sokol_gfx.h"
 #include "sokol_app.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
 #include "microui.h"
 #include "atlas.inl"
 #define SOKOL_GL_IMPL
 #include "sokol_gl.h"
 #include "cdbgui/cdbgui.h"
+#include "sgl-microui-sapp.glsl.h"
 #include <stdio.h> // sprintf
+#include <string.h> // memcmp
 
 typedef struct {
     float r, g, b;
 } color_t;
 
+#define MAX_STRESS_WIDGETS (2000)   // more might overflow the microui command list
+
 static struct {
     mu_Context mu_ctx;
     char logbuf[64000];
     int logbuf_updated;
     color_t bg;
+    int batched;
+    int cache;
+    int stress;
+    float num_stress_widgets;
+    struct {
+        double accum_time;
+        double accum_ms;
+        int accum_frames;
+        char text[2][64];
+    } stats;
 } state = {
-    .bg = { 90.0f, 95.0f, 100.0f }
+    .bg = { 90.0f, 95.0f, 100.0f },
+    .batched = 1,
+    .cache = 1,
+    .num_stress_widgets = 1000.0f,
 };
 
 // UI functions
 static void test_window(mu_Context* ctx);
 static void log_window(mu_Context* ctx);
 static void style_window(mu_Context* ctx);
+static void renderer_window(mu_Context* ctx);
+static void stress_window(mu_Context* ctx);
 
 // microui renderer functions (implementation is at the end of this file)
 static void r_init(void);
@@ -48,6 +74,9 @@ static void r_draw_icon(int id, mu_Rect rect, mu_Color color);
 static int r_get_text_width(const char* text, int len);
 static int r_get_text_height(void);
 static void r_set_clip_rect(mu_Rect rect);
+static void r_render_commands(mu_Context* ctx, int disp_width, int disp_height);
+static int r_num_vertices(void);
+static int r_num_draws(void);
 
 // callbacks
 static int text_width_cb(mu_Font font, const char* text, int len) {
@@ -80,6 +109,7 @@ static void init(void) {
         .logger.func = slog_func,
     });
     __cdbgui_setup();
+    stm_setup();
 
     // setup sokol-gl
     sgl_setup(&(sgl_desc_t){
@@ -149,20 +179,16 @@ void frame(void) {
     test_window(&state.mu_ctx);
     log_window(&state.mu_ctx);
     style_window(&state.mu_ctx);
+    renderer_window(&state.mu_ctx);
+    if (state.stress) {
+        stress_window(&state.mu_ctx);
+    }
     mu_end(&state.mu_ctx);
 
     // micro-ui rendering
-    r_begin(sapp_width(), sapp_height());
-    mu_Command* cmd = 0;
-    while(mu_next_command(&state.mu_ctx, &cmd)) {
-        switch (cmd->type) {
-            case MU_COMMAND_TEXT: r_draw_text(cmd->text.str, cmd->text.pos, cmd->text.color); break;
-            case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
-            case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
-            case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
-        }
-    }
-    r_end();
+    const uint64_t start = stm_now();
+    r_render_commands(&state.mu_ctx, sapp_width(), sapp_height());
+    uint64_t render_ticks = stm_since(start);
 
     // render the sokol-gfx default pass
     sg_begin_pass(&(sg_pass) {
@@ -174,10 +200,25 @@ void frame(void) {
         },
         .swapchain = sglue_swapchain()
     });
+    const uint64_t draw_start = stm_now();
     r_draw();
+    render_ticks += stm_since(draw_start);
     __cdbgui_draw();
     sg_end_pass();
     sg_commit();
+
+    // only refresh the stats text twice per second, so that the command list
+    // doesn't change each frame and the render cache can kick in
+    state.stats.accum_time += sapp_frame_duration();
+    state.stats.accum_ms += stm_ms(render_ticks);
+    state.stats.accum_frames++;
+    if (state.stats.accum_time > 0.5) {
+        snprintf(state.stats.text[0], sizeof(state.stats.text[0]), "%d verts, %d draws", r_num_vertices(), r_num_draws());
+        snprintf(state.stats.text[1], sizeof(state.stats.text[1]), "%.3f ms/frame", state.stats.accum_ms / state.stats.accum_frames);
+        state.stats.accum_time = 0.0;
+        state.stats.accum_ms = 0.0;
+        state.stats.accum_frames = 0;
+    }
 }
 
 static void cleanup(void) {
@@ -359,6 +400,46 @@ static void style_window(mu_Context *ctx) {
     }
 }
 
+static void renderer_window(mu_Context* ctx) {
+    if (mu_begin_window(ctx, "Renderer", mu_rect(380, 300, 300, 130))) {
+        mu_layout_row(ctx, 2, (int[]) { 120, -1 }, 0);
+        mu_checkbox(ctx, "Batched", &state.batched);
+        mu_checkbox(ctx, "Cache", &state.cache);
+        mu_checkbox(ctx, "Stress Test", &state.stress);
+        mu_slider_ex(ctx, &state.num_stress_widgets, 0, MAX_STRESS_WIDGETS, 10, "%.0f", MU_OPT_ALIGNCENTER);
+        mu_layout_row(ctx, 1, (int[]) { -1 }, 0);
+        mu_label(ctx, state.stats.text[0]);
+        mu_label(ctx, state.stats.text[1]);
+        mu_end_window(ctx);
+    }
+}
+
+// lots of small widgets to stress the renderer
+static void stress_window(mu_Context* ctx) {
+    if (mu_begin_window(ctx, "Stress Test", mu_rect(0, 0, sapp_width(), sapp_height()))) {
+        static int checks[MAX_STRESS_WIDGETS];
+        int widths[64];
+        const int num_columns = mu_clamp(mu_get_current_container(ctx)->body.w / 48, 1, 64);
+        for (int i = 0; i < num_columns; i++) {
+            widths[i] = 40;
+        }
+        mu_layout_row(ctx, num_columns, widths, 0);
+        const int num_widgets = (int)state.num_stress_widgets;
+        for (int i = 0; i < num_widgets; i++) {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "W%d", i);
+            mu_push_id(ctx, &i, sizeof(i));
+            if ((i & 1) == 0) {
+                mu_button(ctx, buf);
+            } else {
+                mu_checkbox(ctx, "", &checks[i]);
+            }
+            mu_pop_id(ctx);
+        }
+        mu_end_window(ctx);
+    }
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc; (void)argv;
     return (sapp_desc){
@@ -375,11 +456,42 @@ sapp_desc sokol_main(int argc, char* argv[]) {
 }
 
 //== micrui renderer ===========================================================
+#define R_MAX_QUADS (1<<16)
+#define R_MAX_DRAWS (1024)
+
+// one instance per quad, positions and atlas coordinates in pixels
+typedef struct {
+    int16_t dst[4];     // x0, y0, x1, y1
+    int16_t src[4];     // x0, y0, x1, y1
+    uint32_t color;
+} r_quad_t;
+
+// a range of quads sharing the same clip rect
+typedef struct {
+    mu_Rect clip;
+    int first_quad;
+    int num_quads;
+} r_draw_t;
+
 static sg_image atlas_img;
 static sg_view atlas_view;
 static sg_sampler atlas_smp;
 static sgl_pipeline pip;
 
+static struct {
+    sg_pipeline pip;
+    sg_buffer vbuf;
+    int disp_width;
+    int disp_height;
+    int num_quads;
+    int num_draws;
+    int draws_full;     // out of draw slots, remaining quads are dropped
+    int num_sgl_quads;
+    uint64_t hash;
+    r_quad_t quads[R_MAX_QUADS];
+    r_draw_t draws[R_MAX_DRAWS];
+} rb;
+
 static void r_init(void) {
 
     // atlas image data is in atlas.inl file, this only contains alpha
@@ -423,10 +535,47 @@ static void r_init(void) {
         .label = "microui-pipeline",
     });
 
+    // resources for the batched renderer, one instanced quad per microui quad
+    rb.vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.stream_update = true,
+        .size = sizeof(rb.quads),
+        .label = "microui-quads",
+    });
+    rb.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(microui_shader_desc(sg_query_backend())),
+        .layout = {
+            .buffers[0] = {
+                .stride = sizeof(r_quad_t),
+                .step_func = SG_VERTEXSTEP_PER_INSTANCE,
+            },
+            .attrs = {
+                [ATTR_microui_dst_rect].format = SG_VERTEXFORMAT_SHORT4,
+                [ATTR_microui_src_rect].format = SG_VERTEXFORMAT_SHORT4,
+                [ATTR_microui_color0].format = SG_VERTEXFORMAT_UBYTE4N,
+            },
+        },
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
+        .colors[0].blend = {
+            .enabled = true,
+            .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+            .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA
+        },
+        .label = "microui-batched-pipeline",
+    });
+
     free(rgba8_pixels);
 }
 
 static void r_begin(int disp_width, int disp_height) {
+    rb.disp_width = disp_width;
+    rb.disp_height = disp_height;
+    rb.num_quads = 0;
+    rb.num_draws = 0;
+    rb.draws_full = 0;
+    rb.num_sgl_quads = 0;
+    if (state.batched) {
+        return;
+    }
     sgl_defaults();
     sgl_push_pipeline();
     sgl_load_pipeline(pip);
@@ -439,16 +588,69 @@ static void r_begin(int disp_width, int disp_height) {
 }
 
 static void r_end(void) {
+    if (state.batched) {
+        if (rb.num_quads > 0) {
+            sg_update_buffer(rb.vbuf, &(sg_range){ .ptr = rb.quads, .size = (size_t)rb.num_quads * sizeof(r_quad_t) });
+        }
+        return;
+    }
     sgl_end();
     sgl_pop_matrix();
     sgl_pop_pipeline();
 }
 
 static void r_draw(void) {
-    sgl_draw();
+    if (!state.batched) {
+        sgl_draw();
+        return;
+    }
+    if (rb.num_quads == 0) {
+        return;
+    }
+    const vs_params_t vs_params = {
+        .disp_size = { (float)rb.disp_width, (float)rb.disp_height },
+        .atlas_size = { (float)ATLAS_WIDTH, (float)ATLAS_HEIGHT },
+    };
+    sg_apply_pipeline(rb.pip);
+    sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+    for (int i = 0; i < rb.num_draws; i++) {
+        const r_draw_t* draw = &rb.draws[i];
+        if (draw->num_quads == 0) {
+            continue;
+        }
+        sg_apply_scissor_rect(draw->clip.x, draw->clip.y, draw->clip.w, draw->clip.h, true);
+        sg_apply_bindings(&(sg_bindings){
+            .vertex_buffers[0] = rb.vbuf,
+            .vertex_buffer_offsets[0] = draw->first_quad * (int)sizeof(r_quad_t),
+            .views[VIEW_tex] = atlas_view,
+            .samplers[SMP_smp] = atlas_smp,
+        });
+        sg_draw(0, 4, draw->num_quads);
+    }
+    sg_apply_scissor_rect(0, 0, rb.disp_width, rb.disp_height, true);
+}
+
+static inline int16_t r_clamp16(int val) {
+    return (int16_t)((val < INT16_MIN) ? INT16_MIN : ((val > INT16_MAX) ? INT16_MAX : val));
 }
 
 static void r_push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
+    if (state.batched) {
+        if ((rb.num_quads >= R_MAX_QUADS) || rb.draws_full) {
+            return;
+        }
+        if (rb.num_draws == 0) {
+            r_set_clip_rect(mu_rect(0, 0, rb.disp_width, rb.disp_height));
+        }
+        rb.quads[rb.num_quads++] = (r_quad_t){
+            .dst = { r_clamp16(dst.x), r_clamp16(dst.y), r_clamp16(dst.x + dst.w), r_clamp16(dst.y + dst.h) },
+            .src = { (int16_t)src.x, (int16_t)src.y, (int16_t)(src.x + src.w), (int16_t)(src.y + src.h) },
+            .color = (uint32_t)color.r | ((uint32_t)color.g << 8) | ((uint32_t)color.b << 16) | ((uint32_t)color.a << 24),
+        };
+        rb.draws[rb.num_draws - 1].num_quads++;
+        return;
+    }
+    rb.num_sgl_quads++;
     float u0 = (float) src.x / (float) ATLAS_WIDTH;
     float v0 = (float) src.y / (float) ATLAS_HEIGHT;
     float u1 = (float) (src.x + src.w) / (float) ATLAS_WIDTH;
@@ -501,7 +703,69 @@ static int r_get_text_height(void) {
 }
 
 static void r_set_clip_rect(mu_Rect rect) {
+    if (state.batched) {
+        r_draw_t* cur = (rb.num_draws > 0) ? &rb.draws[rb.num_draws - 1] : 0;
+        if (cur && (cur->num_quads == 0)) {
+            // no quads with the previous clip rect, just replace it
+            cur->clip = rect;
+        } else if (!cur || (memcmp(&cur->clip, &rect, sizeof(rect)) != 0)) {
+            if (rb.num_draws < R_MAX_DRAWS) {
+                rb.draws[rb.num_draws++] = (r_draw_t){ .clip = rect, .first_quad = rb.num_quads };
+            } else {
+                // the quads can't be appended to the last draw since they'd use
+                // the wrong clip rect, so drop them like on quad buffer overflow
+                rb.draws_full = 1;
+            }
+        }
+        return;
+    }
     sgl_end();
     sgl_scissor_rect(rect.x, rect.y, rect.w, rect.h, true);
     sgl_begin_quads();
 }
+
+// FNV-1a hash over the raw microui command list
+static uint64_t r_hash_commands(mu_Context* ctx) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t* ptr = (const uint8_t*) ctx->command_list.items;
+    for (int i = 0; i < ctx->command_list.idx; i++) {
+        hash = (hash ^ ptr[i]) * 0x100000001b3ULL;
+    }
+    hash = (hash ^ (uint64_t)rb.disp_width) * 0x100000001b3ULL;
+    hash = (hash ^ (uint64_t)rb.disp_height) * 0x100000001b3ULL;
+    return hash;
+}
+
+static void r_render_commands(mu_Context* ctx, int disp_width, int disp_height) {
+    if (state.batched && state.cache) {
+        // skip regenerating the quads if the command list is identical to the previous frame
+        rb.disp_width = disp_width;
+        rb.disp_height = disp_height;
+        const uint64_t hash = r_hash_commands(ctx);
+        if ((hash == rb.hash) && (rb.num_draws > 0)) {
+            return;
+        }
+        rb.hash = hash;
+    } else {
+        rb.hash = 0;
+    }
+    r_begin(disp_width, disp_height);
+    mu_Command* cmd = 0;
+    while(mu_next_command(ctx, &cmd)) {
+        switch (cmd->type) {
+            case MU_COMMAND_TEXT: r_draw_text(cmd->text.str, cmd->text.pos, cmd->text.color); break;
+            case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
+            case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
+            case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
+        }
+    }
+    r_end();
+}
+
+static int r_num_vertices(void) {
+    return 4 * (state.batched ? rb.num_quads : rb.num_sgl_quads);
+}
+
+static int r_num_draws(void) {
+    return state.batched ? rb.num_draws : 0;
+}
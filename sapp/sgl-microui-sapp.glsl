@@ -0,0 +1,42 @@
+//------------------------------------------------------------------------------
+//  shaders for sgl-microui-sapp batched renderer, one instance per quad
+//------------------------------------------------------------------------------
+@vs vs
+layout(binding=0) uniform vs_params {
+    vec2 disp_size;
+    vec2 atlas_size;
+};
+
+in ivec4 dst_rect;     // SHORT4: x0, y0, x1, y1 in pixels
+in ivec4 src_rect;     // SHORT4: x0, y0, x1, y1 in atlas texels
+in vec4 color0;
+
+out vec2 uv;
+out vec4 color;
+
+void main() {
+    // triangle strip corners: (0,0), (1,0), (0,1), (1,1)
+    const vec2 corner = vec2(float(gl_VertexIndex & 1), float((gl_VertexIndex >> 1) & 1));
+    const vec4 dst = vec4(dst_rect);
+    const vec4 src = vec4(src_rect);
+    const vec2 pos = mix(dst.xy, dst.zw, corner);
+    gl_Position = vec4(((pos / disp_size) - 0.5) * vec2(2.0, -2.0), 0.5, 1.0);
+    uv = mix(src.xy, src.zw, corner) / atlas_size;
+    color = color0;
+}
+@end
+
+@fs fs
+layout(binding=0) uniform texture2D tex;
+layout(binding=0) uniform sampler smp;
+
+in vec2 uv;
+in vec4 color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = texture(sampler2D(tex, smp), uv) * color;
+}
+@end
+
+@program microui vs fs
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+//  shapecache-bench.c
+//
+//  Startup time of a scene with hundreds of sokol_shape.h tessellation
+//  variants, where each variant is used by several objects:
+//
+//  - rebuild: every object builds its own shape with sokol_shape.h, like
+//    the samples did before util/shapecache.h
+//  - cold: util/shapecache.h without a cache file, each variant is built
+//    once into the merged buffers, and the cache file is written
+//  - warm: util/shapecache.h with the cache file from the cold start, no
+//    shapes are built
+//
+//  Usage:
+//
+//      shapecache-bench [--runs N] [--path cache-file]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#define SOKOL_SHAPE_IMPL
+#include "sokol_shape.h"
+#include "util/shapecache.h"
+
+#define DEFAULT_RUNS (5)
+#define DEFAULT_PATH "shapecache-bench.shapecache"
+#define NUM_SHAPE_TYPES (5)
+#define NUM_TESSELLATIONS (60)
+#define NUM_VARIANTS (NUM_SHAPE_TYPES * NUM_TESSELLATIONS)
+#define OBJECTS_PER_VARIANT (4)
+
+static struct {
+    uint8_t* vertices;
+    uint16_t* indices;
+    int num_vertex_bytes;
+    int num_index_bytes;
+} rebuild;
+
+typedef struct {
+    bool loaded;
+    int num_built;
+    int num_hits;
+    int vertex_bytes;
+    int index_bytes;
+} cache_stats_t;
+
+// the shape variant of an object, returns the number of elements
+static int build_object(int object, sshape_state_t* shp, shapecache_t* cache) {
+    const int variant = object % NUM_VARIANTS;
+    const int t = variant / NUM_SHAPE_TYPES;
+    sshape_element_range_t range = { 0 };
+    switch (variant % NUM_SHAPE_TYPES) {
+        case 0: {
+            const sshape_plane_t params = { .width = 2.0f, .depth = 2.0f, .tiles = (uint16_t)(1 + t) };
+            if (cache) { range = shapecache_plane(cache, &params); } else { sshape_build_plane(shp, &params); }
+        } break;
+        case 1: {
+            const sshape_box_t params = { .width = 1.0f, .height = 1.0f, .depth = 1.0f, .tiles = (uint16_t)(1 + t) };
+            if (cache) { range = shapecache_box(cache, &params); } else { sshape_build_box(shp, &params); }
+        } break;
+        case 2: {
+            const sshape_sphere_t params = { .radius = 1.0f, .slices = (uint16_t)(6 + t), .stacks = (uint16_t)(4 + t / 2) };
+            if (cache) { range = shapecache_sphere(cache, &params); } else { sshape_build_sphere(shp, &params); }
+        } break;
+        case 3: {
+            const sshape_cylinder_t params = { .radius = 0.5f, .height = 1.5f, .slices = (uint16_t)(6 + t), .stacks = (uint16_t)(1 + t / 4) };
+            if (cache) { range = shapecache_cylinder(cache, &params); } else { sshape_build_cylinder(shp, &params); }
+        } break;
+        default: {
+            const sshape_torus_t params = { .radius = 0.5f, .ring_radius = 0.3f, .rings = (uint16_t)(6 + t), .sides = (uint16_t)(4 + t / 2) };
+            if (cache) { range = shapecache_torus(cache, &params); } else { sshape_build_torus(shp, &params); }
+        } break;
+    }
+    if (!cache) {
+        range = sshape_element_range(shp);
+    }
+    return range.num_elements;
+}
+
+// every object builds its own shape into its own buffers
+static double run_rebuild(void) {
+    const uint64_t start = stm_now();
+    const sshape_state_t format = { .disable.colors = true };
+    rebuild.num_vertex_bytes = 0;
+    rebuild.num_index_bytes = 0;
+    for (int i = 0; i < NUM_VARIANTS * OBJECTS_PER_VARIANT; i++) {
+        sshape_state_t shp = format;
+        shp.vertices.buffer = (sshape_range){ rebuild.vertices, SHAPECACHE_MAX_SHAPE_VERTICES * SSHAPE_MAX_VERTEX_SIZE };
+        shp.indices.buffer = (sshape_range){ rebuild.indices, SHAPECACHE_MAX_SHAPE_INDICES * sizeof(uint16_t) };
+        build_object(i, &shp, 0);
+        assert(shp.valid);
+        rebuild.num_vertex_bytes += (int)sshape_vertex_buffer_desc(&shp).data.size;
+        rebuild.num_index_bytes += (int)sshape_index_buffer_desc(&shp).data.size;
+    }
+    return stm_ms(stm_since(start));
+}
+
+static double run_cache(const char* path, cache_stats_t* out_stats) {
+    const uint64_t start = stm_now();
+    shapecache_t cache;
+    shapecache_init(&cache, &(shapecache_desc_t){
+        .format.disable.colors = true,
+        .path = path,
+    });
+    for (int i = 0; i < NUM_VARIANTS * OBJECTS_PER_VARIANT; i++) {
+        build_object(i, 0, &cache);
+    }
+    if (!shapecache_save(&cache)) {
+        fprintf(stderr, "failed to write '%s'\n", path);
+    }
+    const double ms = stm_ms(stm_since(start));
+    *out_stats = (cache_stats_t){
+        .loaded = cache.loaded,
+        .num_built = cache.num_built,
+        .num_hits = cache.num_hits,
+        .vertex_bytes = cache.num_vertices * cache.stride,
+        .index_bytes = cache.num_indices * (int)sizeof(uint32_t),
+    };
+    shapecache_shutdown(&cache);
+    return ms;
+}
+
+static void print_row(const char* name, double ms, int num_built, int num_hits, int vertex_bytes, int index_bytes) {
+    printf("%-10s %10.3f %8d %8d %14d %14d\n", name, ms, num_built, num_hits, vertex_bytes, index_bytes);
+}
+
+int main(int argc, char* argv[]) {
+    int num_runs = DEFAULT_RUNS;
+    const char* path = DEFAULT_PATH;
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--runs")) && ((i + 1) < argc)) {
+            num_runs = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--path")) && ((i + 1) < argc)) {
+            path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--runs N] [--path cache-file]\n", argv[0]);
+            return 10;
+        }
+    }
+    num_runs = (num_runs < 1) ? 1 : num_runs;
+    stm_setup();
+    rebuild.vertices = (uint8_t*) malloc(SHAPECACHE_MAX_SHAPE_VERTICES * SSHAPE_MAX_VERTEX_SIZE);
+    rebuild.indices = (uint16_t*) malloc(SHAPECACHE_MAX_SHAPE_INDICES * sizeof(uint16_t));
+
+    printf("%d shape variants, %d objects per variant, best of %d runs\n\n", NUM_VARIANTS, OBJECTS_PER_VARIANT, num_runs);
+    printf("%-10s %10s %8s %8s %14s %14s\n", "variant", "time (ms)", "built", "hits", "vertex bytes", "index bytes");
+
+    double best_ms = 0.0;
+    for (int run = 0; run < num_runs; run++) {
+        const double ms = run_rebuild();
+        best_ms = ((run == 0) || (ms < best_ms)) ? ms : best_ms;
+    }
+    print_row("rebuild", best_ms, NUM_VARIANTS * OBJECTS_PER_VARIANT, 0, rebuild.num_vertex_bytes, rebuild.num_index_bytes);
+
+    cache_stats_t stats = { 0 };
+    for (int variant = 0; variant < 2; variant++) {
+        const bool cold = (variant == 0);
+        for (int run = 0; run < num_runs; run++) {
+            if (cold) {
+                remove(path);
+            }
+            const double ms = run_cache(path, &stats);
+            best_ms = ((run == 0) || (ms < best_ms)) ? ms : best_ms;
+        }
+        if (!cold && !stats.loaded) {
+            printf("cache file '%s' couldn't be loaded\n", path);
+        }
+        print_row(cold ? "cold" : "warm", best_ms, stats.num_built, stats.num_hits, stats.vertex_bytes, stats.index_bytes);
+    }
+    remove(path);
+    free(rebuild.vertices);
+    free(rebuild.indices);
+    return 0;
+}
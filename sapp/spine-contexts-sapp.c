@@ -14,6 +14,8 @@
 #include "sokol_log.h"
 #include "sokol_glue.h"
 #include "util/fileutil.h"
+#include "util/jobs.h"
+#include "util/spinebatch.h"
 #include "dbgui/dbgui.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -82,6 +84,7 @@ static void init(void) {
         .num_lanes = 1,
         .logger.func = slog_func,
     });
+    jobs_setup(&(jobs_desc_t){0});
     __dbgui_setup();
 
     // create 2 sspine contexts for rendering into offscreen render targets
@@ -120,13 +123,14 @@ static void frame(void) {
     const float delta_time = (float)sapp_frame_duration();
     sfetch_dowork();
 
+    // update both spine instances in parallel
+    spinebatch_update_instances(state.instances, 2, delta_time);
+
     // render spine objects in separate contexts, first one by setting the current context,
     // second one by calling function with ctx arg
-    sspine_update_instance(state.instances[0], delta_time);
     sspine_set_context(state.offscreen[0].ctx);
     sspine_draw_instance_in_layer(state.instances[0], 0);
 
-    sspine_update_instance(state.instances[1], delta_time);
     sspine_context_draw_instance_in_layer(state.offscreen[1].ctx, state.instances[1], 0);
 
     // draw two quads via sokol-gl which use the offscreen-rendered spine scenes as textures
@@ -178,6 +182,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     __dbgui_shutdown();
+    jobs_shutdown();
     sfetch_shutdown();
     sspine_shutdown();
     sgl_shutdown();
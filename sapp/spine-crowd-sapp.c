@@ -0,0 +1,528 @@
+//------------------------------------------------------------------------------
+//  spine-crowd-sapp.c
+//
+//  Stress test for updating many sokol-spine instances:
+//
+//  - hundreds of raptor instances which share the same atlas and skeleton
+//  - the animation state and bone transforms of all instances are updated
+//    in parallel on the job system in util/jobs.h (via util/spinebatch.h),
+//    or serially on the main thread for comparison
+//  - alternatively the looping animations are baked into a per-bone
+//    world transform table at startup (via util/spinebake.h), and instances
+//    are posed by blending between the two nearest baked frames instead of
+//    running the full spine-c animation and constraint solver
+//  - vertex generation (sspine_draw_instance_in_layer()) happens on the
+//    main thread in instance order, so that the rendered result is the
+//    same in all update modes
+//  - the status window compares the average update time of all modes
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_fetch.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#include "sokol_time.h"
+#include "util/fileutil.h"
+#define SOKOL_SPINE_IMPL
+#include "spine/spine.h"
+#include "sokol_spine.h"
+#define SOKOL_IMGUI_IMPL
+#define SOKOL_GFX_IMGUI_IMPL
+#define SOKOL_APP_IMGUI_IMPL
+#include "cimgui.h"
+#include "sokol_imgui.h"
+#include "sokol_gfx_imgui.h"
+#include "sokol_app_imgui.h"
+#include "util/jobs.h"
+#include "util/spinebatch.h"
+#include "util/spinebake.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <float.h>
+#include <math.h>
+
+#define MAX_INSTANCES (1024)
+#define NUM_TIME_SAMPLES (128)
+#define CELL_WIDTH (240.0f)
+#define CELL_HEIGHT (200.0f)
+#define BAKE_RATE (60.0f)
+
+enum {
+    ANIM_WALK,
+    ANIM_ROAR,
+    NUM_ANIMS,
+};
+
+typedef struct {
+    bool loaded;
+    sspine_range data;
+} load_status_t;
+
+static struct {
+    sspine_atlas atlas;
+    sspine_skeleton skeleton;
+    sspine_instance instances[MAX_INSTANCES];
+    spSkeleton* sp_skels[MAX_INSTANCES];
+    int anim_index[MAX_INSTANCES];
+    float anim_time[MAX_INSTANCES];     // advanced in both update modes
+    spinebake_anim_t baked_anims[NUM_ANIMS];
+    bool baked_valid;       // false if baking failed, instances then always use the full update
+    bool last_baked;        // the previous frame used the baked poses
+    float delta_time;
+    int num_instances;
+    int num_cols;
+    int num_rows;
+    sspine_layer_transform layer_transform;
+    sg_pass_action pass_action;
+    struct {
+        load_status_t atlas;
+        load_status_t skeleton;
+        bool failed;
+    } load_status;
+    struct {
+        int num_instances;
+        bool threaded;
+        bool baked;
+    } ui;
+    struct {
+        uint64_t update_time;
+        uint64_t draw_time;
+        int time_index;
+        float frame_time_ms[NUM_TIME_SAMPLES];
+        float update_time_ms[NUM_TIME_SAMPLES];
+        float avg_update_us_per_instance[2][2];     // [baked][threaded]
+    } profiling;
+    struct {
+        uint8_t atlas[4 * 1024];
+        uint8_t skeleton[128 * 1024];
+        uint8_t image[512 * 1024];
+    } buffers;
+} state = {
+    .ui = {
+        .num_instances = 256,
+        .threaded = true,
+    },
+};
+
+static void atlas_data_loaded(const sfetch_response_t* response);
+static void skeleton_data_loaded(const sfetch_response_t* response);
+static void image_data_loaded(const sfetch_response_t* response);
+static void create_spine_objects(void);
+static void set_num_instances(int num_instances);
+static void update_instances_baked(int start, int end, void* user_data);
+static void sync_track_times(void);
+static void ui_draw(void);
+
+static void init(void) {
+    stm_setup();
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sgimgui_setup(&(sgimgui_desc_t){0});
+    sappimgui_setup();
+    simgui_setup(&(simgui_desc_t){
+        .logger.func = slog_func,
+    });
+    // all instances share one skeleton, but need enough vertex and command space for all of them
+    sspine_setup(&(sspine_desc){
+        .max_vertices = 1024 * 1024,
+        .max_commands = 1024,
+        .atlas_pool_size = 1,
+        .skeleton_pool_size = 1,
+        .instance_pool_size = MAX_INSTANCES,
+        .logger.func = slog_func,
+    });
+    sfetch_setup(&(sfetch_desc_t){
+        .max_requests = 3,
+        .num_channels = 2,
+        .num_lanes = 1,
+        .logger.func = slog_func,
+    });
+    jobs_setup(&(jobs_desc_t){0});
+
+    state.pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.25f, 0.3f, 0.35f, 1.0f } }
+    };
+
+    char path_buf[512];
+    sfetch_send(&(sfetch_request_t){
+        .path = fileutil_get_path("raptor-pma.atlas", path_buf, sizeof(path_buf)),
+        .channel = 0,
+        .buffer = SFETCH_RANGE(state.buffers.atlas),
+        .callback = atlas_data_loaded,
+    });
+    sfetch_send(&(sfetch_request_t){
+        .path = fileutil_get_path("raptor-pro.skel", path_buf, sizeof(path_buf)),
+        .channel = 1,
+        .buffer = SFETCH_RANGE(state.buffers.skeleton),
+        .callback = skeleton_data_loaded,
+    });
+}
+
+static void frame(void) {
+    const float delta_time = (float)sapp_frame_duration();
+    sfetch_dowork();
+
+    // update all instances, either in parallel or serially, and either
+    // via the full spine-c update or from the baked pose tables
+    uint64_t t = stm_now();
+    state.delta_time = delta_time;
+    const bool baked = state.ui.baked && state.baked_valid;
+    if (baked) {
+        if (state.ui.threaded) {
+            spinebatch_parallel_for(state.num_instances, update_instances_baked, 0);
+        } else {
+            update_instances_baked(0, state.num_instances, 0);
+        }
+    } else {
+        if (state.last_baked) {
+            sync_track_times();
+        }
+        for (int i = 0; i < state.num_instances; i++) {
+            state.anim_time[i] += delta_time;
+        }
+        if (state.ui.threaded) {
+            spinebatch_update_instances(state.instances, state.num_instances, delta_time);
+        } else {
+            for (int i = 0; i < state.num_instances; i++) {
+                sspine_update_instance(state.instances[i], delta_time);
+            }
+        }
+    }
+    state.last_baked = baked;
+    state.profiling.update_time = stm_since(t);
+    if (state.num_instances > 0) {
+        float* avg = &state.profiling.avg_update_us_per_instance[state.ui.baked][state.ui.threaded];
+        const float us = (float)stm_us(state.profiling.update_time) / (float)state.num_instances;
+        *avg = (*avg == 0.0f) ? us : (*avg * 0.95f + us * 0.05f);
+    }
+
+    // generate vertices on the main thread, always in the same order
+    t = stm_now();
+    for (int i = 0; i < state.num_instances; i++) {
+        sspine_draw_instance_in_layer(state.instances[i], 0);
+    }
+    state.profiling.draw_time = stm_since(t);
+
+    // record the frame time history
+    state.profiling.frame_time_ms[state.profiling.time_index] = delta_time * 1000.0f;
+    state.profiling.update_time_ms[state.profiling.time_index] = (float)stm_ms(state.profiling.update_time);
+    state.profiling.time_index = (state.profiling.time_index + 1) % NUM_TIME_SAMPLES;
+
+    ui_draw();
+
+    // scale the 'virtual canvas' so that the whole crowd grid fits into the window
+    const float aspect = sapp_widthf() / sapp_heightf();
+    float canvas_w = (float)state.num_cols * CELL_WIDTH;
+    float canvas_h = (float)state.num_rows * CELL_HEIGHT;
+    if ((canvas_w / aspect) > canvas_h) {
+        canvas_h = canvas_w / aspect;
+    } else {
+        canvas_w = canvas_h * aspect;
+    }
+    state.layer_transform = (sspine_layer_transform){
+        .size = { .x = canvas_w, .y = canvas_h },
+        .origin = { .x = canvas_w * 0.5f, .y = canvas_h * 0.5f },
+    };
+
+    sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
+    sspine_draw_layer(0, &state.layer_transform);
+    simgui_render();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void cleanup(void) {
+    jobs_shutdown();
+    for (int i = 0; i < NUM_ANIMS; i++) {
+        spinebake_discard(&state.baked_anims[i]);
+    }
+    sfetch_shutdown();
+    sspine_shutdown();
+    sgimgui_shutdown();
+    sappimgui_shutdown();
+    simgui_shutdown();
+    sg_shutdown();
+}
+
+static void input(const sapp_event* ev) {
+    sappimgui_track_event(ev);
+    simgui_handle_event(ev);
+}
+
+static void atlas_data_loaded(const sfetch_response_t* response) {
+    if (response->fetched) {
+        state.load_status.atlas = (load_status_t){
+            .loaded = true,
+            .data = (sspine_range){ .ptr = response->data.ptr, .size = response->data.size }
+        };
+        if (state.load_status.atlas.loaded && state.load_status.skeleton.loaded) {
+            create_spine_objects();
+        }
+    } else if (response->failed) {
+        state.load_status.failed = true;
+    }
+}
+
+static void skeleton_data_loaded(const sfetch_response_t* response) {
+    if (response->fetched) {
+        state.load_status.skeleton = (load_status_t){
+            .loaded = true,
+            .data = (sspine_range){ .ptr = response->data.ptr, .size = response->data.size }
+        };
+        if (state.load_status.atlas.loaded && state.load_status.skeleton.loaded) {
+            create_spine_objects();
+        }
+    } else if (response->failed) {
+        state.load_status.failed = true;
+    }
+}
+
+// called when both the atlas and skeleton file have been loaded, creates the
+// shared atlas and skeleton, the initial instances, and starts loading the atlas images
+static void create_spine_objects(void) {
+    state.atlas = sspine_make_atlas(&(sspine_atlas_desc){
+        .data = state.load_status.atlas.data,
+    });
+    assert(sspine_atlas_valid(state.atlas));
+    state.skeleton = sspine_make_skeleton(&(sspine_skeleton_desc){
+        .atlas = state.atlas,
+        .binary_data = state.load_status.skeleton.data,
+        .prescale = 0.25f,
+        .anim_default_mix = 0.2f,
+    });
+    assert(sspine_skeleton_valid(state.skeleton));
+    set_num_instances(state.ui.num_instances);
+
+    // bake the looping animations into pose tables, fall back to the
+    // full spine-c update if any of them can't be baked
+    spSkeletonData* sp_skel_data = state.sp_skels[0]->data;
+    static const char* anim_names[NUM_ANIMS] = { "walk", "roar" };
+    state.baked_valid = true;
+    for (int i = 0; (i < NUM_ANIMS) && state.baked_valid; i++) {
+        spAnimation* anim = spSkeletonData_findAnimation(sp_skel_data, anim_names[i]);
+        state.baked_valid = anim && spinebake_init(&state.baked_anims[i], sp_skel_data, anim, BAKE_RATE);
+    }
+    if (!state.baked_valid) {
+        for (int i = 0; i < NUM_ANIMS; i++) {
+            spinebake_discard(&state.baked_anims[i]);
+        }
+        state.ui.baked = false;
+    }
+
+    const int num_images = sspine_num_images(state.atlas);
+    for (int img_index = 0; img_index < num_images; img_index++) {
+        const sspine_image img = sspine_image_by_index(state.atlas, img_index);
+        const sspine_image_info img_info = sspine_get_image_info(img);
+        assert(img_info.valid);
+        char path_buf[512];
+        sfetch_send(&(sfetch_request_t){
+            .path = fileutil_get_path(img_info.filename.cstr, path_buf, sizeof(path_buf)),
+            .channel = 0,
+            .buffer = SFETCH_RANGE(state.buffers.image),
+            .callback = image_data_loaded,
+            .user_data = SFETCH_RANGE(img),
+        });
+    }
+}
+
+static void image_data_loaded(const sfetch_response_t* response) {
+    const sspine_image img = *(sspine_image*)response->user_data;
+    const sspine_image_info img_info = sspine_get_image_info(img);
+    assert(img_info.valid);
+    if (response->fetched) {
+        const int desired_channels = 4;
+        int img_width, img_height, num_channels;
+        stbi_uc* pixels = stbi_load_from_memory(
+            response->data.ptr,
+            (int)response->data.size,
+            &img_width,
+            &img_height,
+            &num_channels, desired_channels);
+        if (pixels) {
+            sg_init_image(img_info.sgimage, &(sg_image_desc){
+                .width = img_width,
+                .height = img_height,
+                .pixel_format = SG_PIXELFORMAT_RGBA8,
+                .label = img_info.filename.cstr,
+                .data.mip_levels[0] = {
+                    .ptr = pixels,
+                    .size = (size_t)(img_width * img_height * 4)
+                }
+            });
+            sg_init_view(img_info.sgview, &(sg_view_desc){
+                .texture = { .image = img_info.sgimage },
+            });
+            sg_init_sampler(img_info.sgsampler, &(sg_sampler_desc){
+                .min_filter = img_info.min_filter,
+                .mag_filter = img_info.mag_filter,
+                .mipmap_filter = img_info.mipmap_filter,
+                .wrap_u = img_info.wrap_u,
+                .wrap_v = img_info.wrap_v,
+                .label = img_info.filename.cstr,
+            });
+            stbi_image_free(pixels);
+        } else {
+            state.load_status.failed = true;
+            sg_fail_image(img_info.sgimage);
+        }
+    } else {
+        state.load_status.failed = true;
+        sg_fail_image(img_info.sgimage);
+    }
+}
+
+// sokol_spine.h has no public accessor for the spine-c skeleton of an instance,
+// but since the implementation is compiled into this file the internal lookup can be used
+static spSkeleton* get_sp_skeleton(sspine_instance instance) {
+    _sspine_instance_t* inst = _sspine_lookup_instance(instance.id);
+    assert(inst && inst->sp_skel);
+    return inst->sp_skel;
+}
+
+// pose a range of instances from the baked pose tables, called from job threads
+static void update_instances_baked(int start, int end, void* user_data) {
+    (void)user_data;
+    for (int i = start; i < end; i++) {
+        state.anim_time[i] += state.delta_time;
+        spinebake_apply(&state.baked_anims[state.anim_index[i]], state.sp_skels[i], state.anim_time[i]);
+    }
+}
+
+// the spine-c animation state isn't advanced while the baked poses are used,
+// move its track time to the animation time when switching back to the full update
+static void sync_track_times(void) {
+    for (int i = 0; i < state.num_instances; i++) {
+        _sspine_instance_t* inst = _sspine_lookup_instance(state.instances[i].id);
+        assert(inst && inst->sp_anim_state);
+        spTrackEntry* entry = spAnimationState_getCurrent(inst->sp_anim_state, 0);
+        if (entry) {
+            entry->trackTime = state.anim_time[i];
+        }
+    }
+}
+
+// create or destroy instances to match the requested number, and
+// arrange all instances in a grid matching the current window aspect ratio
+static void set_num_instances(int num_instances) {
+    assert((num_instances >= 0) && (num_instances <= MAX_INSTANCES));
+    if (!sspine_skeleton_valid(state.skeleton)) {
+        return;
+    }
+    while (state.num_instances > num_instances) {
+        sspine_destroy_instance(state.instances[--state.num_instances]);
+    }
+    while (state.num_instances < num_instances) {
+        const int idx = state.num_instances++;
+        const sspine_instance inst = sspine_make_instance(&(sspine_instance_desc){
+            .skeleton = state.skeleton,
+        });
+        assert(sspine_instance_valid(inst));
+        state.anim_index[idx] = ((idx % 5) == 4) ? ANIM_ROAR : ANIM_WALK;
+        const char* anim_name = (state.anim_index[idx] == ANIM_ROAR) ? "roar" : "walk";
+        sspine_set_animation(inst, sspine_anim_by_name(state.skeleton, anim_name), 0, true);
+        // advance each instance by a different amount so they don't all move in lockstep
+        state.anim_time[idx] = (float)((idx * 7919) % 1000) * 0.001f;
+        sspine_update_instance(inst, state.anim_time[idx]);
+        state.instances[idx] = inst;
+        state.sp_skels[idx] = get_sp_skeleton(inst);
+    }
+    const float aspect = sapp_widthf() / sapp_heightf();
+    const int num_cols = (int)ceilf(sqrtf((float)num_instances * aspect * (CELL_HEIGHT / CELL_WIDTH)));
+    const int num_rows = (num_cols > 0) ? ((num_instances + num_cols - 1) / num_cols) : 0;
+    state.num_cols = num_cols;
+    state.num_rows = num_rows;
+    for (int i = 0; i < num_instances; i++) {
+        const int col = i % num_cols;
+        const int row = i / num_cols;
+        sspine_set_position(state.instances[i], (sspine_vec2){
+            .x = ((float)col - (float)(num_cols - 1) * 0.5f) * CELL_WIDTH,
+            .y = ((float)row - (float)(num_rows - 1) * 0.5f) * CELL_HEIGHT + CELL_HEIGHT * 0.4f,
+        });
+    }
+}
+
+static void ui_draw(void) {
+    sappimgui_track_frame();
+    simgui_new_frame(&(simgui_frame_desc_t){
+        .width = sapp_width(),
+        .height = sapp_height(),
+        .delta_time = sapp_frame_duration(),
+        .dpi_scale = sapp_dpi_scale(),
+    });
+    if (igBeginMainMenuBar()) {
+        sgimgui_draw_menu("sokol-gfx");
+        sappimgui_draw_menu("sokol-app");
+        igEndMainMenuBar();
+    }
+    sappimgui_draw();
+    sgimgui_draw();
+    igSetNextWindowPos((ImVec2){ 30, 50 }, ImGuiCond_Once);
+    igSetNextWindowBgAlpha(0.75f);
+    if (igBegin("Status", 0, ImGuiWindowFlags_NoDecoration|ImGuiWindowFlags_AlwaysAutoResize)) {
+        if (state.load_status.failed) {
+            igText("Loading failed!");
+        }
+        igSliderInt("Instances", &state.ui.num_instances, 1, MAX_INSTANCES);
+        if (igIsItemDeactivatedAfterEdit()) {
+            set_num_instances(state.ui.num_instances);
+        }
+        igCheckbox("Threaded Update", &state.ui.threaded);
+        if (state.baked_valid) {
+            igCheckbox("Baked Poses", &state.ui.baked);
+        } else {
+            igText("Baked Poses: not available");
+        }
+        igText("Worker Threads: %d", jobs_num_threads());
+        size_t bake_size = 0;
+        for (int i = 0; i < NUM_ANIMS; i++) {
+            bake_size += spinebake_size(&state.baked_anims[i]);
+        }
+        igText("Baked Pose Tables: %d KB (%.0f Hz)", (int)(bake_size / 1024), BAKE_RATE);
+        igText("Update Time: %.3fms", stm_ms(state.profiling.update_time));
+        igText("Draw Time: %.3fms", stm_ms(state.profiling.draw_time));
+        igPlotLinesEx("##frame_time",
+            state.profiling.frame_time_ms,
+            NUM_TIME_SAMPLES,
+            state.profiling.time_index,
+            "Frame Time (ms)",
+            0.0f, FLT_MAX,
+            (ImVec2){ 300.0f, 60.0f },
+            sizeof(float));
+        igPlotLinesEx("##update_time",
+            state.profiling.update_time_ms,
+            NUM_TIME_SAMPLES,
+            state.profiling.time_index,
+            "Update Time (ms)",
+            0.0f, FLT_MAX,
+            (ImVec2){ 300.0f, 60.0f },
+            sizeof(float));
+        igText("Avg update time per instance (toggle modes to measure):");
+        for (int baked = 0; baked < 2; baked++) {
+            for (int threaded = 0; threaded < 2; threaded++) {
+                igText("  %-6s %-9s %.3fus",
+                    baked ? "baked" : "full",
+                    threaded ? "threaded" : "serial",
+                    state.profiling.avg_update_us_per_instance[baked][threaded]);
+            }
+        }
+    }
+    igEnd();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 1024,
+        .height = 768,
+        .depth_format = SAPP_PIXELFORMAT_NONE,
+        .window_title = "spine-crowd-sapp.c",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
@@ -7,10 +7,13 @@
 #include "sokol_fetch.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
 #include "util/fileutil.h"
 #define SOKOL_SPINE_IMPL
 #include "spine/spine.h"
+#include "spine/extension.h"
 #include "sokol_spine.h"
+#include "util/spinearena.h"
 #define SOKOL_GL_IMPL
 #include "sokol_gl.h"
 #define SOKOL_IMGUI_IMPL
@@ -25,11 +28,24 @@
 #include "stb_image.h"
 
 #define MAX_TRIGGERED_EVENTS (16)
+#define MAX_SPINE_SCENES (5)
+#define NUM_LOAD_BENCHMARK_ITERATIONS (16)
+
+typedef struct {
+    bool valid;
+    double heap_ms;
+    double arena_ms;
+    int heap_allocs;            // heap allocations per load in heap mode
+    int arena_heap_allocs;      // heap allocations per load in arena mode
+    int arena_blocks;
+    size_t arena_bytes;
+} load_benchmark_t;
 
 static struct {
     sspine_atlas atlas;
     sspine_skeleton skeleton;
     sspine_instance instance;
+    spinearena_t* arena;    // owns all spine-c atlas and skeleton data of the current scene
     sg_pass_action pass_action;
     sspine_layer_transform layer_transform;
     sspine_vec2 iktarget_pos;
@@ -50,6 +66,8 @@ static struct {
         bool events_open;
         bool skins_open;
         bool iktargets_open;
+        bool load_benchmark_open;
+        load_benchmark_t load_benchmarks[MAX_SPINE_SCENES];
         struct {
             sspine_bone bone;
             sspine_slot slot;
@@ -72,7 +90,6 @@ static struct {
 } state;
 
 // describe Spine scenes available for loading
-#define MAX_SPINE_SCENES (5)
 #define MAX_QUEUE_ANIMS (4)
 typedef struct {
     const char* name;
@@ -155,8 +172,12 @@ static void draw_bones(void);
 static void ui_setup(void);
 static void ui_shutdown(void);
 static void ui_draw(void);
+static void run_load_benchmark(void);
 
 static void init(void) {
+    stm_setup();
+    // install spine-c allocation hooks before anything else calls into spine-c
+    spinearena_setup();
     // setup sokol-gfx
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
@@ -258,6 +279,7 @@ static void input(const sapp_event* ev) {
 static void cleanup(void) {
     ui_shutdown();
     sspine_shutdown();
+    spinearena_discard(state.arena);
     sfetch_shutdown();
     sgl_shutdown();
     sg_shutdown();
@@ -284,6 +306,9 @@ static bool load_spine_scene(int scene_index) {
     sspine_destroy_instance(state.instance);
     sspine_destroy_skeleton(state.skeleton);
     sspine_destroy_atlas(state.atlas);
+    // ...and free all spine-c atlas and skeleton data in one go
+    spinearena_discard(state.arena);
+    state.arena = 0;
 
     // start loading the atlas file
     char path_buf[512];
@@ -355,6 +380,9 @@ static void skeleton_data_loaded(const sfetch_response_t* response) {
 static void create_spine_objects(void) {
     const int scene_index = state.load_status.scene_index;
 
+    // all spine-c allocations for the atlas and skeleton data go into an arena
+    state.arena = spinearena_begin(0);
+
     // create atlas from file data
     state.atlas = sspine_make_atlas(&(sspine_atlas_desc){
         .data = state.load_status.atlas_data,
@@ -379,6 +407,7 @@ static void create_spine_objects(void) {
         .binary_data = skel_binary_data
     });
     assert(sspine_skeleton_valid(state.skeleton));
+    spinearena_end();
 
     // create a skeleton instance
     state.instance = sspine_make_instance(&(sspine_instance_desc){
@@ -531,6 +560,7 @@ static void ui_draw(void) {
             igMenuItemBoolPtr("Events...", 0, &state.ui.events_open, true);
             igMenuItemBoolPtr("Skins...", 0, &state.ui.skins_open, true);
             igMenuItemBoolPtr("IK Targets...", 0, &state.ui.iktargets_open, true);
+            igMenuItemBoolPtr("Load Benchmark...", 0, &state.ui.load_benchmark_open, true);
             igEndMenu();
         }
         sgimgui_draw_menu("sokol-gfx");
@@ -827,6 +857,37 @@ static void ui_draw(void) {
         }
         igEnd();
     }
+    pos.x += 20; pos.y += 20;
+    if (state.ui.load_benchmark_open) {
+        igSetNextWindowSize(IMVEC2(520, 220), ImGuiCond_Once);
+        igSetNextWindowPos(pos, ImGuiCond_Once);
+        if (igBegin("Load Benchmark", &state.ui.load_benchmark_open, 0)) {
+            if (!sspine_skeleton_valid(state.skeleton)) {
+                igText("No Spine data loaded");
+            } else {
+                igText("Parse atlas + skeleton %d times, heap vs arena allocation", NUM_LOAD_BENCHMARK_ITERATIONS);
+                if (igButton("Run for current scene")) {
+                    run_load_benchmark();
+                }
+                igSeparator();
+                igText("%-12s %9s %9s %11s %11s %7s %9s", "scene", "heap ms", "arena ms", "heap allocs", "arena heap", "blocks", "arena KB");
+                for (int i = 0; i < MAX_SPINE_SCENES; i++) {
+                    const load_benchmark_t* b = &state.ui.load_benchmarks[i];
+                    if (b->valid) {
+                        igText("%-12s %9.3f %9.3f %11d %11d %7d %9d",
+                            spine_scenes[i].ui_name,
+                            b->heap_ms,
+                            b->arena_ms,
+                            b->heap_allocs,
+                            b->arena_heap_allocs,
+                            b->arena_blocks,
+                            (int)(b->arena_bytes / 1024));
+                    }
+                }
+            }
+        }
+        igEnd();
+    }
     // display triggered events
     const double triggered_event_fade_time = 1.0;
     if (sspine_event_valid(state.ui.last_triggered_event.event) && (state.ui.last_triggered_event.time + triggered_event_fade_time) > state.ui.cur_time) {
@@ -849,6 +910,64 @@ static void ui_draw(void) {
     sappimgui_draw();
 }
 
+// parse the current scene's atlas and skeleton file data with spine-c directly
+static spSkeletonData* benchmark_load(spAtlas** out_atlas) {
+    const int scene_index = state.load_status.scene_index;
+    const sspine_range atlas_data = state.load_status.atlas_data;
+    const sspine_range skel_data = state.load_status.skel_data;
+    spAtlas* atlas = spAtlas_create((const char*)atlas_data.ptr, (int)atlas_data.size, "", 0);
+    spSkeletonData* skel_data_out = 0;
+    if (state.load_status.skel_data_is_binary) {
+        spSkeletonBinary* bin = spSkeletonBinary_create(atlas);
+        bin->scale = spine_scenes[scene_index].prescale;
+        skel_data_out = spSkeletonBinary_readSkeletonData(bin, (const unsigned char*)skel_data.ptr, (int)skel_data.size);
+        spSkeletonBinary_dispose(bin);
+    } else {
+        spSkeletonJson* json = spSkeletonJson_create(atlas);
+        json->scale = spine_scenes[scene_index].prescale;
+        skel_data_out = spSkeletonJson_readSkeletonData(json, (const char*)skel_data.ptr);
+        spSkeletonJson_dispose(json);
+    }
+    assert(skel_data_out);
+    *out_atlas = atlas;
+    return skel_data_out;
+}
+
+// load the current scene's data repeatedly, once with all spine-c allocations
+// going to the system heap and freed piece by piece, and once into an arena
+// which is freed in one go
+static void run_load_benchmark(void) {
+    load_benchmark_t* b = &state.ui.load_benchmarks[state.load_status.scene_index];
+    *b = (load_benchmark_t){ .valid = true };
+
+    spinearena_reset_stats();
+    uint64_t t = stm_now();
+    for (int i = 0; i < NUM_LOAD_BENCHMARK_ITERATIONS; i++) {
+        spAtlas* atlas = 0;
+        spSkeletonData* skel_data = benchmark_load(&atlas);
+        spSkeletonData_dispose(skel_data);
+        spAtlas_dispose(atlas);
+    }
+    b->heap_ms = stm_ms(stm_since(t)) / NUM_LOAD_BENCHMARK_ITERATIONS;
+    b->heap_allocs = spinearena_stats().num_heap_allocs / NUM_LOAD_BENCHMARK_ITERATIONS;
+
+    spinearena_reset_stats();
+    t = stm_now();
+    for (int i = 0; i < NUM_LOAD_BENCHMARK_ITERATIONS; i++) {
+        spAtlas* atlas = 0;
+        spinearena_t* arena = spinearena_begin(0);
+        benchmark_load(&atlas);
+        spinearena_end();
+        b->arena_blocks = arena->num_blocks;
+        b->arena_bytes = arena->num_bytes;
+        // spAtlas_dispose() is still needed to release the atlas page textures
+        spAtlas_dispose(atlas);
+        spinearena_discard(arena);
+    }
+    b->arena_ms = stm_ms(stm_since(t)) / NUM_LOAD_BENCHMARK_ITERATIONS;
+    b->arena_heap_allocs = spinearena_stats().num_heap_allocs / NUM_LOAD_BENCHMARK_ITERATIONS;
+}
+
 static void draw_bones(void) {
     if (!sspine_instance_valid(state.instance)) {
         return;
@@ -13,6 +13,8 @@
 #include "sokol_gl.h"
 #include "sokol_glue.h"
 #include "util/fileutil.h"
+#include "util/jobs.h"
+#include "util/spinebatch.h"
 #include "dbgui/dbgui.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -63,6 +65,7 @@ static void init(void) {
         .num_lanes = 1,
         .logger.func = slog_func,
     });
+    jobs_setup(&(jobs_desc_t){0});
     __dbgui_setup();
 
     // setup sokol-gfx pass action to clear screen
@@ -121,17 +124,13 @@ static void frame(void) {
         sgl_end();
     }
 
-    // draw spine instances into different layers
+    // update all spine instances in parallel, and draw them into different layers
     sspine_set_position(state.instances[0], (sspine_vec2){ -225.0f, 128.0f });
-    sspine_update_instance(state.instances[0], delta_time);
-    sspine_draw_instance_in_layer(state.instances[0], 0);
-
     sspine_set_position(state.instances[1], (sspine_vec2){ 0.0f, 128.0f });
-    sspine_update_instance(state.instances[1], delta_time);
-    sspine_draw_instance_in_layer(state.instances[1], 1);
-
     sspine_set_position(state.instances[2], (sspine_vec2){ +225.0f, 128.0f });
-    sspine_update_instance(state.instances[2], delta_time);
+    spinebatch_update_instances(state.instances, NUM_INSTANCES, delta_time);
+    sspine_draw_instance_in_layer(state.instances[0], 0);
+    sspine_draw_instance_in_layer(state.instances[1], 1);
     sspine_draw_instance_in_layer(state.instances[2], 2);
 
     // sokol-gfx render pass, draw the sokol-gl and sokol-spine layers interleaved
@@ -147,6 +146,7 @@ static void frame(void) {
 
 static void cleanup(void) {
     __dbgui_shutdown();
+    jobs_shutdown();
     sfetch_shutdown();
     sgl_shutdown();
     sspine_shutdown();